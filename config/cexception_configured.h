@@ -1,6 +1,7 @@
 #ifndef CONFIG_CEXCEPTION_CONFIGURED_H_
 #define CONFIG_CEXCEPTION_CONFIGURED_H_
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <zlog.h>
@@ -15,6 +16,16 @@
 // The reserved value representing NO EXCEPTION
 #define CEXCEPTION_NONE (0x00)
 
+// Every thread that can Throw() needs its own exception frame stack, otherwise
+// concurrent Try blocks (i.e. the buse worker pool) would longjmp into each
+// other's stack frames. Thread ids are handed out lazily on first use and given
+// back when the thread exits; see blfs_cexception_get_id() in
+// vendor/CException.c
+#define CEXCEPTION_NUM_ID (64)
+#define CEXCEPTION_GET_ID (blfs_cexception_get_id())
+
+unsigned int blfs_cexception_get_id(void);
+
 // A special handler for unhandled exceptions
 #define CEXCEPTION_NO_CATCH_HANDLER(id)                                                     \
 do {                                                                                        \
@@ -285,6 +296,49 @@ do {
 // A cipher switch was triggered when it was unnecessary?!
 #define EXCEPTION_UNNECESSARY_CIPHER_SWITCH 0x56U
 
+// A pthread mutex (or its attributes) failed to initialize
+#define EXCEPTION_LOCK_INIT_FAILURE                     0x57U
+
+// The number of workers passed to --workers was zero or above BLFS_MAX_NUM_WORKERS
+#define EXCEPTION_INVALID_NUM_WORKERS                   0x58U
+
+// fdatasync() on the backstore failed; nothing since the last flush is durable
+#define EXCEPTION_BACKSTORE_SYNC_FAILURE                0x59U
+
+// A helper thread of a pool (see src/pool.h) could not be started
+#define EXCEPTION_POOL_INIT_FAILURE                     0x5AU
+
+// The number passed to --crypt-threads was above BLFS_MAX_NUM_CRYPT_THREADS
+#define EXCEPTION_INVALID_NUM_CRYPT_THREADS             0x5BU
+
+// A --queue-depth, --merge-window, --read-deadline, or --write-deadline value was out of range
+#define EXCEPTION_INVALID_SCHEDULER_SETTING             0x5CU
+
+// pread()/pwrite() on the backstore failed or ran into the end of the file
+#define EXCEPTION_BACKSTORE_IO_FAILURE                  0x5DU
+
+// The string passed to --io-engine does not name an I/O engine
+#define EXCEPTION_STRING_TO_IO_ENGINE_FAILED            0x5EU
+
+// mmap()/munmap() of the backstore failed
+#define EXCEPTION_BACKSTORE_MMAP_FAILURE                0x5FU
+
+// io_uring could not be set up (unsupported or disabled by the kernel)
+#define EXCEPTION_URING_INIT_FAILURE                    0x60U
+
+// O_DIRECT could not be turned on for the backstore (or its size is not block aligned)
+#define EXCEPTION_BACKSTORE_DIRECT_IO_FAILURE           0x61U
+
+// The number passed to --readahead was above BLFS_MAX_READAHEAD_NUGGETS
+#define EXCEPTION_INVALID_READAHEAD                     0x62U
+
+// A stripe member is missing, unexpected, out of order, or belongs to another
+// backstore, or the stripe geometry requested is invalid
+#define EXCEPTION_BAD_STRIPE_MEMBER                     0x63U
+
+// The read-ahead thread (see src/readahead.h) could not be started
+#define EXCEPTION_READAHEAD_INIT_FAILURE                0x64U
+
 ///////////////////////
 // End Configuration //
 ///////////////////////
@@ -9,8 +9,387 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+typedef void (*dirty_serialize_fn)(const void * entry, uint8_t * data);
+typedef void (*dirty_clean_fn)(void * entry, const uint8_t * data);
+
+/**
+ * Where a dirty entry lives in the backstore and how to write it out. Sorting
+ * these (instead of the entries themselves) lets all three kinds be flushed
+ * together, so entries that sit next to each other on disk (a nugget's whole
+ * record, say) always share a write.
+ */
+typedef struct dirty_entry_t
+{
+    uint64_t data_offset;
+    uint64_t data_length;
+    void * entry;
+    dirty_serialize_fn serialize;
+    dirty_clean_fn clean;
+} dirty_entry_t;
+
+/**
+ * Distance between consecutive nuggets' entries of one kind, each entry_length
+ * bytes long. See nugget_record_bytes in backstore.h.
+ */
+static uint64_t nugget_stride(const blfs_backstore_t * backstore, uint64_t entry_length)
+{
+    return backstore->nugget_record_bytes ? backstore->nugget_record_bytes : entry_length;
+}
+
+/**
+ * Allocates the nugget tables' page directory (see blfs_nugget_tables_t in
+ * backstore.h) to cover every nugget the backstore has. Pages come later.
+ */
+static void allocate_nugget_tables(blfs_backstore_t * backstore)
+{
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+    uint64_t num_entries = backstore->num_nuggets;
+
+    IFDEBUG(assert(backstore->md_bytes_per_nugget > 0));
+
+    tables->tj_entry_bytes = CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE);
+    tables->md_entry_bytes = backstore->md_bytes_per_nugget - 1;
+
+    tables->page_bytes = sizeof(blfs_nugget_page_t) + BLFS_TABLE_PAGE_NUGGETS * (2 * sizeof(uint8_t)
+                                                                                + sizeof(blfs_keycount_t)
+                                                                                + sizeof(blfs_tjournal_entry_t)
+                                                                                + sizeof(bitmask_t)
+                                                                                + tables->tj_entry_bytes
+                                                                                + sizeof(blfs_nugget_metadata_t)
+                                                                                + tables->md_entry_bytes);
+
+    tables->max_pages = tables->max_resident_bytes ? MAX(1UL, tables->max_resident_bytes / tables->page_bytes) : UINT64_MAX;
+    tables->num_pages = CEIL(num_entries, (uint64_t) BLFS_TABLE_PAGE_NUGGETS);
+    tables->pages = calloc(tables->num_pages, sizeof *tables->pages);
+
+    if(tables->pages == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    if(pthread_mutex_init(&tables->lock, NULL) != 0)
+        Throw(EXCEPTION_LOCK_INIT_FAILURE);
+
+    tables->num_entries = num_entries;
+
+    IFDEBUG(dzlog_debug("allocated nugget tables for %"PRIu64" nuggets (%"PRIu64" pages)", num_entries, tables->num_pages));
+    IFDEBUG(dzlog_debug("tables->tj_entry_bytes = %"PRIu64, tables->tj_entry_bytes));
+    IFDEBUG(dzlog_debug("tables->md_entry_bytes = %"PRIu64, tables->md_entry_bytes));
+    IFDEBUG(dzlog_debug("tables->page_bytes = %"PRIu64, tables->page_bytes));
+    IFDEBUG(dzlog_debug("tables->max_resident_bytes = %"PRIu64, tables->max_resident_bytes));
+}
+
+/**
+ * Allocates the backstore's nugget tables if this is the first time they are
+ * needed. Not thread safe; see blfs_nugget_tables_t.
+ */
+static blfs_nugget_tables_t * ensure_nugget_tables(blfs_backstore_t * backstore)
+{
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+
+    if(tables->num_entries == 0 && backstore->num_nuggets > 0)
+        allocate_nugget_tables(backstore);
+
+    return tables;
+}
+
+/**
+ * Allocates one (empty) page of the nugget tables.
+ */
+static blfs_nugget_page_t * allocate_nugget_page(const blfs_nugget_tables_t * tables)
+{
+    blfs_nugget_page_t * page = calloc(1, sizeof *page);
+
+    if(page == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    page->loaded = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->loaded);
+    page->created = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->created);
+    page->keycounts = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->keycounts);
+    page->tj_entries = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->tj_entries);
+    page->tj_bitmasks = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->tj_bitmasks);
+    page->tj_slab = calloc(BLFS_TABLE_PAGE_NUGGETS, tables->tj_entry_bytes);
+    page->md_entries = calloc(BLFS_TABLE_PAGE_NUGGETS, sizeof *page->md_entries);
+    page->md_slab = tables->md_entry_bytes ? calloc(BLFS_TABLE_PAGE_NUGGETS, tables->md_entry_bytes) : NULL;
+
+    if(page->loaded == NULL
+       || page->created == NULL
+       || page->keycounts == NULL
+       || page->tj_entries == NULL
+       || page->tj_bitmasks == NULL
+       || page->tj_slab == NULL
+       || page->md_entries == NULL
+       || (page->md_slab == NULL && tables->md_entry_bytes))
+    {
+        Throw(EXCEPTION_ALLOC_FAILURE);
+    }
+
+    return page;
+}
+
+static void free_nugget_page(blfs_nugget_page_t * page)
+{
+    free(page->loaded);
+    free(page->created);
+    free(page->keycounts);
+    free(page->tj_entries);
+    free(page->tj_bitmasks);
+    free(page->tj_slab);
+    free(page->md_entries);
+    free(page->md_slab);
+    free(page);
+}
+
+/**
+ * Returns the page of the backstore's nugget tables holding nugget_index and
+ * sets slot to the nugget's place in it, allocating the tables and the page if
+ * need be. Throws if nugget_index is not in the tables.
+ */
+static blfs_nugget_page_t * get_nugget_page(blfs_backstore_t * backstore, uint64_t nugget_index, uint64_t * slot)
+{
+    blfs_nugget_tables_t * tables = ensure_nugget_tables(backstore);
+
+    if(nugget_index >= tables->num_entries)
+    {
+        IFDEBUG(dzlog_error("EXCEPTION: nugget index %"PRIu64" is not in the nugget tables (%"PRIu64" entries)",
+                            nugget_index, tables->num_entries));
+        Throw(EXCEPTION_OUT_OF_BOUNDS);
+    }
+
+    uint64_t page_index = nugget_index / BLFS_TABLE_PAGE_NUGGETS;
+    blfs_nugget_page_t * page = __atomic_load_n(tables->pages + page_index, __ATOMIC_ACQUIRE);
+
+    // ? Requests for other nuggets on the same page may race us here
+    if(page == NULL)
+    {
+        volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+        pthread_mutex_lock(&tables->lock);
+
+        Try
+        {
+            if(tables->pages[page_index] == NULL)
+            {
+                __atomic_store_n(tables->pages + page_index, allocate_nugget_page(tables), __ATOMIC_RELEASE);
+                __atomic_add_fetch(&tables->resident_pages, 1, __ATOMIC_RELAXED);
+
+                IFDEBUG(dzlog_debug("allocated nugget table page %"PRIu64" (%"PRIu64" resident)",
+                                    page_index, tables->resident_pages));
+            }
+        }
+
+        Catch(e)
+        {
+            pthread_mutex_unlock(&tables->lock);
+            Throw(e);
+        }
+
+        page = tables->pages[page_index];
+        pthread_mutex_unlock(&tables->lock);
+    }
+
+    __atomic_store_n(&page->referenced, TRUE, __ATOMIC_RELAXED);
+
+    *slot = nugget_index % BLFS_TABLE_PAGE_NUGGETS;
+    return page;
+}
+
+static void count_table_access(blfs_backstore_t * backstore, int hit)
+{
+    __atomic_fetch_add(hit ? &backstore->nugget_tables.hits : &backstore->nugget_tables.misses, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Entries are laid out in the slabs using the sizes known when the tables were
+ * allocated; an entry that has since grown would overrun its neighbor.
+ */
+static void ensure_entry_fits(uint64_t entry_length, uint64_t slab_entry_bytes)
+{
+    if(entry_length > slab_entry_bytes)
+    {
+        IFDEBUG(dzlog_error("EXCEPTION: entry of %"PRIu64" bytes does not fit the %"PRIu64" reserved for it",
+                            entry_length, slab_entry_bytes));
+        Throw(EXCEPTION_INVALID_OPERATION);
+    }
+}
+
+static int compare_dirty_entries(const void * a, const void * b)
+{
+    uint64_t lhs = ((const dirty_entry_t *) a)->data_offset;
+    uint64_t rhs = ((const dirty_entry_t *) b)->data_offset;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static void serialize_keycount(const void * entry, uint8_t * data)
+{
+    const blfs_keycount_t * count = entry;
+    memcpy(data, (const uint8_t *) &(count->keycount), count->data_length);
+}
+
+/**
+ * data is what serialize_keycount wrote out. The live keycount may have moved
+ * on since (its nugget lock isn't held while flushing), so it's data that is
+ * on disk, not count->keycount.
+ */
+static void clean_keycount(void * entry, const uint8_t * data)
+{
+    blfs_keycount_t * count = entry;
+
+    memcpy((uint8_t *) &(count->keycount_on_disk), data, count->data_length);
+    count->dirty = FALSE;
+}
+
+static void serialize_nugget_metadata(const void * entry, uint8_t * data)
+{
+    const blfs_nugget_metadata_t * meta = entry;
+
+    IFDEBUG(assert(meta->metadata_length > 0 || meta->metadata == NULL));
+
+    data[0] = BLFS_MD_IDENT_BYTE(meta);
+    memset(data + 1, 0, meta->data_length - 1);
+
+    if(meta->metadata)
+        memcpy(data + 1, meta->metadata, meta->metadata_length);
+}
+
+static void deserialize_ident_byte(blfs_nugget_metadata_t * meta, uint8_t ident_byte)
+{
+    meta->cipher_ident = ident_byte & (uint8_t) ~BLFS_MD_DISCARDED_FLAG;
+    meta->discarded = (ident_byte & BLFS_MD_DISCARDED_FLAG) != 0;
+}
+
+static void clean_nugget_metadata(void * entry, const uint8_t * data)
+{
+    (void) data;
+    ((blfs_nugget_metadata_t *) entry)->dirty = FALSE;
+}
+
+/**
+ * Decides whether a commit can be put off until the next
+ * blfs_commit_dirty_metadata(). If so, entry ends up (once) in dirty_entries.
+ * Returns FALSE if the commit must write through instead.
+ */
+static int defer_commit(blfs_backstore_t * backstore, vector_t * dirty_entries, void * entry, uint8_t * dirty, int deferrable)
+{
+    if(backstore->dirty_lock == NULL || !deferrable)
+        return FALSE;
+
+    int deferred = TRUE;
+
+    pthread_mutex_lock(backstore->dirty_lock);
+
+    if(!*dirty)
+    {
+        if(dirty_entries->count >= BLFS_MAX_DIRTY_METADATA)
+            deferred = FALSE;
+
+        else
+        {
+            vector_add(dirty_entries, entry);
+            *dirty = TRUE;
+        }
+    }
+
+    pthread_mutex_unlock(backstore->dirty_lock);
+    return deferred;
+}
+
+/**
+ * Writes back every dirty entry, sorted by offset, one write per contiguous
+ * run. Entries are only marked clean once all of them are on their way.
+ * Requires backstore->dirty_lock.
+ */
+static void flush_dirty_entries(blfs_backstore_t * backstore)
+{
+    uint32_t num_kcs = backstore->dirty_kcs_counts->count;
+    uint32_t num_mds = backstore->dirty_nugget_md->count;
+    uint32_t num_entries = num_kcs + num_mds;
+
+    if(num_entries == 0)
+        return;
+
+    dirty_entry_t * entries = malloc(num_entries * sizeof *entries);
+
+    if(entries == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    uint64_t total_length = 0;
+    uint32_t e_index = 0;
+
+    for(uint32_t i = 0; i < num_kcs; i++, e_index++)
+    {
+        blfs_keycount_t * count = vector_get(backstore->dirty_kcs_counts, i);
+
+        entries[e_index] = (dirty_entry_t) {
+            count->data_offset, count->data_length, count, serialize_keycount, clean_keycount
+        };
+    }
+
+    for(uint32_t i = 0; i < num_mds; i++, e_index++)
+    {
+        blfs_nugget_metadata_t * meta = vector_get(backstore->dirty_nugget_md, i);
+
+        entries[e_index] = (dirty_entry_t) {
+            meta->data_offset, meta->data_length, meta, serialize_nugget_metadata, clean_nugget_metadata
+        };
+    }
+
+    for(uint32_t i = 0; i < num_entries; i++)
+        total_length += entries[i].data_length;
+
+    qsort(entries, num_entries, sizeof *entries, compare_dirty_entries);
+
+    uint8_t * data = malloc(total_length);
+
+    if(data == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    Try
+    {
+        uint64_t run_start = 0;
+        uint64_t run_end = 0;
+        uint32_t run_first = 0;
+
+        for(uint32_t i = 0; i < num_entries; i++)
+        {
+            entries[i].serialize(entries[i].entry, data + run_end);
+            run_end += entries[i].data_length;
+
+            if(i + 1 == num_entries
+               || entries[i + 1].data_offset != entries[i].data_offset + entries[i].data_length)
+            {
+                IFDEBUG(dzlog_debug("writing back %"PRIu32" entries (%"PRIu64" bytes) at offset %"PRIu64,
+                                    i + 1 - run_first, run_end - run_start, entries[run_first].data_offset));
+
+                blfs_backstore_write(backstore, data + run_start, run_end - run_start, entries[run_first].data_offset);
+
+                run_start = run_end;
+                run_first = i + 1;
+            }
+        }
+    }
+
+    Catch(e)
+    {
+        free(data);
+        free(entries);
+        Throw(e);
+    }
+
+    for(uint64_t i = 0, data_offset = 0; i < num_entries; data_offset += entries[i].data_length, i++)
+        entries[i].clean(entries[i].entry, data + data_offset);
+
+    backstore->dirty_kcs_counts->count = 0;
+    backstore->dirty_nugget_md->count = 0;
+
+    free(data);
+    free(entries);
+}
+
 static blfs_header_t * blfs_generate_header_actual(blfs_backstore_t * backstore,
                                                    uint32_t header_type,
                                                    void(*data_handle)(blfs_backstore_t *, blfs_header_t *))
@@ -188,21 +567,23 @@ blfs_keycount_t * blfs_create_keycount(blfs_backstore_t * backstore, uint64_t nu
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    if(KHASH_CACHE_EXISTS(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, nugget_index))
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+
+    if(page->loaded[slot] & BLFS_TABLE_KEYCOUNT)
     {
-        IFDEBUG(dzlog_error("EXCEPTION: tried to create keycount %"PRIu64" when it already exists in the cache", nugget_index));
+        IFDEBUG(dzlog_error("EXCEPTION: tried to create keycount %"PRIu64" when it already exists in the table", nugget_index));
         Throw(EXCEPTION_INVALID_OPERATION);
     }
 
-    blfs_keycount_t * count = malloc(sizeof *count);
-
-    if(count == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
+    blfs_keycount_t * count = page->keycounts + slot;
 
     count->nugget_index = nugget_index;
-    count->data_offset = backstore->kcs_real_offset + nugget_index * BLFS_HEAD_BYTES_KEYCOUNT;
+    count->data_offset = backstore->kcs_real_offset + nugget_index * nugget_stride(backstore, BLFS_HEAD_BYTES_KEYCOUNT);
     count->data_length = BLFS_HEAD_BYTES_KEYCOUNT;
     count->keycount = 0;
+    count->keycount_on_disk = 0;
+    count->dirty = FALSE;
 
     IFDEBUG(dzlog_debug("created new keycount object"));
     IFDEBUG(dzlog_debug("backstore->kcs_real_offset = %"PRIu64, backstore->kcs_real_offset));
@@ -211,9 +592,10 @@ blfs_keycount_t * blfs_create_keycount(blfs_backstore_t * backstore, uint64_t nu
     IFDEBUG(dzlog_debug("count->data_length = %"PRIu64, count->data_length));
     IFDEBUG(dzlog_debug("count->keycount = %"PRIu64, count->keycount));
 
-    KHASH_CACHE_PUT(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, nugget_index, count);
+    page->loaded[slot] |= BLFS_TABLE_KEYCOUNT;
+    page->created[slot] |= BLFS_TABLE_KEYCOUNT;
 
-    IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was added to the cache", nugget_index));
+    IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was added to the table", nugget_index));
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 
     return count;
@@ -223,32 +605,31 @@ blfs_keycount_t * blfs_open_keycount(blfs_backstore_t * backstore, uint64_t nugg
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    blfs_keycount_t * count;
-    khint64_t khash_itr_key;
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+    blfs_keycount_t * count = page->keycounts + slot;
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, nugget_index)))
+    if(page->loaded[slot] & BLFS_TABLE_KEYCOUNT)
     {
-        count = KHASH_CACHE_GET_WITH_ITRP1(backstore->cache_kcs_counts, khash_itr_key);
-        IFDEBUG(dzlog_debug("CACHE HIT: keycount for nugget id %"PRIu64" was found in the cache", nugget_index));
+        IFDEBUG(dzlog_debug("TABLE HIT: keycount for nugget id %"PRIu64" was found in the table", nugget_index));
+        count_table_access(backstore, TRUE);
     }
 
     else
     {
-        IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was not found in the cache", nugget_index));
-
-        count = malloc(sizeof *count);
-
-        if(count == NULL)
-            Throw(EXCEPTION_ALLOC_FAILURE);
+        IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was not found in the table", nugget_index));
+        count_table_access(backstore, FALSE);
 
         count->nugget_index = nugget_index;
-        count->data_offset = backstore->kcs_real_offset + nugget_index * BLFS_HEAD_BYTES_KEYCOUNT;
+        count->data_offset = backstore->kcs_real_offset + nugget_index * nugget_stride(backstore, BLFS_HEAD_BYTES_KEYCOUNT);
         count->data_length = BLFS_HEAD_BYTES_KEYCOUNT;
 
         uint8_t count_data[count->data_length];
         blfs_backstore_read(backstore, count_data, count->data_length, count->data_offset);
 
         memcpy(&(count->keycount), count_data, count->data_length);
+        count->keycount_on_disk = count->keycount;
+        count->dirty = FALSE;
 
         IFDEBUG(dzlog_debug("opened blfs_keycount_t count object"));
         IFDEBUG(dzlog_debug("backstore->kcs_real_offset = %"PRIu64, backstore->kcs_real_offset));
@@ -259,20 +640,39 @@ blfs_keycount_t * blfs_open_keycount(blfs_backstore_t * backstore, uint64_t nugg
         IFDEBUG(dzlog_debug("count->keycount (as data):"));
         IFDEBUG(hdzlog_debug(&(count->keycount), count->data_length));
 
-        KHASH_CACHE_PUT(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, nugget_index, count);
+        page->loaded[slot] |= BLFS_TABLE_KEYCOUNT;
+        page->created[slot] &= ~BLFS_TABLE_KEYCOUNT;
 
-        IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was added to the cache", nugget_index));
+        IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu64" was added to the table", nugget_index));
     }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return count;
 }
 
-void blfs_commit_keycount(blfs_backstore_t * backstore, const blfs_keycount_t * count)
+/**
+ * Commits count, putting it off until the next blfs_commit_dirty_metadata() if
+ * deferrable allows it.
+ */
+static void commit_keycount(blfs_backstore_t * backstore, blfs_keycount_t * count, int deferrable)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
+    // ! Recovery only ever skips one keycount ahead, so one is all a crash
+    // ! may lose; anything further goes out now (see crash_recovery)
+    if(defer_commit(backstore,
+                    backstore->dirty_kcs_counts,
+                    count,
+                    &count->dirty,
+                    deferrable && count->keycount <= count->keycount_on_disk + 1))
+    {
+        IFDEBUG(dzlog_debug("deferred keycount commit for nugget id %"PRIu32, count->nugget_index));
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
+
     blfs_backstore_write(backstore, (uint8_t *) &(count->keycount), count->data_length, count->data_offset);
+    count->keycount_on_disk = count->keycount;
 
     IFDEBUG(dzlog_debug("committed keycount data to backstore:"));
     IFDEBUG(dzlog_debug("count->nugget_index = %"PRIu32, count->nugget_index));
@@ -285,21 +685,30 @@ void blfs_commit_keycount(blfs_backstore_t * backstore, const blfs_keycount_t *
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
+void blfs_commit_keycount(blfs_backstore_t * backstore, blfs_keycount_t * count)
+{
+    commit_keycount(backstore, count, TRUE);
+}
+
+void blfs_commit_keycount_through(blfs_backstore_t * backstore, blfs_keycount_t * count)
+{
+    commit_keycount(backstore, count, FALSE);
+}
+
 void blfs_close_keycount(blfs_backstore_t * backstore, blfs_keycount_t * count)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    khint64_t khash_itr_key;
+    if(backstore->dirty_lock != NULL && count->dirty)
+        blfs_commit_dirty_metadata(backstore);
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, count->nugget_index)))
-    {
-        IFDEBUG(dzlog_debug("CACHE HIT: keycount for nugget id %"PRIu32" was deleted from the cache", count->nugget_index));
-        KHASH_CACHE_DEL_WITH_ITRP1(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, khash_itr_key);
-    }
+    IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu32" was dropped from the table", count->nugget_index));
 
-    IFDEBUG(dzlog_debug("keycount for nugget id %"PRIu32" is about to be freed...", count->nugget_index));
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, count->nugget_index, &slot);
 
-    free(count);
+    page->loaded[slot] &= ~BLFS_TABLE_KEYCOUNT;
+    page->created[slot] &= ~BLFS_TABLE_KEYCOUNT;
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
@@ -308,22 +717,30 @@ blfs_tjournal_entry_t * blfs_create_tjournal_entry(blfs_backstore_t * backstore,
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    if(KHASH_CACHE_EXISTS(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, nugget_index))
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+
+    if(page->loaded[slot] & BLFS_TABLE_TJ_ENTRY)
     {
-        IFDEBUG(dzlog_error("EXCEPTION: tried to create transaction journal entry %"PRIu64" when it already exists in the cache", nugget_index));
+        IFDEBUG(dzlog_error("EXCEPTION: tried to create transaction journal entry %"PRIu64" when it already exists in the table", nugget_index));
         Throw(EXCEPTION_INVALID_OPERATION);
     }
 
-    blfs_tjournal_entry_t * entry = malloc(sizeof *entry);
-
-    if(entry == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
+    blfs_tjournal_entry_t * entry = page->tj_entries + slot;
 
     IFDEBUG(dzlog_debug("backstore->flakes_per_nugget = %"PRIu32, backstore->flakes_per_nugget));
 
     entry->nugget_index = nugget_index;
     entry->data_length = CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE);
-    entry->data_offset = backstore->tj_real_offset + nugget_index * entry->data_length;
+    entry->data_offset = backstore->tj_real_offset + nugget_index * nugget_stride(backstore, entry->data_length);
+
+    ensure_entry_fits(entry->data_length, backstore->nugget_tables.tj_entry_bytes);
+
+    entry->bitmask = page->tj_bitmasks + slot;
+    entry->bitmask->byte_length = entry->data_length;
+    entry->bitmask->mask = page->tj_slab + slot * backstore->nugget_tables.tj_entry_bytes;
+
+    memset(entry->bitmask->mask, 0, entry->data_length);
 
     IFDEBUG(dzlog_debug("created new blfs_tjournal_entry_t entry object"));
     IFDEBUG(dzlog_debug("backstore->tj_real_offset = %"PRIu64, backstore->tj_real_offset));
@@ -331,9 +748,8 @@ blfs_tjournal_entry_t * blfs_create_tjournal_entry(blfs_backstore_t * backstore,
     IFDEBUG(dzlog_debug("entry->data_offset = %"PRIu64, entry->data_offset));
     IFDEBUG(dzlog_debug("entry->data_length = %"PRIu64, entry->data_length));
 
-    entry->bitmask = bitmask_init(NULL, entry->data_length);
-
-    KHASH_CACHE_PUT(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, nugget_index, entry);
+    page->loaded[slot] |= BLFS_TABLE_TJ_ENTRY;
+    page->created[slot] |= BLFS_TABLE_TJ_ENTRY;
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return entry;
@@ -343,29 +759,31 @@ blfs_tjournal_entry_t * blfs_open_tjournal_entry(blfs_backstore_t * backstore, u
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    blfs_tjournal_entry_t * entry;
-    khint64_t khash_itr_key;
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+    blfs_tjournal_entry_t * entry = page->tj_entries + slot;
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, nugget_index)))
+    if(page->loaded[slot] & BLFS_TABLE_TJ_ENTRY)
     {
-        IFDEBUG(dzlog_debug("CACHE HIT: transaction journal entry for nugget id %"PRIu64" was found in the cache", nugget_index));
-        entry = KHASH_CACHE_GET_WITH_ITRP1(backstore->cache_tj_entries, khash_itr_key);
+        IFDEBUG(dzlog_debug("TABLE HIT: transaction journal entry for nugget id %"PRIu64" was found in the table", nugget_index));
+        count_table_access(backstore, TRUE);
     }
 
     else
     {
-        IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu64" was not found in the cache", nugget_index));
-
-        entry = malloc(sizeof *entry);
-
-        if(entry == NULL)
-            Throw(EXCEPTION_ALLOC_FAILURE);
-
+        IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu64" was not found in the table", nugget_index));
+        count_table_access(backstore, FALSE);
         IFDEBUG(dzlog_debug("backstore->flakes_per_nugget = %"PRIu32, backstore->flakes_per_nugget));
 
         entry->nugget_index = nugget_index;
         entry->data_length = CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE);
-        entry->data_offset = backstore->tj_real_offset + nugget_index * entry->data_length;
+        entry->data_offset = backstore->tj_real_offset + nugget_index * nugget_stride(backstore, entry->data_length);
+
+        ensure_entry_fits(entry->data_length, backstore->nugget_tables.tj_entry_bytes);
+
+        entry->bitmask = page->tj_bitmasks + slot;
+        entry->bitmask->byte_length = entry->data_length;
+        entry->bitmask->mask = page->tj_slab + slot * backstore->nugget_tables.tj_entry_bytes;
 
         IFDEBUG(dzlog_debug("opened blfs_tjournal_entry_t entry object"));
         IFDEBUG(dzlog_debug("backstore->tj_real_offset = %"PRIu64, backstore->tj_real_offset));
@@ -373,24 +791,24 @@ blfs_tjournal_entry_t * blfs_open_tjournal_entry(blfs_backstore_t * backstore, u
         IFDEBUG(dzlog_debug("entry->data_offset = %"PRIu64, entry->data_offset));
         IFDEBUG(dzlog_debug("entry->data_length = %"PRIu64, entry->data_length));
 
-        uint8_t mask_data[entry->data_length];
+        blfs_backstore_read(backstore, entry->bitmask->mask, entry->data_length, entry->data_offset);
 
-        blfs_backstore_read(backstore, mask_data, entry->data_length, entry->data_offset);
-        entry->bitmask = bitmask_init(mask_data, entry->data_length);
+        page->loaded[slot] |= BLFS_TABLE_TJ_ENTRY;
+        page->created[slot] &= ~BLFS_TABLE_TJ_ENTRY;
 
-        KHASH_CACHE_PUT(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, nugget_index, entry);
-
-        IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu64" was added to the cache", nugget_index));
+        IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu64" was added to the table", nugget_index));
     }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return entry;
 }
 
-void blfs_commit_tjournal_entry(blfs_backstore_t * backstore, const blfs_tjournal_entry_t * entry)
+void blfs_commit_tjournal_entry(blfs_backstore_t * backstore, blfs_tjournal_entry_t * entry)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
+    // ! Never deferred: buse_write decides whether a write must rekey by these
+    // ! bits, so a bit lost in a crash would see its flake's keystream reused
     IFDEBUG(dzlog_debug("committing transaction journal entry data to backstore:"));
     IFDEBUG(dzlog_debug("entry->nugget_index = %"PRIu32, entry->nugget_index));
     IFDEBUG(dzlog_debug("entry->data_length (should match below)          = %"PRIu64, entry->data_length));
@@ -409,19 +827,13 @@ void blfs_close_tjournal_entry(blfs_backstore_t * backstore, blfs_tjournal_entry
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    khint64_t khash_itr_key;
+    IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu32" was dropped from the table", entry->nugget_index));
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, entry->nugget_index)))
-    {
-        IFDEBUG(dzlog_debug(
-            "CACHE HIT: transaction journal entry for nugget id %"PRIu32" was deleted from the cache", entry->nugget_index));
-        KHASH_CACHE_DEL_WITH_ITRP1(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, khash_itr_key);
-    }
-
-    IFDEBUG(dzlog_debug("transaction journal entry for nugget id %"PRIu32" is about to be freed...", entry->nugget_index));
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, entry->nugget_index, &slot);
 
-    bitmask_fini(entry->bitmask);
-    free(entry);
+    page->loaded[slot] &= ~BLFS_TABLE_TJ_ENTRY;
+    page->created[slot] &= ~BLFS_TABLE_TJ_ENTRY;
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
@@ -430,27 +842,35 @@ blfs_nugget_metadata_t * blfs_create_nugget_metadata(blfs_backstore_t * backstor
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    if(KHASH_CACHE_EXISTS(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, nugget_index))
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+
+    if(page->loaded[slot] & BLFS_TABLE_METADATA)
     {
-        IFDEBUG(dzlog_error("EXCEPTION: tried to create nugget metadata entry %"PRIu64" when it already exists in the cache", nugget_index));
+        IFDEBUG(dzlog_error("EXCEPTION: tried to create nugget metadata entry %"PRIu64" when it already exists in the table", nugget_index));
         Throw(EXCEPTION_INVALID_OPERATION);
     }
 
-    blfs_nugget_metadata_t * meta = malloc(sizeof *meta);
-
-    if(meta == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
+    blfs_nugget_metadata_t * meta = page->md_entries + slot;
 
     IFDEBUG(dzlog_debug("backstore->md_bytes_per_nugget = %"PRIu32, backstore->md_bytes_per_nugget));
 
     IFDEBUG(assert(backstore->md_bytes_per_nugget > 0));
 
     meta->cipher_ident = backstore->md_default_cipher_ident;
+    meta->discarded = FALSE;
     meta->nugget_index = nugget_index;
     meta->data_length = backstore->md_bytes_per_nugget;
     meta->metadata_length = meta->data_length - 1;
-    meta->data_offset = backstore->md_real_offset + nugget_index * meta->data_length;
-    meta->metadata = meta->metadata_length ? malloc(meta->metadata_length * sizeof *meta->metadata) : NULL;
+    meta->data_offset = backstore->md_real_offset + nugget_index * nugget_stride(backstore, meta->data_length);
+    meta->dirty = FALSE;
+
+    ensure_entry_fits(meta->metadata_length, backstore->nugget_tables.md_entry_bytes);
+
+    meta->metadata = meta->metadata_length ? page->md_slab + slot * backstore->nugget_tables.md_entry_bytes : NULL;
+
+    if(meta->metadata_length)
+        memset(meta->metadata, 0, meta->metadata_length);
 
     IFDEBUG(dzlog_debug("created new blfs_nugget_metadata_t object"));
     IFDEBUG(dzlog_debug("backstore->md_real_offset = %"PRIu64, backstore->md_real_offset));
@@ -461,7 +881,8 @@ blfs_nugget_metadata_t * blfs_create_nugget_metadata(blfs_backstore_t * backstor
     IFDEBUG(dzlog_debug("meta->metadata:"));
     IFDEBUG(hdzlog_debug(meta->metadata, meta->metadata_length));
 
-    KHASH_CACHE_PUT(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, nugget_index, meta);
+    page->loaded[slot] |= BLFS_TABLE_METADATA;
+    page->created[slot] |= BLFS_TABLE_METADATA;
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return meta;
@@ -471,34 +892,30 @@ blfs_nugget_metadata_t * blfs_open_nugget_metadata(blfs_backstore_t * backstore,
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    blfs_nugget_metadata_t * meta;
-    khint64_t khash_itr_key;
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+    blfs_nugget_metadata_t * meta = page->md_entries + slot;
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, nugget_index)))
+    if(page->loaded[slot] & BLFS_TABLE_METADATA)
     {
-        IFDEBUG(dzlog_debug("CACHE HIT: metadata for nugget id %"PRIu64" was found in the cache", nugget_index));
-        meta = KHASH_CACHE_GET_WITH_ITRP1(backstore->cache_nugget_md, khash_itr_key);
+        IFDEBUG(dzlog_debug("TABLE HIT: metadata for nugget id %"PRIu64" was found in the table", nugget_index));
+        count_table_access(backstore, TRUE);
     }
 
     else
     {
-        IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu64" was not found in the cache", nugget_index));
+        IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu64" was not found in the table", nugget_index));
+        count_table_access(backstore, FALSE);
         IFDEBUG(dzlog_debug("(running create first)"));
 
         meta = blfs_create_nugget_metadata(backstore, nugget_index);
 
-        if(meta == NULL)
-            Throw(EXCEPTION_ALLOC_FAILURE);
-
         if(meta->metadata_length)
         {
-            if(meta->metadata == NULL)
-                Throw(EXCEPTION_ALLOC_FAILURE);
-
             uint8_t metadata[meta->data_length];
             blfs_backstore_read(backstore, metadata, meta->data_length, meta->data_offset);
 
-            memcpy(&meta->cipher_ident, metadata, 1);
+            deserialize_ident_byte(meta, metadata[0]);
             memcpy(meta->metadata, metadata + 1, meta->metadata_length);
         }
 
@@ -506,9 +923,12 @@ blfs_nugget_metadata_t * blfs_open_nugget_metadata(blfs_backstore_t * backstore,
         {
             uint8_t ident_data[1];
             blfs_backstore_read(backstore, ident_data, sizeof ident_data, meta->data_offset);
-            memcpy(&meta->cipher_ident, ident_data, sizeof ident_data);
+            deserialize_ident_byte(meta, ident_data[0]);
         }
 
+        // ? It came from the backstore after all
+        page->created[slot] &= ~BLFS_TABLE_METADATA;
+
         IFDEBUG(dzlog_debug("opened blfs_nugget_metadata_t meta object"));
         IFDEBUG(dzlog_debug("backstore->md_real_offset = %"PRIu64, backstore->md_real_offset));
         IFDEBUG(dzlog_debug("meta->nugget_index = %"PRIu32, meta->nugget_index));
@@ -516,6 +936,7 @@ blfs_nugget_metadata_t * blfs_open_nugget_metadata(blfs_backstore_t * backstore,
         IFDEBUG(dzlog_debug("meta->data_length = %"PRIu64, meta->data_length));
         IFDEBUG(dzlog_debug("meta->metadata_length = %"PRIu64, meta->metadata_length));
         IFDEBUG(dzlog_debug("meta->cipher_ident = %"PRIu8, meta->cipher_ident));
+        IFDEBUG(dzlog_debug("meta->discarded = %"PRIu8, meta->discarded));
 
         if(meta->metadata_length)
         {
@@ -523,28 +944,26 @@ blfs_nugget_metadata_t * blfs_open_nugget_metadata(blfs_backstore_t * backstore,
             IFDEBUG(hdzlog_debug(meta->metadata, meta->metadata_length));
         }
 
-        KHASH_CACHE_PUT(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, nugget_index, meta);
-
-        IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu64" was added to the cache", nugget_index));
+        IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu64" was added to the table", nugget_index));
     }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return meta;
 }
 
-void blfs_commit_nugget_metadata(blfs_backstore_t * backstore, const blfs_nugget_metadata_t * meta)
+void blfs_commit_nugget_metadata(blfs_backstore_t * backstore, blfs_nugget_metadata_t * meta)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    uint8_t commit_data[meta->data_length];
-
-    memcpy(commit_data, (uint8_t *) &(meta->cipher_ident), 1);
-    memset(commit_data + 1, 0, (sizeof commit_data) - 1);
-
-    IFDEBUG(assert(meta->metadata_length > 0 || meta->metadata == NULL));
+    if(defer_commit(backstore, backstore->dirty_nugget_md, meta, &meta->dirty, TRUE))
+    {
+        IFDEBUG(dzlog_debug("deferred metadata commit for nugget id %"PRIu32, meta->nugget_index));
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
 
-    if(meta->metadata)
-        memcpy(commit_data + 1, meta->metadata, meta->metadata_length);
+    uint8_t commit_data[meta->data_length];
+    serialize_nugget_metadata(meta, commit_data);
 
     IFDEBUG(dzlog_debug("committing nugget metadata to backstore:"));
     IFDEBUG(dzlog_debug("meta->nugget_index = %"PRIu32, meta->nugget_index));
@@ -573,19 +992,299 @@ void blfs_close_nugget_metadata(blfs_backstore_t * backstore, blfs_nugget_metada
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    khint64_t khash_itr_key;
+    if(backstore->dirty_lock != NULL && meta->dirty)
+        blfs_commit_dirty_metadata(backstore);
+
+    IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu32" was dropped from the table", meta->nugget_index));
+
+    uint64_t slot;
+    blfs_nugget_page_t * page = get_nugget_page(backstore, meta->nugget_index, &slot);
+
+    page->loaded[slot] &= ~BLFS_TABLE_METADATA;
+    page->created[slot] &= ~BLFS_TABLE_METADATA;
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_commit_dirty_metadata(blfs_backstore_t * backstore)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(backstore->dirty_lock == NULL)
+    {
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
+
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
 
-    if((khash_itr_key = KHASH_CACHE_EXISTS(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, meta->nugget_index)))
+    pthread_mutex_lock(backstore->dirty_lock);
+
+    IFDEBUG(dzlog_debug("writing back %"PRIu32" keycount(s), %"PRIu32" metadata entries",
+                        backstore->dirty_kcs_counts->count,
+                        backstore->dirty_nugget_md->count));
+
+    Try
     {
-        IFDEBUG(dzlog_debug(
-            "CACHE HIT: metadata for nugget id %"PRIu32" was deleted from the cache", meta->nugget_index));
-        KHASH_CACHE_DEL_WITH_ITRP1(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, khash_itr_key);
+        flush_dirty_entries(backstore);
     }
 
-    IFDEBUG(dzlog_debug("metadata for nugget id %"PRIu32" is about to be freed...", meta->nugget_index));
+    Catch(e)
+    {
+        pthread_mutex_unlock(backstore->dirty_lock);
+        Throw(e);
+    }
+
+    pthread_mutex_unlock(backstore->dirty_lock);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+/**
+ * Fills in every entry (of the kinds in table_kinds) of the first num_nuggets
+ * nuggets that is not already in the tables from a region of the backstore
+ * that holds stride bytes per nugget, beginning at region_offset. The region
+ * is read BLFS_METADATA_LOAD_CHUNK_BYTES (rounded down to whole nuggets) at a
+ * time.
+ */
+static void load_nugget_region(blfs_backstore_t * backstore,
+                               uint64_t num_nuggets,
+                               uint8_t table_kinds,
+                               uint64_t region_offset,
+                               uint64_t stride)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    uint64_t nuggets_per_chunk = MAX(1UL, BLFS_METADATA_LOAD_CHUNK_BYTES / stride);
+    uint8_t * chunk = malloc(MIN(nuggets_per_chunk, num_nuggets) * stride);
+
+    if(chunk == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    IFDEBUG(dzlog_debug("loading %"PRIu64" nuggets (%"PRIu64" bytes each) from offset %"PRIu64", %"PRIu64" nuggets per read",
+                        num_nuggets, stride, region_offset, nuggets_per_chunk));
+
+    for(uint64_t first_nugget = 0; first_nugget < num_nuggets; first_nugget += nuggets_per_chunk)
+    {
+        uint64_t chunk_nuggets = MIN(nuggets_per_chunk, num_nuggets - first_nugget);
+        blfs_backstore_read(backstore, chunk, chunk_nuggets * stride, region_offset + first_nugget * stride);
+
+        for(uint64_t nugget_index = first_nugget; nugget_index < first_nugget + chunk_nuggets; nugget_index++)
+        {
+            uint64_t slot;
+            blfs_nugget_page_t * page = get_nugget_page(backstore, nugget_index, &slot);
+            uint8_t * nugget_data = chunk + (nugget_index - first_nugget) * stride;
+            uint8_t loaded = page->loaded[slot];
+
+            // ? Anything already in the tables may be newer than what is on disk
+            if((table_kinds & BLFS_TABLE_KEYCOUNT) && !(loaded & BLFS_TABLE_KEYCOUNT))
+            {
+                blfs_keycount_t * count = blfs_create_keycount(backstore, nugget_index);
+
+                memcpy(&(count->keycount), nugget_data + (backstore->kcs_real_offset - region_offset), count->data_length);
+                count->keycount_on_disk = count->keycount;
+            }
+
+            if((table_kinds & BLFS_TABLE_TJ_ENTRY) && !(loaded & BLFS_TABLE_TJ_ENTRY))
+            {
+                blfs_tjournal_entry_t * entry = blfs_create_tjournal_entry(backstore, nugget_index);
+                memcpy(entry->bitmask->mask, nugget_data + (backstore->tj_real_offset - region_offset), entry->data_length);
+            }
+
+            if((table_kinds & BLFS_TABLE_METADATA) && !(loaded & BLFS_TABLE_METADATA))
+            {
+                blfs_nugget_metadata_t * meta = blfs_create_nugget_metadata(backstore, nugget_index);
+                uint8_t * md_data = nugget_data + (backstore->md_real_offset - region_offset);
+
+                deserialize_ident_byte(meta, md_data[0]);
+
+                if(meta->metadata_length)
+                    memcpy(meta->metadata, md_data + 1, meta->metadata_length);
+            }
+
+            page->created[slot] &= ~(table_kinds & ~loaded);
+        }
+    }
+
+    free(chunk);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_load_nugget_tables(blfs_backstore_t * backstore)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_nugget_tables_t * tables = ensure_nugget_tables(backstore);
+
+    if(backstore->num_nuggets == 0)
+    {
+        IFDEBUG(dzlog_debug("no nuggets to load"));
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
+
+    // ? Loading pages only to evict them again would be a waste
+    uint64_t num_nuggets = MIN((uint64_t) backstore->num_nuggets, MIN(tables->max_pages, tables->num_pages) * BLFS_TABLE_PAGE_NUGGETS);
+
+    IFDEBUG(dzlog_debug("loading %"PRIu64" of %"PRIu32" nuggets", num_nuggets, backstore->num_nuggets));
+
+    // ? Each nugget's keycount, TJ entry, and metadata share a record
+    if(backstore->nugget_record_bytes)
+    {
+        load_nugget_region(backstore,
+                           num_nuggets,
+                           BLFS_TABLE_KEYCOUNT | BLFS_TABLE_TJ_ENTRY | BLFS_TABLE_METADATA,
+                           backstore->kcs_real_offset,
+                           backstore->nugget_record_bytes);
+    }
+
+    else
+    {
+        load_nugget_region(backstore, num_nuggets, BLFS_TABLE_KEYCOUNT, backstore->kcs_real_offset, BLFS_HEAD_BYTES_KEYCOUNT);
+        load_nugget_region(backstore,
+                           num_nuggets,
+                           BLFS_TABLE_TJ_ENTRY,
+                           backstore->tj_real_offset,
+                           CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE));
+        load_nugget_region(backstore,
+                           num_nuggets,
+                           BLFS_TABLE_METADATA,
+                           backstore->md_real_offset,
+                           backstore->md_bytes_per_nugget);
+    }
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+int blfs_pick_nugget_page_victim(blfs_backstore_t * backstore, uint64_t * page_index)
+{
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+    int found = FALSE;
+
+    // ? Cheap enough to ask after every request
+    if(tables->max_resident_bytes == 0
+       || __atomic_load_n(&tables->resident_pages, __ATOMIC_RELAXED) <= tables->max_pages)
+    {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&tables->lock);
+
+    // ? Every page gets a second chance, so two sweeps always turn one up
+    for(uint64_t step = 0; step < 2 * tables->num_pages && tables->resident_pages > tables->max_pages; step++)
+    {
+        uint64_t candidate = tables->clock_hand;
+        blfs_nugget_page_t * page = tables->pages[candidate];
+
+        tables->clock_hand = (candidate + 1) % tables->num_pages;
+
+        if(page == NULL || __atomic_exchange_n(&page->referenced, FALSE, __ATOMIC_RELAXED))
+            continue;
+
+        IFDEBUG(dzlog_debug("picked nugget table page %"PRIu64" to evict (%"PRIu64" resident, %"PRIu64" allowed)",
+                            candidate, tables->resident_pages, tables->max_pages));
+
+        *page_index = candidate;
+        found = TRUE;
+        break;
+    }
+
+    pthread_mutex_unlock(&tables->lock);
+    return found;
+}
+
+void blfs_evict_nugget_page(blfs_backstore_t * backstore, uint64_t page_index)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+    blfs_nugget_page_t * page = page_index < tables->num_pages
+                                ? __atomic_load_n(tables->pages + page_index, __ATOMIC_ACQUIRE)
+                                : NULL;
+
+    if(page == NULL)
+    {
+        IFDEBUG(dzlog_debug("nugget table page %"PRIu64" is not resident", page_index));
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
+
+    uint64_t first_nugget = page_index * BLFS_TABLE_PAGE_NUGGETS;
+    uint64_t page_nuggets = MIN((uint64_t) BLFS_TABLE_PAGE_NUGGETS, tables->num_entries - first_nugget);
+    int any_dirty = FALSE;
+
+    for(uint64_t slot = 0; slot < page_nuggets; slot++)
+    {
+        uint8_t loaded = page->loaded[slot];
+        uint8_t created = page->created[slot] & loaded;
+
+        // ? Entries that were only ever created (blfs_run_mode_create) exist
+        // ? nowhere else yet; reading them back in later must find them
+        if(created & BLFS_TABLE_KEYCOUNT)
+            blfs_commit_keycount(backstore, page->keycounts + slot);
+
+        if(created & BLFS_TABLE_TJ_ENTRY)
+            blfs_commit_tjournal_entry(backstore, page->tj_entries + slot);
+
+        if(created & BLFS_TABLE_METADATA)
+            blfs_commit_nugget_metadata(backstore, page->md_entries + slot);
+
+        any_dirty = any_dirty
+                    || ((loaded & BLFS_TABLE_KEYCOUNT) && page->keycounts[slot].dirty)
+                    || ((loaded & BLFS_TABLE_METADATA) && page->md_entries[slot].dirty);
+    }
+
+    // ! The dirty vectors point into the page
+    if(any_dirty)
+        blfs_commit_dirty_metadata(backstore);
+
+    pthread_mutex_lock(&tables->lock);
+
+    __atomic_store_n(tables->pages + page_index, NULL, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&tables->resident_pages, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&tables->lock);
+
+    free_nugget_page(page);
+    __atomic_fetch_add(&tables->evictions, 1, __ATOMIC_RELAXED);
+
+    IFDEBUG(dzlog_debug("evicted nugget table page %"PRIu64" (nuggets %"PRIu64" through %"PRIu64")",
+                        page_index, first_nugget, first_nugget + page_nuggets - 1));
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_get_nugget_table_stats(blfs_backstore_t * backstore, blfs_nugget_table_stats_t * stats)
+{
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+
+    stats->hits = __atomic_load_n(&tables->hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&tables->misses, __ATOMIC_RELAXED);
+    stats->evictions = __atomic_load_n(&tables->evictions, __ATOMIC_RELAXED);
+    stats->resident_bytes = __atomic_load_n(&tables->resident_pages, __ATOMIC_RELAXED) * tables->page_bytes;
+    stats->max_resident_bytes = tables->max_resident_bytes;
+}
+
+void blfs_close_nugget_tables(blfs_backstore_t * backstore)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_nugget_tables_t * tables = &backstore->nugget_tables;
+
+    if(tables->pages != NULL)
+    {
+        for(uint64_t page_index = 0; page_index < tables->num_pages; page_index++)
+        {
+            if(tables->pages[page_index] != NULL)
+                free_nugget_page(tables->pages[page_index]);
+        }
+
+        free(tables->pages);
+        pthread_mutex_destroy(&tables->lock);
+    }
 
-    free(meta->metadata);
-    free(meta);
+    memset(tables, 0, sizeof *tables);
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
@@ -4,6 +4,9 @@
 #include "constants.h"
 #include "khash.h"
 #include "bitmask.h"
+#include "vector.h"
+
+#include <pthread.h>
 
 //////////////////////////
 // Static HEAD ordering //
@@ -76,6 +79,8 @@ typedef struct blfs_header_t
  * @data_offset     data offset in the backstore
  * @data_length     total length of the keycount data in bytes; always 8
  * @keycount        the keycount value in the keystore (not synced)
+ * @keycount_on_disk the keycount value last written to the backstore
+ * @dirty           committed but not yet written back (see blfs_commit_keycount)
  */
 typedef struct blfs_keycount_t
 {
@@ -84,6 +89,8 @@ typedef struct blfs_keycount_t
     uint64_t data_length;
 
     uint64_t keycount;
+    uint64_t keycount_on_disk;
+    uint8_t dirty;
 } blfs_keycount_t;
 
 /**
@@ -117,6 +124,10 @@ typedef struct blfs_tjournal_entry_t
  * @cipher_ident    value corresponding to swappable_cipher_e (see: constants.h)
  * @metadata        metadata_length bytes of data
  * @metadata_length length of metadata bytes; (md_bytes_per_nugget - 1)
+ * @discarded       the nugget's flakes whose TJ bits are clear read as zeros
+ *                  (every flake after creation or a trim); stored as
+ *                  BLFS_MD_DISCARDED_FLAG in the cipher identifier byte
+ * @dirty           committed but not yet written back
  */
 typedef struct blfs_nugget_metadata_t
 {
@@ -127,16 +138,156 @@ typedef struct blfs_nugget_metadata_t
 
     uint8_t cipher_ident;
     uint8_t * metadata;
+    uint8_t discarded;
+    uint8_t dirty;
 } blfs_nugget_metadata_t;
 
+/**
+ * The first byte of a nugget's metadata as it is stored (and hashed).
+ */
+#define BLFS_MD_IDENT_BYTE(meta) ((uint8_t) ((meta)->cipher_ident | ((meta)->discarded ? BLFS_MD_DISCARDED_FLAG : 0)))
+
 ///////////////////////////
 // Cache initializations //
 ///////////////////////////
 
 KHASH_MAP_INIT_INT64(BLFS_KHASH_HEADERS_CACHE_NAME, blfs_header_t*)
-KHASH_MAP_INIT_INT64(BLFS_KHASH_KCS_CACHE_NAME, blfs_keycount_t*)
-KHASH_MAP_INIT_INT64(BLFS_KHASH_TJ_CACHE_NAME, blfs_tjournal_entry_t*)
-KHASH_MAP_INIT_INT64(BLFS_KHASH_MD_CACHE_NAME, blfs_nugget_metadata_t*)
+
+/**
+ * BLFS_TABLE_PAGE_NUGGETS consecutive nuggets' worth of the nugget tables (see
+ * below). A page is allocated (and evicted) as a whole.
+ *
+ * @referenced          set whenever one of the page's entries is opened;
+ *                      cleared as the CLOCK hand passes (second chance)
+ * @loaded              which of a nugget's entries are filled in (BLFS_TABLE_*)
+ * @created             which of them were created rather than read in, i.e.
+ *                      may exist nowhere but here (BLFS_TABLE_*)
+ * @keycounts           BLFS_TABLE_PAGE_NUGGETS keycounts
+ * @tj_entries          BLFS_TABLE_PAGE_NUGGETS TJ entries
+ * @tj_bitmasks         BLFS_TABLE_PAGE_NUGGETS bitmasks, the TJ entries' bitmask fields
+ * @tj_slab             BLFS_TABLE_PAGE_NUGGETS * tj_entry_bytes bytes of TJ bits
+ * @md_entries          BLFS_TABLE_PAGE_NUGGETS nugget metadata entries
+ * @md_slab             BLFS_TABLE_PAGE_NUGGETS * md_entry_bytes bytes of nugget metadata
+ */
+typedef struct blfs_nugget_page_t
+{
+    uint8_t referenced;
+
+    uint8_t * loaded;
+    uint8_t * created;
+
+    blfs_keycount_t * keycounts;
+    blfs_tjournal_entry_t * tj_entries;
+    bitmask_t * tj_bitmasks;
+    uint8_t * tj_slab;
+    blfs_nugget_metadata_t * md_entries;
+    uint8_t * md_slab;
+} blfs_nugget_page_t;
+
+/**
+ * The in-memory keycount store, TJ, and nugget metadata: flat arrays indexed
+ * directly by nugget (nugget indices are dense, so there is nothing to hash),
+ * split into pages of BLFS_TABLE_PAGE_NUGGETS nuggets each. The
+ * blfs_keycount_t, blfs_tjournal_entry_t, and blfs_nugget_metadata_t handed
+ * out by the blfs_create_* and blfs_open_* functions are views into these;
+ * each TJ entry's bitmask points into its page's tj_slab and each nugget's
+ * metadata into its md_slab, so nothing is allocated per nugget.
+ *
+ * The page directory is allocated the first time any entry is asked for (that
+ * is when md_bytes_per_nugget is known), which must happen before requests are
+ * served. A page is allocated the first time one of its entries is asked for,
+ * and an entry is filled in (from the backstore or by create) the first time
+ * it is asked for. Asking for a nugget at or past num_entries throws
+ * EXCEPTION_OUT_OF_BOUNDS.
+ *
+ * If max_resident_bytes is non-zero, pages beyond it are evicted in CLOCK
+ * order (see blfs_pick_nugget_page_victim and blfs_evict_nugget_page). Nothing
+ * is ever evicted behind a caller's back: whoever opens entries is responsible
+ * for evicting pages when (and only when) nothing can be holding entries from
+ * them, so the cap is a soft one. Allocation, eviction, and the counters are
+ * thread safe; a given nugget's entries are only as safe as the nugget's lock.
+ *
+ * @num_entries         nuggets covered (num_nuggets when allocated); 0 until
+ *                      the tables are allocated
+ * @tj_entry_bytes      bytes of tj_slab per nugget
+ * @md_entry_bytes      bytes of md_slab per nugget (md_bytes_per_nugget - 1)
+ * @page_bytes          memory a page occupies
+ * @max_resident_bytes  memory pages may occupy before they are evicted; 0
+ *                      means pages are never evicted. Set before allocation
+ * @max_pages           max_resident_bytes in pages (at least 1)
+ * @lock                guards allocation, eviction, and the CLOCK hand
+ * @num_pages           entries in pages
+ * @pages               the page directory; NULL entries are not resident
+ * @resident_pages      non-NULL entries in pages
+ * @clock_hand          page the next victim search starts at
+ * @hits                entries opened that were already in the tables
+ * @misses              entries opened that had to be read in
+ * @evictions           pages evicted
+ */
+#define BLFS_TABLE_KEYCOUNT     0x01U
+#define BLFS_TABLE_TJ_ENTRY     0x02U
+#define BLFS_TABLE_METADATA     0x04U
+
+typedef struct blfs_nugget_tables_t
+{
+    uint64_t num_entries;
+    uint64_t tj_entry_bytes;
+    uint64_t md_entry_bytes;
+    uint64_t page_bytes;
+    uint64_t max_resident_bytes;
+    uint64_t max_pages;
+
+    pthread_mutex_t lock;
+
+    uint64_t num_pages;
+    blfs_nugget_page_t ** pages;
+    uint64_t resident_pages;
+    uint64_t clock_hand;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} blfs_nugget_tables_t;
+
+/**
+ * A snapshot of the nugget tables' counters; see blfs_get_nugget_table_stats.
+ *
+ * @hits                entries opened that were already in memory
+ * @misses              entries opened that had to be read in
+ * @evictions           pages evicted to stay under the cap
+ * @resident_bytes      memory resident pages occupy
+ * @max_resident_bytes  the cap (0 = unbounded)
+ */
+typedef struct blfs_nugget_table_stats_t
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t resident_bytes;
+    uint64_t max_resident_bytes;
+} blfs_nugget_table_stats_t;
+
+/**
+ * One of the extra files/devices a backstore's body is spread across. Member
+ * 0 is the body device if there is one and the backstore itself (which is not
+ * described by one of these) otherwise. Every member of a striped backstore or
+ * one with a body device ends in a BLFS_STRIPE_LABEL_BYTES label (see
+ * blfs_backstore_create_stripe_members in io.h).
+ *
+ * @file_path           path to the member
+ * @io_fd               read-write descriptor pointing to the member
+ * @file_size_actual    size of the member in bytes, label included
+ * @is_block_device     the member is a raw block device, not a file
+ * @logical_block_bytes smallest unit the device can address (1 for files)
+ */
+typedef struct blfs_stripe_member_t
+{
+    const char * file_path;
+    int io_fd;
+    uint64_t file_size_actual;
+    uint8_t is_block_device;
+    uint32_t logical_block_bytes;
+} blfs_stripe_member_t;
 
 /**
  * This struct and its related functions (in io.h) abstract away a lot of the
@@ -151,13 +302,35 @@ KHASH_MAP_INIT_INT64(BLFS_KHASH_MD_CACHE_NAME, blfs_nugget_metadata_t*)
  * @file_name               backstore file name (limited to 16 characters)
  * @read_fd                 read-only descriptor pointing to backstore file
  * @write_fd                read-write descriptor pointing to backstore file
+ * @format_version          on-disk layout version (the version header)
  * @kcs_real_offset         integer offset to where the keycount store begins
  * @tj_real_offset          integer offset 2 where the TJ begins
+ * @md_real_offset          integer offset to where the nugget metadata begins
+ * @nugget_record_bytes     stride between nuggets' keycount/TJ/metadata if they
+ *                          share a record (format_version 900+); else 0
+ * @epoch_record_offset     where the epoch record is (format_version 901+);
+ *                          else 0
  * @body_real_offset        integer offset to where data BODY (nuggets) begins
+ *                          (where the records end, if body_device is set)
  * @nugget_size_bytes       how big of a region a nugget represents
  * @writeable_size_actual   the actual number of writable bytes (real BODY size)
  * @master_secret           cached secret from KDF, BLFS_CRYPTO_BYTES_KDF_OUT
  * @md_default_cipher_ident cipher value stored for new metadata entries
+ * @is_block_device         the backstore is a raw block device, not a file
+ * @logical_block_bytes     smallest unit the device can address (1 for files)
+ * @physical_block_bytes    unit the device actually writes (st_blksize for files)
+ * @stripe_width            members the body is striped across (0 or 1: none)
+ * @stripe_nuggets          consecutive nuggets on a member before the next
+ * @stripe_members          members 1 through stripe_width - 1
+ * @body_device             where the body goes (as member 0) if the backstore
+ *                          itself holds only headers and records; else NULL
+ * @io_engine               how blfs_backstore_read/write reach the file (io.h)
+ * @mapping                 the whole file mapped shared (ioe_mmap only)
+ * @dirty_lock              guards the dirty_* vectors and every entry's dirty
+ *                          flag; NULL means metadata commits write through
+ * @dirty_kcs_counts        keycounts committed but not yet written back
+ * @dirty_nugget_md         nugget metadata committed but not yet written back
+ * @nugget_tables           every nugget's keycount, TJ entry, and metadata
  */
 typedef struct blfs_backstore_t
 {
@@ -166,9 +339,12 @@ typedef struct blfs_backstore_t
 
     int io_fd;
 
+    uint32_t format_version;
     uint64_t kcs_real_offset;
     uint64_t tj_real_offset;
     uint64_t md_real_offset;
+    uint64_t nugget_record_bytes;
+    uint64_t epoch_record_offset;
     uint64_t body_real_offset;
 
     uint32_t nugget_size_bytes;
@@ -184,10 +360,24 @@ typedef struct blfs_backstore_t
 
     uint8_t md_default_cipher_ident;
 
-    khash_t(BLFS_KHASH_HEADERS_CACHE_NAME)  * cache_headers;
-    khash_t(BLFS_KHASH_KCS_CACHE_NAME)      * cache_kcs_counts;
-    khash_t(BLFS_KHASH_TJ_CACHE_NAME)       * cache_tj_entries;
-    khash_t(BLFS_KHASH_MD_CACHE_NAME)       * cache_nugget_md;
+    uint8_t is_block_device;
+    uint32_t logical_block_bytes;
+    uint32_t physical_block_bytes;
+
+    uint32_t stripe_width;
+    uint32_t stripe_nuggets;
+    blfs_stripe_member_t * stripe_members;
+    blfs_stripe_member_t * body_device;
+
+    io_engine_e io_engine;
+    uint8_t * mapping;
+
+    pthread_mutex_t * dirty_lock;
+    vector_t * dirty_kcs_counts;
+    vector_t * dirty_nugget_md;
+
+    khash_t(BLFS_KHASH_HEADERS_CACHE_NAME) * cache_headers;
+    blfs_nugget_tables_t nugget_tables;
 } blfs_backstore_t;
 
 /////////////////////////
@@ -272,17 +462,35 @@ blfs_keycount_t * blfs_create_keycount(blfs_backstore_t * backstore, uint64_t nu
 blfs_keycount_t * blfs_open_keycount(blfs_backstore_t * backstore, uint64_t nugget_index);
 
 /**
- * Immediately writes the specified keycount to the specified backstore. Throws
- * an error upon failure.
+ * Writes the specified keycount to the specified backstore. Throws an error
+ * upon failure.
+ *
+ * If the backstore has a dirty_lock, the write is deferred to the next
+ * blfs_commit_dirty_metadata() instead, though only while the keycount is at
+ * most one ahead of what is on disk: after a crash, recovery burns exactly one
+ * keycount (see crash_recovery), so that is all that may go missing. Commits
+ * that would put it further ahead (or that would grow the dirty list past
+ * BLFS_MAX_DIRTY_METADATA) write through immediately.
  *
  * @param backstore
  * @param count
  */
-void blfs_commit_keycount(blfs_backstore_t * backstore, const blfs_keycount_t * count);
+void blfs_commit_keycount(blfs_backstore_t * backstore, blfs_keycount_t * count);
 
 /**
- * The specified keycount is free()'d. Be careful calling this. It should rarely
- * if ever be used.
+ * Like blfs_commit_keycount, but never deferred: count is on the backstore
+ * once this returns. Needed before anything written through after it relies
+ * on it, such as TJ bits being cleared for the new keycount.
+ *
+ * @param backstore
+ * @param count
+ */
+void blfs_commit_keycount_through(blfs_backstore_t * backstore, blfs_keycount_t * count);
+
+/**
+ * The specified keycount is dropped from memory (after being written back if
+ * it is dirty) and will be read in again the next time it is opened. count
+ * must not be used afterwards. It should rarely if ever be used.
  *
  * @param backstore
  * @param count
@@ -312,17 +520,19 @@ blfs_tjournal_entry_t * blfs_create_tjournal_entry(blfs_backstore_t * backstore,
 blfs_tjournal_entry_t * blfs_open_tjournal_entry(blfs_backstore_t * backstore, uint64_t nugget_index);
 
 /**
- * Immediately writes the specified TJ entry to the specified backstore. Throws
- * an error upon failure.
+ * Writes the specified TJ entry to the specified backstore. Unlike keycounts
+ * and nugget metadata, TJ entries always write through: a flake whose bit
+ * never reaches the backstore would be overwritten without rekeying after a
+ * crash. Throws an error upon failure.
  *
  * @param backstore
  * @param entry
  */
-void blfs_commit_tjournal_entry(blfs_backstore_t * backstore, const blfs_tjournal_entry_t * entry);
+void blfs_commit_tjournal_entry(blfs_backstore_t * backstore, blfs_tjournal_entry_t * entry);
 
 /**
- * The specified TJ entry is free()'d. Be careful calling this. It should rarely
- * if ever be used.
+ * The specified TJ entry is dropped from memory and will be read in again the next time it is opened. entry
+ * must not be used afterwards. It should rarely if ever be used.
  *
  * @param backstore
  * @param entry
@@ -352,21 +562,100 @@ blfs_nugget_metadata_t * blfs_create_nugget_metadata(blfs_backstore_t * backstor
 blfs_nugget_metadata_t * blfs_open_nugget_metadata(blfs_backstore_t * backstore, uint64_t nugget_index);
 
 /**
- * Immediately writes the specified nugget metadata to the specified backstore.
+ * Writes the specified nugget metadata to the specified backstore, or defers
+ * the write to the next blfs_commit_dirty_metadata() if the backstore has a
+ * dirty_lock (and fewer than BLFS_MAX_DIRTY_METADATA entries are waiting).
  * Throws an error upon failure.
  *
  * @param backstore
  * @param meta
  */
-void blfs_commit_nugget_metadata(blfs_backstore_t * backstore, const blfs_nugget_metadata_t * meta);
+void blfs_commit_nugget_metadata(blfs_backstore_t * backstore, blfs_nugget_metadata_t * meta);
 
 /**
- * The specified nugget metadata is free()'d. Be careful calling this. It should
- * rarely if ever be used.
+ * The specified nugget metadata is dropped from memory (after being written
+ * back if it is dirty) and will be read in again the next time it is opened.
+ * meta must not be used afterwards. It should rarely if ever be used.
  *
  * @param backstore
  * @param meta
  */
 void blfs_close_nugget_metadata(blfs_backstore_t * backstore, blfs_nugget_metadata_t * meta);
 
+/**
+ * Writes back every deferred keycount and nugget metadata commit. They are
+ * sorted by offset and every contiguous run (adjacent nuggets of one kind, in
+ * the older layout) goes out as a single write. In nugget records (see
+ * nugget_record_bytes) a TJ entry separates each keycount from its metadata,
+ * so those two are written apart. Nothing is synced. Does nothing if the
+ * backstore has no dirty_lock. Throws an error upon failure.
+ *
+ * ! With ioe_uring, do not call this inside a batch (see io.h)
+ *
+ * @param backstore
+ */
+void blfs_commit_dirty_metadata(blfs_backstore_t * backstore);
+
+/**
+ * Reads every keycount, TJ entry, and nugget metadata into the backstore's
+ * nugget tables (see blfs_nugget_tables_t) with a few large sequential reads of
+ * at most BLFS_METADATA_LOAD_CHUNK_BYTES each rather than one small read per
+ * entry, so that opening them afterwards never touches the backstore. Entries
+ * already in the tables are left alone. If the tables are capped (see
+ * blfs_nugget_tables_t), only as many leading pages as fit are loaded; the rest
+ * are read in as they are opened. Throws an error upon failure.
+ *
+ * Note that this function requires md_bytes_per_nugget to be set.
+ *
+ * @param backstore
+ */
+void blfs_load_nugget_tables(blfs_backstore_t * backstore);
+
+/**
+ * Returns the index of a page of the backstore's nugget tables (see
+ * blfs_nugget_tables_t) worth evicting, chosen in CLOCK order, if (and only
+ * if) more pages are resident than max_resident_bytes allows. The page is not
+ * evicted; see blfs_evict_nugget_page.
+ *
+ * @param  backstore
+ * @param  page_index   Set to the victim's index
+ *
+ * @return              Non-zero if there is a victim
+ */
+int blfs_pick_nugget_page_victim(blfs_backstore_t * backstore, uint64_t * page_index);
+
+/**
+ * Evicts a page of the backstore's nugget tables: every dirty entry is written
+ * back (see blfs_commit_dirty_metadata), every entry that was created but never
+ * read in is committed, and the page is freed. Does nothing if the page is not
+ * resident. Throws an error upon failure.
+ *
+ * ! Nobody may be holding (or opening) an entry of any nugget in
+ * ! [page_index * BLFS_TABLE_PAGE_NUGGETS, (page_index + 1) * BLFS_TABLE_PAGE_NUGGETS)
+ *
+ * ! With ioe_uring, do not call this inside a batch (see io.h)
+ *
+ * @param backstore
+ * @param page_index
+ */
+void blfs_evict_nugget_page(blfs_backstore_t * backstore, uint64_t page_index);
+
+/**
+ * Fills stats in with the current values of the backstore's nugget table
+ * counters. Thread safe.
+ *
+ * @param backstore
+ * @param stats
+ */
+void blfs_get_nugget_table_stats(blfs_backstore_t * backstore, blfs_nugget_table_stats_t * stats);
+
+/**
+ * Frees the backstore's nugget tables (see blfs_nugget_tables_t) without
+ * writing anything back. Every keycount, TJ entry, and nugget metadata handed
+ * out is invalidated. Called by blfs_backstore_close().
+ *
+ * @param backstore
+ */
+void blfs_close_nugget_tables(blfs_backstore_t * backstore);
+
 #endif /* BLFS_BACKSTORE_H_ */
@@ -218,6 +218,14 @@ int sc_generic_freestyle_write_handle(freestyle_variant variant,
         cipher->output_size_bytes
     );
 
+    uint_fast32_t first_flake = flake_index;
+
+    // ? Every flake is encrypted whole into here, then written out at once
+    uint8_t * flakes_out = malloc((flake_end - flake_index) * flake_size);
+
+    if(flakes_out == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
     for(; flake_index < flake_end; flake_index++)
     {
         uint_fast32_t flake_write_length = MIN(flake_total_bytes_to_write, flake_size - flake_internal_offset);
@@ -243,7 +251,7 @@ int sc_generic_freestyle_write_handle(freestyle_variant variant,
         IFDEBUG(dzlog_debug("flake_end: %"PRIuFAST32, flake_end));
 
         uint8_t flake_data[flake_size];
-        uint8_t flake_out[flake_size];
+        uint8_t * flake_out = flakes_out + (flake_index - first_flake) * flake_size;
         IFDEBUG(memset(flake_data, 0x3D, flake_size));
         IFDEBUG(memset(flake_out, 0x3E, flake_size));
 
@@ -365,14 +373,6 @@ int sc_generic_freestyle_write_handle(freestyle_variant variant,
 
         update_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
 
-        blfs_backstore_write_body(buselfs_state->backstore,
-                                  flake_out,
-                                  flake_size,
-                                  nugget_offset * nugget_size + flake_index * flake_size);
-
-        IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
-        IFDEBUG(hdzlog_debug(flake_out, MIN(64U, flake_size)));
-
         flake_internal_offset = 0;
 
         IFDEBUG(assert(flake_total_bytes_to_write >= flake_write_length));
@@ -381,6 +381,16 @@ int sc_generic_freestyle_write_handle(freestyle_variant variant,
         buffer += flake_write_length;
     }
 
+    blfs_backstore_write_body(buselfs_state->backstore,
+                              flakes_out,
+                              (flake_end - first_flake) * flake_size,
+                              nugget_offset * nugget_size + first_flake * flake_size);
+
+    IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
+    IFDEBUG(hdzlog_debug(flakes_out, MIN(64U, (flake_end - first_flake) * flake_size)));
+
+    free(flakes_out);
+
     assert(meta->metadata_length > 0);
 
     blfs_commit_nugget_metadata(buselfs_state->backstore, meta);
@@ -388,7 +398,7 @@ int sc_generic_freestyle_write_handle(freestyle_variant variant,
     uint8_t data[meta->data_length];
     uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
 
-    memcpy(data, &(meta->cipher_ident), 1);
+    data[0] = BLFS_MD_IDENT_BYTE(meta);
     memcpy(data + 1, meta->metadata, meta->metadata_length);
 
     blfs_chacha20_struct_hash(hash, data, meta->data_length, buselfs_state->backstore->master_secret);
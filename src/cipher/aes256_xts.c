@@ -101,6 +101,13 @@ static int write_handle(const uint8_t * buffer,
     // ! Maybe update and commit the MTRH here first and again later?
     uint_fast32_t flake_total_bytes_to_write = buffer_write_length;
     uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint_fast32_t first_flake = flake_index;
+
+    // ? Every flake is encrypted whole into here, then written out at once
+    uint8_t * flakes_data = malloc((flake_end - flake_index) * flake_size);
+
+    if(flakes_data == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
 
     for(uint_fast32_t i = 0; flake_index < flake_end; flake_index++, i++)
     {
@@ -110,7 +117,7 @@ static int write_handle(const uint8_t * buffer,
         IFDEBUG(dzlog_debug("flake_index: %"PRIuFAST32, flake_index));
         IFDEBUG(dzlog_debug("flake_end: %"PRIuFAST32, flake_end));
 
-        uint8_t flake_data[flake_size];
+        uint8_t * flake_data = flakes_data + i * flake_size;
         IFDEBUG(memset(flake_data, 0x3D, flake_size));
 
         // ! Data to write isn't aligned and/or is smaller than
@@ -197,14 +204,6 @@ static int write_handle(const uint8_t * buffer,
 
         update_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
 
-        blfs_backstore_write_body(buselfs_state->backstore,
-                                  flake_data,
-                                  flake_size,
-                                  nugget_offset * nugget_size + flake_index * flake_size);
-
-        IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
-        IFDEBUG(hdzlog_debug(flake_data, MIN(64U, flake_size)));
-
         flake_internal_offset = 0;
 
         IFDEBUG(assert(flake_total_bytes_to_write >= flake_write_length));
@@ -213,6 +212,16 @@ static int write_handle(const uint8_t * buffer,
         buffer += flake_write_length;
     }
 
+    blfs_backstore_write_body(buselfs_state->backstore,
+                              flakes_data,
+                              (flake_end - first_flake) * flake_size,
+                              nugget_offset * nugget_size + first_flake * flake_size);
+
+    IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
+    IFDEBUG(hdzlog_debug(flakes_data, MIN(64U, (flake_end - first_flake) * flake_size)));
+
+    free(flakes_data);
+
     return buffer - original_buffer;
 }
 
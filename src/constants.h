@@ -5,9 +5,24 @@
 // Configurable //
 //////////////////
 
-#define BLFS_CURRENT_VERSION 820U
+#define BLFS_CURRENT_VERSION 902U
 #define BLFS_LEAST_COMPAT_VERSION 820U
 
+// ? Backstores at least this version keep each nugget's keycount, TJ entry,
+// ? and metadata together in one record (see blfs_backstore_setup_actual_post)
+#define BLFS_NUGGET_RECORDS_VERSION 900U
+#define BLFS_NUGGET_RECORD_ALIGNMENT 1U // records are padded out to a multiple of this (e.g. 512 for one per sector)
+
+// ? Backstores at least this version keep an epoch record between the headers
+// ? and the nugget records (see blfs_backstore_write_epoch_record)
+#define BLFS_EPOCH_RECORD_VERSION 901U
+#define BLFS_EPOCH_RECORD_BYTES (BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER + BLFS_HEAD_HEADER_BYTES_MTRH) // global version + merkle root
+#define BLFS_EPOCH_RECORD_INTERVAL 64U // the record is rewritten on the first and then every this many drains of an epoch
+
+// ? Since version 902, the high bit of the cipher identifier byte of a nugget's
+// ? metadata marks the nugget as discarded (see blfs_nugget_metadata_t)
+#define BLFS_MD_DISCARDED_FLAG 0x80U
+
 // ! These would likely be non-static irl
 #define BLFS_RPMB_KEY "thirtycharactersecurecounterkey!"
 #define BLFS_RPMB_DEVICE "/dev/mmcblk0rpmb"
@@ -15,7 +30,7 @@
 #define BLFS_CONFIG_ZLOG "../config/zlog_conf.conf"
 
 // ! When adding new command line flags, don't forget to update this!
-#define MAX_NUM_ARGC 21
+#define MAX_NUM_ARGC 76
 
 #define VECTOR_GROWTH_FACTOR    2
 #define VECTOR_INIT_SIZE        10
@@ -93,6 +108,15 @@ typedef enum usecase_e {
     uc_no_impl              = 7, // ! Make sure this is always the last one
 } usecase_e;
 
+typedef enum io_engine_e {
+    ioe_default         = 1,
+    ioe_pread           = 1,
+    ioe_mmap            = 2,
+    ioe_uring           = 3,
+    ioe_direct          = 4,
+    ioe_not_impl        = 5, // ! Make sure this is always the last one
+} io_engine_e;
+
 #include <string.h> /* strdup() */
 #include <sys/stat.h>
 
@@ -143,6 +167,7 @@ typedef enum usecase_e {
 #define FALSE 0
 
 #define BITS_IN_A_BYTE 8
+#define BYTES_IN_A_KB 1024
 #define BYTES_IN_A_MB 1048576
 
 #define MIN(a,b) __extension__ ({ __typeof__ (a) _a = (a); __typeof__ (b) _b = (b); _a < _b ? _a : _b; })
@@ -316,6 +341,36 @@ typedef enum usecase_e {
 
 #define BLFS_DELAY_RW_PENALTY_MS                20U // in milliseconds
 
+#define BLFS_DEFAULT_NUM_WORKERS                4U // threads concurrently serving NBD requests (see buse.c)
+#define BLFS_MAX_NUM_WORKERS                    32U // ! must stay below CEXCEPTION_NUM_ID (see config/)
+
+#define BLFS_DEFAULT_NUM_CRYPT_THREADS          0U // helper threads per process that large requests fan out to (0 = off)
+#define BLFS_MAX_NUM_CRYPT_THREADS              16U // ! workers + crypt threads + 1 (read-ahead) must stay below CEXCEPTION_NUM_ID
+
+#define BLFS_DEFAULT_QUEUE_DEPTH                0U // requests buse.c accepts before it stops reading more (0 = 2 per worker, see buse.h)
+#define BLFS_MAX_QUEUE_DEPTH                    1024U
+#define BLFS_DEFAULT_MERGE_WINDOW_KB            128U // contiguous queued writes are merged up to this size (0 = off)
+#define BLFS_MAX_MERGE_WINDOW_KB                1024U // ! every worker keeps a buffer this large
+#define BLFS_DEFAULT_READ_DEADLINE_MS           500U // a read queued this long is served before anything else
+#define BLFS_DEFAULT_WRITE_DEADLINE_MS          5000U // a write queued this long is served ahead of reads
+
+#define BLFS_URING_ENTRIES                      64U // ops one io_uring submission (per thread) can hold
+#define BLFS_DIRECT_IO_ALIGNMENT                4096U // ioe_direct widens accesses out to blocks this large
+#define BLFS_DIRECT_IO_LOCK_STRIPES             64U // locks ioe_direct read-modify-writes are spread over
+#define BLFS_MAX_DIRTY_METADATA                 4096U // deferred commits (of each kind) held before writing through
+#define BLFS_METADATA_LOAD_CHUNK_BYTES          1048576U // blfs_load_nugget_tables reads metadata in chunks this large
+#define BLFS_TABLE_PAGE_NUGGETS                 256U // nuggets whose entries are kept in memory (and evicted) together
+#define BLFS_DEFAULT_METADATA_CACHE_MB          0U // memory nugget metadata may occupy before pages are evicted (0 = unbounded)
+#define BLFS_MAX_EVICTION_ATTEMPTS              8U // pages (all busy) passed over before a request gives up trimming
+#define BLFS_DEFAULT_READAHEAD_NUGGETS          0U // decrypted nuggets sequential reads are read ahead into (0 = off)
+#define BLFS_MAX_READAHEAD_NUGGETS              1024U // ! each one costs a nugget's worth of memory
+#define BLFS_READAHEAD_STREAMS                  8U // concurrent sequential streams tracked
+#define BLFS_READAHEAD_MIN_WINDOW               2U // nuggets a stream is first read ahead by
+#define BLFS_MAX_STRIPE_WIDTH                   16U // files/devices a backstore is striped across, itself included
+#define BLFS_DEFAULT_STRIPE_NUGGETS             1U // consecutive nuggets on one stripe member
+#define BLFS_STRIPE_LABEL_MAGIC                 "SCSTRIPE"
+#define BLFS_STRIPE_LABEL_BYTES                 36U // magic (8) + salt (16) + index, width, nuggets (3x uint32_t)
+
 /////////
 // MMC //
 /////////
@@ -344,9 +399,6 @@ typedef enum usecase_e {
 // of type names!
 // #define BLFS_KHASH_NUGGET_KEY_CACHE_NAME
 // #define BLFS_KHASH_HEADERS_CACHE_NAME
-// #define BLFS_KHASH_KCS_CACHE_NAME
-// #define BLFS_KHASH_TJ_CACHE_NAME
-// #define BLFS_KHASH_MD_CACHE_NAME
 #define BLFS_KHASH_NUGGET_KEY_SIZE_BYTES        100
 
 /**
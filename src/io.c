@@ -5,6 +5,7 @@
  */
 
 #include "io.h"
+#include "uring.h"
 #include "swappable.h"
 
 #include <errno.h>
@@ -15,7 +16,503 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+/**
+ * What each thread batching writes with ioe_uring keeps: its ring and how many
+ * batches deep it currently is.
+ */
+typedef struct io_batch_t
+{
+    blfs_uring_t * ring;
+    uint32_t depth;
+} io_batch_t;
+
+static pthread_key_t io_batch_key;
+static pthread_once_t io_batch_key_once = PTHREAD_ONCE_INIT;
+
+static void free_io_batch(void * arg)
+{
+    io_batch_t * batch = arg;
+
+    blfs_uring_fini(batch->ring);
+    free(batch);
+}
+
+static void create_io_batch_key(void)
+{
+    pthread_key_create(&io_batch_key, free_io_batch);
+}
+
+/**
+ * Returns the calling thread's batch, setting up its ring the first time.
+ */
+static io_batch_t * get_io_batch(void)
+{
+    pthread_once(&io_batch_key_once, create_io_batch_key);
+
+    io_batch_t * batch = pthread_getspecific(io_batch_key);
+
+    if(batch == NULL)
+    {
+        batch = malloc(sizeof *batch);
+
+        if(batch == NULL)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+
+        batch->ring = blfs_uring_init(BLFS_URING_ENTRIES);
+        batch->depth = 0;
+
+        pthread_setspecific(io_batch_key, batch);
+    }
+
+    return batch;
+}
+
+/**
+ * Returns the calling thread's batch if backstore writes are to be queued on
+ * it right now, NULL otherwise.
+ */
+static io_batch_t * open_io_batch(const blfs_backstore_t * backstore)
+{
+    if(backstore->io_engine != ioe_uring)
+        return NULL;
+
+    io_batch_t * batch = get_io_batch();
+    return batch->depth ? batch : NULL;
+}
+
+/**
+ * What each thread doing ioe_direct I/O keeps: an aligned bounce buffer, grown
+ * to fit the largest unaligned access it has seen so far.
+ */
+typedef struct io_bounce_t
+{
+    uint8_t * buffer;
+    uint64_t size;
+} io_bounce_t;
+
+static pthread_key_t io_bounce_key;
+static pthread_once_t io_bounce_key_once = PTHREAD_ONCE_INIT;
+
+// ? Serialize read-modify-writes of the same block (hashed by block number)
+static pthread_mutex_t direct_io_locks[BLFS_DIRECT_IO_LOCK_STRIPES];
+
+static void free_io_bounce(void * arg)
+{
+    io_bounce_t * bounce = arg;
+
+    free(bounce->buffer);
+    free(bounce);
+}
+
+static void create_io_bounce_key(void)
+{
+    pthread_key_create(&io_bounce_key, free_io_bounce);
+
+    for(uint32_t i = 0; i < BLFS_DIRECT_IO_LOCK_STRIPES; i++)
+        pthread_mutex_init(direct_io_locks + i, NULL);
+}
+
+/**
+ * Returns the calling thread's bounce buffer, making sure it holds at least
+ * size bytes. Its contents do not survive growing it.
+ */
+static uint8_t * get_io_bounce(uint64_t size)
+{
+    pthread_once(&io_bounce_key_once, create_io_bounce_key);
+
+    io_bounce_t * bounce = pthread_getspecific(io_bounce_key);
+
+    if(bounce == NULL)
+    {
+        bounce = calloc(1, sizeof *bounce);
+
+        if(bounce == NULL)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+
+        pthread_setspecific(io_bounce_key, bounce);
+    }
+
+    if(bounce->size < size)
+    {
+        void * buffer = NULL;
+
+        free(bounce->buffer);
+        bounce->buffer = NULL;
+        bounce->size = 0;
+
+        if(posix_memalign(&buffer, BLFS_DIRECT_IO_ALIGNMENT, size) != 0)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+
+        bounce->buffer = buffer;
+        bounce->size = size;
+
+        IFDEBUG(dzlog_debug("grew this thread's bounce buffer to %"PRIu64" bytes", size));
+    }
+
+    return bounce->buffer;
+}
+
+/**
+ * pread() until all of length is in buffer. Throws an error upon failure.
+ */
+static void pread_fully(int fd, uint8_t * buffer, uint64_t length, uint64_t offset)
+{
+    while(length > 0)
+    {
+        ssize_t bytes_read = pread64(fd, buffer, length, offset);
+
+        if(bytes_read == -1 && errno == EINTR)
+            continue;
+
+        // ? 0 means we hit EOF: the backstore is shorter than it should be
+        if(bytes_read <= 0)
+        {
+            dzlog_fatal("IO error: read error at offset %"PRIu64": %s",
+                        offset, bytes_read ? strerror(errno) : "unexpected end of file");
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+        }
+
+        length -= bytes_read;
+        buffer += bytes_read;
+        offset += bytes_read;
+    }
+}
+
+/**
+ * pwrite() until all of length is out of buffer. Throws an error upon failure.
+ */
+static void pwrite_fully(int fd, const uint8_t * buffer, uint64_t length, uint64_t offset)
+{
+    while(length > 0)
+    {
+        ssize_t bytes_written = pwrite64(fd, buffer, length, offset);
+
+        if(bytes_written == -1 && errno == EINTR)
+            continue;
+
+        if(bytes_written <= 0)
+        {
+            dzlog_fatal("IO error: write error at offset %"PRIu64": %s",
+                        offset, bytes_written ? strerror(errno) : "no progress");
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+        }
+
+        length -= bytes_written;
+        buffer += bytes_written;
+        offset += bytes_written;
+    }
+}
+
+static int is_direct_io_aligned(const uint8_t * buffer, uint64_t length, uint64_t offset)
+{
+    return (uintptr_t) buffer % BLFS_DIRECT_IO_ALIGNMENT == 0
+        && length % BLFS_DIRECT_IO_ALIGNMENT == 0
+        && offset % BLFS_DIRECT_IO_ALIGNMENT == 0;
+}
+
+/**
+ * O_DIRECT read. Accesses that are not aligned go through the bounce buffer,
+ * widened out to whole blocks.
+ */
+static void read_direct(int fd, uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    if(is_direct_io_aligned(buffer, length, offset))
+    {
+        pread_fully(fd, buffer, length, offset);
+        return;
+    }
+
+    uint64_t start = offset - offset % BLFS_DIRECT_IO_ALIGNMENT;
+    uint64_t end = CEIL(offset + length, BLFS_DIRECT_IO_ALIGNMENT) * BLFS_DIRECT_IO_ALIGNMENT;
+    uint8_t * bounce = get_io_bounce(end - start);
+
+    pread_fully(fd, bounce, end - start, start);
+    memcpy(buffer, bounce + (offset - start), length);
+}
+
+/**
+ * O_DIRECT write. Accesses that are not aligned become a read-modify-write of
+ * the whole blocks they touch. The partial blocks at either end are locked
+ * meanwhile, since e.g. neighbouring keycounts share a block but not a lock
+ * higher up.
+ */
+static void write_direct(int fd, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    if(is_direct_io_aligned(buffer, length, offset))
+    {
+        pwrite_fully(fd, buffer, length, offset);
+        return;
+    }
+
+    uint64_t start = offset - offset % BLFS_DIRECT_IO_ALIGNMENT;
+    uint64_t end = CEIL(offset + length, BLFS_DIRECT_IO_ALIGNMENT) * BLFS_DIRECT_IO_ALIGNMENT;
+    uint64_t last = end - BLFS_DIRECT_IO_ALIGNMENT;
+    uint8_t * bounce = get_io_bounce(end - start);
+
+    // ? fd is mixed in so the members of a striped backstore don't contend
+    uint32_t head_stripe = (start / BLFS_DIRECT_IO_ALIGNMENT + (uint64_t) fd) % BLFS_DIRECT_IO_LOCK_STRIPES;
+    uint32_t tail_stripe = (last / BLFS_DIRECT_IO_ALIGNMENT + (uint64_t) fd) % BLFS_DIRECT_IO_LOCK_STRIPES;
+
+    // ? Always lowest stripe first so two writers can't deadlock
+    pthread_mutex_lock(direct_io_locks + MIN(head_stripe, tail_stripe));
+
+    if(head_stripe != tail_stripe)
+        pthread_mutex_lock(direct_io_locks + MAX(head_stripe, tail_stripe));
+
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    Try
+    {
+        if(start != offset)
+            pread_fully(fd, bounce, BLFS_DIRECT_IO_ALIGNMENT, start);
+
+        if(end != offset + length && (last != start || start == offset))
+            pread_fully(fd, bounce + (last - start), BLFS_DIRECT_IO_ALIGNMENT, last);
+
+        memcpy(bounce + (offset - start), buffer, length);
+        pwrite_fully(fd, bounce, end - start, start);
+    }
+
+    Catch(e)
+    {
+        IFDEBUG(dzlog_error("direct read-modify-write at offset %"PRIu64" threw 0x%x", offset, e));
+    }
+
+    if(head_stripe != tail_stripe)
+        pthread_mutex_unlock(direct_io_locks + MAX(head_stripe, tail_stripe));
+
+    pthread_mutex_unlock(direct_io_locks + MIN(head_stripe, tail_stripe));
+
+    if(e != EXCEPTION_NO_EXCEPTION)
+        Throw(e);
+}
+
+/**
+ * Reads length bytes at (real) offset from fd, which is either the backstore's
+ * own io_fd or one of its stripe members', the way the backstore's io_engine
+ * says to. Throws an error upon failure.
+ */
+static void read_fd(blfs_backstore_t * backstore, int fd, uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    io_batch_t * batch = open_io_batch(backstore);
+
+    // ? Queued writes haven't happened yet; make sure this sees them
+    if(batch != NULL && blfs_uring_overlaps(batch->ring, fd, offset, length))
+        blfs_uring_submit_and_wait(batch->ring);
+
+    // ? Only io_fd is ever mapped (striped backstores can't use ioe_mmap)
+    if(backstore->mapping != NULL && fd == backstore->io_fd)
+    {
+        // ? Past the end of the mapping is SIGBUS, not an error return
+        if(offset > backstore->file_size_actual || length > backstore->file_size_actual - offset)
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+
+        memcpy(buffer, backstore->mapping + offset, length);
+    }
+
+    else if(backstore->io_engine == ioe_direct)
+        read_direct(fd, buffer, length, offset);
+
+    // ? Positional I/O straight into the caller's buffer; workers share fd so
+    // ? its file offset cannot be used
+    else
+        pread_fully(fd, buffer, length, offset);
+}
+
+/**
+ * Writes length bytes at (real) offset to fd. See read_fd.
+ */
+static void write_fd(blfs_backstore_t * backstore, int fd, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    io_batch_t * batch = open_io_batch(backstore);
+
+    if(backstore->mapping != NULL && fd == backstore->io_fd)
+    {
+        if(offset > backstore->file_size_actual || length > backstore->file_size_actual - offset)
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+
+        memcpy(backstore->mapping + offset, buffer, length);
+    }
+
+    else if(batch != NULL)
+        blfs_uring_queue_write(batch->ring, fd, buffer, length, offset);
+
+    else if(backstore->io_engine == ioe_direct)
+        write_direct(fd, buffer, length, offset);
+
+    // ? Positional I/O straight from the caller's buffer; workers share fd so
+    // ? its file offset cannot be used
+    else
+        pwrite_fully(fd, buffer, length, offset);
+}
+
+/**
+ * Returns the backstore file itself described the way a stripe member is.
+ */
+static blfs_stripe_member_t get_backstore_itself(const blfs_backstore_t * backstore)
+{
+    blfs_stripe_member_t backstore_itself = {
+        .file_path           = backstore->file_path,
+        .io_fd               = backstore->io_fd,
+        .file_size_actual    = backstore->file_size_actual,
+        .is_block_device     = backstore->is_block_device,
+        .logical_block_bytes = backstore->logical_block_bytes,
+    };
+
+    return backstore_itself;
+}
+
+/**
+ * Returns member of backstore by value. Member 0 is the body device if the
+ * backstore has one and the backstore itself otherwise.
+ */
+static blfs_stripe_member_t get_stripe_member(const blfs_backstore_t * backstore, uint32_t member)
+{
+    if(member > 0)
+        return backstore->stripe_members[member - 1];
+
+    if(backstore->body_device != NULL)
+        return *backstore->body_device;
+
+    return get_backstore_itself(backstore);
+}
+
+/**
+ * Fills devices with every file/device backstore spans (the backstore itself
+ * first) and returns how many there are.
+ */
+static uint32_t get_devices(const blfs_backstore_t * backstore, blfs_stripe_member_t devices[BLFS_MAX_STRIPE_WIDTH + 1])
+{
+    uint32_t num_devices = 0;
+
+    devices[num_devices++] = get_backstore_itself(backstore);
+
+    for(uint32_t member = backstore->body_device != NULL ? 0 : 1; member < MAX(1U, backstore->stripe_width); member++)
+        devices[num_devices++] = get_stripe_member(backstore, member);
+
+    return num_devices;
+}
+
+/**
+ * Returns where member's share of the body begins within it: right after the
+ * nugget records if it is the backstore itself, else at its very beginning.
+ */
+static uint64_t body_start_on(const blfs_backstore_t * backstore, uint32_t member)
+{
+    return member > 0 || backstore->body_device != NULL ? 0 : backstore->body_real_offset;
+}
+
+/**
+ * Whether the members of backstore end in stripe labels. Only unstriped
+ * backstores that hold their own body have none.
+ */
+static int has_stripe_labels(const blfs_backstore_t * backstore)
+{
+    return backstore->stripe_width > 1 || backstore->body_device != NULL;
+}
+
+/**
+ * Finds where the body byte at offset actually lives: sets member and
+ * real_offset (within that member) and returns how many of the length bytes
+ * from there on are contiguous in it. An unstriped backstore's body is all in
+ * one piece on member 0 (see body_start_on).
+ *
+ * Body chunks of stripe_nuggets nuggets go round robin across the members,
+ * member 0 first.
+ */
+static uint64_t locate_body(const blfs_backstore_t * backstore,
+                            uint64_t offset,
+                            uint64_t length,
+                            uint32_t * member,
+                            uint64_t * real_offset)
+{
+    if(backstore->stripe_width <= 1)
+    {
+        *member = 0;
+        *real_offset = body_start_on(backstore, 0) + offset;
+
+        return length;
+    }
+
+    uint64_t chunk_bytes = (uint64_t) backstore->stripe_nuggets * backstore->nugget_size_bytes;
+    uint64_t chunk = offset / chunk_bytes;
+    uint64_t chunk_offset = offset % chunk_bytes;
+
+    *member = (uint32_t)(chunk % backstore->stripe_width);
+    *real_offset = body_start_on(backstore, *member)
+                   + chunk / backstore->stripe_width * chunk_bytes
+                   + chunk_offset;
+
+    return MIN(length, chunk_bytes - chunk_offset);
+}
+
+/**
+ * Returns how many of the backstore's nuggets live on member.
+ */
+static uint64_t nuggets_on_stripe_member(const blfs_backstore_t * backstore, uint32_t member)
+{
+    uint64_t round_nuggets = (uint64_t) backstore->stripe_nuggets * MAX(1U, backstore->stripe_width);
+    uint64_t leftover = backstore->num_nuggets % round_nuggets;
+    uint64_t before = (uint64_t) member * backstore->stripe_nuggets;
+
+    return backstore->num_nuggets / round_nuggets * backstore->stripe_nuggets
+           + (leftover > before ? MIN(leftover - before, (uint64_t) backstore->stripe_nuggets) : 0);
+}
+
+/**
+ * Reads length bytes at (real) offset from member. If member is the backstore
+ * itself, this goes through blfs_backstore_read like everything else in the
+ * backstore file does.
+ */
+static void read_stripe_member(blfs_backstore_t * backstore, uint32_t member, uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    if(member == 0 && backstore->body_device == NULL)
+        blfs_backstore_read(backstore, buffer, length, offset);
+
+    else
+    {
+        IFDEBUG(dzlog_debug("reading %"PRIu32" bytes at %"PRIu64" from stripe member %"PRIu32, length, offset, member));
+        read_fd(backstore, get_stripe_member(backstore, member).io_fd, buffer, length, offset);
+    }
+}
+
+/**
+ * Writes length bytes at (real) offset to member. See read_stripe_member.
+ */
+static void write_stripe_member(blfs_backstore_t * backstore, uint32_t member, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    if(member == 0 && backstore->body_device == NULL)
+        blfs_backstore_write(backstore, buffer, length, offset);
+
+    else
+    {
+        IFDEBUG(dzlog_debug("writing %"PRIu32" bytes at %"PRIu64" to stripe member %"PRIu32, length, offset, member));
+        write_fd(backstore, get_stripe_member(backstore, member).io_fd, buffer, length, offset);
+    }
+}
+
+/**
+ * Writes length zeros at (real) offset in member.
+ */
+static void write_zeros(blfs_backstore_t * backstore, uint32_t member, uint64_t offset, uint64_t length)
+{
+    if(length == 0)
+        return;
+
+    uint8_t * zeros = calloc(length, sizeof *zeros);
+
+    if(zeros == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    write_stripe_member(backstore, member, zeros, length, offset);
+    free(zeros);
+}
 
 /**
  * Get a filename from a path.
@@ -51,353 +548,1095 @@ static const char * get_filename_from_path(const char * path, int max_length)
 }
 
 /**
- * Actually does the creating and initializing of a backstore struct instance.
- *
- * @param  path
+ * Whether backstore keeps each nugget's keycount, TJ entry, and metadata in
+ * one record.
  */
-static blfs_backstore_t * backstore_setup_actual_pre(const char * path)
+static int has_nugget_records(const blfs_backstore_t * backstore)
 {
-    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
-    IFDEBUG(dzlog_debug("creating new blfs_backstore_t backstore object"));
+    return backstore->format_version >= BLFS_NUGGET_RECORDS_VERSION;
+}
 
-    char * fpath = strdup(path);
+/**
+ * Whether backstore keeps an epoch record right after its headers.
+ */
+static int has_epoch_record(const blfs_backstore_t * backstore)
+{
+    return backstore->format_version >= BLFS_EPOCH_RECORD_VERSION;
+}
 
-    blfs_backstore_t init = {
-        .file_path        = fpath,
-        .file_name        = get_filename_from_path(fpath, BLFS_BACKSTORE_FILENAME_MAXLEN),
-        .cache_headers    = kh_init(BLFS_KHASH_HEADERS_CACHE_NAME),
-        .cache_kcs_counts = kh_init(BLFS_KHASH_KCS_CACHE_NAME),
-        .cache_tj_entries = kh_init(BLFS_KHASH_TJ_CACHE_NAME),
-        .cache_nugget_md  = kh_init(BLFS_KHASH_MD_CACHE_NAME),
-    };
+/**
+ * Finds out the size (and block sizes) of the backstore file or block device
+ * open at fd. Throws an error upon failure.
+ */
+static void probe_backstore_file(int fd,
+                                 const char * path,
+                                 uint64_t * file_size_actual,
+                                 uint8_t * is_block_device,
+                                 uint32_t * logical_block_bytes,
+                                 uint32_t * physical_block_bytes)
+{
+    struct stat backstore_stat;
+
+    if(fstat(fd, &backstore_stat) == -1)
+        Throw(EXCEPTION_OPEN_FAILURE);
+
+    *is_block_device = S_ISBLK(backstore_stat.st_mode);
+
+    // ? A partition or LV has no file size to speak of; the device knows its
+    // ? own size and block sizes
+    if(*is_block_device)
+    {
+        int device_logical_block_bytes = 0;
+        unsigned int device_physical_block_bytes = 0;
+
+        if(ioctl(fd, BLKGETSIZE64, file_size_actual) == -1
+           || ioctl(fd, BLKSSZGET, &device_logical_block_bytes) == -1
+           || ioctl(fd, BLKPBSZGET, &device_physical_block_bytes) == -1)
+        {
+            dzlog_fatal("IO error: could not query block device %s: %s", path, strerror(errno));
+            Throw(EXCEPTION_OPEN_FAILURE);
+        }
+
+        *logical_block_bytes = (uint32_t) device_logical_block_bytes;
+        *physical_block_bytes = device_physical_block_bytes;
+    }
+
+    else
+    {
+        off64_t backstore_size_actual_int = lseek64(fd, 0, SEEK_END);
+
+        if(backstore_size_actual_int < 0)
+        {
+            IFDEBUG(dzlog_fatal("strange..."));
+            Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+        }
+
+        *file_size_actual = (uint64_t) backstore_size_actual_int;
+        *logical_block_bytes = 1;
+        *physical_block_bytes = (uint32_t) backstore_stat.st_blksize;
+    }
+}
+
+/**
+ * Actually does the creating and initializing of a backstore struct instance.
+ *
+ * @param  path
+ */
+static blfs_backstore_t * backstore_setup_actual_pre(const char * path)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+    IFDEBUG(dzlog_debug("creating new blfs_backstore_t backstore object"));
+
+    char * fpath = strdup(path);
+
+    blfs_backstore_t init = {
+        .file_path        = fpath,
+        .file_name        = get_filename_from_path(fpath, BLFS_BACKSTORE_FILENAME_MAXLEN),
+        .cache_headers    = kh_init(BLFS_KHASH_HEADERS_CACHE_NAME),
+        .format_version   = BLFS_CURRENT_VERSION,
+        .stripe_width     = 1,
+        .stripe_nuggets   = BLFS_DEFAULT_STRIPE_NUGGETS,
+        .stripe_members   = NULL,
+        .body_device      = NULL,
+        .io_engine        = ioe_pread,
+        .mapping          = NULL,
+    };
+
+    IFDEBUG(dzlog_debug("init->file_path = %s", init.file_path));
+    IFDEBUG(dzlog_debug("init->file_name = %s", init.file_name));
+
+    blfs_backstore_t * backstore = malloc(sizeof *backstore);
+
+    if(backstore == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    memcpy(backstore, &init, sizeof *backstore);
+
+    backstore->dirty_lock = malloc(sizeof *backstore->dirty_lock);
+
+    if(backstore->dirty_lock == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    if(pthread_mutex_init(backstore->dirty_lock, NULL) != 0)
+        Throw(EXCEPTION_LOCK_INIT_FAILURE);
+
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    backstore->io_fd = open(backstore->file_path, O_CREAT | O_RDWR, BLFS_DEFAULT_BACKSTORE_FILE_PERMS);
+
+    if(backstore->io_fd < 0)
+        Throw(EXCEPTION_OPEN_FAILURE);
+
+    probe_backstore_file(backstore->io_fd,
+                         backstore->file_path,
+                         &backstore->file_size_actual,
+                         &backstore->is_block_device,
+                         &backstore->logical_block_bytes,
+                         &backstore->physical_block_bytes);
+
+    IFDEBUG(dzlog_debug("backstore->is_block_device = %"PRIu8, backstore->is_block_device));
+    IFDEBUG(dzlog_debug("backstore->logical_block_bytes = %"PRIu32, backstore->logical_block_bytes));
+    IFDEBUG(dzlog_debug("backstore->physical_block_bytes = %"PRIu32, backstore->physical_block_bytes));
+
+    IFDEBUG(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+
+    return backstore;
+}
+
+void blfs_backstore_setup_actual_post(blfs_backstore_t * backstore)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    // ! get the last item in the header (before the start of the kcs) and
+    // ! use its offset + length to determine the true length of the HEAD header
+    blfs_header_t * header_last = blfs_open_header(backstore, header_types_ordered[BLFS_HEAD_NUM_HEADERS - 1][0]);
+
+    // We need to know the number of nuggets to calculate the other offsets
+    blfs_header_t * header_numnuggets = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_NUMNUGGETS);
+    backstore->num_nuggets = *((uint32_t *) header_numnuggets->data);
+
+    IFDEBUG(dzlog_debug("backstore->num_nuggets = %"PRIu32, backstore->num_nuggets));
+
+    // We also need to know the number of flakes per nugget
+    blfs_header_t * header_flakespernugget = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESPERNUGGET);
+    backstore->flakes_per_nugget = *((uint32_t *) header_flakespernugget->data);
+
+    IFDEBUG(dzlog_debug("backstore->flakes_per_nugget = %"PRIu32, backstore->flakes_per_nugget));
+
+    // And finally, we need the individual byte size of each flake
+    blfs_header_t * header_flakesizebytes = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES);
+    backstore->flake_size_bytes = *((uint32_t *) header_flakesizebytes->data);
+
+    IFDEBUG(dzlog_debug("backstore->flake_size_bytes = %"PRIu32, backstore->flake_size_bytes));
+    IFDEBUG(dzlog_debug("header_last->data_length = %"PRIu64, header_last->data_length));
+
+    uint64_t head_end = header_last->data_offset + header_last->data_length;
+    uint64_t tj_bytes_per_nugget = CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE);
+
+    IFDEBUG(dzlog_debug("backstore->format_version = %"PRIu32, backstore->format_version));
+
+    backstore->epoch_record_offset = 0;
+
+    if(has_epoch_record(backstore))
+    {
+        backstore->epoch_record_offset = head_end;
+        head_end += BLFS_EPOCH_RECORD_BYTES;
+    }
+
+    IFDEBUG(dzlog_debug("backstore->epoch_record_offset = %"PRIu64, backstore->epoch_record_offset));
+
+    // ? Older backstores keep all keycounts, then all TJ entries, then all
+    // ? metadata; newer ones give each nugget one record holding all three, so
+    // ? the offsets below are those of nugget 0's (see nugget_record_bytes)
+    if(has_nugget_records(backstore))
+    {
+        backstore->kcs_real_offset = CEIL(head_end, (uint64_t) BLFS_NUGGET_RECORD_ALIGNMENT) * BLFS_NUGGET_RECORD_ALIGNMENT;
+        backstore->tj_real_offset  = backstore->kcs_real_offset + BLFS_HEAD_BYTES_KEYCOUNT;
+        backstore->md_real_offset  = backstore->tj_real_offset + tj_bytes_per_nugget;
+    }
+
+    else
+    {
+        backstore->kcs_real_offset = head_end;
+        backstore->tj_real_offset  = backstore->kcs_real_offset + backstore->num_nuggets * BLFS_HEAD_BYTES_KEYCOUNT;
+        backstore->md_real_offset  = backstore->tj_real_offset + backstore->num_nuggets * tj_bytes_per_nugget;
+    }
+
+    IFDEBUG(dzlog_debug("backstore->kcs_real_offset = %"PRIu64, backstore->kcs_real_offset));
+    IFDEBUG(dzlog_debug("backstore->tj_real_offset = %"PRIu64, backstore->tj_real_offset));
+    IFDEBUG(dzlog_debug("backstore->md_real_offset = %"PRIu64, backstore->tj_real_offset));
+}
+
+void blfs_backstore_setup_actual_finish(blfs_backstore_t * backstore)
+{
+    if(has_nugget_records(backstore))
+    {
+        backstore->nugget_record_bytes = blfs_backstore_nugget_record_bytes(backstore->flakes_per_nugget,
+                                                                            backstore->md_bytes_per_nugget);
+
+        backstore->body_real_offset = backstore->kcs_real_offset + backstore->num_nuggets * backstore->nugget_record_bytes;
+    }
+
+    else
+    {
+        backstore->nugget_record_bytes = 0;
+        backstore->body_real_offset = backstore->md_real_offset + backstore->num_nuggets * backstore->md_bytes_per_nugget;
+    }
+
+    IFDEBUG(dzlog_debug("backstore->nugget_record_bytes = %"PRIu64, backstore->nugget_record_bytes));
+    IFDEBUG(dzlog_debug("backstore->body_real_offset = %"PRIu64, backstore->body_real_offset));
+
+    backstore->nugget_size_bytes = backstore->flakes_per_nugget * backstore->flake_size_bytes;
+    IFDEBUG(dzlog_debug("backstore->nugget_size_bytes = %"PRIu32, backstore->nugget_size_bytes));
+
+    backstore->writeable_size_actual = backstore->num_nuggets * backstore->nugget_size_bytes;
+    IFDEBUG(dzlog_debug("file_size_actual - body_real_offset => %"PRId64, ((int64_t) backstore->file_size_actual) - ((int64_t) backstore->body_real_offset)));
+    IFDEBUG(dzlog_debug("backstore->writeable_size_actual = %"PRIu64, backstore->writeable_size_actual));
+
+    if(!has_stripe_labels(backstore))
+    {
+        if(backstore->writeable_size_actual > backstore->file_size_actual - backstore->body_real_offset)
+            Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+    }
+
+    // ? Each member only has to fit its own share of the body (see locate_body)
+    // ? and the backstore its records, whether or not it holds any body
+    else
+    {
+        if(backstore->body_real_offset > backstore->file_size_actual)
+            Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+
+        for(uint32_t member = 0; member < MAX(1U, backstore->stripe_width); member++)
+        {
+            uint64_t body_bytes = nuggets_on_stripe_member(backstore, member) * backstore->nugget_size_bytes;
+            uint64_t available = blfs_backstore_stripe_member_bytes(backstore, member);
+            uint64_t body_start = body_start_on(backstore, member);
+
+            IFDEBUG(dzlog_debug("stripe member %"PRIu32" holds %"PRIu64" body bytes", member, body_bytes));
+
+            if(available < body_start || body_bytes > available - body_start)
+                Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+        }
+    }
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+uint64_t blfs_backstore_nugget_record_bytes(uint32_t flakes_per_nugget, uint32_t md_bytes_per_nugget)
+{
+    uint64_t record_bytes = BLFS_HEAD_BYTES_KEYCOUNT + CEIL(flakes_per_nugget, BITS_IN_A_BYTE) + md_bytes_per_nugget;
+    return CEIL(record_bytes, (uint64_t) BLFS_NUGGET_RECORD_ALIGNMENT) * BLFS_NUGGET_RECORD_ALIGNMENT;
+}
+
+blfs_backstore_t * blfs_backstore_create(const char * path, uint64_t file_size_bytes)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    struct stat path_stat;
+
+    // ? Block devices always exist; they're overwritten instead
+    if(stat(path, &path_stat) != -1 && !S_ISBLK(path_stat.st_mode))
+        Throw(EXCEPTION_FILE_ALREADY_EXISTS);
+
+    blfs_backstore_t * backstore = backstore_setup_actual_pre(path);
+
+    if(backstore->is_block_device)
+    {
+        dzlog_notice("%s is a block device; using all %"PRIu64" bytes of it (requested %"PRIu64")",
+                     path, backstore->file_size_actual, file_size_bytes);
+    }
+
+    else
+    {
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wunused-result"
+
+        ftruncate(backstore->io_fd, file_size_bytes);
+        backstore->file_size_actual = file_size_bytes;
+
+        #pragma GCC diagnostic pop
+    }
+
+    // Header data
+    uint64_t data_version_int = BLFS_CURRENT_VERSION;
+    uint8_t * data_version = (uint8_t *) &data_version_int;
+
+    IFDEBUG(dzlog_debug("data_version = %"PRIu64, data_version_int));
+    IFDEBUG(dzlog_debug("data_version:"));
+    IFDEBUG(hdzlog_debug(data_version, BLFS_HEAD_HEADER_BYTES_VERSION));
+
+    uint8_t data_salt[BLFS_HEAD_HEADER_BYTES_SALT];
+    uint8_t data_mtrh[BLFS_HEAD_HEADER_BYTES_MTRH];
+    uint8_t data_tpmglobalver[BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER];
+    uint8_t data_verification[BLFS_HEAD_HEADER_BYTES_VERIFICATION];
+    uint8_t data_numnuggets[BLFS_HEAD_HEADER_BYTES_NUMNUGGETS];
+    uint8_t data_flakespernugget[BLFS_HEAD_HEADER_BYTES_FLAKESPERNUGGET];
+    uint8_t data_flakesizebytes[BLFS_HEAD_HEADER_BYTES_FLAKESIZE_BYTES];
+    uint8_t data_initialized[BLFS_HEAD_HEADER_BYTES_INITIALIZED];
+
+    memset(data_salt, 0, BLFS_HEAD_HEADER_BYTES_SALT);
+    memset(data_mtrh, 0, BLFS_HEAD_HEADER_BYTES_MTRH);
+    memset(data_tpmglobalver, 0, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
+    memset(data_verification, 0, BLFS_HEAD_HEADER_BYTES_VERIFICATION);
+    memset(data_numnuggets, 0, BLFS_HEAD_HEADER_BYTES_NUMNUGGETS);
+    memset(data_flakespernugget, 0, BLFS_HEAD_HEADER_BYTES_FLAKESPERNUGGET);
+    memset(data_flakesizebytes, 0, BLFS_HEAD_HEADER_BYTES_FLAKESIZE_BYTES);
+    memset(data_initialized, 0, BLFS_HEAD_HEADER_BYTES_INITIALIZED);
+
+    data_tpmglobalver[0] = 0x01;
+
+    // Initialize headers (add them to cache so further opens don't hit disk)
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_VERSION, data_version);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT, data_salt);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_MTRH, data_mtrh);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER, data_tpmglobalver);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_VERIFICATION, data_verification);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_NUMNUGGETS, data_numnuggets);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESPERNUGGET, data_flakespernugget);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES, data_flakesizebytes);
+    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED, data_initialized);
+
+    backstore->kcs_real_offset = 0;
+    backstore->tj_real_offset = 0;
+    backstore->md_real_offset = 0;
+    backstore->nugget_record_bytes = 0;
+    backstore->epoch_record_offset = 0;
+    backstore->body_real_offset = 0;
+    backstore->nugget_size_bytes = 0;
+    backstore->flake_size_bytes = 0;
+    backstore->writeable_size_actual = 0;
+    backstore->md_bytes_per_nugget = 1;
+    backstore->num_nuggets = 0;
+    backstore->flakes_per_nugget = 0;
+    backstore->md_default_cipher_ident = 0;
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+
+    return backstore;
+}
+
+blfs_backstore_t * blfs_backstore_open(const char * path)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(access(path, F_OK) == -1)
+        Throw(EXCEPTION_FILE_DOES_NOT_EXIST);
+
+    blfs_backstore_t * backstore = backstore_setup_actual_pre(path);
+
+    // Make sure the backstore has been initialized
+    blfs_header_t * header_initialized = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED);
+    uint8_t is_initized = *(header_initialized->data);
+
+    IFDEBUG(dzlog_debug("is_initized (%"PRIu8" || %"PRIu8" == initialized) = %"PRIu8,
+                        (uint8_t) BLFS_HEAD_IS_INITIALIZED_VALUE, (uint8_t) BLFS_HEAD_WAS_WIPED_VALUE, is_initized));
+
+    if(is_initized != (uint8_t) BLFS_HEAD_IS_INITIALIZED_VALUE && is_initized != (uint8_t) BLFS_HEAD_WAS_WIPED_VALUE)
+        Throw(EXCEPTION_BACKSTORE_NOT_INITIALIZED);
+
+    // Make sure the version is, if not the same as ours, at least compatible
+    // (and not from a newer build whose layout we don't know)
+    blfs_header_t * header_version = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_VERSION);
+    uint32_t their_version = *((uint32_t *) header_version->data);
+
+    IFDEBUG(dzlog_debug("their_version = %"PRIu32, their_version));
+    IFDEBUG(dzlog_debug("BLFS_CURRENT_VERSION = %"PRIu32, BLFS_CURRENT_VERSION));
+    IFDEBUG(dzlog_debug("BLFS_LEAST_COMPAT_VERSION = %"PRIu32, BLFS_LEAST_COMPAT_VERSION));
+
+    if(their_version > BLFS_CURRENT_VERSION || their_version < BLFS_LEAST_COMPAT_VERSION)
+        Throw(EXCEPTION_INCOMPAT_BACKSTORE_VERSION);
+
+    backstore->format_version = their_version;
+
+    blfs_backstore_setup_actual_post(backstore);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+
+    return backstore;
+}
+
+/**
+ * Opens (or, if create is non-zero, creates) the stripe member at path. Files
+ * being created are emptied and sized to file_size_bytes. Throws an error upon
+ * failure.
+ */
+static void open_stripe_member(blfs_stripe_member_t * member, const char * path, int create, uint64_t file_size_bytes)
+{
+    uint32_t physical_block_bytes = 0;
+
+    member->file_path = strdup(path);
+    member->io_fd = open(path, create ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR, BLFS_DEFAULT_BACKSTORE_FILE_PERMS);
+
+    if(member->io_fd < 0)
+    {
+        dzlog_fatal("IO error: could not open stripe member %s: %s", path, strerror(errno));
+        Throw(EXCEPTION_OPEN_FAILURE);
+    }
+
+    probe_backstore_file(member->io_fd,
+                         path,
+                         &member->file_size_actual,
+                         &member->is_block_device,
+                         &member->logical_block_bytes,
+                         &physical_block_bytes);
+
+    if(create && !member->is_block_device)
+    {
+        if(ftruncate(member->io_fd, file_size_bytes) == -1)
+            Throw(EXCEPTION_OPEN_FAILURE);
+
+        member->file_size_actual = file_size_bytes;
+    }
+
+    IFDEBUG(dzlog_debug("stripe member %s: %"PRIu64" bytes", path, member->file_size_actual));
+
+    if(member->file_size_actual < BLFS_STRIPE_LABEL_BYTES)
+        Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+}
+
+/**
+ * Writes the stripe label to the last BLFS_STRIPE_LABEL_BYTES of member: the
+ * magic, the backstore's salt (so members can't be mixed up with another
+ * backstore's), then member's index, the stripe width, and stripe_nuggets.
+ */
+static void write_stripe_label(blfs_backstore_t * backstore, uint32_t member, const uint8_t * salt)
+{
+    uint8_t label[BLFS_STRIPE_LABEL_BYTES] = { 0x00 };
+
+    // ! this is DEFINITELY endian-sensitive!!!
+    uint32_t geometry[3] = { member, backstore->stripe_width, backstore->stripe_nuggets };
+
+    memcpy(label, BLFS_STRIPE_LABEL_MAGIC, sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1);
+    memcpy(label + sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1, salt, BLFS_HEAD_HEADER_BYTES_SALT);
+    memcpy(label + sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1 + BLFS_HEAD_HEADER_BYTES_SALT, geometry, sizeof geometry);
+
+    write_stripe_member(backstore,
+                        member,
+                        label,
+                        sizeof label,
+                        get_stripe_member(backstore, member).file_size_actual - BLFS_STRIPE_LABEL_BYTES);
+}
+
+/**
+ * Reads member's stripe label into geometry (see write_stripe_label). Returns
+ * zero if member has no label belonging to the backstore with salt.
+ */
+static int read_stripe_label(blfs_backstore_t * backstore, uint32_t member, const uint8_t * salt, uint32_t geometry[3])
+{
+    uint8_t label[BLFS_STRIPE_LABEL_BYTES] = { 0x00 };
+    uint64_t file_size_actual = get_stripe_member(backstore, member).file_size_actual;
+
+    if(file_size_actual < BLFS_STRIPE_LABEL_BYTES)
+        return FALSE;
+
+    read_stripe_member(backstore, member, label, sizeof label, file_size_actual - BLFS_STRIPE_LABEL_BYTES);
+
+    // ? A label with some other salt is left over from whatever was there before
+    if(memcmp(label, BLFS_STRIPE_LABEL_MAGIC, sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1) != 0
+       || memcmp(label + sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1, salt, BLFS_HEAD_HEADER_BYTES_SALT) != 0)
+    {
+        return FALSE;
+    }
+
+    memcpy(geometry, label + sizeof(BLFS_STRIPE_LABEL_MAGIC) - 1 + BLFS_HEAD_HEADER_BYTES_SALT, 3 * sizeof *geometry);
+    return TRUE;
+}
+
+void blfs_backstore_create_stripe_members(blfs_backstore_t * backstore,
+                                          const char * const * paths,
+                                          uint32_t num_paths,
+                                          uint32_t stripe_nuggets,
+                                          uint64_t file_size_bytes)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(num_paths == 0 || num_paths >= BLFS_MAX_STRIPE_WIDTH || stripe_nuggets == 0)
+        Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+
+    if(get_stripe_member(backstore, 0).file_size_actual < BLFS_STRIPE_LABEL_BYTES)
+        Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+
+    blfs_header_t * salt_header = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT);
+
+    backstore->stripe_members = calloc(num_paths, sizeof *backstore->stripe_members);
+
+    if(backstore->stripe_members == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    for(uint32_t member = 1; member <= num_paths; member++)
+        open_stripe_member(backstore->stripe_members + member - 1, paths[member - 1], TRUE, file_size_bytes);
+
+    backstore->stripe_width = num_paths + 1;
+    backstore->stripe_nuggets = stripe_nuggets;
+
+    for(uint32_t member = 0; member < backstore->stripe_width; member++)
+        write_stripe_label(backstore, member, salt_header->data);
+
+    IFDEBUG(dzlog_debug("backstore->stripe_width = %"PRIu32, backstore->stripe_width));
+    IFDEBUG(dzlog_debug("backstore->stripe_nuggets = %"PRIu32, backstore->stripe_nuggets));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_backstore_open_stripe_members(blfs_backstore_t * backstore, const char * const * paths, uint32_t num_paths)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    uint32_t geometry[3] = { 0 };
+    blfs_header_t * salt_header = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT);
+
+    if(!read_stripe_label(backstore, 0, salt_header->data, geometry))
+    {
+        IFDEBUG(dzlog_debug("backstore is not striped"));
+
+        // ? A body device is only ever attached after its label checks out
+        if(num_paths != 0)
+        {
+            dzlog_fatal("%s is not striped, but %"PRIu32" stripe member(s) were given", backstore->file_path, num_paths);
+            Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+        }
+
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return;
+    }
+
+    uint32_t stripe_width = geometry[1];
+    uint32_t stripe_nuggets = geometry[2];
+
+    if(geometry[0] != 0 || stripe_width != num_paths + 1 || stripe_width > BLFS_MAX_STRIPE_WIDTH || stripe_nuggets == 0)
+    {
+        dzlog_fatal("%s is striped across %"PRIu32" members, but %"PRIu32" were given",
+                    backstore->file_path, stripe_width, num_paths + 1);
+
+        Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+    }
+
+    // ? A backstore with a body device but no other members is labeled too
+    if(num_paths != 0)
+    {
+        backstore->stripe_members = calloc(num_paths, sizeof *backstore->stripe_members);
+
+        if(backstore->stripe_members == NULL)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+    }
+
+    for(uint32_t member = 1; member < stripe_width; member++)
+    {
+        open_stripe_member(backstore->stripe_members + member - 1, paths[member - 1], FALSE, 0);
+
+        // ? Members given out of order would silently scramble the body
+        if(!read_stripe_label(backstore, member, salt_header->data, geometry)
+           || geometry[0] != member
+           || geometry[1] != stripe_width
+           || geometry[2] != stripe_nuggets)
+        {
+            dzlog_fatal("%s is not stripe member %"PRIu32" of %s", paths[member - 1], member, backstore->file_path);
+            Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+        }
+    }
+
+    backstore->stripe_width = stripe_width;
+    backstore->stripe_nuggets = stripe_nuggets;
+
+    IFDEBUG(dzlog_debug("backstore->stripe_width = %"PRIu32, backstore->stripe_width));
+    IFDEBUG(dzlog_debug("backstore->stripe_nuggets = %"PRIu32, backstore->stripe_nuggets));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_backstore_create_body_device(blfs_backstore_t * backstore, const char * path, uint64_t file_size_bytes)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    // ? Stripe members are labeled with the body device as member 0
+    if(backstore->body_device != NULL || backstore->stripe_width > 1)
+        Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+
+    blfs_header_t * salt_header = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT);
+
+    backstore->body_device = calloc(1, sizeof *backstore->body_device);
+
+    if(backstore->body_device == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    open_stripe_member(backstore->body_device, path, TRUE, file_size_bytes);
+    write_stripe_label(backstore, 0, salt_header->data);
+
+    IFDEBUG(dzlog_debug("body of %s goes on %s", backstore->file_path, path));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_backstore_open_body_device(blfs_backstore_t * backstore, const char * path)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    uint32_t geometry[3] = { 0 };
+    blfs_header_t * salt_header = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT);
+
+    if(backstore->body_device != NULL || backstore->stripe_width > 1)
+        Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+
+    backstore->body_device = calloc(1, sizeof *backstore->body_device);
+
+    if(backstore->body_device == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    open_stripe_member(backstore->body_device, path, FALSE, 0);
+
+    // ? Geometry is checked along with the other members' (see
+    // ? blfs_backstore_open_stripe_members); this only makes sure the body
+    // ? belongs to this backstore at all
+    if(!read_stripe_label(backstore, 0, salt_header->data, geometry) || geometry[0] != 0)
+    {
+        dzlog_fatal("%s does not hold the body of %s", path, backstore->file_path);
+        Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+    }
+
+    IFDEBUG(dzlog_debug("body of %s is on %s", backstore->file_path, path));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+uint64_t blfs_backstore_stripe_member_bytes(const blfs_backstore_t * backstore, uint32_t member)
+{
+    uint64_t file_size_actual = get_stripe_member(backstore, member).file_size_actual;
+    return has_stripe_labels(backstore) ? file_size_actual - BLFS_STRIPE_LABEL_BYTES : file_size_actual;
+}
+
+uint32_t blfs_backstore_stripe_member_of(const blfs_backstore_t * backstore, uint64_t nugget_index)
+{
+    if(backstore->stripe_width <= 1)
+        return 0;
+
+    return (uint32_t)((nugget_index / backstore->stripe_nuggets) % backstore->stripe_width);
+}
+
+void blfs_backstore_close(blfs_backstore_t * backstore)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_commit_dirty_metadata(backstore);
+
+    pthread_mutex_destroy(backstore->dirty_lock);
+    free(backstore->dirty_lock);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+
+    kh_destroy(BLFS_KHASH_HEADERS_CACHE_NAME, backstore->cache_headers);
+    blfs_close_nugget_tables(backstore);
+
+    if(backstore->mapping != NULL)
+        munmap(backstore->mapping, backstore->file_size_actual);
+
+    for(uint32_t member = 1; member < backstore->stripe_width; member++)
+    {
+        close(backstore->stripe_members[member - 1].io_fd);
+        free((void *) backstore->stripe_members[member - 1].file_path);
+    }
+
+    free(backstore->stripe_members);
+
+    if(backstore->body_device != NULL)
+    {
+        close(backstore->body_device->io_fd);
+        free((void *) backstore->body_device->file_path);
+        free(backstore->body_device);
+    }
+
+    close(backstore->io_fd);
+    free((void *) backstore->file_path);
+    free(backstore);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_backstore_set_io_engine(blfs_backstore_t * backstore, io_engine_e io_engine)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_stripe_member_t devices[BLFS_MAX_STRIPE_WIDTH + 1];
+    uint32_t num_devices = get_devices(backstore, devices);
+
+    for(uint32_t device = 0; device < num_devices && io_engine == ioe_direct; device++)
+    {
+        blfs_stripe_member_t target = devices[device];
+
+        // ? O_DIRECT can only reach whole blocks, so the last one must be whole too
+        if(target.file_size_actual % BLFS_DIRECT_IO_ALIGNMENT != 0)
+        {
+            dzlog_fatal("IO error: size %"PRIu64" of %s is not a multiple of %"PRIu32" bytes",
+                        target.file_size_actual, target.file_path, (uint32_t) BLFS_DIRECT_IO_ALIGNMENT);
+
+            Throw(EXCEPTION_BACKSTORE_DIRECT_IO_FAILURE);
+        }
+
+        // ? ...and the blocks ioe_direct widens accesses to must be whole device blocks
+        if(BLFS_DIRECT_IO_ALIGNMENT % target.logical_block_bytes != 0)
+        {
+            dzlog_fatal("IO error: logical block size %"PRIu32" of %s does not divide %"PRIu32" bytes",
+                        target.logical_block_bytes, target.file_path, (uint32_t) BLFS_DIRECT_IO_ALIGNMENT);
 
-    IFDEBUG(dzlog_debug("init->file_path = %s", init.file_path));
-    IFDEBUG(dzlog_debug("init->file_name = %s", init.file_name));
+            Throw(EXCEPTION_BACKSTORE_DIRECT_IO_FAILURE);
+        }
+    }
 
-    blfs_backstore_t * backstore = malloc(sizeof *backstore);
+    // ? One mapping can't span several files
+    if(io_engine == ioe_mmap && num_devices > 1)
+    {
+        dzlog_fatal("IO error: a backstore spanning %"PRIu32" files/devices cannot be mapped", num_devices);
+        Throw(EXCEPTION_BACKSTORE_MMAP_FAILURE);
+    }
 
-    if(backstore == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
+    if(io_engine == ioe_mmap && backstore->mapping == NULL)
+    {
+        void * mapping = mmap(NULL, backstore->file_size_actual, PROT_READ | PROT_WRITE, MAP_SHARED, backstore->io_fd, 0);
 
-    memcpy(backstore, &init, sizeof *backstore);
+        if(mapping == MAP_FAILED)
+        {
+            dzlog_fatal("IO error: mmap error: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_MMAP_FAILURE);
+        }
 
-    backstore->io_fd = open(backstore->file_path, O_CREAT | O_RDWR, BLFS_DEFAULT_BACKSTORE_FILE_PERMS);
+        backstore->mapping = mapping;
+    }
 
-    if(backstore->io_fd < 0)
-        Throw(EXCEPTION_OPEN_FAILURE);
+    else if(io_engine != ioe_mmap && backstore->mapping != NULL)
+    {
+        // ? Whatever is still dirty in the mapping goes out with it
+        if(msync(backstore->mapping, backstore->file_size_actual, MS_SYNC) == -1
+           || munmap(backstore->mapping, backstore->file_size_actual) == -1)
+        {
+            dzlog_fatal("IO error: munmap error: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_MMAP_FAILURE);
+        }
 
-    off64_t backstore_size_actual_int = lseek64(backstore->io_fd, 0, SEEK_END);
+        backstore->mapping = NULL;
+    }
 
-    if(backstore_size_actual_int < 0)
+    for(uint32_t device = 0; device < num_devices; device++)
     {
-        IFDEBUG(dzlog_fatal("strange..."));
-        Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+        int fd = devices[device].io_fd;
+        int flags = fcntl(fd, F_GETFL);
+        int new_flags = io_engine == ioe_direct ? flags | O_DIRECT : flags & ~O_DIRECT;
+
+        // ? Anything still dirty in the page cache goes out before it is bypassed
+        if(flags == -1 || (new_flags != flags && (fdatasync(fd) == -1 || fcntl(fd, F_SETFL, new_flags) == -1)))
+        {
+            dzlog_fatal("IO error: toggling O_DIRECT failed: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_DIRECT_IO_FAILURE);
+        }
     }
 
-    backstore->file_size_actual = (uint64_t) backstore_size_actual_int;
+    // ? Sets up this thread's ring now, so a kernel without io_uring is
+    // ? caught here rather than by the first write
+    if(io_engine == ioe_uring)
+        (void) get_io_batch();
 
-    IFDEBUG(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
+    backstore->io_engine = io_engine;
 
+    IFDEBUG(dzlog_debug("backstore->io_engine = %d", backstore->io_engine));
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
-
-    return backstore;
 }
 
-void blfs_backstore_setup_actual_post(blfs_backstore_t * backstore)
+io_engine_e blfs_ident_string_to_io_engine(const char * ioe_str)
 {
-    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
-
-    // ! get the last item in the header (before the start of the kcs) and
-    // ! use its offset + length to determine the true length of the HEAD header
-    blfs_header_t * header_last = blfs_open_header(backstore, header_types_ordered[BLFS_HEAD_NUM_HEADERS - 1][0]);
-
-    // We need to know the number of nuggets to calculate the other offsets
-    blfs_header_t * header_numnuggets = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_NUMNUGGETS);
-    backstore->num_nuggets = *((uint32_t *) header_numnuggets->data);
+    io_engine_e io_engine = ioe_not_impl;
 
-    IFDEBUG(dzlog_debug("backstore->num_nuggets = %"PRIu32, backstore->num_nuggets));
+    if(strcmp(ioe_str, "ioe_default") == 0)
+        io_engine = ioe_default;
 
-    // We also need to know the number of flakes per nugget
-    blfs_header_t * header_flakespernugget = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESPERNUGGET);
-    backstore->flakes_per_nugget = *((uint32_t *) header_flakespernugget->data);
+    else if(strcmp(ioe_str, "ioe_pread") == 0)
+        io_engine = ioe_pread;
 
-    IFDEBUG(dzlog_debug("backstore->flakes_per_nugget = %"PRIu32, backstore->flakes_per_nugget));
+    else if(strcmp(ioe_str, "ioe_mmap") == 0)
+        io_engine = ioe_mmap;
 
-    // And finally, we need the individual byte size of each flake
-    blfs_header_t * header_flakesizebytes = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES);
-    backstore->flake_size_bytes = *((uint32_t *) header_flakesizebytes->data);
+    else if(strcmp(ioe_str, "ioe_uring") == 0)
+        io_engine = ioe_uring;
 
-    IFDEBUG(dzlog_debug("backstore->flake_size_bytes = %"PRIu32, backstore->flake_size_bytes));
-    IFDEBUG(dzlog_debug("header_last->data_length = %"PRIu64, header_last->data_length));
+    else if(strcmp(ioe_str, "ioe_direct") == 0)
+        io_engine = ioe_direct;
 
-    backstore->kcs_real_offset = header_last->data_offset + header_last->data_length;
-    backstore->tj_real_offset  = backstore->kcs_real_offset + backstore->num_nuggets * BLFS_HEAD_BYTES_KEYCOUNT;
-    backstore->md_real_offset  = backstore->tj_real_offset + backstore->num_nuggets * CEIL(backstore->flakes_per_nugget, BITS_IN_A_BYTE);
+    else
+        Throw(EXCEPTION_STRING_TO_IO_ENGINE_FAILED);
 
-    IFDEBUG(dzlog_debug("backstore->kcs_real_offset = %"PRIu64, backstore->kcs_real_offset));
-    IFDEBUG(dzlog_debug("backstore->tj_real_offset = %"PRIu64, backstore->tj_real_offset));
-    IFDEBUG(dzlog_debug("backstore->md_real_offset = %"PRIu64, backstore->tj_real_offset));
+    return io_engine;
 }
 
-void blfs_backstore_setup_actual_finish(blfs_backstore_t * backstore)
+void blfs_backstore_begin_batch(blfs_backstore_t * backstore)
 {
-    backstore->body_real_offset = backstore->md_real_offset + backstore->num_nuggets * backstore->md_bytes_per_nugget;
-    IFDEBUG(dzlog_debug("backstore->body_real_offset = %"PRIu64, backstore->body_real_offset));
+    if(backstore->io_engine == ioe_uring)
+        get_io_batch()->depth++;
+}
 
-    backstore->nugget_size_bytes = backstore->flakes_per_nugget * backstore->flake_size_bytes;
-    IFDEBUG(dzlog_debug("backstore->nugget_size_bytes = %"PRIu32, backstore->nugget_size_bytes));
+void blfs_backstore_end_batch(blfs_backstore_t * backstore)
+{
+    if(backstore->io_engine != ioe_uring)
+        return;
 
-    backstore->writeable_size_actual = backstore->num_nuggets * backstore->nugget_size_bytes;
-    IFDEBUG(dzlog_debug("file_size_actual - body_real_offset => %"PRId64, ((int64_t) backstore->file_size_actual) - ((int64_t) backstore->body_real_offset)));
-    IFDEBUG(dzlog_debug("backstore->writeable_size_actual = %"PRIu64, backstore->writeable_size_actual));
+    io_batch_t * batch = get_io_batch();
 
-    if(backstore->writeable_size_actual > backstore->file_size_actual - backstore->body_real_offset)
-        Throw(EXCEPTION_BACKSTORE_SIZE_TOO_SMALL);
+    IFDEBUG(assert(batch->depth > 0));
 
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    if(--batch->depth == 0)
+        blfs_uring_submit_and_wait(batch->ring);
 }
 
-blfs_backstore_t * blfs_backstore_create(const char * path, uint64_t file_size_bytes)
+void blfs_backstore_read(blfs_backstore_t * backstore, uint8_t * buffer, uint32_t length, uint64_t offset)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    if(access(path, F_OK) != -1)
-        Throw(EXCEPTION_FILE_ALREADY_EXISTS);
+    IFDEBUG(dzlog_info("incoming read request for data of length %"PRIu32" from offset %"PRIu64" to %"PRIu64,
+                        length, offset, offset + length - 1));
 
-    blfs_backstore_t * backstore = backstore_setup_actual_pre(path);
+    IFDEBUG4(fprintf(stderr, "Committed read of size %"PRIu32" (%"PRIu64" to %"PRIu64")\n", length, offset, offset + length - 1));
 
-    #pragma GCC diagnostic push
-    #pragma GCC diagnostic ignored "-Wunused-result"
+    IFDEBUG3(dzlog_debug("length + offset = %"PRIu64, length + offset));
+    IFDEBUG3(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
 
-    ftruncate(backstore->io_fd, file_size_bytes);
-    backstore->file_size_actual = file_size_bytes;
+    IFDEBUGANY(if(length + offset > backstore->file_size_actual) Throw(EXCEPTION_DEBUGGING_OVERFLOW));
+    IFDEBUGANY(if(length + offset < length) Throw(EXCEPTION_DEBUGGING_UNDERFLOW));
 
-    #pragma GCC diagnostic pop
+    read_fd(backstore, backstore->io_fd, buffer, length, offset);
 
-    // Header data
-    uint64_t data_version_int = BLFS_CURRENT_VERSION;
-    uint8_t * data_version = (uint8_t *) &data_version_int;
+    IFDEBUG3(dzlog_debug("first 64 bytes:"));
+    IFDEBUG3(hdzlog_debug(buffer, MIN(64U, length)));
 
-    IFDEBUG(dzlog_debug("data_version = %"PRIu64, data_version_int));
-    IFDEBUG(dzlog_debug("data_version:"));
-    IFDEBUG(hdzlog_debug(data_version, BLFS_HEAD_HEADER_BYTES_VERSION));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
 
-    uint8_t data_salt[BLFS_HEAD_HEADER_BYTES_SALT];
-    uint8_t data_mtrh[BLFS_HEAD_HEADER_BYTES_MTRH];
-    uint8_t data_tpmglobalver[BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER];
-    uint8_t data_verification[BLFS_HEAD_HEADER_BYTES_VERIFICATION];
-    uint8_t data_numnuggets[BLFS_HEAD_HEADER_BYTES_NUMNUGGETS];
-    uint8_t data_flakespernugget[BLFS_HEAD_HEADER_BYTES_FLAKESPERNUGGET];
-    uint8_t data_flakesizebytes[BLFS_HEAD_HEADER_BYTES_FLAKESIZE_BYTES];
-    uint8_t data_initialized[BLFS_HEAD_HEADER_BYTES_INITIALIZED];
+void blfs_backstore_write(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    memset(data_salt, 0, BLFS_HEAD_HEADER_BYTES_SALT);
-    memset(data_mtrh, 0, BLFS_HEAD_HEADER_BYTES_MTRH);
-    memset(data_tpmglobalver, 0, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
-    memset(data_verification, 0, BLFS_HEAD_HEADER_BYTES_VERIFICATION);
-    memset(data_numnuggets, 0, BLFS_HEAD_HEADER_BYTES_NUMNUGGETS);
-    memset(data_flakespernugget, 0, BLFS_HEAD_HEADER_BYTES_FLAKESPERNUGGET);
-    memset(data_flakesizebytes, 0, BLFS_HEAD_HEADER_BYTES_FLAKESIZE_BYTES);
-    memset(data_initialized, 0, BLFS_HEAD_HEADER_BYTES_INITIALIZED);
+    IFDEBUG(dzlog_info("incoming write request for data of length %"PRIu32" from offset %"PRIu64" to %"PRIu64,
+                        length, offset, offset + length - 1));
 
-    data_tpmglobalver[0] = 0x01;
+    IFDEBUG4(fprintf(stderr, "Committed write of size %"PRIu32" (%"PRIu64" to %"PRIu64")\n", length, offset, offset + length - 1));
 
-    // Initialize headers (add them to cache so further opens don't hit disk)
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_VERSION, data_version);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_SALT, data_salt);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_MTRH, data_mtrh);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER, data_tpmglobalver);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_VERIFICATION, data_verification);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_NUMNUGGETS, data_numnuggets);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESPERNUGGET, data_flakespernugget);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES, data_flakesizebytes);
-    (void) blfs_create_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED, data_initialized);
+    IFDEBUG3(dzlog_debug("first 64 bytes:"));
+    IFDEBUG3(hdzlog_debug(buffer, MIN(64U, length)));
 
-    backstore->kcs_real_offset = 0;
-    backstore->tj_real_offset = 0;
-    backstore->md_real_offset = 0;
-    backstore->body_real_offset = 0;
-    backstore->nugget_size_bytes = 0;
-    backstore->flake_size_bytes = 0;
-    backstore->writeable_size_actual = 0;
-    backstore->md_bytes_per_nugget = 1;
-    backstore->num_nuggets = 0;
-    backstore->flakes_per_nugget = 0;
-    backstore->md_default_cipher_ident = 0;
+    IFDEBUG3(dzlog_debug("length + offset = %"PRIu64, length + offset));
+    IFDEBUG3(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
 
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    IFDEBUGANY(if(length + offset > backstore->file_size_actual) Throw(EXCEPTION_DEBUGGING_OVERFLOW));
+    IFDEBUGANY(if(length + offset < length) Throw(EXCEPTION_DEBUGGING_UNDERFLOW));
 
-    return backstore;
+    write_fd(backstore, backstore->io_fd, buffer, length, offset);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
-blfs_backstore_t * blfs_backstore_open(const char * path)
+int blfs_backstore_read_epoch_record(blfs_backstore_t * backstore, uint64_t * global_version, uint8_t * root)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    if(access(path, F_OK) == -1)
-        Throw(EXCEPTION_FILE_DOES_NOT_EXIST);
+    if(!backstore->epoch_record_offset)
+    {
+        IFDEBUG(dzlog_debug("backstore predates epoch records"));
+        IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        return FALSE;
+    }
 
-    blfs_backstore_t * backstore = backstore_setup_actual_pre(path);
+    uint8_t record[BLFS_EPOCH_RECORD_BYTES];
 
-    // Make sure the backstore has been initialized
-    blfs_header_t * header_initialized = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED);
-    uint8_t is_initized = *(header_initialized->data);
+    blfs_backstore_read(backstore, record, sizeof record, backstore->epoch_record_offset);
 
-    IFDEBUG(dzlog_debug("is_initized (%"PRIu8" || %"PRIu8" == initialized) = %"PRIu8,
-                        (uint8_t) BLFS_HEAD_IS_INITIALIZED_VALUE, (uint8_t) BLFS_HEAD_WAS_WIPED_VALUE, is_initized));
+    memcpy(global_version, record, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
+    memcpy(root, record + BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, BLFS_HEAD_HEADER_BYTES_MTRH);
 
-    if(is_initized != (uint8_t) BLFS_HEAD_IS_INITIALIZED_VALUE && is_initized != (uint8_t) BLFS_HEAD_WAS_WIPED_VALUE)
-        Throw(EXCEPTION_BACKSTORE_NOT_INITIALIZED);
+    IFDEBUG(dzlog_debug("epoch record global version = %"PRIu64, *global_version));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    return TRUE;
+}
 
-    // Make sure the version is, if not the same as ours, at least compatible
-    blfs_header_t * header_version = blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_VERSION);
-    uint32_t their_version = *((uint32_t *) header_version->data);
+void blfs_backstore_write_epoch_record(blfs_backstore_t * backstore, uint64_t global_version, const uint8_t * root)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    IFDEBUG(dzlog_debug("their_version = %"PRIu32, their_version));
-    IFDEBUG(dzlog_debug("BLFS_CURRENT_VERSION = %"PRIu32, BLFS_CURRENT_VERSION));
-    IFDEBUG(dzlog_debug("BLFS_LEAST_COMPAT_VERSION = %"PRIu32, BLFS_LEAST_COMPAT_VERSION));
+    if(backstore->epoch_record_offset)
+    {
+        uint8_t record[BLFS_EPOCH_RECORD_BYTES];
 
-    if(their_version != BLFS_CURRENT_VERSION && their_version < BLFS_LEAST_COMPAT_VERSION)
-        Throw(EXCEPTION_INCOMPAT_BACKSTORE_VERSION);
+        memcpy(record, (uint8_t *) &global_version, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
+        memcpy(record + BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, root, BLFS_HEAD_HEADER_BYTES_MTRH);
 
-    blfs_backstore_setup_actual_post(backstore);
+        blfs_backstore_write(backstore, record, sizeof record, backstore->epoch_record_offset);
+    }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
-
-    return backstore;
 }
 
-void blfs_backstore_close(blfs_backstore_t * backstore)
+void blfs_backstore_read_body(blfs_backstore_t * backstore, uint8_t * buffer, uint32_t length, uint64_t offset)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    kh_destroy(BLFS_KHASH_HEADERS_CACHE_NAME, backstore->cache_headers);
-    kh_destroy(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts);
-    kh_destroy(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries);
-    kh_destroy(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md);
-    close(backstore->io_fd);
-    free((void *) backstore->file_path);
-    free(backstore);
+    while(length > 0)
+    {
+        uint32_t member = 0;
+        uint64_t real_offset = 0;
+        uint32_t piece = (uint32_t) locate_body(backstore, offset, length, &member, &real_offset);
+
+        read_stripe_member(backstore, member, buffer, piece, real_offset);
+
+        buffer += piece;
+        offset += piece;
+        length -= piece;
+    }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
-void blfs_backstore_read(blfs_backstore_t * backstore, uint8_t * buffer, uint32_t length, uint64_t offset)
+void blfs_backstore_write_body(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t len, uint64_t offset)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    uint32_t size = length;
-    uint8_t * temp_buffer = malloc(length * sizeof *temp_buffer);
-    uint8_t * original_buffer = temp_buffer;
-
-    if(temp_buffer == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
-
-    IFDEBUG(dzlog_info("incoming read request for data of length %"PRIu32" from offset %"PRIu64" to %"PRIu64,
-                        length, offset, offset + length - 1));
+    while(len > 0)
+    {
+        uint32_t member = 0;
+        uint64_t real_offset = 0;
+        uint32_t piece = (uint32_t) locate_body(backstore, offset, len, &member, &real_offset);
 
-    IFDEBUG4(fprintf(stderr, "Committed read of size %"PRIu32" (%"PRIu64" to %"PRIu64")\n", length, offset, offset + length - 1));
+        write_stripe_member(backstore, member, buffer, piece, real_offset);
 
-    IFDEBUG3(dzlog_debug("length + offset = %"PRIu64, length + offset));
-    IFDEBUG3(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
+        buffer += piece;
+        offset += piece;
+        len -= piece;
+    }
 
-    IFDEBUGANY(if(length + offset > backstore->file_size_actual) Throw(EXCEPTION_DEBUGGING_OVERFLOW));
-    IFDEBUGANY(if(length + offset < length) Throw(EXCEPTION_DEBUGGING_UNDERFLOW));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
 
-    lseek64(backstore->io_fd, offset, SEEK_SET);
+/**
+ * Discards length bytes at (real) offset in member. See
+ * blfs_backstore_discard_body.
+ */
+static void discard_stripe_member(blfs_backstore_t * backstore,
+                                  uint32_t member,
+                                  uint64_t length,
+                                  uint64_t real_offset,
+                                  int keep_allocated)
+{
+    blfs_stripe_member_t target = get_stripe_member(backstore, member);
 
-    while(length > 0)
-    {
-        errno = 0;
+    uint64_t real_end = real_offset + length;
+    uint64_t block_bytes = target.logical_block_bytes;
+    int mode = (keep_allocated ? FALLOC_FL_ZERO_RANGE : FALLOC_FL_PUNCH_HOLE) | FALLOC_FL_KEEP_SIZE;
 
-        int bytes_read = read(backstore->io_fd, temp_buffer, length);
+    IFDEBUGANY(if(real_end > target.file_size_actual) Throw(EXCEPTION_DEBUGGING_OVERFLOW));
 
-        if(bytes_read == -1 || errno)
-        {
-            dzlog_fatal("IO error: read error: %s", strerror(errno));
-            errno = 0;
-        }
+    // ? Block devices only discard whole logical blocks, so the range is
+    // ? shrunk to those and whatever sticks out either side is zeroed by hand
+    uint64_t start = MIN(CEIL(real_offset, block_bytes) * block_bytes, real_end);
+    uint64_t end = MAX(start, real_end / block_bytes * block_bytes);
 
-        IFDEBUG(assert(bytes_read > 0));
+    IFDEBUG(dzlog_debug("discarding [%"PRIu64", %"PRIu64") of [%"PRIu64", %"PRIu64") on member %"PRIu32,
+                        start, end, real_offset, real_end, member));
 
-        length -= bytes_read;
-        temp_buffer += bytes_read;
-    }
+    write_zeros(backstore, member, real_offset, start - real_offset);
+    write_zeros(backstore, member, end, real_end - end);
 
-    memcpy(buffer, original_buffer, size);
+    if(start == end)
+        return;
 
-    IFDEBUG3(dzlog_debug("first 64 bytes:"));
-    IFDEBUG3(hdzlog_debug(buffer, MIN(64U, size)));
+    // ? KEEP_SIZE so discarding the tail never shrinks the file. On a block
+    // ? device, PUNCH_HOLE is a discard that still guarantees zeros
+    if(fallocate(target.io_fd, mode, start, end - start) == -1)
+    {
+        uint64_t range[2] = { start, end - start };
 
-    free(original_buffer);
+        // ? Not every filesystem (or block device) supports these modes. The
+        // ? range must still read back as zeros afterwards (see populate_mt)
+        IFDEBUG(dzlog_debug("fallocate failed (%s), zeroing instead", strerror(errno)));
+        errno = 0;
 
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+        if(!target.is_block_device || ioctl(target.io_fd, BLKZEROOUT, range) == -1)
+            write_zeros(backstore, member, start, end - start);
+    }
 }
 
-void blfs_backstore_write(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t length, uint64_t offset)
+void blfs_backstore_discard_body(blfs_backstore_t * backstore, uint32_t length, uint64_t offset, int keep_allocated)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    uint8_t * temp_buffer = malloc(length * sizeof *temp_buffer);
-    uint8_t * original_buffer = temp_buffer;
-
-    if(temp_buffer == NULL)
-        Throw(EXCEPTION_ALLOC_FAILURE);
-
-    IFDEBUG(dzlog_info("incoming write request for data of length %"PRIu32" from offset %"PRIu64" to %"PRIu64,
-                        length, offset, offset + length - 1));
-
-    IFDEBUG4(fprintf(stderr, "Committed write of size %"PRIu32" (%"PRIu64" to %"PRIu64")\n", length, offset, offset + length - 1));
-
-    IFDEBUG3(dzlog_debug("first 64 bytes:"));
-    IFDEBUG3(hdzlog_debug(buffer, MIN(64U, length)));
+    while(length > 0)
+    {
+        uint32_t member = 0;
+        uint64_t real_offset = 0;
+        uint32_t piece = (uint32_t) locate_body(backstore, offset, length, &member, &real_offset);
 
-    IFDEBUG3(dzlog_debug("length + offset = %"PRIu64, length + offset));
-    IFDEBUG3(dzlog_debug("backstore->file_size_actual = %"PRIu64, backstore->file_size_actual));
+        discard_stripe_member(backstore, member, piece, real_offset, keep_allocated);
 
-    IFDEBUGANY(if(length + offset > backstore->file_size_actual) Throw(EXCEPTION_DEBUGGING_OVERFLOW));
-    IFDEBUGANY(if(length + offset < length) Throw(EXCEPTION_DEBUGGING_UNDERFLOW));
+        offset += piece;
+        length -= piece;
+    }
 
-    memcpy(temp_buffer, buffer, length);
-    lseek64(backstore->io_fd, offset, SEEK_SET);
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
 
+int blfs_backstore_body_is_hole(const blfs_backstore_t * backstore, uint64_t length, uint64_t offset)
+{
     while(length > 0)
     {
-        errno = 0;
+        uint32_t member = 0;
+        uint64_t real_offset = 0;
+        uint64_t piece = locate_body(backstore, offset, length, &member, &real_offset);
+        blfs_stripe_member_t target = get_stripe_member(backstore, member);
+
+        // ? A device's unwritten blocks hold whatever was there before
+        if(target.is_block_device)
+            return FALSE;
 
-        int bytes_written = write(backstore->io_fd, temp_buffer, length);
+        off64_t data_offset = lseek64(target.io_fd, real_offset, SEEK_DATA);
 
-        if(bytes_written == -1 || errno)
+        if(data_offset == -1)
         {
-            dzlog_fatal("IO error: write error: %s", strerror(errno));
+            // ? ENXIO means there's no data at all past real_offset; anything
+            // ? else (no SEEK_DATA support, say) means we can't tell
+            int no_data = errno == ENXIO;
             errno = 0;
+
+            if(!no_data)
+                return FALSE;
         }
 
-        IFDEBUG(assert(bytes_written > 0));
+        else if((uint64_t) data_offset < real_offset + piece)
+            return FALSE;
 
-        length -= bytes_written;
-        temp_buffer += bytes_written;
+        offset += piece;
+        length -= piece;
     }
 
-    free(original_buffer);
-
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    return TRUE;
 }
 
-void blfs_backstore_read_body(blfs_backstore_t * backstore, uint8_t * buffer, uint32_t length, uint64_t offset)
+void blfs_backstore_sync(blfs_backstore_t * backstore)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    blfs_backstore_read(backstore, buffer, length, backstore->body_real_offset + offset);
+    io_batch_t * batch = open_io_batch(backstore);
 
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
-}
+    // ? Linked behind everything queued so far and ahead of everything after
+    if(batch != NULL)
+        blfs_uring_queue_fsync(batch->ring, backstore->io_fd);
 
-void blfs_backstore_write_body(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t len, uint64_t offset)
-{
-    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+    // ? MS_SYNC writes back the mapping's dirty pages and waits on them, the
+    // ? mmap equivalent of fdatasync
+    else if(backstore->mapping != NULL)
+    {
+        if(msync(backstore->mapping, backstore->file_size_actual, MS_SYNC) == -1)
+        {
+            dzlog_fatal("IO error: msync error: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_SYNC_FAILURE);
+        }
+    }
+
+    else if(fdatasync(backstore->io_fd) == -1)
+    {
+        dzlog_fatal("IO error: fdatasync error: %s", strerror(errno));
+        Throw(EXCEPTION_BACKSTORE_SYNC_FAILURE);
+    }
+
+    blfs_stripe_member_t devices[BLFS_MAX_STRIPE_WIDTH + 1];
+    uint32_t num_devices = get_devices(backstore, devices);
+
+    // ? Bodies on the body device and other stripe members are only durable
+    // ? once they are too
+    for(uint32_t device = 1; device < num_devices; device++)
+    {
+        int fd = devices[device].io_fd;
 
-    blfs_backstore_write(backstore, buffer, len, backstore->body_real_offset + offset);
+        if(batch != NULL)
+            blfs_uring_queue_fsync(batch->ring, fd);
+
+        else if(fdatasync(fd) == -1)
+        {
+            dzlog_fatal("IO error: fdatasync error on %s: %s", devices[device].file_path, strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_SYNC_FAILURE);
+        }
+    }
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
@@ -21,6 +21,15 @@ void blfs_backstore_setup_actual_post(blfs_backstore_t * backstore);
  */
 void blfs_backstore_setup_actual_finish(blfs_backstore_t * backstore);
 
+/**
+ * Returns how many bytes a nugget's record (keycount, TJ entry, and metadata,
+ * in that order) takes up in a format_version 900+ backstore, padding included.
+ *
+ * @param  flakes_per_nugget
+ * @param  md_bytes_per_nugget
+ */
+uint64_t blfs_backstore_nugget_record_bytes(uint32_t flakes_per_nugget, uint32_t md_bytes_per_nugget);
+
 /**
  * Initialize a blfs_backstore_t object and create the appropriate backstore
  * file descriptors to the path specified. Throws an error if a file already
@@ -40,6 +49,93 @@ blfs_backstore_t * blfs_backstore_create(const char * path, uint64_t file_size_b
  */
 blfs_backstore_t * blfs_backstore_open(const char * path);
 
+/**
+ * Put the body of a backstore being created on the file/device at path,
+ * leaving the backstore itself to hold only the headers and nugget records
+ * (say, on a smaller but faster device). The body device becomes member 0 of
+ * any stripe (see blfs_backstore_create_stripe_members), so this must be
+ * called first.
+ *
+ * A file is created (or emptied) and sized to file_size_bytes; a block device
+ * is used whole. It then ends in a stripe label carrying the backstore's salt,
+ * so the salt header must already be set. Must be called before
+ * blfs_backstore_setup_actual_finish. Throws an error upon failure.
+ *
+ * @param  backstore        blfs_backstore_t instance
+ * @param  path             Body device path
+ * @param  file_size_bytes  The size of the body file in bytes
+ */
+void blfs_backstore_create_body_device(blfs_backstore_t * backstore, const char * path, uint64_t file_size_bytes);
+
+/**
+ * Attach the body device at path to an opened backstore (see
+ * blfs_backstore_create_body_device). Throws EXCEPTION_BAD_STRIPE_MEMBER if
+ * path does not hold this backstore's body. Must be called before
+ * blfs_backstore_open_stripe_members.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  path         Body device path
+ */
+void blfs_backstore_open_body_device(blfs_backstore_t * backstore, const char * path);
+
+/**
+ * Stripe the body of a backstore being created across the files/devices at
+ * paths: member 0 is the body device if there is one and the backstore itself
+ * otherwise, and paths are members 1 through num_paths, in order. Body chunks
+ * of stripe_nuggets nuggets go round robin across the members (nugget i lives
+ * on member (i / stripe_nuggets) % width). The headers and nugget records stay
+ * on the backstore, so the other members only hold bodies.
+ *
+ * Members that are files are created (or emptied) and sized to
+ * file_size_bytes; block devices are used whole. Every member, the backstore
+ * included, then ends in a label recording the stripe geometry and the
+ * backstore's salt, so the salt header must already be set. Must be called
+ * before blfs_backstore_setup_actual_finish. Throws an error upon failure.
+ *
+ * @param  backstore        blfs_backstore_t instance
+ * @param  paths            Stripe member paths
+ * @param  num_paths        Number of paths (at most BLFS_MAX_STRIPE_WIDTH - 1)
+ * @param  stripe_nuggets   Consecutive nuggets on one member (must be > 0)
+ * @param  file_size_bytes  The size of each member file in bytes
+ */
+void blfs_backstore_create_stripe_members(blfs_backstore_t * backstore,
+                                          const char * const * paths,
+                                          uint32_t num_paths,
+                                          uint32_t stripe_nuggets,
+                                          uint64_t file_size_bytes);
+
+/**
+ * Reads the stripe geometry from the label of an opened backstore and opens
+ * the members it calls for from paths (see
+ * blfs_backstore_create_stripe_members). Throws EXCEPTION_BAD_STRIPE_MEMBER if
+ * paths are not exactly the backstore's members in the right order, which
+ * includes giving any for a backstore that is not striped. Must be called
+ * before blfs_backstore_setup_actual_finish.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  paths        Stripe member paths
+ * @param  num_paths    Number of paths
+ */
+void blfs_backstore_open_stripe_members(blfs_backstore_t * backstore, const char * const * paths, uint32_t num_paths);
+
+/**
+ * Returns how many bytes of member (see blfs_backstore_create_stripe_members)
+ * are free for nugget records and bodies, i.e. its size less its stripe label.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  member       Stripe member index
+ */
+uint64_t blfs_backstore_stripe_member_bytes(const blfs_backstore_t * backstore, uint32_t member);
+
+/**
+ * Returns the index of the stripe member nugget_index's body lives on (always
+ * 0 if the backstore is not striped).
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  nugget_index
+ */
+uint32_t blfs_backstore_stripe_member_of(const blfs_backstore_t * backstore, uint64_t nugget_index);
+
 /**
  * Deinitialize a blfs_backstore_t instance, close all relevant file
  * descriptors, and free all relevant pointers and internal caches. There should
@@ -51,6 +147,66 @@ blfs_backstore_t * blfs_backstore_open(const char * path);
  */
 void blfs_backstore_close(blfs_backstore_t * backstore);
 
+/**
+ * Switch the engine blfs_backstore_read() and blfs_backstore_write() (and
+ * everything built on them) use to reach the backstore file. Throws an error
+ * upon failure.
+ *
+ * With ioe_pread, every access is a pread()/pwrite() against io_fd. With
+ * ioe_mmap, the whole file is mapped shared once and accesses become plain
+ * memcpys into and out of the mapping; dirty pages only reach the disk in
+ * blfs_backstore_sync() (or whenever the kernel writes them back).
+ *
+ * ioe_uring behaves like ioe_pread, except that writes and syncs issued
+ * between blfs_backstore_begin_batch() and blfs_backstore_end_batch() are
+ * queued on the calling thread's io_uring and go out together, in order, when
+ * the batch ends. Throws EXCEPTION_URING_INIT_FAILURE if io_uring is missing.
+ *
+ * ioe_direct turns on O_DIRECT, so nothing is cached twice. Accesses that are
+ * not block aligned (BLFS_DIRECT_IO_ALIGNMENT) go through a per-thread aligned
+ * buffer and, for writes, become a locked read-modify-write of the blocks they
+ * touch. The backstore size must be a multiple of the block size.
+ *
+ * Striped backstores and those with a body device (see
+ * blfs_backstore_create_stripe_members) use the same engine for every file
+ * and device they span and cannot use ioe_mmap.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  io_engine    The engine to use from now on
+ */
+void blfs_backstore_set_io_engine(blfs_backstore_t * backstore, io_engine_e io_engine);
+
+/**
+ * Start (or nest) a batch on the calling thread. With ioe_uring, every
+ * blfs_backstore_write() and blfs_backstore_sync() until the matching
+ * blfs_backstore_end_batch() is only queued, so the buffers passed to them must
+ * stay alive and untouched until then. Reads still happen right away (after
+ * submitting the batch early if they overlap a queued write). Does nothing with
+ * the other engines.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ */
+void blfs_backstore_begin_batch(blfs_backstore_t * backstore);
+
+/**
+ * End a batch begun with blfs_backstore_begin_batch(). Ending the outermost one
+ * submits everything queued with a single syscall and waits for it to finish.
+ * Throws an error upon failure.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ */
+void blfs_backstore_end_batch(blfs_backstore_t * backstore);
+
+/**
+ * Takes a string and converts it to its corresponding io_engine_e enum item.
+ * Throws an exception if the passed string is invalid.
+ *
+ * @param  ioe_str
+ *
+ * @return io_engine_e
+ */
+io_engine_e blfs_ident_string_to_io_engine(const char * ioe_str);
+
 /**
  * Read data from the backstore file. Throws an error upon failure.
  *
@@ -71,6 +227,32 @@ void blfs_backstore_read(blfs_backstore_t * backstore, uint8_t * buffer, uint32_
  */
 void blfs_backstore_write(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t length, uint64_t offset);
 
+/**
+ * Reads the backstore's epoch record (see blfs_backstore_write_epoch_record)
+ * into global_version and root (BLFS_HEAD_HEADER_BYTES_MTRH bytes). Returns
+ * zero, leaving both untouched, if the backstore predates epoch records.
+ * Throws an error upon failure.
+ *
+ * @param  backstore        blfs_backstore_t instance
+ * @param  global_version   Set to the global version the record was made under
+ * @param  root             Set to the merkle root the record vouches for
+ */
+int blfs_backstore_read_epoch_record(blfs_backstore_t * backstore, uint64_t * global_version, uint8_t * root);
+
+/**
+ * Overwrites the backstore's epoch record: the merkle root of everything on the
+ * backstore as of now, made while the global version is global_version (i.e.
+ * ahead of the header until the next group commit). It is what lets a crash
+ * between group commits be told apart from tampering (see blfs_soft_open).
+ * Does nothing if the backstore predates epoch records. Throws an error upon
+ * failure.
+ *
+ * @param  backstore        blfs_backstore_t instance
+ * @param  global_version   The open epoch's global version
+ * @param  root             BLFS_HEAD_HEADER_BYTES_MTRH bytes
+ */
+void blfs_backstore_write_epoch_record(blfs_backstore_t * backstore, uint64_t global_version, const uint8_t * root);
+
 /**
  * Read data from the backstore file's body section. Throws an error upon failure.
  *
@@ -91,4 +273,37 @@ void blfs_backstore_read_body(blfs_backstore_t * backstore, uint8_t * buffer, ui
  */
 void blfs_backstore_write_body(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t length, uint64_t offset);
 
+/**
+ * Discard a range of the backstore file's body section so that it reads back as
+ * zeros, punching a hole in the file (or zeroing the range in place if
+ * keep_allocated is non-zero) where the filesystem supports it and writing
+ * zeros otherwise. Throws an error upon failure.
+ *
+ * @param  backstore        blfs_backstore_t instance
+ * @param  length           Number of bytes that will be discarded
+ * @param  offset           The discarded range will begin at this offset in the backstore (relative to beginning of body)
+ * @param  keep_allocated   If non-zero, the range stays allocated in the backstore file
+ */
+void blfs_backstore_discard_body(blfs_backstore_t * backstore, uint32_t length, uint64_t offset, int keep_allocated);
+
+/**
+ * Returns non-zero if a range of the backstore file's body section is known to
+ * read back as zeros without having to read it, i.e. it lies entirely within a
+ * hole of a sparse backstore file (as left by creation or a discard). Returns
+ * zero whenever that cannot be told, e.g. for block devices.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ * @param  length       Number of bytes in the range
+ * @param  offset       The range begins at this offset in the backstore (relative to beginning of body)
+ */
+int blfs_backstore_body_is_hole(const blfs_backstore_t * backstore, uint64_t length, uint64_t offset);
+
+/**
+ * Flush everything written to the backstore so far out to stable storage
+ * (fdatasync). Throws an error upon failure.
+ *
+ * @param  backstore    blfs_backstore_t instance
+ */
+void blfs_backstore_sync(blfs_backstore_t * backstore);
+
 #endif /* BLFS_IO_H_ */
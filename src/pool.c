@@ -0,0 +1,224 @@
+/**
+ * Fixed-size helper thread pool used to fan independent per-nugget work out
+ * across cores.
+ *
+ * @author Bernard Dickens
+ */
+
+#include "pool.h"
+
+#include <stdlib.h>
+#include <inttypes.h>
+
+/**
+ * One pool_run call. Lives on the caller's stack until every one of its tasks
+ * has finished. All fields besides fn, context, and num_tasks are guarded by
+ * the pool's lock.
+ */
+typedef struct pool_batch_t
+{
+    pool_task_fn fn;
+    void * context;
+    uint32_t num_tasks;
+    uint32_t next_task;
+    uint32_t tasks_done;
+    CEXCEPTION_T error;
+    struct pool_batch_t * next;
+} pool_batch_t;
+
+/**
+ * Hands out the next task of batch. Once the last one is claimed, the batch is
+ * taken off the queue. Requires pool->lock.
+ */
+static uint32_t claim_task(pool_t * pool, pool_batch_t * batch)
+{
+    uint32_t task_index = batch->next_task++;
+
+    if(batch->next_task == batch->num_tasks)
+    {
+        pool_batch_t ** link = &pool->head;
+
+        while(*link != batch)
+            link = &(*link)->next;
+
+        *link = batch->next;
+    }
+
+    return task_index;
+}
+
+/**
+ * Runs one task without the lock held and records its outcome.
+ */
+static void run_task(pool_t * pool, pool_batch_t * batch, uint32_t task_index)
+{
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    Try
+    {
+        batch->fn(batch->context, task_index);
+    }
+
+    Catch(e)
+    {
+        IFDEBUG(dzlog_error("task %"PRIu32" of batch %p threw 0x%x", task_index, (void *) batch, e));
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    if(e != EXCEPTION_NO_EXCEPTION && batch->error == EXCEPTION_NO_EXCEPTION)
+        batch->error = e;
+
+    if(++batch->tasks_done == batch->num_tasks)
+        pthread_cond_broadcast(&pool->batch_done);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void * pool_thread_main(void * arg)
+{
+    pool_t * pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while(TRUE)
+    {
+        while(pool->head == NULL && !pool->shutting_down)
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+
+        if(pool->head == NULL)
+            break;
+
+        pool_batch_t * batch = pool->head;
+        uint32_t task_index = claim_task(pool, batch);
+
+        pthread_mutex_unlock(&pool->lock);
+        run_task(pool, batch, task_index);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+pool_t * pool_init(uint32_t num_threads)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(num_threads == 0)
+        Throw(EXCEPTION_POOL_INIT_FAILURE);
+
+    pool_t * pool = malloc(sizeof *pool);
+
+    if(pool == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    pool->threads = malloc(num_threads * sizeof *pool->threads);
+
+    if(pool->threads == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    pool->num_threads = 0;
+    pool->head = NULL;
+    pool->shutting_down = FALSE;
+
+    if(pthread_mutex_init(&pool->lock, NULL) != 0
+       || pthread_cond_init(&pool->work_available, NULL) != 0
+       || pthread_cond_init(&pool->batch_done, NULL) != 0)
+    {
+        Throw(EXCEPTION_POOL_INIT_FAILURE);
+    }
+
+    for(; pool->num_threads < num_threads; pool->num_threads++)
+    {
+        if(pthread_create(pool->threads + pool->num_threads, NULL, pool_thread_main, pool) != 0)
+        {
+            // ? Take down the ones that did start before failing
+            pool_fini(pool);
+            Throw(EXCEPTION_POOL_INIT_FAILURE);
+        }
+    }
+
+    IFDEBUG(dzlog_debug("started %"PRIu32" pool thread(s)", pool->num_threads));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    return pool;
+}
+
+void pool_fini(pool_t * pool)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = TRUE;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(uint32_t i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->batch_done);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->threads);
+    free(pool);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void pool_run(pool_t * pool, pool_task_fn fn, void * context, uint32_t num_tasks)
+{
+    if(pool == NULL || num_tasks < 2)
+    {
+        for(uint32_t task_index = 0; task_index < num_tasks; task_index++)
+            fn(context, task_index);
+
+        return;
+    }
+
+    pool_batch_t batch = {
+        .fn = fn,
+        .context = context,
+        .num_tasks = num_tasks,
+        .next_task = 0,
+        .tasks_done = 0,
+        .error = EXCEPTION_NO_EXCEPTION,
+        .next = NULL
+    };
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool_batch_t ** tail = &pool->head;
+
+    while(*tail != NULL)
+        tail = &(*tail)->next;
+
+    *tail = &batch;
+
+    // ? The caller takes one task itself, so at most num_tasks - 1 helpers
+    if(num_tasks - 1 >= pool->num_threads)
+        pthread_cond_broadcast(&pool->work_available);
+
+    else
+    {
+        for(uint32_t i = 0; i < num_tasks - 1; i++)
+            pthread_cond_signal(&pool->work_available);
+    }
+
+    while(batch.next_task < batch.num_tasks)
+    {
+        uint32_t task_index = claim_task(pool, &batch);
+
+        pthread_mutex_unlock(&pool->lock);
+        run_task(pool, &batch, task_index);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    while(batch.tasks_done < batch.num_tasks)
+        pthread_cond_wait(&pool->batch_done, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+
+    if(batch.error != EXCEPTION_NO_EXCEPTION)
+        Throw(batch.error);
+}
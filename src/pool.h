@@ -0,0 +1,83 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include "constants.h"
+
+#include <pthread.h>
+
+/**
+ * A task as handed to pool_run: called once for each task_index in
+ * [0, num_tasks). Tasks may Throw(); see pool_run.
+ */
+typedef void (*pool_task_fn)(void * context, uint32_t task_index);
+
+struct pool_batch_t;
+
+/**
+ * A fixed set of helper threads that pool_run fans independent tasks out to.
+ *
+ * @threads         The helper threads
+ * @num_threads     Number of helper threads
+ * @lock            Guards everything below
+ * @work_available  Signalled when a batch is queued or the pool shuts down
+ * @batch_done      Signalled when the last task of any batch finishes
+ * @head            Batches that still have unclaimed tasks, oldest first
+ * @shutting_down   Set by pool_fini
+ */
+typedef struct pool_t
+{
+    pthread_t * threads;
+    uint32_t num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    pthread_cond_t batch_done;
+
+    struct pool_batch_t * head;
+    int shutting_down;
+} pool_t;
+
+/**
+ * Create a pool of num_threads helper threads. Do not forget to call
+ * pool_fini() when you're done with it!
+ *
+ * Throws EXCEPTION_POOL_INIT_FAILURE if the threads cannot be started.
+ *
+ * @param  num_threads  Number of helper threads (must be > 0)
+ *
+ * @return              The new pool
+ */
+pool_t * pool_init(uint32_t num_threads);
+
+/**
+ * Stop and join every helper thread, then free the pool. No pool_run may be
+ * in progress.
+ *
+ * @param pool
+ */
+void pool_fini(pool_t * pool);
+
+/**
+ * Call fn(context, i) for every i in [0, num_tasks) and return once all of
+ * them have finished. The calling thread works through the tasks alongside
+ * the pool's helper threads, so this always makes progress even if every
+ * helper is busy with other batches. Several threads may call pool_run on the
+ * same pool at once.
+ *
+ * Tasks run in no particular order and must be independent of each other.
+ * Note that helper threads do not hold any locks the caller holds.
+ *
+ * If pool is NULL or num_tasks < 2, the tasks simply run in order on the
+ * calling thread.
+ *
+ * If any task throws, the remaining tasks still run, and then the first
+ * exception is rethrown from pool_run in the calling thread.
+ *
+ * @param pool
+ * @param fn
+ * @param context
+ * @param num_tasks
+ */
+void pool_run(pool_t * pool, pool_task_fn fn, void * context, uint32_t num_tasks);
+
+#endif /* POOL_H_ */
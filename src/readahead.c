@@ -0,0 +1,364 @@
+/**
+ * Sequential read detection and a bounded buffer of decrypted nuggets read
+ * ahead of demand.
+ *
+ * @author Bernard Dickens
+ */
+
+#include "readahead.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/**
+ * Returns the slot holding nugget_index or NULL. Requires ra->lock.
+ */
+static readahead_slot_t * find_slot(readahead_t * ra, uint64_t nugget_index)
+{
+    for(uint32_t i = 0; i < ra->num_slots; i++)
+    {
+        if(ra->slots[i].valid && ra->slots[i].nugget_index == nugget_index)
+            return ra->slots + i;
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns the slot to (re)fill next: an empty one if there is one, else the
+ * least recently used of those already read from, else the least recently
+ * used overall. Requires ra->lock.
+ */
+static readahead_slot_t * victim_slot(readahead_t * ra)
+{
+    readahead_slot_t * victim = NULL;
+
+    for(uint32_t i = 0; i < ra->num_slots; i++)
+    {
+        readahead_slot_t * slot = ra->slots + i;
+
+        if(!slot->valid)
+            return slot;
+
+        // ? Nuggets that were already read are unlikely to be read again
+        if(victim == NULL
+           || (slot->used && !victim->used)
+           || (slot->used == victim->used && slot->last_used < victim->last_used))
+        {
+            victim = slot;
+        }
+    }
+
+    return victim;
+}
+
+static void * readahead_thread_main(void * arg)
+{
+    readahead_t * ra = arg;
+
+    pthread_mutex_lock(&ra->lock);
+
+    while(TRUE)
+    {
+        while(ra->num_jobs == 0 && !ra->shutting_down)
+            pthread_cond_wait(&ra->work_available, &ra->lock);
+
+        if(ra->shutting_down)
+            break;
+
+        readahead_job_t job = ra->jobs[0];
+        volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+        memmove(ra->jobs, ra->jobs + 1, --ra->num_jobs * sizeof *ra->jobs);
+        ra->busy = TRUE;
+
+        pthread_mutex_unlock(&ra->lock);
+
+        // ? Nobody asked for these nuggets yet. Should one of them fail to
+        // ? verify, the read that does ask for it will fail instead
+        Try
+        {
+            ra->fill(ra->fill_context, job.first_nugget, job.count, job.stream);
+        }
+
+        Catch(e)
+        {
+            IFDEBUGANY(dzlog_warn("reading ahead of nugget %"PRIu64" failed (0x%x); dropped", job.first_nugget, e));
+        }
+
+        pthread_mutex_lock(&ra->lock);
+
+        ra->busy = FALSE;
+
+        if(ra->num_jobs == 0)
+            pthread_cond_broadcast(&ra->idle);
+    }
+
+    pthread_mutex_unlock(&ra->lock);
+    return NULL;
+}
+
+readahead_t * readahead_init(uint32_t num_slots, uint32_t nugget_size)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(num_slots == 0)
+        Throw(EXCEPTION_INVALID_READAHEAD);
+
+    readahead_t * ra = calloc(1, sizeof *ra);
+
+    if(ra == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    ra->nugget_size = nugget_size;
+    ra->num_slots = num_slots;
+    ra->max_window = MAX(1U, num_slots / 2);
+    ra->slots = calloc(num_slots, sizeof *ra->slots);
+
+    if(ra->slots == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    for(uint32_t i = 0; i < num_slots; i++)
+    {
+        ra->slots[i].data = malloc(nugget_size);
+
+        if(ra->slots[i].data == NULL)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+    }
+
+    if(pthread_mutex_init(&ra->lock, NULL) != 0
+       || pthread_cond_init(&ra->work_available, NULL) != 0
+       || pthread_cond_init(&ra->idle, NULL) != 0)
+    {
+        Throw(EXCEPTION_LOCK_INIT_FAILURE);
+    }
+
+    IFDEBUG(dzlog_debug("reading ahead into %"PRIu32" slot(s) of %"PRIu32" bytes", num_slots, nugget_size));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+
+    return ra;
+}
+
+void readahead_fini(readahead_t * ra)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(ra->has_thread)
+    {
+        pthread_mutex_lock(&ra->lock);
+        ra->shutting_down = TRUE;
+        pthread_cond_broadcast(&ra->work_available);
+        pthread_mutex_unlock(&ra->lock);
+
+        pthread_join(ra->thread, NULL);
+    }
+
+    pthread_cond_destroy(&ra->work_available);
+    pthread_cond_destroy(&ra->idle);
+    pthread_mutex_destroy(&ra->lock);
+
+    for(uint32_t i = 0; i < ra->num_slots; i++)
+        free(ra->slots[i].data);
+
+    free(ra->slots);
+    free(ra);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void readahead_start(readahead_t * ra, readahead_fill_fn fill, void * context)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    ra->fill = fill;
+    ra->fill_context = context;
+
+    if(pthread_create(&ra->thread, NULL, readahead_thread_main, ra) != 0)
+        Throw(EXCEPTION_READAHEAD_INIT_FAILURE);
+
+    ra->has_thread = TRUE;
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void readahead_schedule(readahead_t * ra, uint64_t first_nugget, uint32_t count, uint32_t stream)
+{
+    pthread_mutex_lock(&ra->lock);
+
+    // ? Only falls this far behind if reads come faster than they can be read
+    // ? ahead of, in which case reading ahead wouldn't help anyway
+    if(ra->num_jobs < BLFS_READAHEAD_STREAMS)
+    {
+        ra->jobs[ra->num_jobs++] = (readahead_job_t) {
+            .first_nugget = first_nugget,
+            .count = count,
+            .stream = stream
+        };
+
+        pthread_cond_signal(&ra->work_available);
+    }
+
+    else
+    {
+        IFDEBUG(dzlog_debug("read-ahead queue is full; dropping %"PRIu32" nugget(s) from %"PRIu64, count, first_nugget));
+    }
+
+    pthread_mutex_unlock(&ra->lock);
+}
+
+void readahead_wait(readahead_t * ra)
+{
+    pthread_mutex_lock(&ra->lock);
+
+    while(ra->num_jobs || ra->busy)
+        pthread_cond_wait(&ra->idle, &ra->lock);
+
+    pthread_mutex_unlock(&ra->lock);
+}
+
+uint32_t readahead_note_read(readahead_t * ra, uint64_t offset, uint32_t length, uint64_t * first_nugget, uint32_t * stream)
+{
+    if(length == 0)
+        return 0;
+
+    uint64_t next_nugget = (offset + length - 1) / ra->nugget_size + 1;
+    uint32_t count = 0;
+
+    pthread_mutex_lock(&ra->lock);
+
+    uint64_t tick = ++ra->tick;
+    uint32_t s = 0;
+
+    for(uint32_t i = 0; i < BLFS_READAHEAD_STREAMS; i++)
+    {
+        readahead_stream_t * candidate = ra->streams + i;
+
+        // ? last_used == 0 means the stream was never used
+        if(candidate->last_used && candidate->next_offset == offset)
+        {
+            s = i;
+            break;
+        }
+
+        if(candidate->last_used < ra->streams[s].last_used)
+            s = i;
+    }
+
+    readahead_stream_t * st = ra->streams + s;
+
+    if(!st->last_used || st->next_offset != offset)
+    {
+        IFDEBUG(dzlog_debug("read at %"PRIu64" starts stream %"PRIu32, offset, s));
+
+        st->prefetch_end = next_nugget;
+        st->window = 0;
+    }
+
+    else
+    {
+        uint64_t remaining = st->prefetch_end > next_nugget ? st->prefetch_end - next_nugget : 0;
+
+        // ? Read ahead again once the stream is halfway through what it has,
+        // ? growing the window every time it keeps going
+        if(st->window == 0 || remaining <= st->window / 2)
+        {
+            st->window = st->window ? MIN(st->window * 2, ra->max_window) : MIN(BLFS_READAHEAD_MIN_WINDOW, ra->max_window);
+
+            *first_nugget = MAX(st->prefetch_end, next_nugget);
+            st->prefetch_end = next_nugget + st->window;
+
+            if(st->prefetch_end > *first_nugget)
+                count = (uint32_t)(st->prefetch_end - *first_nugget);
+
+            *stream = s;
+
+            IFDEBUG(dzlog_debug("stream %"PRIu32" reads ahead %"PRIu32" nugget(s) from %"PRIu64" (window %"PRIu32")",
+                                s, count, *first_nugget, st->window));
+        }
+    }
+
+    st->next_offset = offset + length;
+    st->last_used = tick;
+
+    pthread_mutex_unlock(&ra->lock);
+
+    return count;
+}
+
+int readahead_contains(readahead_t * ra, uint64_t nugget_index)
+{
+    pthread_mutex_lock(&ra->lock);
+    int contains = find_slot(ra, nugget_index) != NULL;
+    pthread_mutex_unlock(&ra->lock);
+
+    return contains;
+}
+
+int readahead_copy_out(readahead_t * ra, uint64_t nugget_index, uint8_t * buffer, uint32_t internal_offset, uint32_t length)
+{
+    pthread_mutex_lock(&ra->lock);
+
+    readahead_slot_t * slot = find_slot(ra, nugget_index);
+
+    if(slot != NULL)
+    {
+        memcpy(buffer, slot->data + internal_offset, length);
+
+        slot->used = TRUE;
+        slot->last_used = ++ra->tick;
+    }
+
+    pthread_mutex_unlock(&ra->lock);
+
+    return slot != NULL;
+}
+
+void readahead_insert(readahead_t * ra, uint64_t nugget_index, const uint8_t * data, uint32_t stream)
+{
+    pthread_mutex_lock(&ra->lock);
+
+    readahead_slot_t * slot = find_slot(ra, nugget_index);
+
+    if(slot == NULL)
+    {
+        slot = victim_slot(ra);
+
+        // ? Read ahead for nothing: whoever it was read ahead for asks for too much
+        if(slot->valid && !slot->used)
+        {
+            readahead_stream_t * victim_stream = ra->streams + slot->stream;
+
+            IFDEBUG(dzlog_debug("nugget %"PRIu64" evicted unread; shrinking stream %"PRIu32"'s window",
+                                slot->nugget_index, slot->stream));
+
+            if(victim_stream->window > BLFS_READAHEAD_MIN_WINDOW)
+                victim_stream->window /= 2;
+        }
+    }
+
+    memcpy(slot->data, data, ra->nugget_size);
+
+    slot->nugget_index = nugget_index;
+    slot->valid = TRUE;
+    slot->used = FALSE;
+    slot->stream = stream;
+    slot->last_used = ++ra->tick;
+
+    pthread_mutex_unlock(&ra->lock);
+}
+
+void readahead_invalidate(readahead_t * ra, uint64_t first_nugget, uint64_t last_nugget)
+{
+    pthread_mutex_lock(&ra->lock);
+
+    for(uint32_t i = 0; i < ra->num_slots; i++)
+    {
+        readahead_slot_t * slot = ra->slots + i;
+
+        if(slot->valid && slot->nugget_index >= first_nugget && slot->nugget_index <= last_nugget)
+            slot->valid = FALSE;
+    }
+
+    pthread_mutex_unlock(&ra->lock);
+}
@@ -0,0 +1,229 @@
+#ifndef READAHEAD_H_
+#define READAHEAD_H_
+
+#include "constants.h"
+
+#include <pthread.h>
+
+/**
+ * A sequential read stream as seen by readahead_note_read.
+ *
+ * @next_offset         Where the stream's next read is expected to begin
+ * @prefetch_end        Nuggets before this one have already been prefetched
+ * @window              Nuggets the stream is read ahead by (0 until it has
+ *                      proven sequential)
+ * @last_used           Tick of the stream's last read, for replacement
+ */
+typedef struct readahead_stream_t
+{
+    uint64_t next_offset;
+    uint64_t prefetch_end;
+    uint32_t window;
+    uint64_t last_used;
+} readahead_stream_t;
+
+/**
+ * One nugget's worth of plaintext.
+ *
+ * @nugget_index        The nugget held (only meaningful if valid)
+ * @valid               Non-zero if the slot holds a nugget
+ * @used                Non-zero once a read has been served from the slot
+ * @stream              The stream the nugget was prefetched for
+ * @last_used           Tick of the slot's last fill or hit, for eviction
+ * @data                nugget_size bytes of plaintext
+ */
+typedef struct readahead_slot_t
+{
+    uint64_t nugget_index;
+    uint8_t valid;
+    uint8_t used;
+    uint32_t stream;
+    uint64_t last_used;
+    uint8_t * data;
+} readahead_slot_t;
+
+/**
+ * Fills ra with count nuggets from first_nugget on, attributed to stream (see
+ * readahead_schedule). May Throw(); the nuggets are dropped if it does.
+ */
+typedef void (*readahead_fill_fn)(void * context, uint64_t first_nugget, uint32_t count, uint32_t stream);
+
+/**
+ * A window waiting for the read-ahead thread.
+ */
+typedef struct readahead_job_t
+{
+    uint64_t first_nugget;
+    uint32_t count;
+    uint32_t stream;
+} readahead_job_t;
+
+/**
+ * Sequential read detection and a bounded buffer of decrypted (and already
+ * verified) nuggets that sequential streams are read ahead into. All functions
+ * are thread safe.
+ *
+ * Note that nothing here knows when the nuggets it holds change. Whoever
+ * writes to (or trims) a nugget must call readahead_invalidate while holding
+ * that nugget's lock, and fill it only while holding it too.
+ *
+ * @lock                Guards everything below
+ * @nugget_size         Bytes in a nugget
+ * @num_slots           Nuggets the buffer holds
+ * @max_window          The most nuggets a stream is read ahead by
+ * @slots               The buffer
+ * @streams             Streams being tracked
+ * @tick                Incremented on every access; orders last_used
+ * @thread              Runs fill for each scheduled job (see readahead_start)
+ * @has_thread          Set once thread is running
+ * @fill                Called by thread to fill a window
+ * @fill_context        Passed to fill
+ * @work_available      Signalled when a job is queued or ra shuts down
+ * @idle                Signalled when the last queued job is done
+ * @jobs                Windows waiting for thread, oldest first
+ * @num_jobs            Number of jobs waiting
+ * @busy                Set while thread runs fill
+ * @shutting_down       Set by readahead_fini
+ */
+typedef struct readahead_t
+{
+    pthread_mutex_t lock;
+
+    uint32_t nugget_size;
+    uint32_t num_slots;
+    uint32_t max_window;
+
+    readahead_slot_t * slots;
+    readahead_stream_t streams[BLFS_READAHEAD_STREAMS];
+
+    uint64_t tick;
+
+    pthread_t thread;
+    int has_thread;
+    readahead_fill_fn fill;
+    void * fill_context;
+    pthread_cond_t work_available;
+    pthread_cond_t idle;
+
+    readahead_job_t jobs[BLFS_READAHEAD_STREAMS];
+    uint32_t num_jobs;
+    int busy;
+    int shutting_down;
+} readahead_t;
+
+/**
+ * Create a read-ahead buffer holding num_slots nuggets of nugget_size bytes
+ * each. A stream is read ahead by at most half of them so that a second stream
+ * does not immediately evict the first. Do not forget to call readahead_fini()
+ * when you're done with it!
+ *
+ * @param  num_slots    Nuggets the buffer holds (must be > 0)
+ * @param  nugget_size  Bytes in a nugget
+ *
+ * @return              The new buffer
+ */
+readahead_t * readahead_init(uint32_t num_slots, uint32_t nugget_size);
+
+/**
+ * Free ra and everything it holds. If ra was started, its thread is stopped
+ * first (after the job it's running, if any; the rest are dropped).
+ *
+ * @param ra
+ */
+void readahead_fini(readahead_t * ra);
+
+/**
+ * Start ra's thread, which calls fill(context, ...) for every job scheduled
+ * with readahead_schedule. Throws EXCEPTION_READAHEAD_INIT_FAILURE if it
+ * cannot be started.
+ *
+ * @param ra
+ * @param fill
+ * @param context
+ */
+void readahead_start(readahead_t * ra, readahead_fill_fn fill, void * context);
+
+/**
+ * Queues the window readahead_note_read decided on for ra's thread and returns
+ * right away, so the read that triggered it isn't held up. If too many windows
+ * are already waiting, this one is dropped. ra must have been started.
+ *
+ * @param ra
+ * @param first_nugget      See readahead_note_read
+ * @param count             See readahead_note_read
+ * @param stream            See readahead_note_read
+ */
+void readahead_schedule(readahead_t * ra, uint64_t first_nugget, uint32_t count, uint32_t stream);
+
+/**
+ * Blocks until ra's thread has finished every job scheduled so far.
+ *
+ * @param ra
+ */
+void readahead_wait(readahead_t * ra);
+
+/**
+ * Records a read of length bytes at (absolute) offset and decides whether the
+ * nuggets after it should be read ahead.
+ *
+ * A read that begins exactly where a tracked stream left off continues that
+ * stream; any other read starts a new one (replacing the least recently used)
+ * and is never read ahead of, so random reads cost nothing extra. Once a stream
+ * has proven sequential it is read ahead by BLFS_READAHEAD_MIN_WINDOW nuggets.
+ * Every time it consumes half of what was read ahead for it, the next window
+ * is read ahead, doubling (up to max_window) if the previous one was used up.
+ * Windows are halved whenever nuggets read ahead are evicted without ever
+ * being read, i.e. when the buffer is too small for the streams using it.
+ *
+ * @param  ra
+ * @param  offset           Where the read began
+ * @param  length           Bytes read
+ * @param  first_nugget     Set to the first nugget to read ahead
+ * @param  stream           Set to the stream to attribute the nuggets to
+ *
+ * @return                  How many nuggets (from first_nugget on) to read
+ *                          ahead; 0 if none
+ */
+uint32_t readahead_note_read(readahead_t * ra, uint64_t offset, uint32_t length, uint64_t * first_nugget, uint32_t * stream);
+
+/**
+ * Returns non-zero if ra holds nugget_index.
+ *
+ * @param ra
+ * @param nugget_index
+ */
+int readahead_contains(readahead_t * ra, uint64_t nugget_index);
+
+/**
+ * If ra holds nugget_index, copies length bytes beginning at internal_offset
+ * within it into buffer and returns non-zero. Returns zero otherwise.
+ *
+ * @param ra
+ * @param nugget_index
+ * @param buffer
+ * @param internal_offset
+ * @param length
+ */
+int readahead_copy_out(readahead_t * ra, uint64_t nugget_index, uint8_t * buffer, uint32_t internal_offset, uint32_t length);
+
+/**
+ * Puts the plaintext of nugget_index (nugget_size bytes from data) into ra,
+ * evicting the least recently used nugget if ra is full.
+ *
+ * @param ra
+ * @param nugget_index
+ * @param data
+ * @param stream            See readahead_note_read
+ */
+void readahead_insert(readahead_t * ra, uint64_t nugget_index, const uint8_t * data, uint32_t stream);
+
+/**
+ * Drops every nugget in [first_nugget, last_nugget] that ra holds.
+ *
+ * @param ra
+ * @param first_nugget
+ * @param last_nugget
+ */
+void readahead_invalidate(readahead_t * ra, uint64_t first_nugget, uint64_t last_nugget);
+
+#endif /* READAHEAD_H_ */
@@ -22,14 +22,18 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+/**
+ * One flake's worth of zeros (as big as a flake can get), for tagging and
+ * encrypting zeros without putting them on the stack.
+ */
+static const uint8_t zero_flake[BLFS_HEAD_MAX_FLAKESIZE_BYTES];
+
 // ! This must be changed/updated if we're adding new storage layers (e.g.
 // ! the new "nugget metadata" layer)
 uint32_t calculate_total_space_required_for_1nug(uint32_t nuggetsize, uint32_t flakes_per_nugget, uint32_t md_bytes_per_nugget)
 {
     return nuggetsize // ? Space for 1 nugget
-        + BLFS_HEAD_BYTES_KEYCOUNT // ? Space for 1 kcs
-        + CEIL(flakes_per_nugget, BITS_IN_A_BYTE) // ? Space for 1 TJ entry
-        + md_bytes_per_nugget; // ? Space for 1 nugget md
+        + blfs_backstore_nugget_record_bytes(flakes_per_nugget, md_bytes_per_nugget); // ? Space for 1 kcs + TJ entry + md
 }
 
 // ! This must be changed/updated if we're adding new storage layers (e.g.
@@ -81,45 +85,34 @@ uint32_t mt_calculate_tj1_index(const buselfs_state_t * buselfs_state, uint32_t
 }
 
 /**
- * Unimplemented BUSE internal function.
+ * BUSE disconnect handler. Commits any outstanding writes so that a clean
+ * disconnect never leaves the backstore looking like it crashed.
  */
 static void buse_disc(void * userdata)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    (void) userdata;
-
-    IFDEBUG(dzlog_info("Received a disconnect request (not implemented)."));
-    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
-}
-
-/**
- * Unimplemented BUSE internal function.
- */
-static int buse_flush(void * userdata)
-{
-    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+    IFDEBUG(dzlog_info("Received a disconnect request."));
+    blfs_group_commit((buselfs_state_t *) userdata);
 
-    (void) userdata;
+    blfs_nugget_table_stats_t stats;
+    blfs_get_nugget_table_stats(((buselfs_state_t *) userdata)->backstore, &stats);
 
-    IFDEBUG(dzlog_info("Received a flush request (not implemented)."));
+    dzlog_notice("Metadata cache: %"PRIu64" hits, %"PRIu64" misses, %"PRIu64" evictions, %"PRIu64" of %"PRIu64" bytes resident",
+                 stats.hits, stats.misses, stats.evictions, stats.resident_bytes, stats.max_resident_bytes);
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
-    return 0;
 }
 
 /**
- * Unimplemented BUSE internal function.
+ * BUSE flush handler (NBD_CMD_FLUSH and FUA writes). See blfs_group_commit.
  */
-static int buse_trim(uint64_t from, uint32_t len, void * userdata)
+static int buse_flush(void * userdata)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-    (void) from;
-    (void) len;
-    (void) userdata;
-
-    IFDEBUG(dzlog_info("Received a trim request (not implemented)"));
+    IFDEBUG(dzlog_info("Received a flush request."));
+    blfs_group_commit((buselfs_state_t *) userdata);
 
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
     return 0;
@@ -135,6 +128,35 @@ static struct mq_attr mqattrs = {
     .mq_msgsize = BLFS_SV_MESSAGE_SIZE_BYTES
 };
 
+/**
+ * Evicts pages of the nugget tables (see blfs_nugget_tables_t) until the
+ * backstore is back under its metadata cache cap. A page is only evicted if
+ * none of its nuggets is locked, so whoever calls this must not be holding any
+ * entries (or nugget locks) itself. Busy pages are passed over; after
+ * BLFS_MAX_EVICTION_ATTEMPTS of them, the rest is left to the next call.
+ */
+static void trim_nugget_tables(buselfs_state_t * buselfs_state)
+{
+    uint64_t page_index;
+    uint32_t attempts = 0;
+
+    while(attempts < BLFS_MAX_EVICTION_ATTEMPTS && blfs_pick_nugget_page_victim(buselfs_state->backstore, &page_index))
+    {
+        uint64_t first_nugget = page_index * BLFS_TABLE_PAGE_NUGGETS;
+        uint64_t last_nugget = first_nugget + BLFS_TABLE_PAGE_NUGGETS - 1;
+
+        if(!blfs_trylock_nuggets(buselfs_state, first_nugget, last_nugget))
+        {
+            IFDEBUG(dzlog_debug("nugget table page %"PRIu64" is busy; passing it over", page_index));
+            attempts++;
+            continue;
+        }
+
+        blfs_evict_nugget_page(buselfs_state->backstore, page_index);
+        blfs_unlock_nuggets(buselfs_state, first_nugget, last_nugget);
+    }
+}
+
 static void populate_key_cache(buselfs_state_t * buselfs_state)
 {
     if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
@@ -169,6 +191,8 @@ static void populate_key_cache(buselfs_state_t * buselfs_state)
                 blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
                 add_keychain_to_key_cache(buselfs_state, nugget_index, flake_index, count->keycount, flake_key);
             }
+
+            trim_nugget_tables(buselfs_state);
         }
     }
 }
@@ -230,6 +254,8 @@ static void populate_mt(buselfs_state_t * buselfs_state)
         add_to_merkle_tree((uint8_t *) &(count->keycount), BLFS_HEAD_BYTES_KEYCOUNT, buselfs_state);
         IFDEBUG(verify_in_merkle_tree((uint8_t *) &(count->keycount), BLFS_HEAD_BYTES_KEYCOUNT, operations_completed, buselfs_state));
         IFNDEBUG(interact_print_percent_done((operations_completed + 1) * 100 / operations_total));
+
+        trim_nugget_tables(buselfs_state);
     }
 
     // Next, the TJ entries
@@ -246,6 +272,8 @@ static void populate_mt(buselfs_state_t * buselfs_state)
         add_to_merkle_tree(hash, BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT, buselfs_state);
         IFDEBUG(verify_in_merkle_tree(hash, BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT, operations_completed, buselfs_state));
         IFNDEBUG(interact_print_percent_done((operations_completed + 1) * 100 / operations_total));
+
+        trim_nugget_tables(buselfs_state);
     }
 
     // Next, the nugget metadata
@@ -259,7 +287,7 @@ static void populate_mt(buselfs_state_t * buselfs_state)
         uint8_t data[meta->data_length];
         uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
 
-        memcpy(data, &(meta->cipher_ident), 1);
+        data[0] = BLFS_MD_IDENT_BYTE(meta);
 
         if(meta->metadata_length)
             memcpy(data + 1, meta->metadata, meta->metadata_length);
@@ -268,12 +296,21 @@ static void populate_mt(buselfs_state_t * buselfs_state)
         add_to_merkle_tree(hash, sizeof hash, buselfs_state);
         IFDEBUG(verify_in_merkle_tree(hash, BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT, operations_completed, buselfs_state));
         IFNDEBUG(interact_print_percent_done((operations_completed + 1) * 100 / operations_total));
+
+        trim_nugget_tables(buselfs_state);
     }
 
     // Finally, the flake tags
     IFDEBUG(dzlog_debug("MERKLE TREE: adding flake tags..."));
     IFDEBUG(dzlog_debug("MERKLE TREE: starting index %"PRIu32, operations_completed));
 
+    // ? Each nugget is read in with one call rather than one per flake
+    uint8_t * nugget_data = malloc(nugsize);
+    IFDEBUG(uint32_t nuggets_skipped = 0);
+
+    if(nugget_data == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
     for(uint32_t nugget_index = 0; nugget_index < buselfs_state->backstore->num_nuggets; nugget_index++)
     {
         uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT] = { 0x00 };
@@ -284,11 +321,23 @@ static void populate_mt(buselfs_state_t * buselfs_state)
         if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
             blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_index);
 
+        // ? Nuggets that were never written (all of them, right after
+        // ? creation) are holes in the backstore and so known to be zeros;
+        // ? their tags are computed without reading them in
+        if(blfs_backstore_body_is_hole(buselfs_state->backstore, nugsize, (uint64_t) nugget_index * nugsize))
+        {
+            memset(nugget_data, 0, nugsize);
+            IFDEBUG(nuggets_skipped++);
+        }
+
+        else
+            blfs_backstore_read_body(buselfs_state->backstore, nugget_data, nugsize, (uint64_t) nugget_index * nugsize);
+
         for(uint32_t flake_index = 0; flake_index < buselfs_state->backstore->flakes_per_nugget; flake_index++, operations_completed++)
         {
             uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY] = { 0x00 };
             uint8_t * tag = malloc(BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT * sizeof *tag);
-            uint8_t flake_data[flakesize];
+            const uint8_t * flake_data = nugget_data + flake_index * flakesize;
 
             if(tag == NULL)
                 Throw(EXCEPTION_ALLOC_FAILURE);
@@ -299,15 +348,19 @@ static void populate_mt(buselfs_state_t * buselfs_state)
             else
                 get_flake_key_using_keychain(flake_key, buselfs_state, nugget_index, flake_index, count->keycount);
 
-            blfs_backstore_read_body(buselfs_state->backstore, flake_data, flakesize, nugget_index * nugsize + flake_index * flakesize);
-
             blfs_poly1305_generate_tag(tag, flake_data, flakesize, flake_key);
             add_to_merkle_tree(tag, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT, buselfs_state);
             IFDEBUG(verify_in_merkle_tree(tag, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT, operations_completed, buselfs_state));
             IFNDEBUG(interact_print_percent_done((operations_completed + 1) * 100 / operations_total));
         }
+
+        trim_nugget_tables(buselfs_state);
     }
 
+    free(nugget_data);
+
+    IFDEBUG(dzlog_debug("MERKLE TREE: %"PRIu32" of %"PRIu32" nuggets were holes and not read in",
+                        nuggets_skipped, buselfs_state->backstore->num_nuggets));
     IFDEBUG(dzlog_debug("MERKLE TREE: final index vs size (should be +1 diff) %"PRIu32" vs %"PRIu32, operations_completed, mt_get_size(buselfs_state->merkle_tree)));
     IFNDEBUG(printf("\n"));
 }
@@ -614,6 +667,8 @@ int blfs_swap_nugget_to_active_cipher(int swapping_while_read_or_write,
                 // * writes (and reads) that would otherwise aggro a pristine
                 // * nugget!
 
+                blfs_lock_nuggets(buselfs_state, target, target);
+
                 blfs_tjournal_entry_t * target_entry = blfs_open_tjournal_entry(buselfs_state->backstore, target);
                 blfs_nugget_metadata_t * target_meta = blfs_open_nugget_metadata(buselfs_state->backstore, target);
 
@@ -652,6 +707,8 @@ int blfs_swap_nugget_to_active_cipher(int swapping_while_read_or_write,
                     target_meta->cipher_ident = (uint8_t) encryption_cipher->enum_id;
                     blfs_commit_nugget_metadata(buselfs_state->backstore, target_meta);
                 }
+
+                blfs_unlock_nuggets(buselfs_state, target, target);
             }
 
             IFDEBUGANY(dzlog_notice("<[FINISHED AGGRESSIVE CIPHER SWAP PROCEDURE AFTER NUGGET %"PRIu64"]>", target_nugget_index));
@@ -761,6 +818,8 @@ void update_application_state_check_mq(buselfs_state_t * buselfs_state)
     blfs_mq_msg_t incoming_msg;
     int processed_input = FALSE;
 
+    blfs_lock_state(buselfs_state);
+
     do {
         blfs_read_input_queue(buselfs_state, &incoming_msg);
 
@@ -771,6 +830,8 @@ void update_application_state_check_mq(buselfs_state_t * buselfs_state)
          * * opcode 0 => error state or null message (i.e. a message does not exist)
          * * opcode 1 => indicate cipher switch or selectivity change [payload: ignored]
          * * opcode 2 => TRIM one of the mirrored partitions if using swap_mirrored [payload: partition to TRIM]
+         * * opcode 3 => report metadata cache statistics [payload: ignored] (answered with opcode 3 on the outgoing
+         * *             queue, payload: blfs_nugget_table_stats_t)
          */
         IFDEBUG(dzlog_debug("Received application state update: opcode %i", incoming_msg.opcode));
 
@@ -820,6 +881,23 @@ void update_application_state_check_mq(buselfs_state_t * buselfs_state)
                 Throw(EXCEPTION_MUST_HALT);
                 break;
 
+            case 3:
+                if(processed_input)
+                    Throw(EXCEPTION_CANNOT_HANDLE_MULTIPLE_MESSAGES_IN_QUEUE);
+
+                (void) buselfs_state; // ? language quirk
+                blfs_nugget_table_stats_t stats;
+                blfs_mq_msg_t outgoing_msg = { .opcode = 3, .priority = 0, .payload = { 0x00 } };
+
+                blfs_get_nugget_table_stats(buselfs_state->backstore, &stats);
+                memcpy(outgoing_msg.payload, &stats, sizeof stats);
+
+                IFDEBUGANY(dzlog_info("reporting metadata cache statistics: %"PRIu64" hits, %"PRIu64" misses",
+                                      stats.hits, stats.misses));
+
+                blfs_write_output_queue(buselfs_state, &outgoing_msg, 0);
+                break;
+
             default:
                 Throw(EXCEPTION_BAD_OPCODE);
                 break;
@@ -828,9 +906,133 @@ void update_application_state_check_mq(buselfs_state_t * buselfs_state)
         processed_input++;
     } while(incoming_msg.opcode != 0);
 
+    blfs_unlock_state(buselfs_state);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+static void initialize_recursive_mutex(pthread_mutex_t * mutex)
+{
+    pthread_mutexattr_t attr;
+
+    if(pthread_mutexattr_init(&attr) != 0
+       || pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0
+       || pthread_mutex_init(mutex, &attr) != 0)
+    {
+        Throw(EXCEPTION_LOCK_INIT_FAILURE);
+    }
+
+    pthread_mutexattr_destroy(&attr);
+}
+
+void blfs_initialize_locks(buselfs_state_t * buselfs_state)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    uint32_t num_nuggets = buselfs_state->backstore->num_nuggets;
+
+    buselfs_state->nugget_locks = malloc(num_nuggets * sizeof *buselfs_state->nugget_locks);
+    buselfs_state->state_lock = malloc(sizeof *buselfs_state->state_lock);
+    buselfs_state->writes_drained = malloc(sizeof *buselfs_state->writes_drained);
+
+    if(buselfs_state->nugget_locks == NULL || buselfs_state->state_lock == NULL || buselfs_state->writes_drained == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    for(uint32_t nugget_index = 0; nugget_index < num_nuggets; nugget_index++)
+        initialize_recursive_mutex(buselfs_state->nugget_locks + nugget_index);
+
+    initialize_recursive_mutex(buselfs_state->state_lock);
+
+    if(pthread_cond_init(buselfs_state->writes_drained, NULL) != 0)
+        Throw(EXCEPTION_LOCK_INIT_FAILURE);
+
+    IFDEBUG(dzlog_debug("initialized %"PRIu32" nugget locks", num_nuggets));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_destroy_locks(buselfs_state_t * buselfs_state)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    if(buselfs_state->nugget_locks != NULL)
+    {
+        for(uint32_t nugget_index = 0; nugget_index < buselfs_state->backstore->num_nuggets; nugget_index++)
+            pthread_mutex_destroy(buselfs_state->nugget_locks + nugget_index);
+    }
+
+    if(buselfs_state->state_lock != NULL)
+        pthread_mutex_destroy(buselfs_state->state_lock);
+
+    if(buselfs_state->writes_drained != NULL)
+        pthread_cond_destroy(buselfs_state->writes_drained);
+
+    free(buselfs_state->nugget_locks);
+    free(buselfs_state->state_lock);
+    free(buselfs_state->writes_drained);
+
+    buselfs_state->nugget_locks = NULL;
+    buselfs_state->state_lock = NULL;
+    buselfs_state->writes_drained = NULL;
+
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
+void blfs_lock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index)
+{
+    if(buselfs_state->nugget_locks == NULL)
+        return;
+
+    last_nugget_index = MIN(last_nugget_index, (uint64_t) buselfs_state->backstore->num_nuggets - 1);
+
+    // ! Always ascending, otherwise two multi-nugget requests can deadlock
+    for(uint64_t nugget_index = first_nugget_index; nugget_index <= last_nugget_index; nugget_index++)
+        pthread_mutex_lock(buselfs_state->nugget_locks + nugget_index);
+}
+
+void blfs_unlock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index)
+{
+    if(buselfs_state->nugget_locks == NULL)
+        return;
+
+    last_nugget_index = MIN(last_nugget_index, (uint64_t) buselfs_state->backstore->num_nuggets - 1);
+
+    for(uint64_t nugget_index = first_nugget_index; nugget_index <= last_nugget_index; nugget_index++)
+        pthread_mutex_unlock(buselfs_state->nugget_locks + nugget_index);
+}
+
+int blfs_trylock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index)
+{
+    if(buselfs_state->nugget_locks == NULL)
+        return TRUE;
+
+    last_nugget_index = MIN(last_nugget_index, (uint64_t) buselfs_state->backstore->num_nuggets - 1);
+
+    for(uint64_t nugget_index = first_nugget_index; nugget_index <= last_nugget_index; nugget_index++)
+    {
+        if(pthread_mutex_trylock(buselfs_state->nugget_locks + nugget_index) != 0)
+        {
+            if(nugget_index > first_nugget_index)
+                blfs_unlock_nuggets(buselfs_state, first_nugget_index, nugget_index - 1);
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+void blfs_lock_state(const buselfs_state_t * buselfs_state)
+{
+    if(buselfs_state->state_lock != NULL)
+        pthread_mutex_lock(buselfs_state->state_lock);
+}
+
+void blfs_unlock_state(const buselfs_state_t * buselfs_state)
+{
+    if(buselfs_state->state_lock != NULL)
+        pthread_mutex_unlock(buselfs_state->state_lock);
+}
+
 /**
  * ! This function MUST be called before buselfs_state->merkle_tree_root_hash
  * ! is referenced!
@@ -841,9 +1043,13 @@ void update_merkle_tree_root_hash(buselfs_state_t * buselfs_state)
 {
     IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
+    blfs_lock_state(buselfs_state);
+
     if(mt_get_root(buselfs_state->merkle_tree, buselfs_state->merkle_tree_root_hash) != MT_SUCCESS)
         Throw(EXCEPTION_MERKLE_TREE_ROOT_FAILURE);
 
+    blfs_unlock_state(buselfs_state);
+
     IFDEBUG(dzlog_debug("merkle tree root hash:"));
     IFDEBUG(hdzlog_debug(buselfs_state->merkle_tree_root_hash, BLFS_CRYPTO_BYTES_MTRH));
 
@@ -853,8 +1059,59 @@ void update_merkle_tree_root_hash(buselfs_state_t * buselfs_state)
 void commit_merkle_tree_root_hash(buselfs_state_t * buselfs_state)
 {
     blfs_header_t * mtrh_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_MTRH);
+
+    blfs_lock_state(buselfs_state);
     memcpy(mtrh_header->data, buselfs_state->merkle_tree_root_hash, BLFS_HEAD_HEADER_BYTES_MTRH);
     blfs_commit_header(buselfs_state->backstore, mtrh_header);
+    blfs_unlock_state(buselfs_state);
+}
+
+void blfs_group_commit(buselfs_state_t * buselfs_state)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    blfs_lock_state(buselfs_state);
+
+    // ? Writes already underway (e.g. on another nbd connection) must land
+    // ? first or the committed root would not cover them. The state lock is
+    // ? only held once here, so waiting on it is safe
+    while(buselfs_state->writes_in_flight && buselfs_state->writes_drained != NULL)
+        pthread_cond_wait(buselfs_state->writes_drained, buselfs_state->state_lock);
+
+    // ? Keycounts and nugget metadata deferred since the last group commit go
+    // ? out first, sorted and coalesced, so the sync below covers them (and so
+    // ? they're never part of the uring batch)
+    blfs_commit_dirty_metadata(buselfs_state->backstore);
+
+    // ? With ioe_uring, both syncs and both headers go out as one linked
+    // ? submission; the ordering below still holds
+    blfs_backstore_begin_batch(buselfs_state->backstore);
+
+    if(buselfs_state->epoch_open)
+    {
+        blfs_header_t * tpmv_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER);
+
+        IFDEBUG(dzlog_debug("closing write epoch at global version %"PRIu64, *(uint64_t *) tpmv_header->data));
+
+        IFDEBUG(dzlog_debug("MERKLE TREE: update TPM header"));
+        update_in_merkle_tree(tpmv_header->data, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, 0, buselfs_state);
+        update_merkle_tree_root_hash(buselfs_state);
+
+        // ! Body and metadata must be on disk before the headers vouch for them
+        blfs_backstore_sync(buselfs_state->backstore);
+
+        blfs_commit_header(buselfs_state->backstore, tpmv_header);
+        commit_merkle_tree_root_hash(buselfs_state);
+
+        buselfs_state->epoch_open = FALSE;
+    }
+
+    blfs_backstore_sync(buselfs_state->backstore);
+    blfs_backstore_end_batch(buselfs_state->backstore);
+
+    blfs_unlock_state(buselfs_state);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
 void add_to_merkle_tree(uint8_t * data, size_t length, const buselfs_state_t * buselfs_state)
@@ -865,7 +1122,9 @@ void add_to_merkle_tree(uint8_t * data, size_t length, const buselfs_state_t * b
     IFDEBUG(dzlog_debug("data:"));
     IFDEBUG(hdzlog_debug(data, length));
 
+    blfs_lock_state(buselfs_state);
     mt_error_t err = mt_add(buselfs_state->merkle_tree, data, length);
+    blfs_unlock_state(buselfs_state);
 
     if(err != MT_SUCCESS)
     {
@@ -885,7 +1144,9 @@ void update_in_merkle_tree(uint8_t * data, size_t length, uint32_t index, const
     IFDEBUG(dzlog_debug("data:"));
     IFDEBUG(hdzlog_debug(data, length));
 
+    blfs_lock_state(buselfs_state);
     mt_error_t err = mt_update(buselfs_state->merkle_tree, data, length, index);
+    blfs_unlock_state(buselfs_state);
 
     if(err != MT_SUCCESS)
     {
@@ -905,7 +1166,9 @@ void verify_in_merkle_tree(uint8_t * data, size_t length, uint32_t index, const
     IFDEBUG(dzlog_debug("data:"));
     IFDEBUG(hdzlog_debug(data, length));
 
+    blfs_lock_state(buselfs_state);
     mt_error_t err = mt_verify(buselfs_state->merkle_tree, data, length, index);
+    blfs_unlock_state(buselfs_state);
 
     if(err != MT_SUCCESS)
     {
@@ -998,7 +1261,8 @@ void get_flake_key_using_keychain(uint8_t * flake_key,
 
 blfs_backstore_t * blfs_backstore_open_with_ctx(const char * path, buselfs_state_t * buselfs_state)
 {
-    blfs_backstore_t * backstore = blfs_backstore_open(path);
+    // ? With a metadata device, the headers are there and path holds the body
+    blfs_backstore_t * backstore = blfs_backstore_open(buselfs_state->metadata_path != NULL ? buselfs_state->metadata_path : path);
 
     // ? +1 for the byte that holds the swappable_cipher_e identifier associated
     // ? with that nugget
@@ -1020,295 +1284,1137 @@ blfs_backstore_t * blfs_backstore_open_with_ctx(const char * path, buselfs_state
     ));
 
     backstore->md_default_cipher_ident = buselfs_state->primary_cipher->enum_id;
+    backstore->nugget_tables.max_resident_bytes = buselfs_state->metadata_cache_bytes;
+
+    if(buselfs_state->metadata_path != NULL)
+        blfs_backstore_open_body_device(backstore, path);
 
+    blfs_backstore_open_stripe_members(backstore, buselfs_state->stripe_member_paths, buselfs_state->num_stripe_members);
     blfs_backstore_setup_actual_finish(backstore);
 
     return backstore;
 }
 
-int buse_read(void * output_buffer, uint32_t length, uint64_t absolute_offset, void * userdata)
+/**
+ * Registers a mutation (buse_write or buse_trim) with the current group commit
+ * epoch. Must be paired with leave_write_epoch.
+ */
+static void enter_write_epoch(buselfs_state_t * buselfs_state)
 {
-    IFDEBUGANY(dzlog_debug(">>>> entering %s", __func__));
-
-    uint8_t * buffer = (uint8_t *) output_buffer;
-    buselfs_state_t * buselfs_state = (buselfs_state_t *) userdata;
-    uint_fast32_t size = length;
-
-    if(buselfs_state->delay_rw)
-    {
-        IFDEBUGANY(dzlog_debug("buselfs_state->delay_rw = TRUE, delaying read for %u milliseconds", BLFS_DELAY_RW_PENALTY_MS));
-        usleep(BLFS_DELAY_RW_PENALTY_MS * 1000);
-    }
-
-    IFDEBUG(dzlog_debug("synchronizing application state..."));
-    if(absolute_offset < buselfs_state->buseops->size) // ! Race condition here if msg sent during rekeying
-        update_application_state_check_mq(buselfs_state);
+    blfs_header_t * tpmv_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER);
 
-    IFDEBUG(dzlog_debug("output_buffer (ptr): %p", (void *) output_buffer));
-    IFDEBUG(dzlog_debug("buffer (ptr): %p", (void *) buffer));
-    IFDEBUG(dzlog_debug("length: %"PRIu32, length));
-    IFDEBUG(dzlog_debug("absolute_offset: %"PRIu64, absolute_offset));
-    IFDEBUG(dzlog_debug("userdata (ptr): %p", (void *) userdata));
-    IFDEBUG(dzlog_debug("buselfs_state (ptr): %p", (void *) buselfs_state));
+    // ? The first write since the last group commit opens a new epoch by
+    // ? bumping the global version (one RPMB round trip). The header itself is
+    // ? only committed by blfs_group_commit, so until then a crash shows up as
+    // ? RPMB == header + 1 and every write in between shares the one bump (see
+    // ? leave_write_epoch for how blfs_soft_open tells that from tampering)
+    blfs_lock_state(buselfs_state);
 
-    // ? If we're in swap_mirrored mode, make sure to adjust abs offset
-    if(buselfs_state->active_swap_strategy == swap_mirrored
-        && buselfs_state->active_cipher_enum_id == buselfs_state->swap_cipher->enum_id
-        && absolute_offset < buselfs_state->buseops->size)
-    {
-        absolute_offset += buselfs_state->buseops->size;
-        IFDEBUG(assert(absolute_offset >= buselfs_state->buseops->size));
-    }
+    buselfs_state->writes_in_flight++;
 
-    // ? If we're in swap_selective mode, make sure to adjust abs offset
-    if(buselfs_state->active_swap_strategy == swap_selective
-        && buselfs_state->active_cipher_enum_id == buselfs_state->swap_cipher->enum_id
-        && absolute_offset < buselfs_state->buseops->size)
+    if(!buselfs_state->epoch_open)
     {
-        absolute_offset += buselfs_state->buseops->size;
-        IFDEBUG(assert(absolute_offset >= buselfs_state->buseops->size));
-    }
-
-    IFDEBUG(assert(absolute_offset < buselfs_state->backstore->writeable_size_actual));
-    IFDEBUG(dzlog_debug("FINAL absolute_offset: %"PRIu64, absolute_offset));
+        uint64_t tpmv_value = *(uint64_t *) tpmv_header->data;
 
-    uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
-    uint_fast32_t flake_size = buselfs_state->backstore->flake_size_bytes;
-    uint_fast32_t flakes_per_nugget = buselfs_state->backstore->flakes_per_nugget;
-    uint_fast32_t num_nuggets = buselfs_state->backstore->num_nuggets;
-    uint_fast32_t mt_offset = mt_calculate_expected_size(buselfs_state, 0);
+        IFDEBUG(dzlog_debug("tpmv_header->data:"));
+        IFDEBUG(dzlog_debug("was %"PRIu64, tpmv_value));
 
-    (void) num_nuggets; // ? Even when not debugging, no warnings from compiler!
+        tpmv_value++;
 
-    // ! For a bigger system, this cast could be a problem
-    uint_fast32_t nugget_offset          = (uint_fast32_t)(absolute_offset / nugget_size); // nugget_index
-    uint_fast32_t nugget_internal_offset = (uint_fast32_t)(absolute_offset % nugget_size); // internal point at which to start within nug
+        IFDEBUG(dzlog_debug("now %"PRIu64, tpmv_value));
 
-    IFDEBUG(dzlog_debug("nugget_size: %"PRIuFAST32, nugget_size));
-    IFDEBUG(dzlog_debug("flake_size: %"PRIuFAST32, flake_size));
-    IFDEBUG(dzlog_debug("num_nuggets: %"PRIuFAST32, num_nuggets));
-    IFDEBUG(dzlog_debug("flakes_per_nugget: %"PRIuFAST32, flakes_per_nugget));
-    IFDEBUG(dzlog_debug("mt_offset: %"PRIuFAST32, mt_offset));
-    IFDEBUGANY(dzlog_debug("nugget_offset (nugget index): %"PRIuFAST32, nugget_offset));
-    IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
+        memcpy(tpmv_header->data, (uint8_t *) &tpmv_value, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
 
-    blfs_swappable_cipher_t * active_cipher;
+        // ! Needs to be guaranteed monotonic in a real implementation, not based on header
+        blfs_globalversion_commit(buselfs_state->rpmb_secure_index, tpmv_value);
 
-    if(buselfs_state->active_swap_strategy == swap_mirrored || buselfs_state->active_swap_strategy == swap_selective)
-    {
-        active_cipher = absolute_offset < buselfs_state->buseops->size
-                        ? buselfs_state->primary_cipher
-                        : buselfs_state->swap_cipher;
+        buselfs_state->epoch_open = TRUE;
+        buselfs_state->epoch_drains = 0;
     }
 
-    else
-        active_cipher = blfs_get_active_cipher(buselfs_state);
-
-    int first_nugget = TRUE;
-
-    while(length != 0)
-    {
-        IFDEBUG(dzlog_debug("starting with length: %"PRIu32, length));
+    blfs_unlock_state(buselfs_state);
+}
 
-        (void) size;
-        IFDEBUG(assert(length > 0 && length <= size));
+/**
+ * Counterpart to enter_write_epoch. Headers and the merkle root are left for
+ * blfs_group_commit, but on the first and then every
+ * BLFS_EPOCH_RECORD_INTERVAL-th drain of an epoch the backstore's epoch record
+ * is brought up to date so a crash before the next group commit can still be
+ * recovered from by blfs_soft_open.
+ *
+ * ! Writes after the latest record are not vouched for by anything on the
+ * ! backstore: a crash among them leaves it matching no root, and opening it
+ * ! then requires --allow-insecure-start. Likewise, a backstore rolled back to
+ * ! any record of the current epoch will pass verification
+ */
+static void leave_write_epoch(buselfs_state_t * buselfs_state)
+{
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
 
-        uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT];
+    blfs_lock_state(buselfs_state);
 
-        uint_fast32_t buffer_read_length = MIN(length, nugget_size - nugget_internal_offset); // nmlen
-        uint_fast32_t first_affected_flake = nugget_internal_offset / flake_size;
-        uint_fast32_t num_affected_flakes =
-            CEIL((nugget_internal_offset + buffer_read_length), flake_size) - first_affected_flake;
-        uint_fast32_t nugget_read_length = num_affected_flakes * flake_size;
+    int drained = --buselfs_state->writes_in_flight == 0;
 
-        uint8_t nugget_data[nugget_read_length];
+    // ? Rewriting the record means flushing the deferred metadata and hashing
+    // ? up a root with state_lock held, which at queue depth 1 would be every
+    // ? write. The first drain must always write one though: without a record
+    // ? for this epoch, a crash is indistinguishable from tampering
+    int record_due = drained
+                     && buselfs_state->epoch_open
+                     && buselfs_state->backstore->epoch_record_offset
+                     && buselfs_state->epoch_drains++ % BLFS_EPOCH_RECORD_INTERVAL == 0;
 
-        int last_nugget = length - buffer_read_length == 0;
+    // ? The record vouches for everything on the backstore right now, so the
+    // ? deferred metadata has to go out ahead of it. An attacker can't forge
+    // ? one: the root covers the flake tags and TJ hashes, which need the key
+    if(record_due)
+    {
+        Try
+        {
+            blfs_header_t * tpmv_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER);
+            uint8_t root[BLFS_HEAD_HEADER_BYTES_MTRH];
 
-        IFDEBUG(dzlog_debug("first nugget: %s", first_nugget ? "YES" : "NO"));
-        IFDEBUG(dzlog_debug("last nugget: %s", last_nugget ? "YES" : "NO"));
+            blfs_commit_dirty_metadata(buselfs_state->backstore);
 
-        IFDEBUG(dzlog_debug("buffer_read_length: %"PRIuFAST32, buffer_read_length));
-        IFDEBUG(dzlog_debug("first_affected_flake: %"PRIuFAST32, first_affected_flake));
-        IFDEBUG(dzlog_debug("num_affected_flakes: %"PRIuFAST32, num_affected_flakes));
-        IFDEBUG(dzlog_debug("nugget_read_length: %"PRIuFAST32, nugget_read_length));
+            if(mt_get_root(buselfs_state->merkle_tree, root) != MT_SUCCESS)
+                Throw(EXCEPTION_MERKLE_TREE_ROOT_FAILURE);
 
-        if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
-        {
-            IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
-            blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_offset);
+            blfs_backstore_write_epoch_record(buselfs_state->backstore, *(uint64_t *) tpmv_header->data, root);
         }
 
-        else
+        Catch(e)
         {
-            IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
-            get_nugget_key_using_index(nugget_key, buselfs_state, nugget_offset);
+            if(buselfs_state->writes_drained != NULL)
+                pthread_cond_broadcast(buselfs_state->writes_drained);
+
+            blfs_unlock_state(buselfs_state);
+            Throw(e);
         }
+    }
 
-        IFDEBUG(dzlog_debug("nugget_key (initial 64 bytes):"));
-        IFDEBUG(hdzlog_debug(nugget_key, MIN(64U, BLFS_CRYPTO_BYTES_KDF_OUT)));
+    if(drained && buselfs_state->writes_drained != NULL)
+        pthread_cond_broadcast(buselfs_state->writes_drained);
 
-        blfs_keycount_t * count = blfs_open_keycount(buselfs_state->backstore, nugget_offset);
-        IFDEBUG(dzlog_debug("count->keycount: %"PRIu64, count->keycount));
+    blfs_unlock_state(buselfs_state);
+}
 
-        uint_fast32_t flake_index = first_affected_flake;
-        uint_fast32_t flake_end = first_affected_flake + num_affected_flakes;
+/**
+ * Counterpart to enter_write_epoch for a mutation that threw partway. The epoch
+ * record is left alone: the backstore need not match the merkle tree until
+ * some later write (or blfs_group_commit) gets through.
+ */
+static void abandon_write_epoch(buselfs_state_t * buselfs_state)
+{
+    blfs_lock_state(buselfs_state);
 
-        blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_offset);
+    if(--buselfs_state->writes_in_flight == 0 && buselfs_state->writes_drained != NULL)
+        pthread_cond_broadcast(buselfs_state->writes_drained);
 
-        IFDEBUG(dzlog_debug(">-> active_cipher enum id: %u", active_cipher->enum_id));
-        IFDEBUG(dzlog_debug(">-> nugget (meta) enum id: %u", meta->cipher_ident));
+    blfs_unlock_state(buselfs_state);
+}
 
-        int want_to_cipher_switch = active_cipher->enum_id != meta->cipher_ident;
-        int using_non_forward_strategy =  buselfs_state->active_swap_strategy == swap_mirrored
-                                       || buselfs_state->active_swap_strategy == swap_selective;
+/**
+ * Returns TRUE if every flake in [first_flake, first_flake + num_flakes) of the
+ * nugget is discarded: the nugget's metadata is flagged discarded (as buse_trim
+ * and creation leave it) and the flake's TJ bit is clear. Such flakes read back
+ * as zeros without touching the backstore.
+ */
+static int flakes_are_discarded(buselfs_state_t * buselfs_state,
+                                const blfs_nugget_metadata_t * meta,
+                                uint32_t nugget_index,
+                                uint32_t first_flake,
+                                uint32_t num_flakes)
+{
+    if(!meta->discarded)
+        return FALSE;
 
-        if(want_to_cipher_switch && !using_non_forward_strategy)
-        {
-            IFDEBUGANY(dzlog_notice("read() is triggering cipher switch..."));
-            buffer += blfs_swap_nugget_to_active_cipher(
-                SWAP_WHILE_READ,
-                last_nugget,
-                buselfs_state,
-                nugget_offset,
-                buffer,
-                buffer_read_length,
-                nugget_internal_offset
-            );
-        }
+    blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_index);
+    return !bitmask_any_bits_set(entry->bitmask, first_flake, num_flakes);
+}
 
-        else
-        {
-            IFDEBUG(assert(!want_to_cipher_switch));
-            IFDEBUGANY(dzlog_debug("(explicit cipher swap was not necessary for this nugget)"));
+/**
+ * Commits meta and points its merkle tree leaf at the result.
+ */
+static void commit_nugget_metadata_and_leaf(buselfs_state_t * buselfs_state, blfs_nugget_metadata_t * meta)
+{
+    uint8_t data[meta->data_length];
+    uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
 
-            IFDEBUG(dzlog_debug("blfs_backstore_read_body offset: %"PRIuFAST32,
-                                nugget_offset * nugget_size + first_affected_flake * flake_size));
+    blfs_commit_nugget_metadata(buselfs_state->backstore, meta);
 
-            blfs_backstore_read_body(buselfs_state->backstore,
-                                    nugget_data,
-                                    nugget_read_length,
-                                    nugget_offset * nugget_size + first_affected_flake * flake_size);
+    data[0] = BLFS_MD_IDENT_BYTE(meta);
 
-            IFDEBUG(dzlog_debug("nugget_data (initial 64 bytes):"));
-            IFDEBUG(hdzlog_debug(nugget_data, MIN(64U, nugget_read_length)));
+    if(meta->metadata_length)
+        memcpy(data + 1, meta->metadata, meta->metadata_length);
 
-            if(active_cipher->read_handle)
-            {
-                IFDEBUG4(dzlog_notice("[executing read handle with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
-
-                buffer += active_cipher->read_handle(
-                    buffer,
-                    buselfs_state,
-                    buffer_read_length,
-                    flake_index,
-                    flake_end,
-                    first_affected_flake,
-                    flake_size,
-                    flakes_per_nugget,
-                    mt_offset,
-                    nugget_data,
-                    nugget_key,
-                    nugget_offset,
-                    nugget_internal_offset,
-                    count,
-                    first_nugget,
-                    last_nugget
-                );
-            }
+    blfs_chacha20_struct_hash(hash, data, meta->data_length, buselfs_state->backstore->master_secret);
+    update_in_merkle_tree(hash, sizeof hash, mt_calculate_metadata_mt_index(buselfs_state, meta->nugget_index), buselfs_state);
+}
 
-            else
-            {
-                IFDEBUG4(dzlog_notice("[commencing typical read with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+/**
+ * A buse_read or buse_write request, split at nugget boundaries into num_parts
+ * parts: part i is the slice of the request that falls within the i-th nugget
+ * it touches. absolute_offset is final, i.e. already adjusted for the active
+ * swap strategy. Only valid while the caller holds the locks of every nugget
+ * the request touches.
+ */
+typedef struct rw_request_t
+{
+    buselfs_state_t * buselfs_state;
+    blfs_swappable_cipher_t * active_cipher;
+    uint8_t * buffer;
+    uint32_t length;
+    uint64_t absolute_offset;
+    uint32_t num_parts;
+} rw_request_t;
 
-                for(uint_fast32_t i = 0; flake_index < flake_end; flake_index++, i++)
-                {
-                    uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
-                    uint8_t tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+/**
+ * Yields the nugget a part of request falls within, where in that nugget the
+ * part begins, where in the request's buffer it begins, and its length.
+ */
+static void locate_request_part(const rw_request_t * request,
+                                uint32_t part,
+                                uint_fast32_t * nugget_offset,
+                                uint_fast32_t * nugget_internal_offset,
+                                uint_fast32_t * buffer_offset,
+                                uint_fast32_t * part_length)
+{
+    uint_fast32_t nugget_size = request->buselfs_state->backstore->nugget_size_bytes;
+    uint_fast32_t first_internal_offset = (uint_fast32_t)(request->absolute_offset % nugget_size);
+
+    *nugget_offset = (uint_fast32_t)(request->absolute_offset / nugget_size) + part;
+    *nugget_internal_offset = part == 0 ? first_internal_offset : 0;
+    *buffer_offset = part == 0 ? 0 : (nugget_size - first_internal_offset) + (part - 1) * nugget_size;
+    *part_length = MIN(request->length - *buffer_offset, nugget_size - *nugget_internal_offset);
+}
+
+/**
+ * Returns TRUE if the parts of request can safely be handed to the crypt_pool,
+ * i.e. there is a pool, there is more than one part, and none of the nuggets
+ * involved has to be swapped to the active cipher first. A swap may lock and
+ * rewrite the nuggets that follow it, which only the calling thread can do.
+ * When writing, no part may overwrite flakes either: rekeying reads the nugget
+ * back in through buse_read_actual, which takes the nugget locks the calling
+ * thread holds.
+ */
+static int request_can_fan_out(const rw_request_t * request, int writing)
+{
+    buselfs_state_t * buselfs_state = request->buselfs_state;
+
+    if(buselfs_state->crypt_pool == NULL || request->num_parts < 2)
+        return FALSE;
+
+    int using_non_forward_strategy =  buselfs_state->active_swap_strategy == swap_mirrored
+                                   || buselfs_state->active_swap_strategy == swap_selective;
+
+    uint_fast32_t first_nugget = (uint_fast32_t)(request->absolute_offset / buselfs_state->backstore->nugget_size_bytes);
+    uint_fast32_t flake_size = buselfs_state->backstore->flake_size_bytes;
+
+    for(uint_fast32_t nugget_index = first_nugget; nugget_index < first_nugget + request->num_parts; nugget_index++)
+    {
+        // ? Opening the metadata here also means the pool threads only ever hit
+        // ? the metadata cache, never insert into it
+        blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_index);
+
+        if(!using_non_forward_strategy && meta->cipher_ident != request->active_cipher->enum_id)
+        {
+            IFDEBUGANY(dzlog_debug("nugget %"PRIuFAST32" needs a cipher swap; not fanning out", nugget_index));
+            return FALSE;
+        }
+
+        if(writing)
+        {
+            uint_fast32_t nugget_offset;
+            uint_fast32_t nugget_internal_offset;
+            uint_fast32_t buffer_offset;
+            uint_fast32_t part_length;
+
+            locate_request_part(request, nugget_index - first_nugget, &nugget_offset, &nugget_internal_offset, &buffer_offset, &part_length);
+
+            uint_fast32_t first_affected_flake = nugget_internal_offset / flake_size;
+            uint_fast32_t num_affected_flakes = CEIL((nugget_internal_offset + part_length), flake_size) - first_affected_flake;
+
+            blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_index);
+
+            if(bitmask_any_bits_set(entry->bitmask, first_affected_flake, num_affected_flakes))
+            {
+                IFDEBUGANY(dzlog_debug("nugget %"PRIuFAST32" would be rekeyed; not fanning out", nugget_index));
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * Reads part (one nugget's worth) of the buse_read request described by
+ * context. Called once per part, possibly on a crypt_pool thread; see
+ * buse_read.
+ */
+static void read_request_part(void * context, uint32_t part)
+{
+    const rw_request_t * request = (const rw_request_t *) context;
+    buselfs_state_t * buselfs_state = request->buselfs_state;
+    blfs_swappable_cipher_t * active_cipher = request->active_cipher;
+
+    uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint_fast32_t flake_size = buselfs_state->backstore->flake_size_bytes;
+    uint_fast32_t flakes_per_nugget = buselfs_state->backstore->flakes_per_nugget;
+    uint_fast32_t mt_offset = mt_calculate_expected_size(buselfs_state, 0);
+
+    uint_fast32_t nugget_offset;
+    uint_fast32_t nugget_internal_offset;
+    uint_fast32_t buffer_offset;
+    uint_fast32_t buffer_read_length; // nmlen
+
+    locate_request_part(request, part, &nugget_offset, &nugget_internal_offset, &buffer_offset, &buffer_read_length);
+
+    uint8_t * buffer = request->buffer + buffer_offset;
+
+    IFDEBUGANY(dzlog_debug("reading part %"PRIu32" of %"PRIu32" (nugget %"PRIuFAST32")", part, request->num_parts, nugget_offset));
+    IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
+    IFDEBUG(dzlog_debug("buffer_offset: %"PRIuFAST32, buffer_offset));
+
+    uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT];
+
+    uint_fast32_t first_affected_flake = nugget_internal_offset / flake_size;
+    uint_fast32_t num_affected_flakes =
+        CEIL((nugget_internal_offset + buffer_read_length), flake_size) - first_affected_flake;
+    uint_fast32_t nugget_read_length = num_affected_flakes * flake_size;
+
+    uint8_t nugget_data[nugget_read_length];
+
+    int first_nugget = part == 0;
+    int last_nugget = part == request->num_parts - 1;
+
+    IFDEBUG(dzlog_debug("first nugget: %s", first_nugget ? "YES" : "NO"));
+    IFDEBUG(dzlog_debug("last nugget: %s", last_nugget ? "YES" : "NO"));
+
+    IFDEBUG(dzlog_debug("buffer_read_length: %"PRIuFAST32, buffer_read_length));
+    IFDEBUG(dzlog_debug("first_affected_flake: %"PRIuFAST32, first_affected_flake));
+    IFDEBUG(dzlog_debug("num_affected_flakes: %"PRIuFAST32, num_affected_flakes));
+    IFDEBUG(dzlog_debug("nugget_read_length: %"PRIuFAST32, nugget_read_length));
+
+    if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+    {
+        IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
+        blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_offset);
+    }
+
+    else
+    {
+        IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
+        get_nugget_key_using_index(nugget_key, buselfs_state, nugget_offset);
+    }
+
+    IFDEBUG(dzlog_debug("nugget_key (initial 64 bytes):"));
+    IFDEBUG(hdzlog_debug(nugget_key, MIN(64U, BLFS_CRYPTO_BYTES_KDF_OUT)));
+
+    blfs_keycount_t * count = blfs_open_keycount(buselfs_state->backstore, nugget_offset);
+    IFDEBUG(dzlog_debug("count->keycount: %"PRIu64, count->keycount));
+
+    uint_fast32_t flake_index = first_affected_flake;
+    uint_fast32_t flake_end = first_affected_flake + num_affected_flakes;
+
+    blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_offset);
+
+    IFDEBUG(dzlog_debug(">-> active_cipher enum id: %u", active_cipher->enum_id));
+    IFDEBUG(dzlog_debug(">-> nugget (meta) enum id: %u", meta->cipher_ident));
+
+    int want_to_cipher_switch = active_cipher->enum_id != meta->cipher_ident;
+    int using_non_forward_strategy =  buselfs_state->active_swap_strategy == swap_mirrored
+                                   || buselfs_state->active_swap_strategy == swap_selective;
+
+    if(want_to_cipher_switch && !using_non_forward_strategy)
+    {
+        IFDEBUGANY(dzlog_notice("read() is triggering cipher switch..."));
+        blfs_swap_nugget_to_active_cipher(
+            SWAP_WHILE_READ,
+            last_nugget,
+            buselfs_state,
+            nugget_offset,
+            buffer,
+            buffer_read_length,
+            nugget_internal_offset
+        );
+    }
+
+    else if(buselfs_state->readahead != NULL && readahead_copy_out(buselfs_state->readahead,
+                                                                   nugget_offset,
+                                                                   buffer,
+                                                                   nugget_internal_offset,
+                                                                   buffer_read_length))
+    {
+        IFDEBUGANY(dzlog_debug("(nugget was read ahead, copied out of the read-ahead buffer)"));
+    }
+
+    else if(flakes_are_discarded(buselfs_state, meta, nugget_offset, first_affected_flake, num_affected_flakes))
+    {
+        IFDEBUGANY(dzlog_debug("(affected flakes were discarded, reading zeros)"));
+
+        memset(buffer, 0, buffer_read_length);
+    }
+
+    else
+    {
+        IFDEBUG(assert(!want_to_cipher_switch));
+        IFDEBUGANY(dzlog_debug("(explicit cipher swap was not necessary for this nugget)"));
+
+        IFDEBUG(dzlog_debug("blfs_backstore_read_body offset: %"PRIuFAST32,
+                            nugget_offset * nugget_size + first_affected_flake * flake_size));
+
+        blfs_backstore_read_body(buselfs_state->backstore,
+                                nugget_data,
+                                nugget_read_length,
+                                nugget_offset * nugget_size + first_affected_flake * flake_size);
+
+        IFDEBUG(dzlog_debug("nugget_data (initial 64 bytes):"));
+        IFDEBUG(hdzlog_debug(nugget_data, MIN(64U, nugget_read_length)));
+
+        if(active_cipher->read_handle)
+        {
+            IFDEBUG4(dzlog_notice("[executing read handle with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+
+            active_cipher->read_handle(
+                buffer,
+                buselfs_state,
+                buffer_read_length,
+                flake_index,
+                flake_end,
+                first_affected_flake,
+                flake_size,
+                flakes_per_nugget,
+                mt_offset,
+                nugget_data,
+                nugget_key,
+                nugget_offset,
+                nugget_internal_offset,
+                count,
+                first_nugget,
+                last_nugget
+            );
+        }
+
+        else
+        {
+            IFDEBUG4(dzlog_notice("[commencing typical read with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+
+            for(uint_fast32_t i = 0; flake_index < flake_end; flake_index++, i++)
+            {
+                uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
+                uint8_t tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+
+                if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+                {
+                    IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
+                    blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
+                }
+
+                else
+                {
+                    IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
+                    get_flake_key_using_keychain(flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
+                }
+
+                IFDEBUG(dzlog_debug("nugget index (offset): %"PRIuFAST32, nugget_offset));
+                IFDEBUG(dzlog_debug("flake_index: %"PRIuFAST32" of %"PRIuFAST32, flake_index, flake_end-1));
+                IFDEBUG(dzlog_debug("flake_key (initial 64 bytes):"));
+                IFDEBUG(hdzlog_debug(flake_key, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY)));
+
+                IFDEBUG(dzlog_debug("blfs_poly1305_generate_tag calculated ptr: %p --[ + "
+                                    "%"PRIuFAST32" * %"PRIuFAST32" => %"PRIuFAST32
+                                    " ]> %p (gen tag for %"PRIuFAST32" bytes)",
+                                    (void *) nugget_data,
+                                    flake_index,
+                                    flake_size,
+                                    flake_index * flake_size,
+                                    (void *) (nugget_data + (i * flake_size)),
+                                    flake_size));
+
+                blfs_poly1305_generate_tag(tag, nugget_data + (i * flake_size), flake_size, flake_key);
+
+                IFDEBUG(dzlog_debug("tag (initial 64 bytes):"));
+                IFDEBUG(hdzlog_debug(tag, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT)));
+
+                IFDEBUG(dzlog_debug("verify_in_merkle_tree calculated offset: %"PRIuFAST32,
+                                    mt_offset + nugget_offset * flakes_per_nugget + flake_index));
+
+                verify_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
+            }
+
+            IFDEBUG(dzlog_debug(
+                "blfs_crypt calculated ptr: %p --[ + "
+                "%"PRIuFAST32" - %"PRIuFAST32" * %"PRIuFAST32" => %"PRIuFAST32
+                " ]> %p (crypting %"PRIuFAST32" bytes)",
+                (void *) nugget_data,
+                nugget_internal_offset,
+                first_affected_flake,
+                flake_size,
+                nugget_internal_offset - first_affected_flake * flake_size,
+                (void *) (nugget_data + (nugget_internal_offset - first_affected_flake * flake_size)),
+                buffer_read_length
+            ));
+
+            blfs_swappable_crypt(
+                active_cipher,
+                buffer,
+                nugget_data + (nugget_internal_offset - first_affected_flake * flake_size),
+                buffer_read_length,
+                nugget_key,
+                count->keycount,
+                nugget_internal_offset
+            );
+
+            // ? A discarded nugget written to since still has discarded flakes
+            // ? among its written ones, and those read as zeros
+            if(meta->discarded)
+            {
+                blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_offset);
+
+                for(uint_fast32_t zero_index = first_affected_flake; zero_index < flake_end; zero_index++)
+                {
+                    if(bitmask_is_bit_set(entry->bitmask, zero_index))
+                        continue;
+
+                    uint64_t zero_begin = MAX((uint64_t) zero_index * flake_size, (uint64_t) nugget_internal_offset);
+                    uint64_t zero_end = MIN((uint64_t) (zero_index + 1) * flake_size, (uint64_t) nugget_internal_offset + buffer_read_length);
+
+                    memset(buffer + (zero_begin - nugget_internal_offset), 0, zero_end - zero_begin);
+                }
+            }
+
+            IFDEBUG(dzlog_debug("buffer final contents (initial 64 bytes):"));
+            IFDEBUG(hdzlog_debug(buffer, MIN(64U, buffer_read_length)));
+        }
+    }
+}
+
+/**
+ * The nuggets fill_read_ahead decrypts into the read-ahead buffer. request is
+ * filled in per nugget by read_ahead_part.
+ */
+typedef struct read_ahead_t
+{
+    rw_request_t request;
+    const uint64_t * nuggets;
+    uint8_t * data;
+    uint32_t stream;
+} read_ahead_t;
+
+/**
+ * Reads, verifies, and decrypts the part-th nugget of the read_ahead_t context
+ * in whole, then puts it into the read-ahead buffer. Called once per nugget,
+ * possibly on a crypt_pool thread; see fill_read_ahead.
+ */
+static void read_ahead_part(void * context, uint32_t part)
+{
+    const read_ahead_t * ahead = (const read_ahead_t *) context;
+    buselfs_state_t * buselfs_state = ahead->request.buselfs_state;
+
+    uint32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint8_t * data = ahead->data + (uint64_t) part * nugget_size;
+
+    rw_request_t request = ahead->request;
+
+    request.buffer = data;
+    request.length = nugget_size;
+    request.absolute_offset = ahead->nuggets[part] * nugget_size;
+    request.num_parts = 1;
+
+    read_request_part(&request, 0);
+    readahead_insert(buselfs_state->readahead, ahead->nuggets[part], data, ahead->stream);
+}
+
+/**
+ * Tells the read-ahead buffer about a buse_read of length bytes at (final)
+ * absolute_offset and, should that continue a sequential stream, schedules the
+ * nuggets after it to be read ahead by fill_read_ahead on the read-ahead
+ * thread. Returns without waiting for them.
+ */
+static void read_ahead(buselfs_state_t * buselfs_state, uint64_t absolute_offset, uint32_t length)
+{
+    uint64_t first_nugget = 0;
+    uint32_t stream = 0;
+    uint32_t count = readahead_note_read(buselfs_state->readahead, absolute_offset, length, &first_nugget, &stream);
+
+    uint64_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint64_t end_nugget = buselfs_state->backstore->num_nuggets;
+
+    // ? The two halves use different ciphers, so a stream never crosses over
+    if((buselfs_state->active_swap_strategy == swap_mirrored || buselfs_state->active_swap_strategy == swap_selective)
+       && absolute_offset < buselfs_state->buseops->size)
+    {
+        end_nugget = buselfs_state->buseops->size / nugget_size;
+    }
+
+    if(count == 0 || first_nugget >= end_nugget)
+        return;
+
+    readahead_schedule(buselfs_state->readahead,
+                       first_nugget,
+                       (uint32_t) MIN((uint64_t) count, end_nugget - first_nugget),
+                       stream);
+}
+
+/**
+ * Reads count nuggets from first_nugget on ahead (see read_ahead): each is read
+ * in whole, verified, and decrypted into the read-ahead buffer, fanned out
+ * across the crypt_pool when there is one. Nuggets that are already buffered
+ * or would first need a cipher swap are skipped; the latter are left to
+ * buse_read proper. Runs on the read-ahead thread (see readahead_start), which
+ * holds no other locks.
+ */
+static void fill_read_ahead(void * context, uint64_t first_nugget, uint32_t count, uint32_t stream)
+{
+    buselfs_state_t * buselfs_state = (buselfs_state_t *) context;
+    uint64_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+
+    int using_non_forward_strategy =  buselfs_state->active_swap_strategy == swap_mirrored
+                                   || buselfs_state->active_swap_strategy == swap_selective;
+
+    blfs_swappable_cipher_t * active_cipher;
+
+    // ? read_ahead never schedules across the halves, so the first nugget
+    // ? tells which one this is
+    if(using_non_forward_strategy)
+    {
+        active_cipher = first_nugget * nugget_size < buselfs_state->buseops->size
+                        ? buselfs_state->primary_cipher
+                        : buselfs_state->swap_cipher;
+    }
+
+    else
+        active_cipher = blfs_get_active_cipher(buselfs_state);
+
+    uint64_t last_nugget = first_nugget + count - 1;
+    uint64_t nuggets[count];
+    uint32_t num_nuggets = 0;
+
+    blfs_lock_nuggets(buselfs_state, first_nugget, last_nugget);
+
+    for(uint64_t nugget_index = first_nugget; nugget_index <= last_nugget; nugget_index++)
+    {
+        // ? As in request_can_fan_out, the metadata is opened on this thread
+        blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_index);
+
+        if(readahead_contains(buselfs_state->readahead, nugget_index)
+           || (!using_non_forward_strategy && meta->cipher_ident != active_cipher->enum_id))
+        {
+            continue;
+        }
+
+        nuggets[num_nuggets++] = nugget_index;
+    }
+
+    IFDEBUGANY(dzlog_debug("reading ahead %"PRIu32" of nuggets [%"PRIu64", %"PRIu64"]", num_nuggets, first_nugget, last_nugget));
+
+    uint8_t * data = malloc(num_nuggets * nugget_size);
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    read_ahead_t ahead = {
+        .request = {
+            .buselfs_state = buselfs_state,
+            .active_cipher = active_cipher
+        },
+        .nuggets = nuggets,
+        .data = data,
+        .stream = stream
+    };
+
+    Try
+    {
+        if(num_nuggets && data == NULL)
+            Throw(EXCEPTION_ALLOC_FAILURE);
+
+        pool_run(buselfs_state->crypt_pool, read_ahead_part, &ahead, num_nuggets);
+    }
+
+    Catch(e)
+    {
+        free(data);
+        blfs_unlock_nuggets(buselfs_state, first_nugget, last_nugget);
+        Throw(e);
+    }
+
+    free(data);
+    blfs_unlock_nuggets(buselfs_state, first_nugget, last_nugget);
+}
+
+/**
+ * Everything buse_read does except trimming the nugget tables, which would be
+ * unsafe for blfs_rekey_nugget_then_write: it reads through this while holding
+ * entries (and the locks) of the nugget being rekeyed. That read is no part of
+ * a stream either, so it passes a zero may_read_ahead.
+ */
+static int buse_read_actual(void * output_buffer, uint32_t length, uint64_t absolute_offset, void * userdata, int may_read_ahead)
+{
+    IFDEBUGANY(dzlog_debug(">>>> entering %s", __func__));
+
+    uint8_t * buffer = (uint8_t *) output_buffer;
+    buselfs_state_t * buselfs_state = (buselfs_state_t *) userdata;
+
+    if(buselfs_state->delay_rw)
+    {
+        IFDEBUGANY(dzlog_debug("buselfs_state->delay_rw = TRUE, delaying read for %u milliseconds", BLFS_DELAY_RW_PENALTY_MS));
+        usleep(BLFS_DELAY_RW_PENALTY_MS * 1000);
+    }
+
+    IFDEBUG(dzlog_debug("synchronizing application state..."));
+    if(absolute_offset < buselfs_state->buseops->size) // ! Race condition here if msg sent during rekeying
+        update_application_state_check_mq(buselfs_state);
+
+    IFDEBUG(dzlog_debug("output_buffer (ptr): %p", (void *) output_buffer));
+    IFDEBUG(dzlog_debug("buffer (ptr): %p", (void *) buffer));
+    IFDEBUG(dzlog_debug("length: %"PRIu32, length));
+    IFDEBUG(dzlog_debug("absolute_offset: %"PRIu64, absolute_offset));
+    IFDEBUG(dzlog_debug("userdata (ptr): %p", (void *) userdata));
+    IFDEBUG(dzlog_debug("buselfs_state (ptr): %p", (void *) buselfs_state));
+
+    // ? If we're in swap_mirrored mode, make sure to adjust abs offset
+    if(buselfs_state->active_swap_strategy == swap_mirrored
+        && buselfs_state->active_cipher_enum_id == buselfs_state->swap_cipher->enum_id
+        && absolute_offset < buselfs_state->buseops->size)
+    {
+        absolute_offset += buselfs_state->buseops->size;
+        IFDEBUG(assert(absolute_offset >= buselfs_state->buseops->size));
+    }
+
+    // ? If we're in swap_selective mode, make sure to adjust abs offset
+    if(buselfs_state->active_swap_strategy == swap_selective
+        && buselfs_state->active_cipher_enum_id == buselfs_state->swap_cipher->enum_id
+        && absolute_offset < buselfs_state->buseops->size)
+    {
+        absolute_offset += buselfs_state->buseops->size;
+        IFDEBUG(assert(absolute_offset >= buselfs_state->buseops->size));
+    }
+
+    IFDEBUG(assert(absolute_offset < buselfs_state->backstore->writeable_size_actual));
+    IFDEBUG(dzlog_debug("FINAL absolute_offset: %"PRIu64, absolute_offset));
+
+    uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+
+    // ! For a bigger system, this cast could be a problem
+    uint_fast32_t nugget_offset = (uint_fast32_t)(absolute_offset / nugget_size); // nugget_index
+
+    IFDEBUG(dzlog_debug("nugget_size: %"PRIuFAST32, nugget_size));
+    IFDEBUGANY(dzlog_debug("nugget_offset (nugget index): %"PRIuFAST32, nugget_offset));
+
+    uint_fast32_t first_locked_nugget = nugget_offset;
+    uint_fast32_t last_locked_nugget = length ? (uint_fast32_t)((absolute_offset + length - 1) / nugget_size) : nugget_offset;
+
+    blfs_lock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
+
+    blfs_swappable_cipher_t * active_cipher;
+
+    if(buselfs_state->active_swap_strategy == swap_mirrored || buselfs_state->active_swap_strategy == swap_selective)
+    {
+        active_cipher = absolute_offset < buselfs_state->buseops->size
+                        ? buselfs_state->primary_cipher
+                        : buselfs_state->swap_cipher;
+    }
+
+    else
+        active_cipher = blfs_get_active_cipher(buselfs_state);
+
+    rw_request_t request = {
+        .buselfs_state = buselfs_state,
+        .active_cipher = active_cipher,
+        .buffer = buffer,
+        .length = length,
+        .absolute_offset = absolute_offset,
+        .num_parts = length ? (uint32_t)(last_locked_nugget - first_locked_nugget + 1) : 0
+    };
+
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    // ? Every part runs under the nugget locks this thread holds
+    Try
+    {
+        pool_run(request_can_fan_out(&request, FALSE) ? buselfs_state->crypt_pool : NULL, read_request_part, &request, request.num_parts);
+    }
+
+    Catch(e)
+    {
+        blfs_unlock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
+        Throw(e);
+    }
+
+    blfs_unlock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
+
+    if(may_read_ahead && buselfs_state->readahead != NULL)
+        read_ahead(buselfs_state, absolute_offset, length);
+
+    IFDEBUGANY(dzlog_debug("<<<< leaving %s", __func__));
+    return 0;
+}
+
+int buse_read(void * output_buffer, uint32_t length, uint64_t absolute_offset, void * userdata)
+{
+    int result = buse_read_actual(output_buffer, length, absolute_offset, userdata, TRUE);
+
+    trim_nugget_tables((buselfs_state_t *) userdata);
+    return result;
+}
+
+/**
+ * Writes part (one nugget's worth) of the buse_write request described by
+ * context. Called once per part, possibly on a crypt_pool thread; see
+ * buse_write.
+ */
+static void write_request_part(void * context, uint32_t part)
+{
+    const rw_request_t * request = (const rw_request_t *) context;
+    buselfs_state_t * buselfs_state = request->buselfs_state;
+    blfs_swappable_cipher_t * active_cipher = request->active_cipher;
+
+    uint_fast32_t nugget_size       = buselfs_state->backstore->nugget_size_bytes;
+    uint_fast32_t flake_size        = buselfs_state->backstore->flake_size_bytes;
+    uint_fast32_t flakes_per_nugget = buselfs_state->backstore->flakes_per_nugget;
+    uint_fast32_t mt_offset         = mt_calculate_expected_size(buselfs_state, 0);
+
+    uint_fast32_t nugget_offset;
+    uint_fast32_t nugget_internal_offset;
+    uint_fast32_t buffer_offset;
+    uint_fast32_t buffer_write_length; // nmlen
+
+    locate_request_part(request, part, &nugget_offset, &nugget_internal_offset, &buffer_offset, &buffer_write_length);
+
+    const uint8_t * buffer = request->buffer + buffer_offset;
+
+    IFDEBUGANY(dzlog_debug("writing part %"PRIu32" of %"PRIu32" (nugget %"PRIuFAST32")", part, request->num_parts, nugget_offset));
+    IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
+    IFDEBUG(dzlog_debug("buffer_offset: %"PRIuFAST32, buffer_offset));
+
+    uint_fast32_t first_affected_flake = nugget_internal_offset / flake_size;
+    uint_fast32_t num_affected_flakes =
+        CEIL((nugget_internal_offset + buffer_write_length), flake_size) - first_affected_flake;
+
+    IFDEBUG(dzlog_debug("buffer_write_length: %"PRIuFAST32, buffer_write_length));
+    IFDEBUG(dzlog_debug("first_affected_flake: %"PRIuFAST32, first_affected_flake));
+    IFDEBUG(dzlog_debug("num_affected_flakes: %"PRIuFAST32, num_affected_flakes));
+
+    uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT];
+
+    if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+    {
+        IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
+        blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_offset);
+    }
+
+    else
+    {
+        IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
+        get_nugget_key_using_index(nugget_key, buselfs_state, nugget_offset);
+    }
+
+    IFDEBUG(dzlog_debug("nugget_key (initial 64 bytes):"));
+    IFDEBUG(hdzlog_debug(nugget_key, MIN(64U, BLFS_CRYPTO_BYTES_KDF_OUT)));
+
+    blfs_keycount_t * count = blfs_open_keycount(buselfs_state->backstore, nugget_offset);
+    IFDEBUG(dzlog_debug("count->keycount: %"PRIu64, count->keycount));
+
+    uint_fast32_t flake_internal_offset = nugget_internal_offset % flake_size;
+    uint_fast32_t flake_total_bytes_to_write = buffer_write_length;
+
+    IFDEBUG(dzlog_debug("buffer_write_length: %"PRIuFAST32, buffer_write_length));
+    IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
+    IFDEBUG(dzlog_debug("flake_size: %"PRIuFAST32, flake_size));
+    IFDEBUG(dzlog_debug("flake_internal_offset: %"PRIuFAST32, flake_internal_offset));
 
-                    if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
-                    {
-                        IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
-                        blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
-                    }
+    int last_nugget = part == request->num_parts - 1;
+
+    IFDEBUG(dzlog_debug("last nugget: %s", last_nugget ? "YES" : "NO"));
+
+    uint_fast32_t flake_index = first_affected_flake;
+    uint_fast32_t flake_end = first_affected_flake + num_affected_flakes;
+
+    blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_offset);
+
+    IFDEBUGANY(dzlog_debug(">-> active_cipher enum id: %u", active_cipher->enum_id));
+    IFDEBUGANY(dzlog_debug(">-> nugget (meta) enum id: %u", meta->cipher_ident));
+
+    if(!(buselfs_state->active_swap_strategy == swap_mirrored
+        || buselfs_state->active_swap_strategy == swap_selective)
+       && active_cipher->enum_id != meta->cipher_ident)
+    {
+        IFDEBUGANY(dzlog_notice("write() is triggering cipher switch..."));
+
+        blfs_swap_nugget_to_active_cipher(
+            SWAP_WHILE_WRITE,
+            last_nugget,
+            buselfs_state,
+            nugget_offset,
+            (uint8_t *) buffer, // ! Don't worry, we'll be good...
+            buffer_write_length,
+            nugget_internal_offset
+        );
+    }
+
+    else
+    {
+        IFDEBUGANY(dzlog_notice("(explicit cipher swap was not necessary for this nugget)"));
+
+        blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_offset);
+
+        // ? Only set for the typical write, whose flakes are all staged here so
+        // ? their body writes can go out together with the TJ entry (see io.h)
+        uint8_t * flakes_data = NULL;
+
+        IFDEBUG(dzlog_debug("entry->bitmask (pre-update):"));
+        IFDEBUG(hdzlog_debug(entry->bitmask->mask, entry->bitmask->byte_length));
+
+        if(active_cipher->write_handle)
+        {
+            IFDEBUG4(dzlog_notice("[executing write handle with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+            active_cipher->write_handle(
+                buffer,
+                buselfs_state,
+                buffer_write_length,
+                flake_index,
+                flake_end,
+                flake_size,
+                flakes_per_nugget,
+                flake_internal_offset,
+                mt_offset,
+                nugget_key,
+                nugget_offset,
+                count
+            );
+        }
+
+        else
+        {
+            // ? First, check if this constitutes an overwrite...
+            if(bitmask_any_bits_set(entry->bitmask, first_affected_flake, num_affected_flakes))
+            {
+                IFDEBUGANY(dzlog_notice("OVERWRITE DETECTED! PERFORMING IN-PLACE JOURNALED REKEYING + WRITE (l=%"PRIuFAST32")", buffer_write_length));
+                blfs_rekey_nugget_then_write(buselfs_state, nugget_offset, buffer, buffer_write_length, nugget_internal_offset);
+            }
 
-                    else
+            else
+            {
+                // ! Maybe update and commit the MTRH here first and again later?
+                IFDEBUG4(dzlog_notice("[commencing typical write with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+
+                flakes_data = malloc(num_affected_flakes * flake_size);
+
+                if(flakes_data == NULL)
+                    Throw(EXCEPTION_ALLOC_FAILURE);
+
+                blfs_backstore_begin_batch(buselfs_state->backstore);
+
+                volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+                // ? Should anything below throw, the batch must still be ended (or
+                // ? every later write on this thread would only ever be queued)
+                Try
+                {
+                    // ? The part of flakes_data that actually changed. Every flake
+                    // ? in between is written whole, so this is one contiguous run
+                    uint_fast32_t body_start = 0;
+                    uint_fast32_t body_end = 0;
+
+                    for(uint_fast32_t i = 0; flake_index < flake_end; flake_index++, i++)
                     {
-                        IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
-                        get_flake_key_using_keychain(flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
-                    }
+                        uint_fast32_t flake_write_length = MIN(flake_total_bytes_to_write, flake_size - flake_internal_offset);
+
+                        IFDEBUG(dzlog_debug("flake_write_length: %"PRIuFAST32, flake_write_length));
+                        IFDEBUG(dzlog_debug("flake_index: %"PRIuFAST32, flake_index));
+                        IFDEBUG(dzlog_debug("flake_end: %"PRIuFAST32, flake_end));
+
+                        uint8_t * flake_data = flakes_data + i * flake_size;
+                        IFDEBUG(memset(flake_data, 0, flake_size));
+
+                        int unaligned = flake_internal_offset != 0 || flake_internal_offset + flake_write_length < flake_size;
+                        int discarded = unaligned && flakes_are_discarded(buselfs_state, meta, nugget_offset, flake_index, 1);
+
+                        // ? A discarded flake reads as zeros, so the bytes this
+                        // ? write doesn't cover must be encrypted zeros too
+                        if(discarded)
+                        {
+                            IFDEBUGANY(dzlog_notice("UNALIGNED! Write flake was discarded; filling in zeros"));
+
+                            blfs_swappable_crypt(
+                                active_cipher,
+                                flake_data,
+                                zero_flake,
+                                flake_size,
+                                nugget_key,
+                                count->keycount,
+                                flake_index * flake_size
+                            );
+                        }
+
+                        // ! Data to write isn't aligned and/or is smaller than
+                        // ! flake_size, so we need to verify its integrity
+                        else if(unaligned)
+                        {
+                            IFDEBUGANY(dzlog_notice("UNALIGNED! Write flake requires verification"));
+
+                            // Read in the entire flake
+                            blfs_backstore_read_body(buselfs_state->backstore,
+                                                    flake_data,
+                                                    flake_size,
+                                                    nugget_offset * nugget_size + flake_index * flake_size);
+
+                            // Generate a local flake key
+                            uint8_t local_flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
+                            uint8_t local_tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+
+                            if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+                            {
+                                IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
+                                blfs_poly1305_key_from_data(local_flake_key, nugget_key, flake_index, count->keycount);
+                            }
+
+                            else
+                            {
+                                IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
+                                get_flake_key_using_keychain(local_flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
+                            }
+
+                            // Generate tag
+                            blfs_poly1305_generate_tag(local_tag, flake_data, flake_size, local_flake_key);
+
+                            // Check tag in Merkle Tree
+                            verify_in_merkle_tree(local_tag, sizeof local_tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
+                        }
+
+                        IFDEBUG(dzlog_debug("INCOMPLETE flake_data (initial 64 bytes):"));
+                        IFDEBUG(hdzlog_debug(flake_data, MIN(64U, flake_size)));
+
+                        IFDEBUG(dzlog_debug("buffer at this point (initial 64 bytes):"));
+                        IFDEBUG(hdzlog_debug(buffer, MIN(64U, flake_total_bytes_to_write)));
+
+                        IFDEBUG(dzlog_debug("blfs_crypt calculated src length: %"PRIuFAST32, flake_write_length));
+
+                        IFDEBUG(dzlog_debug("blfs_crypt calculated dest offset: %"PRIuFAST32,
+                                        i * flake_size));
+
+                        IFDEBUG(dzlog_debug("blfs_crypt calculated nio: %"PRIuFAST32,
+                                        flake_index * flake_size + flake_internal_offset));
+
+                        blfs_swappable_crypt(
+                            active_cipher,
+                            flake_data + flake_internal_offset,
+                            buffer,
+                            flake_write_length,
+                            nugget_key,
+                            count->keycount,
+                            flake_index * flake_size + flake_internal_offset
+                        );
+
+                        IFDEBUG(dzlog_debug("*complete* flake_data (initial 64 bytes):"));
+                        IFDEBUG(hdzlog_debug(flake_data, MIN(64U, flake_size)));
+
+                        uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
+                        uint8_t tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+
+                        if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+                        {
+                            IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
+                            blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
+                        }
+
+                        else
+                        {
+                            IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
+                            get_flake_key_using_keychain(flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
+                        }
+
+                        blfs_poly1305_generate_tag(tag, flake_data, flake_size, flake_key);
+
+                        IFDEBUG(dzlog_debug("flake_key (initial 64 bytes):"));
+                        IFDEBUG(hdzlog_debug(flake_key, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY)));
+
+                        IFDEBUG(dzlog_debug("tag (initial 64 bytes):"));
+                        IFDEBUG(hdzlog_debug(tag, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT)));
+
+                        IFDEBUG(dzlog_debug("update_in_merkle_tree calculated offset: %"PRIuFAST32,
+                                            mt_offset + nugget_offset * flakes_per_nugget + flake_index));
+
+                        update_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
+
+                        // ? The filled in zeros of a discarded flake go out with the write
+                        uint_fast32_t body_offset = discarded ? 0 : flake_internal_offset;
+                        uint_fast32_t body_length = discarded ? flake_size : flake_write_length;
 
-                    IFDEBUG(dzlog_debug("nugget index (offset): %"PRIuFAST32, nugget_offset));
-                    IFDEBUG(dzlog_debug("flake_index: %"PRIuFAST32" of %"PRIuFAST32, flake_index, flake_end-1));
-                    IFDEBUG(dzlog_debug("flake_key (initial 64 bytes):"));
-                    IFDEBUG(hdzlog_debug(flake_key, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY)));
+                        if(i == 0)
+                            body_start = body_offset;
 
-                    IFDEBUG(dzlog_debug("blfs_poly1305_generate_tag calculated ptr: %p --[ + "
-                                        "%"PRIuFAST32" * %"PRIuFAST32" => %"PRIuFAST32
-                                        " ]> %p (gen tag for %"PRIuFAST32" bytes)",
-                                        (void *) nugget_data,
-                                        flake_index,
-                                        flake_size,
-                                        flake_index * flake_size,
-                                        (void *) (nugget_data + (i * flake_size)),
-                                        flake_size));
+                        body_end = i * flake_size + body_offset + body_length;
 
-                    blfs_poly1305_generate_tag(tag, nugget_data + (i * flake_size), flake_size, flake_key);
+                        flake_internal_offset = 0;
+
+                        IFDEBUGANY(assert(flake_total_bytes_to_write > flake_total_bytes_to_write - flake_write_length));
+
+                        flake_total_bytes_to_write -= flake_write_length;
+                        buffer += flake_write_length;
+
+                    }
 
-                    IFDEBUG(dzlog_debug("tag (initial 64 bytes):"));
-                    IFDEBUG(hdzlog_debug(tag, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT)));
+                    IFDEBUGANY(assert(flake_total_bytes_to_write == 0));
+
+                    // ! The TJ entry goes out ahead of the body (the batch keeps
+                    // ! them in order): ciphertext on the backstore whose bits were
+                    // ! not would be overwritten without rekeying after a crash
+                    bitmask_set_bits(entry->bitmask, first_affected_flake, num_affected_flakes);
+                    blfs_commit_tjournal_entry(buselfs_state->backstore, entry);
 
-                    IFDEBUG(dzlog_debug("verify_in_merkle_tree calculated offset: %"PRIuFAST32,
-                                        mt_offset + nugget_offset * flakes_per_nugget + flake_index));
+                    // ? One write for the whole nugget rather than one per flake
+                    IFDEBUG(dzlog_debug("blfs_backstore_write_body offset: %"PRIuFAST32,
+                                        nugget_offset * nugget_size + first_affected_flake * flake_size + body_start));
 
-                    verify_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
+                    blfs_backstore_write_body(buselfs_state->backstore,
+                                              flakes_data + body_start,
+                                              body_end - body_start,
+                                              nugget_offset * nugget_size + first_affected_flake * flake_size + body_start);
+
+                    IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
+                    IFDEBUG(hdzlog_debug(flakes_data + body_start, MIN(64U, body_end - body_start)));
                 }
 
-                IFDEBUG(dzlog_debug(
-                    "blfs_crypt calculated ptr: %p --[ + "
-                    "%"PRIuFAST32" - %"PRIuFAST32" * %"PRIuFAST32" => %"PRIuFAST32
-                    " ]> %p (crypting %"PRIuFAST32" bytes)",
-                    (void *) nugget_data,
-                    nugget_internal_offset,
-                    first_affected_flake,
-                    flake_size,
-                    nugget_internal_offset - first_affected_flake * flake_size,
-                    (void *) (nugget_data + (nugget_internal_offset - first_affected_flake * flake_size)),
-                    buffer_read_length
-                ));
-
-                blfs_swappable_crypt(
-                    active_cipher,
-                    buffer,
-                    nugget_data + (nugget_internal_offset - first_affected_flake * flake_size),
-                    buffer_read_length,
-                    nugget_key,
-                    count->keycount,
-                    nugget_internal_offset
-                );
-
-                IFDEBUG(dzlog_debug("output_buffer final contents (initial 64 bytes):"));
-                IFDEBUG(hdzlog_debug(output_buffer, MIN(64U, size)));
-
-                buffer += buffer_read_length;
+                Catch(e)
+                {
+                    blfs_backstore_end_batch(buselfs_state->backstore);
+                    free(flakes_data);
+                    Throw(e);
+                }
             }
         }
 
-        length -= buffer_read_length;
-        nugget_internal_offset = 0;
-        nugget_offset++;
+        // ? Both forms (write_handle and swappable_crypt) need to update TJ
+        // ? even if the algo is something like freestyle that ignores TJ! The
+        // ? typical write already did so above
+
+        if(flakes_data == NULL)
+        {
+            bitmask_set_bits(entry->bitmask, first_affected_flake, num_affected_flakes);
+            blfs_commit_tjournal_entry(buselfs_state->backstore, entry);
+        }
+
+        IFDEBUG(dzlog_debug("entry->bitmask (post-update):"));
+        IFDEBUG(hdzlog_debug(entry->bitmask->mask, entry->bitmask->byte_length));
 
-        IFDEBUG(dzlog_debug("END (next nugget):"));
-        IFDEBUG(dzlog_debug("buffer: %p", (void *) buffer));
-        IFDEBUG(dzlog_debug("length: %"PRIu32, length));
-        IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
-        IFDEBUG(dzlog_debug("nugget_offset: %"PRIuFAST32, nugget_offset));
+        if(flakes_data != NULL)
+        {
+            blfs_backstore_end_batch(buselfs_state->backstore);
+            free(flakes_data);
+        }
 
-        first_nugget = FALSE;
-    }
+        IFDEBUG(dzlog_debug("MERKLE TREE: update TJ entry"));
 
-    IFDEBUGANY(dzlog_debug("<<<< leaving %s", __func__));
-    return 0;
+        uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
+
+        blfs_chacha20_struct_hash(hash, entry->bitmask->mask, entry->bitmask->byte_length, buselfs_state->backstore->master_secret);
+        update_in_merkle_tree(
+            hash,
+            sizeof hash,
+            mt_calculate_tj1_index(buselfs_state, nugget_offset),
+            buselfs_state
+        );
+    }
 }
 
 int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_offset, void * userdata)
@@ -1317,7 +2423,6 @@ int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_off
 
     const uint8_t * buffer = (const uint8_t *) input_buffer;
     buselfs_state_t * buselfs_state = (buselfs_state_t *) userdata;
-    uint_fast32_t size = length;
 
     if(buselfs_state->delay_rw)
     {
@@ -1336,14 +2441,7 @@ int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_off
     IFDEBUG(dzlog_debug("userdata (ptr): %p", (void *) userdata));
     IFDEBUG(dzlog_debug("buselfs_state (ptr): %p", (void *) buselfs_state));
 
-    uint_fast32_t nugget_size       = buselfs_state->backstore->nugget_size_bytes;
-    uint_fast32_t flake_size        = buselfs_state->backstore->flake_size_bytes;
-    uint_fast32_t num_nuggets       = buselfs_state->backstore->num_nuggets;
-    uint_fast32_t flakes_per_nugget = buselfs_state->backstore->flakes_per_nugget;
-
-    (void) num_nuggets;
-
-    uint_fast32_t mt_offset = mt_calculate_expected_size(buselfs_state, 0);
+    uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
 
     // ? If we're in swap_selective mode, make sure to adjust abs offset
     if(buselfs_state->active_swap_strategy == swap_selective
@@ -1357,19 +2455,16 @@ int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_off
     }
 
     // ! For a bigger system, this cast could be a problem
-    uint_fast32_t nugget_offset          = (uint_fast32_t)(absolute_offset / nugget_size); // nugget_index
-    uint_fast32_t nugget_internal_offset = (uint_fast32_t)(absolute_offset % nugget_size); // internal point at which to start within nug
+    uint_fast32_t nugget_offset = (uint_fast32_t)(absolute_offset / nugget_size); // nugget_index
 
     IFDEBUG(dzlog_debug("nugget_size: %"PRIuFAST32, nugget_size));
-    IFDEBUG(dzlog_debug("flake_size: %"PRIuFAST32, flake_size));
-    IFDEBUG(dzlog_debug("num_nuggets: %"PRIuFAST32, num_nuggets));
-    IFDEBUG(dzlog_debug("flakes_per_nugget: %"PRIuFAST32, flakes_per_nugget));
-    IFDEBUG(dzlog_debug("mt_offset: %"PRIuFAST32, mt_offset));
     IFDEBUGANY(dzlog_debug("nugget_offset: %"PRIuFAST32, nugget_offset));
-    IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
+
+    uint_fast32_t first_locked_nugget = nugget_offset;
+    uint_fast32_t last_locked_nugget = length ? (uint_fast32_t)((absolute_offset + length - 1) / nugget_size) : nugget_offset;
 
     IFDEBUG(dzlog_debug("buffer to write (initial 64 bytes):"));
-    IFDEBUG(hdzlog_debug(input_buffer, MIN(64U, size)));
+    IFDEBUG(hdzlog_debug(input_buffer, MIN(64U, length)));
 
     IFDEBUGANY(assert(buselfs_state->active_swap_strategy == swap_mirrored
         || buselfs_state->active_swap_strategy == swap_selective
@@ -1388,17 +2483,7 @@ int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_off
 
     IFDEBUG4(else { IFDEBUGANY(dzlog_notice("[[SKIPPING MIRRORED WRITE REGION]]")); });
 
-    blfs_header_t * tpmv_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER);
-    uint64_t tpmv_value = *(uint64_t *) tpmv_header->data;
-
-    IFDEBUG(dzlog_debug("tpmv_header->data:"));
-    IFDEBUG(dzlog_debug("was %"PRIu64, tpmv_value));
-
-    tpmv_value++;
-
-    IFDEBUG(dzlog_debug("now %"PRIu64, tpmv_value));
-
-    memcpy(tpmv_header->data, (uint8_t *) &tpmv_value, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER);
+    enter_write_epoch(buselfs_state);
 
     blfs_swappable_cipher_t * active_cipher;
 
@@ -1412,289 +2497,252 @@ int buse_write(const void * input_buffer, uint32_t length, uint64_t absolute_off
     else
         active_cipher = blfs_get_active_cipher(buselfs_state);
 
-    // ! Needs to be guaranteed monotonic in a real implementation, not based on header
-    blfs_globalversion_commit(buselfs_state->rpmb_secure_index, tpmv_value);
-
-    while(length != 0)
-    {
-        IFDEBUGANY(dzlog_debug("next iteration in write workhorse with length: %"PRIu32, length));
-
-        (void) size;
-        IFDEBUGANY(assert(length > 0 && length <= size));
-
-        uint_fast32_t buffer_write_length = MIN(length, nugget_size - nugget_internal_offset); // nmlen
-        uint_fast32_t first_affected_flake = nugget_internal_offset / flake_size;
-        uint_fast32_t num_affected_flakes =
-            CEIL((nugget_internal_offset + buffer_write_length), flake_size) - first_affected_flake;
-
-        IFDEBUG(dzlog_debug("buffer_write_length: %"PRIuFAST32, buffer_write_length));
-        IFDEBUG(dzlog_debug("first_affected_flake: %"PRIuFAST32, first_affected_flake));
-        IFDEBUG(dzlog_debug("num_affected_flakes: %"PRIuFAST32, num_affected_flakes));
-
-        uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT];
-
-        if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
-        {
-            IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
-            blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_offset);
-        }
-
-        else
-        {
-            IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
-            get_nugget_key_using_index(nugget_key, buselfs_state, nugget_offset);
-        }
-
-        IFDEBUG(dzlog_debug("nugget_key (initial 64 bytes):"));
-        IFDEBUG(hdzlog_debug(nugget_key, MIN(64U, BLFS_CRYPTO_BYTES_KDF_OUT)));
+    blfs_lock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
 
-        blfs_keycount_t * count = blfs_open_keycount(buselfs_state->backstore, nugget_offset);
-        IFDEBUG(dzlog_debug("count->keycount: %"PRIu64, count->keycount));
-
-        uint_fast32_t flake_internal_offset = nugget_internal_offset % flake_size;
-        uint_fast32_t flake_total_bytes_to_write = buffer_write_length;
-
-        IFDEBUG(dzlog_debug("buffer_write_length: %"PRIuFAST32, buffer_write_length));
-        IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
-        IFDEBUG(dzlog_debug("flake_size: %"PRIuFAST32, flake_size));
-        IFDEBUG(dzlog_debug("flake_internal_offset: %"PRIuFAST32, flake_internal_offset));
-
-        int last_nugget = length - buffer_write_length == 0;
-
-        IFDEBUG(dzlog_debug("last nugget: %s", last_nugget ? "YES" : "NO"));
-
-        uint_fast32_t flake_index = first_affected_flake;
-        uint_fast32_t flake_end = first_affected_flake + num_affected_flakes;
-
-        blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_offset);
-
-        IFDEBUGANY(dzlog_debug(">-> active_cipher enum id: %u", active_cipher->enum_id));
-        IFDEBUGANY(dzlog_debug(">-> nugget (meta) enum id: %u", meta->cipher_ident));
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+    volatile int locked = TRUE;
 
-        if(!(buselfs_state->active_swap_strategy == swap_mirrored
-            || buselfs_state->active_swap_strategy == swap_selective)
-           && active_cipher->enum_id != meta->cipher_ident)
-        {
-            IFDEBUGANY(dzlog_notice("write() is triggering cipher switch..."));
+    // ? Should anything below throw, the locks and the epoch must still be
+    // ? given up or the next flush (and every later write) would hang
+    Try
+    {
+        if(buselfs_state->readahead != NULL)
+            readahead_invalidate(buselfs_state->readahead, first_locked_nugget, last_locked_nugget);
+
+        rw_request_t request = {
+            .buselfs_state = buselfs_state,
+            .active_cipher = active_cipher,
+            .buffer = (uint8_t *) buffer, // ! Only ever read from by write_request_part
+            .length = length,
+            .absolute_offset = absolute_offset,
+            .num_parts = length ? (uint32_t)(last_locked_nugget - first_locked_nugget + 1) : 0
+        };
+
+        // ? Every part runs under the nugget locks this thread holds; the merkle
+        // ? tree and header commit still happen later, in blfs_group_commit
+        pool_run(request_can_fan_out(&request, TRUE) ? buselfs_state->crypt_pool : NULL, write_request_part, &request, request.num_parts);
+
+        blfs_unlock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
+        locked = FALSE;
+
+        // ? Anything eviction writes back still belongs to this epoch
+        trim_nugget_tables(buselfs_state);
+    }
 
-            buffer += blfs_swap_nugget_to_active_cipher(
-                SWAP_WHILE_WRITE,
-                last_nugget,
-                buselfs_state,
-                nugget_offset,
-                (uint8_t *) buffer, // ! Don't worry, we'll be good...
-                buffer_write_length,
-                nugget_internal_offset
-            );
-        }
+    Catch(e)
+    {
+        if(locked)
+            blfs_unlock_nuggets(buselfs_state, first_locked_nugget, last_locked_nugget);
 
-        else
-        {
-            IFDEBUGANY(dzlog_notice("(explicit cipher swap was not necessary for this nugget)"));
+        abandon_write_epoch(buselfs_state);
+        Throw(e);
+    }
 
-            blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_offset);
+    leave_write_epoch(buselfs_state);
 
-            IFDEBUG(dzlog_debug("entry->bitmask (pre-update):"));
-            IFDEBUG(hdzlog_debug(entry->bitmask->mask, entry->bitmask->byte_length));
+    IFDEBUGANY(dzlog_info("<<<< leaving %s", __func__));
+    return 0;
+}
 
-            if(active_cipher->write_handle)
-            {
-                IFDEBUG4(dzlog_notice("[executing write handle with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
-                buffer += active_cipher->write_handle(
-                    buffer,
-                    buselfs_state,
-                    buffer_write_length,
-                    flake_index,
-                    flake_end,
-                    flake_size,
-                    flakes_per_nugget,
-                    flake_internal_offset,
-                    mt_offset,
-                    nugget_key,
-                    nugget_offset,
-                    count
-                );
-            }
+/**
+ * Returns every nugget lying entirely within [from, from + len) to the pristine
+ * state (see buse_trim) and returns the number of them. Partially covered
+ * nuggets are left alone: the rest of such a nugget is still live and shares
+ * its keycount with the covered part. If keep_allocated is non-zero the
+ * nuggets' bodies stay allocated in the backstore.
+ */
+static uint32_t reset_nuggets_in_range(buselfs_state_t * buselfs_state, uint64_t from, uint32_t len, int keep_allocated)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
 
-            else
-            {
-                // ? First, check if this constitutes an overwrite...
-                if(bitmask_any_bits_set(entry->bitmask, first_affected_flake, num_affected_flakes))
-                {
-                    IFDEBUGANY(dzlog_notice("OVERWRITE DETECTED! PERFORMING IN-PLACE JOURNALED REKEYING + WRITE (l=%"PRIuFAST32")", buffer_write_length));
-                    blfs_rekey_nugget_then_write(buselfs_state, nugget_offset, buffer, buffer_write_length, nugget_internal_offset);
+    IFDEBUG(dzlog_debug("len: %"PRIu32, len));
+    IFDEBUG(dzlog_debug("initial from: %"PRIu64, from));
 
-                    buffer += buffer_write_length;
-                }
+    // ? Follow writes around the mirrored and selective swap regions. Region
+    // ? size is a multiple of nugget size, so the same nuggets are covered
+    if(buselfs_state->active_swap_strategy == swap_mirrored && from < buselfs_state->buseops->size)
+        reset_nuggets_in_range(buselfs_state, from + buselfs_state->buseops->size, len, keep_allocated);
 
-                else
-                {
-                    // ! Maybe update and commit the MTRH here first and again later?
-                    IFDEBUG4(dzlog_notice("[commencing typical write with active cipher %s (%"PRIu8")]", active_cipher->name, active_cipher->enum_id));
+    if(buselfs_state->active_swap_strategy == swap_selective
+        && buselfs_state->active_cipher_enum_id == buselfs_state->swap_cipher->enum_id)
+    {
+        from += buselfs_state->buseops->size;
+    }
 
-                    for(uint_fast32_t i = 0; flake_index < flake_end; flake_index++, i++)
-                    {
-                        uint_fast32_t flake_write_length = MIN(flake_total_bytes_to_write, flake_size - flake_internal_offset);
+    uint_fast32_t nugget_size       = buselfs_state->backstore->nugget_size_bytes;
+    uint_fast32_t flake_size        = buselfs_state->backstore->flake_size_bytes;
+    uint_fast32_t flakes_per_nugget = buselfs_state->backstore->flakes_per_nugget;
 
-                        IFDEBUG(dzlog_debug("flake_write_length: %"PRIuFAST32, flake_write_length));
-                        IFDEBUG(dzlog_debug("flake_index: %"PRIuFAST32, flake_index));
-                        IFDEBUG(dzlog_debug("flake_end: %"PRIuFAST32, flake_end));
+    uint_fast32_t first_nugget = (uint_fast32_t) CEIL(from, (uint64_t) nugget_size);
+    uint_fast32_t end_nugget   = (uint_fast32_t)((from + len) / nugget_size);
 
-                        uint8_t flake_data[flake_size];
-                        IFDEBUG(memset(flake_data, 0, flake_size));
+    IFDEBUG(dzlog_debug("resetting nuggets [%"PRIuFAST32", %"PRIuFAST32")", first_nugget, end_nugget));
 
-                        // ! Data to write isn't aligned and/or is smaller than
-                        // ! flake_size, so we need to verify its integrity
-                        if(flake_internal_offset != 0 || flake_internal_offset + flake_write_length < flake_size)
-                        {
-                            IFDEBUGANY(dzlog_notice("UNALIGNED! Write flake requires verification"));
+    if(first_nugget >= end_nugget)
+    {
+        IFDEBUG(dzlog_debug("<<<< leaving %s (no whole nuggets in range)", __func__));
+        return 0;
+    }
 
-                            // Read in the entire flake
-                            blfs_backstore_read_body(buselfs_state->backstore,
-                                                    flake_data,
-                                                    flake_size,
-                                                    nugget_offset * nugget_size + flake_index * flake_size);
+    enter_write_epoch(buselfs_state);
+    blfs_lock_nuggets(buselfs_state, first_nugget, end_nugget - 1);
 
-                            // Generate a local flake key
-                            uint8_t local_flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
-                            uint8_t local_tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+    volatile int locked = TRUE;
 
-                            if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
-                            {
-                                IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
-                                blfs_poly1305_key_from_data(local_flake_key, nugget_key, flake_index, count->keycount);
-                            }
+    // ? As in buse_write, the locks and the epoch are given up even on failure
+    Try
+    {
+        if(buselfs_state->readahead != NULL)
+            readahead_invalidate(buselfs_state->readahead, first_nugget, end_nugget - 1);
 
-                            else
-                            {
-                                IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
-                                get_flake_key_using_keychain(local_flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
-                            }
+        for(uint_fast32_t nugget_index = first_nugget; nugget_index < end_nugget; nugget_index++)
+        {
+            uint8_t nugget_key[BLFS_CRYPTO_BYTES_KDF_OUT];
 
-                            // Generate tag
-                            blfs_poly1305_generate_tag(local_tag, flake_data, flake_size, local_flake_key);
+            if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+                blfs_nugget_key_from_data(nugget_key, buselfs_state->backstore->master_secret, nugget_index);
 
-                            // Check tag in Merkle Tree
-                            verify_in_merkle_tree(local_tag, sizeof local_tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
-                        }
+            else
+                get_nugget_key_using_index(nugget_key, buselfs_state, nugget_index);
+
+            blfs_keycount_t * count = blfs_open_keycount(buselfs_state->backstore, nugget_index);
+            blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, nugget_index);
+            blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_index);
+
+            // ! Writes into the reset nugget will start over with clear TJ bits,
+            // ! so they must not reuse the keystream of the data discarded here. If
+            // ! we're in crash recovery mode, the very next keycount might be burned.
+            count->keycount += buselfs_state->crash_recovery ? 2 : 1;
+            bitmask_clear_bits(entry->bitmask, 0, flakes_per_nugget);
+
+            // ! The new keycount must be on disk before the clear TJ bits are:
+            // ! crash recovery never burns a keycount for flakes it sees as
+            // ! unwritten, so the old one would be reused
+            blfs_commit_keycount_through(buselfs_state->backstore, count);
+            blfs_commit_tjournal_entry(buselfs_state->backstore, entry);
 
-                        IFDEBUG(dzlog_debug("INCOMPLETE flake_data (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(flake_data, MIN(64U, flake_size)));
+            blfs_backstore_discard_body(buselfs_state->backstore, nugget_size, (uint64_t) nugget_index * nugget_size, keep_allocated);
 
-                        IFDEBUG(dzlog_debug("buffer at this point (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(buffer, MIN(64U, length)));
+            // ? Its flakes read as zeros until they're written again
+            if(!meta->discarded)
+            {
+                meta->discarded = TRUE;
+                commit_nugget_metadata_and_leaf(buselfs_state, meta);
+            }
 
-                        IFDEBUG(dzlog_debug("blfs_crypt calculated src length: %"PRIuFAST32, flake_write_length));
+            // ? Update the merkle tree so the nugget verifies as all-zero flakes
 
-                        IFDEBUG(dzlog_debug("blfs_crypt calculated dest offset: %"PRIuFAST32,
-                                        i * flake_size));
+            uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
 
-                        IFDEBUG(dzlog_debug("blfs_crypt calculated nio: %"PRIuFAST32,
-                                        flake_index * flake_size + flake_internal_offset));
+            blfs_chacha20_struct_hash(hash, entry->bitmask->mask, entry->bitmask->byte_length, buselfs_state->backstore->master_secret);
+            update_in_merkle_tree(hash, sizeof hash, mt_calculate_tj1_index(buselfs_state, nugget_index), buselfs_state);
 
-                        blfs_swappable_crypt(
-                            active_cipher,
-                            flake_data + flake_internal_offset,
-                            buffer,
-                            flake_write_length,
-                            nugget_key,
-                            count->keycount,
-                            flake_index * flake_size + flake_internal_offset
-                        );
+            update_in_merkle_tree((uint8_t *) &count->keycount,
+                BLFS_HEAD_BYTES_KEYCOUNT,
+                mt_calculate_keycount_index(nugget_index),
+                buselfs_state
+            );
 
-                        IFDEBUG(dzlog_debug("*complete* flake_data (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(flake_data, MIN(64U, flake_size)));
+            for(uint32_t flake_index = 0; flake_index < flakes_per_nugget; flake_index++)
+            {
+                uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
+                uint8_t tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
 
-                        uint8_t flake_key[BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY];
-                        uint8_t tag[BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT];
+                if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
+                    blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
 
-                        if(BLFS_DEFAULT_DISABLE_KEY_CACHING)
-                        {
-                            IFDEBUG(dzlog_debug("KEY CACHING DISABLED!"));
-                            blfs_poly1305_key_from_data(flake_key, nugget_key, flake_index, count->keycount);
-                        }
+                else
+                    get_flake_key_using_keychain(flake_key, buselfs_state, nugget_index, flake_index, count->keycount);
 
-                        else
-                        {
-                            IFDEBUG(dzlog_debug("KEY CACHING ENABLED!"));
-                            get_flake_key_using_keychain(flake_key, buselfs_state, nugget_offset, flake_index, count->keycount);
-                        }
+                blfs_poly1305_generate_tag(tag, zero_flake, flake_size, flake_key);
+                update_in_merkle_tree(tag, sizeof tag, mt_calculate_flake_offset(buselfs_state, nugget_index, flake_index), buselfs_state);
+            }
+        }
 
-                        blfs_poly1305_generate_tag(tag, flake_data, flake_size, flake_key);
+        blfs_unlock_nuggets(buselfs_state, first_nugget, end_nugget - 1);
+        locked = FALSE;
 
-                        IFDEBUG(dzlog_debug("flake_key (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(flake_key, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_KEY)));
+        trim_nugget_tables(buselfs_state);
+    }
 
-                        IFDEBUG(dzlog_debug("tag (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(tag, MIN(64U, BLFS_CRYPTO_BYTES_FLAKE_TAG_OUT)));
+    Catch(e)
+    {
+        if(locked)
+            blfs_unlock_nuggets(buselfs_state, first_nugget, end_nugget - 1);
 
-                        IFDEBUG(dzlog_debug("update_in_merkle_tree calculated offset: %"PRIuFAST32,
-                                            mt_offset + nugget_offset * flakes_per_nugget + flake_index));
+        abandon_write_epoch(buselfs_state);
+        Throw(e);
+    }
 
-                        update_in_merkle_tree(tag, sizeof tag, mt_offset + nugget_offset * flakes_per_nugget + flake_index, buselfs_state);
+    leave_write_epoch(buselfs_state);
 
-                        IFDEBUG(dzlog_debug("blfs_backstore_write_body offset: %"PRIuFAST32,
-                                            nugget_offset * nugget_size + flake_index * flake_size + flake_internal_offset));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+    return end_nugget - first_nugget;
+}
 
-                        blfs_backstore_write_body(buselfs_state->backstore,
-                                                flake_data + flake_internal_offset,
-                                                flake_write_length,
-                                                nugget_offset * nugget_size + flake_index * flake_size + flake_internal_offset);
+int buse_trim(uint64_t from, uint32_t len, void * userdata)
+{
+    IFDEBUGANY(dzlog_info(">>>> entering %s", __func__));
 
-                        IFDEBUG(dzlog_debug("blfs_backstore_write_body input (initial 64 bytes):"));
-                        IFDEBUG(hdzlog_debug(flake_data + flake_internal_offset, MIN(64U, flake_write_length)));
+    // ? A trim is only ever a hint, so partially covered nuggets are skipped
+    reset_nuggets_in_range((buselfs_state_t *) userdata, from, len, FALSE);
 
-                        flake_internal_offset = 0;
+    IFDEBUGANY(dzlog_info("<<<< leaving %s", __func__));
+    return 0;
+}
 
-                        IFDEBUGANY(assert(flake_total_bytes_to_write > flake_total_bytes_to_write - flake_write_length));
+int buse_write_zeroes(uint64_t from, uint32_t len, int no_hole, void * userdata)
+{
+    IFDEBUGANY(dzlog_info(">>>> entering %s", __func__));
 
-                        flake_total_bytes_to_write -= flake_write_length;
-                        buffer += flake_write_length;
+    buselfs_state_t * buselfs_state = (buselfs_state_t *) userdata;
+    uint_fast32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
 
-                    }
+    // ? Whole nuggets are reset without touching a single flake
+    uint32_t num_reset = reset_nuggets_in_range(buselfs_state, from, len, no_hole);
 
-                    IFDEBUGANY(assert(flake_total_bytes_to_write == 0));
-                }
-            }
+    // ? Whatever is left over (at most one partial nugget at each end, or the
+    // ? whole range if it covered no nugget entirely) is written out normally
+    uint64_t end = from + len;
+    uint64_t reset_begin = num_reset ? CEIL(from, (uint64_t) nugget_size) * nugget_size : end;
+    uint64_t reset_end = num_reset ? reset_begin + (uint64_t) num_reset * nugget_size : end;
 
-            // ? Both forms (write_handle and swappable_crypt) need to update TJ
-            // ? even if the algo is something like freestyle that ignores TJ!
+    uint64_t head_length = reset_begin - from;
+    uint64_t tail_length = end - reset_end;
 
-            bitmask_set_bits(entry->bitmask, first_affected_flake, num_affected_flakes);
-            blfs_commit_tjournal_entry(buselfs_state->backstore, entry);
-            IFDEBUG(dzlog_debug("entry->bitmask (post-update):"));
-            IFDEBUG(hdzlog_debug(entry->bitmask->mask, entry->bitmask->byte_length));
+    IFDEBUG(dzlog_debug("writing zeros to [%"PRIu64", %"PRIu64") and [%"PRIu64", %"PRIu64")", from, reset_begin, reset_end, end));
 
-            IFDEBUG(dzlog_debug("MERKLE TREE: update TJ entry"));
+    if(head_length == 0 && tail_length == 0)
+    {
+        IFDEBUGANY(dzlog_info("<<<< leaving %s", __func__));
+        return 0;
+    }
 
-            uint8_t hash[BLFS_CRYPTO_BYTES_STRUCT_HASH_OUT];
+    // ? Each leftover goes out in one write (under two nuggets' worth), so a
+    // ? nugget that already holds data is rekeyed once rather than per flake
+    uint8_t * zeros = calloc(MAX(head_length, tail_length), sizeof *zeros);
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
 
-            blfs_chacha20_struct_hash(hash, entry->bitmask->mask, entry->bitmask->byte_length, buselfs_state->backstore->master_secret);
-            update_in_merkle_tree(
-                hash,
-                sizeof hash,
-                mt_calculate_tj1_index(buselfs_state, nugget_offset),
-                buselfs_state
-            );
-        }
+    if(zeros == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
 
-        length -= buffer_write_length;
-        nugget_internal_offset = 0;
-        nugget_offset++;
+    Try
+    {
+        if(head_length)
+            buse_write(zeros, (uint32_t) head_length, from, buselfs_state);
 
-        IFDEBUG(dzlog_debug("END (next nugget):"));
-        IFDEBUG(dzlog_debug("buffer: %p", (void *) buffer));
-        IFDEBUG(dzlog_debug("length: %"PRIu32, length));
-        IFDEBUG(dzlog_debug("nugget_internal_offset: %"PRIuFAST32, nugget_internal_offset));
-        IFDEBUG(dzlog_debug("nugget_offset: %"PRIuFAST32, nugget_offset));
+        if(tail_length)
+            buse_write(zeros, (uint32_t) tail_length, reset_end, buselfs_state);
     }
 
-    blfs_commit_header(buselfs_state->backstore, tpmv_header);
-
-    IFDEBUG(dzlog_debug("MERKLE TREE: update TPM header"));
-    update_in_merkle_tree(tpmv_header->data, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, 0, buselfs_state);
+    Catch(e)
+    {
+        free(zeros);
+        Throw(e);
+    }
 
-    commit_merkle_tree_root_hash(buselfs_state);
+    free(zeros);
 
     IFDEBUGANY(dzlog_info("<<<< leaving %s", __func__));
     return 0;
@@ -1738,10 +2786,11 @@ void blfs_rekey_nugget_then_write(buselfs_state_t * buselfs_state,
         Throw(EXCEPTION_ALLOC_FAILURE);
 
     // Read in *and verify* nugget FIRST
-    buse_read(rekeying_nugget_data,
-              buselfs_state->backstore->nugget_size_bytes,
-              rekeying_nugget_index * buselfs_state->backstore->nugget_size_bytes,
-              (void *) buselfs_state);
+    buse_read_actual(rekeying_nugget_data,
+                     buselfs_state->backstore->nugget_size_bytes,
+                     rekeying_nugget_index * buselfs_state->backstore->nugget_size_bytes,
+                     (void *) buselfs_state,
+                     FALSE);
 
     memcpy(rekeying_nugget_data + nugget_internal_offset, buffer, length);
 
@@ -1807,6 +2856,15 @@ void blfs_rekey_nugget_then_write(buselfs_state_t * buselfs_state,
     bitmask_set_bits(jentry->bitmask, first_affected_flake, num_affected_flakes);
     blfs_commit_tjournal_entry(buselfs_state->backstore, jentry);
 
+    // ? Discarded flakes were read in as zeros and now hold them encrypted
+    blfs_nugget_metadata_t * jmeta = blfs_open_nugget_metadata(buselfs_state->backstore, rekeying_nugget_index);
+
+    if(jmeta->discarded)
+    {
+        jmeta->discarded = FALSE;
+        commit_nugget_metadata_and_leaf(buselfs_state, jmeta);
+    }
+
     IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
 }
 
@@ -1880,6 +2938,10 @@ void blfs_soft_open(buselfs_state_t * buselfs_state, uint8_t cin_allow_insecure_
         Throw(EXCEPTION_GLOBAL_CORRECTNESS_FAILURE);
     }
 
+    dzlog_notice("Loading nugget metadata...");
+
+    blfs_load_nugget_tables(buselfs_state->backstore);
+
     dzlog_notice("Populating key cache...");
 
     populate_key_cache(buselfs_state);
@@ -1905,12 +2967,41 @@ void blfs_soft_open(buselfs_state_t * buselfs_state, uint8_t cin_allow_insecure_
     IFDEBUG(dzlog_debug("computed MTRH:"));
     IFDEBUG(hdzlog_debug(buselfs_state->merkle_tree_root_hash, BLFS_HEAD_HEADER_BYTES_MTRH));
 
-    if(memcmp(mtrh_header->data, buselfs_state->merkle_tree_root_hash, BLFS_HEAD_HEADER_BYTES_MTRH) != 0)
+    int crashed = global_correctness == BLFS_GLOBAL_CORRECTNESS_POTENTIAL_CRASH;
+    int mtrh_ok = memcmp(mtrh_header->data, buselfs_state->merkle_tree_root_hash, BLFS_HEAD_HEADER_BYTES_MTRH) == 0;
+
+    // ? A crash between group commits leaves the header and MTRH a whole epoch
+    // ? behind the rest of the backstore. If the epoch record was made during
+    // ? the epoch right after the header's (and the global version agrees, or
+    // ? there's no RPMB to ask), the root it vouches for stands in for the MTRH
+    uint64_t record_version = 0;
+    uint8_t record_root[BLFS_HEAD_HEADER_BYTES_MTRH] = { 0x00 };
+
+    if(blfs_backstore_read_epoch_record(buselfs_state->backstore, &record_version, record_root)
+       && record_version == tpmv_value + 1
+       && (crashed || BLFS_MANUAL_GV_FALLBACK != -1))
+    {
+        IFDEBUG(dzlog_debug("epoch record is one ahead of the header; the last epoch was never committed"));
+        IFDEBUG(dzlog_debug("record_root:"));
+        IFDEBUG(hdzlog_debug(record_root, BLFS_HEAD_HEADER_BYTES_MTRH));
+
+        crashed = TRUE;
+
+        if(!mtrh_ok)
+            mtrh_ok = memcmp(record_root, buselfs_state->merkle_tree_root_hash, BLFS_HEAD_HEADER_BYTES_MTRH) == 0;
+    }
+
+    if(!mtrh_ok)
     {
         dzlog_fatal("!!!!!!! ERROR: FATAL BLOCK DEVICE BACKSTORE MT INTEGRITY CHECK FAILURE !!!!!!!");
 
+        // ? Whatever happened, keystreams may have been used that the
+        // ? keycounts on the backstore don't account for
         if(cin_allow_insecure_start)
+        {
             dzlog_warn("`allow-insecure-start` flag detected. Forcing start anyway...");
+            buselfs_state->crash_recovery = TRUE;
+        }
 
         else
         {
@@ -1924,9 +3015,11 @@ void blfs_soft_open(buselfs_state_t * buselfs_state, uint8_t cin_allow_insecure_
         }
     }
 
-    else if(global_correctness != BLFS_GLOBAL_CORRECTNESS_ALL_GOOD)
+    // ? Keystreams used during the lost epoch must not be reused, so every
+    // ? write after this skips a keycount
+    if(crashed)
     {
-        dzlog_warn("Integrity check passed, but the global version is off by one. A rollback (or crash) may have"
+        dzlog_warn("Integrity check passed, but the global version is off by one. A rollback (or crash) may have "
                    "occurred. Proceed with caution.");
 
         tpmv_value++;
@@ -1938,6 +3031,7 @@ void blfs_soft_open(buselfs_state_t * buselfs_state, uint8_t cin_allow_insecure_
 
         IFDEBUG(dzlog_debug("MERKLE TREE: update TPM header"));
         update_in_merkle_tree(tpmv_header->data, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, 0, buselfs_state);
+        update_merkle_tree_root_hash(buselfs_state);
     }
 
     commit_merkle_tree_root_hash(buselfs_state);
@@ -1960,11 +3054,15 @@ void blfs_run_mode_create(const char * backstore_path,
     volatile uint8_t already_attempted_delete = 0;
     volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
 
+    // ? With a metadata device, the headers go there and backstore_path gets
+    // ? the body alone
+    const char * header_path = buselfs_state->metadata_path != NULL ? buselfs_state->metadata_path : backstore_path;
+
     IFDEBUG(dzlog_debug("running in CREATE mode!"));
 
     Try
     {
-        backstore_v = blfs_backstore_create(backstore_path, cin_backstore_size);
+        backstore_v = blfs_backstore_create(header_path, cin_backstore_size);
 
         // ! refs to memory allocated during blfs_backstore_create
         // ! will be lost during an exception. It's technically a memory
@@ -1977,10 +3075,10 @@ void blfs_run_mode_create(const char * backstore_path,
         {
             IFDEBUG(dzlog_debug("backstore file already exists, deleting and trying again..."));
 
-            unlink(backstore_path);
+            unlink(header_path);
             already_attempted_delete = 1;
 
-            backstore_v = blfs_backstore_create(backstore_path, cin_backstore_size);
+            backstore_v = blfs_backstore_create(header_path, cin_backstore_size);
         }
 
         else
@@ -1993,6 +3091,7 @@ void blfs_run_mode_create(const char * backstore_path,
     }
 
     buselfs_state->backstore = (blfs_backstore_t *) backstore_v;
+    buselfs_state->backstore->nugget_tables.max_resident_bytes = buselfs_state->metadata_cache_bytes;
 
     char passwd[BLFS_PASSWORD_BUF_SIZE] = { 0x00 };
     char passck[BLFS_PASSWORD_BUF_SIZE];
@@ -2024,6 +3123,20 @@ void blfs_run_mode_create(const char * backstore_path,
     blfs_header_t * salt_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_SALT);
     blfs_KDF_generate_salt(salt_header->data);
 
+    // Move the body off to its own device and stripe it across any other
+    // members; their labels carry the salt
+    if(buselfs_state->metadata_path != NULL)
+        blfs_backstore_create_body_device(buselfs_state->backstore, backstore_path, cin_backstore_size);
+
+    if(buselfs_state->num_stripe_members)
+    {
+        blfs_backstore_create_stripe_members(buselfs_state->backstore,
+                                             buselfs_state->stripe_member_paths,
+                                             buselfs_state->num_stripe_members,
+                                             buselfs_state->stripe_nuggets,
+                                             cin_backstore_size);
+    }
+
     // Derive master secret, cache it
     blfs_password_to_secret(buselfs_state->backstore->master_secret, passwd, strlen(passwd), salt_header->data);
     IFDEBUG(dzlog_debug("buselfs_state->backstore->master_secret:"));
@@ -2110,9 +3223,16 @@ void blfs_run_mode_create(const char * backstore_path,
     blfs_header_t * last_header = blfs_open_header(buselfs_state->backstore,
                                                    header_types_ordered[BLFS_HEAD_NUM_HEADERS - 1][0]);
 
-    uint64_t headersize = last_header->data_offset + last_header->data_length;
+    // ? Nugget records start on a BLFS_NUGGET_RECORD_ALIGNMENT boundary after
+    // ? the epoch record
+    uint64_t headersize = CEIL(last_header->data_offset + last_header->data_length + BLFS_EPOCH_RECORD_BYTES,
+                               (uint64_t) BLFS_NUGGET_RECORD_ALIGNMENT) * BLFS_NUGGET_RECORD_ALIGNMENT;
     int64_t nuggetsize = cin_flake_size * cin_flakes_per_nugget;
-    int64_t space_remaining = cin_backstore_size - headersize;
+    uint8_t has_body_device = buselfs_state->backstore->body_device != NULL;
+    // ? Not cin_backstore_size: a block device backstore is used whole
+    int64_t space_remaining = (has_body_device ? (int64_t) buselfs_state->backstore->file_size_actual
+                                               : (int64_t) blfs_backstore_stripe_member_bytes(buselfs_state->backstore, 0))
+                              - headersize;
     int64_t num_nuggets_calculated_64 = 0;
 
     uint64_t total_space_req_for_one_nug = calculate_total_space_required_for_1nug(
@@ -2121,17 +3241,38 @@ void blfs_run_mode_create(const char * backstore_path,
         buselfs_state->backstore->md_bytes_per_nugget
     );
 
+    uint64_t record_bytes = blfs_backstore_nugget_record_bytes(cin_flakes_per_nugget,
+                                                               buselfs_state->backstore->md_bytes_per_nugget);
+
+    // ? Nuggets whose body goes on some other member (or the body device) only
+    // ? need room for their record here
+    int64_t member_space_remaining[BLFS_MAX_STRIPE_WIDTH] = { 0 };
+
+    for(uint32_t member = has_body_device ? 0 : 1; member < MAX(1U, buselfs_state->backstore->stripe_width); member++)
+        member_space_remaining[member] = blfs_backstore_stripe_member_bytes(buselfs_state->backstore, member);
+
     IFDEBUG(dzlog_debug("headersize = %"PRIu64, headersize));
     IFDEBUG(dzlog_debug("nuggetsize = %"PRIu64, nuggetsize));
     IFDEBUG(dzlog_debug("total_space_req_for_one_nug = %"PRIu64, total_space_req_for_one_nug));
     IFDEBUG(dzlog_debug("space_remaining = %"PRId64, space_remaining));
 
-    while(space_remaining > 0 && (unsigned) space_remaining > total_space_req_for_one_nug)
+    while(TRUE)
     {
+        uint32_t member = blfs_backstore_stripe_member_of(buselfs_state->backstore, num_nuggets_calculated_64);
+        uint8_t body_elsewhere = member || has_body_device;
+        uint64_t space_req = body_elsewhere ? record_bytes : total_space_req_for_one_nug;
+
+        if(space_remaining <= 0 || (unsigned) space_remaining <= space_req)
+            break;
+
+        if(body_elsewhere && member_space_remaining[member] < nuggetsize)
+            break;
+
         num_nuggets_calculated_64 += 1;
 
         // Subtract the space required for a nugget, a keycount, a TJ entry, and a metadata struct
-        space_remaining -= total_space_req_for_one_nug;
+        space_remaining -= space_req;
+        member_space_remaining[member] -= body_elsewhere ? nuggetsize : 0;
     }
 
     IFDEBUG(dzlog_debug("num_nuggets_calculated_64 = %"PRId64, num_nuggets_calculated_64));
@@ -2162,7 +3303,10 @@ void blfs_run_mode_create(const char * backstore_path,
     {
         (void) blfs_create_keycount(buselfs_state->backstore, nugget_index);
         (void) blfs_create_tjournal_entry(buselfs_state->backstore, nugget_index);
-        (void) blfs_create_nugget_metadata(buselfs_state->backstore, nugget_index);
+        // ? Every nugget starts out a hole, so all of its flakes read as zeros
+        blfs_create_nugget_metadata(buselfs_state->backstore, nugget_index)->discarded = TRUE;
+
+        trim_nugget_tables(buselfs_state);
     }
 
     dzlog_notice("Populating key cache...");
@@ -2230,6 +3374,18 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
 
     buselfs_state->backstore = NULL;
     buselfs_state->is_cipher_swapping = FALSE;
+    buselfs_state->nugget_locks = NULL;
+    buselfs_state->state_lock = NULL;
+    buselfs_state->writes_drained = NULL;
+    buselfs_state->writes_in_flight = 0;
+    buselfs_state->epoch_open = FALSE;
+    buselfs_state->epoch_drains = 0;
+    buselfs_state->crypt_pool = NULL;
+    buselfs_state->readahead = NULL;
+    buselfs_state->num_stripe_members = 0;
+    buselfs_state->stripe_nuggets = BLFS_DEFAULT_STRIPE_NUGGETS;
+    buselfs_state->metadata_path = NULL;
+    buselfs_state->metadata_cache_bytes = BLFS_DEFAULT_METADATA_CACHE_MB * BYTES_IN_A_MB;
 
     uint8_t  cin_allow_insecure_start  = FALSE;
     uint8_t  cin_use_default_password  = FALSE;
@@ -2242,6 +3398,17 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
     swap_strategy_e cin_swap_strategy  = swap_default;
     usecase_e cin_usecase              = uc_default;
     uint8_t cin_delay_rw               = FALSE;
+    uint32_t cin_num_workers           = BLFS_DEFAULT_NUM_WORKERS;
+    uint8_t cin_multi_conn             = FALSE;
+    uint32_t cin_num_crypt_threads     = BLFS_DEFAULT_NUM_CRYPT_THREADS;
+    uint32_t cin_queue_depth           = BLFS_DEFAULT_QUEUE_DEPTH;
+    uint32_t cin_merge_window_kb       = BLFS_DEFAULT_MERGE_WINDOW_KB;
+    uint32_t cin_read_deadline_ms      = BLFS_DEFAULT_READ_DEADLINE_MS;
+    uint32_t cin_write_deadline_ms     = BLFS_DEFAULT_WRITE_DEADLINE_MS;
+    uint32_t cin_readahead_nuggets     = BLFS_DEFAULT_READAHEAD_NUGGETS;
+    uint32_t cin_metadata_cache_mb     = BLFS_DEFAULT_METADATA_CACHE_MB;
+    io_engine_e cin_io_engine          = ioe_default;
+    char * cin_backstore_path          = NULL;
 
     IFDEBUG3(printf("<bare debug>: argc: %i\n", argc));
 
@@ -2258,14 +3425,39 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
         "[--swap-strategy swap_default]"
         "[--support-uc uc_default]"
         "[--delay-rw]"
-        "[--tpm-id %"PRIu32"] "
+        "[--tpm-id %"PRIu32"]"
+        "[--workers %"PRIu32"]"
+        "[--multi-conn]"
+        "[--crypt-threads %"PRIu32"]"
+        "[--queue-depth %"PRIu32"]"
+        "[--merge-window %"PRIu32"]"
+        "[--read-deadline %"PRIu32"]"
+        "[--write-deadline %"PRIu32"]"
+        "[--io-engine ioe_default]"
+        "[--readahead %"PRIu32"]"
+        "[--metadata-cache %"PRIu32"]"
+        "[--backstore-path path]"
+        "[--stripe-member path]..."
+        "[--stripe-nuggets %"PRIu32"]"
+        "[--metadata-path path] "
         "create nbd_device_name\n\n"
-        "  %s [--default-password][--allow-insecure-start] open nbd_device_name\n\n"
-        "  %s [--default-password][--allow-insecure-start] wipe nbd_device_name\n\n"
+        "  %s [--default-password][--allow-insecure-start][--workers %"PRIu32"][--multi-conn][--crypt-threads %"PRIu32"]"
+        "[--queue-depth %"PRIu32"][--merge-window %"PRIu32"][--read-deadline %"PRIu32"][--write-deadline %"PRIu32"]"
+        "[--io-engine ioe_default][--readahead %"PRIu32"][--metadata-cache %"PRIu32"][--backstore-path path][--stripe-member path]..."
+        "[--metadata-path path] open nbd_device_name\n\n"
+        "  %s [--default-password][--allow-insecure-start][--backstore-path path] wipe nbd_device_name\n\n"
 
         "Defaults are shown above. See README.md or constants.h for more details. Also note: nbd_device must always\n"
-        "appear last and the desired command (open, wipe, etc) second to last.\n\n"
+        "appear last and the desired command (open, wipe, etc) second to last.\n\n",
+        argv[0], BLFS_DEFAULT_BYTES_BACKSTORE, BLFS_DEFAULT_BYTES_FLAKE, BLFS_DEFAULT_FLAKES_PER_NUGGET, BLFS_DEFAULT_TPM_ID,
+        BLFS_DEFAULT_NUM_WORKERS, BLFS_DEFAULT_NUM_CRYPT_THREADS, BLFS_DEFAULT_QUEUE_DEPTH, BLFS_DEFAULT_MERGE_WINDOW_KB,
+        BLFS_DEFAULT_READ_DEADLINE_MS, BLFS_DEFAULT_WRITE_DEADLINE_MS, BLFS_DEFAULT_READAHEAD_NUGGETS,
+        BLFS_DEFAULT_METADATA_CACHE_MB, BLFS_DEFAULT_STRIPE_NUGGETS, argv[0], BLFS_DEFAULT_NUM_WORKERS, BLFS_DEFAULT_NUM_CRYPT_THREADS, BLFS_DEFAULT_QUEUE_DEPTH, BLFS_DEFAULT_MERGE_WINDOW_KB,
+        BLFS_DEFAULT_READ_DEADLINE_MS, BLFS_DEFAULT_WRITE_DEADLINE_MS, BLFS_DEFAULT_READAHEAD_NUGGETS, BLFS_DEFAULT_METADATA_CACHE_MB,
+        argv[0]);
 
+        // ? Split up so that no single string literal is longer than C11 guarantees support for
+        printf(
         "::create command::\n"
         "This command will create and load a brand new StrongBox backstore. Note that this command will force overwrite a\n"
         " previous backstore made with the same nbd device name if it already exists.\n\n"
@@ -2279,15 +3471,51 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
         "- swap-cipher       chosen cipher for use with swap strategies (same choices as cipher)\n"
         "- swap-strategy     chosen swap strategy (see README for choices)\n"
         "- support-uc        chosen cipher for crypt (see README for choices)\n"
-        "- tpm-id            internal index used by RPMB module\n\n"
+        "- tpm-id            internal index used by RPMB module\n"
+        "- workers           number of threads serving requests concurrently (max %"PRIu32")\n"
+        "- multi-conn        give the kernel one nbd socket per worker instead of sharing a single one\n"
+        "- crypt-threads     helper threads a request spanning several nuggets is split across (0 = off, max %"PRIu32")\n"
+        "- queue-depth       requests accepted from the kernel before reading more of them stalls (0 = 2 per worker, max %"PRIu32")\n"
+        "- merge-window      contiguous queued writes are merged into one up to this many KILOBYTES (0 = off, max %"PRIu32")\n"
+        "- read-deadline     MILLISECONDS a read may wait queued before it is served ahead of everything else\n"
+        "- write-deadline    MILLISECONDS a write may wait queued (behind reads) before it is served ahead of them\n"
+        "- io-engine         how the backstore is accessed: ioe_pread (default), ioe_mmap, ioe_uring, or ioe_direct\n"
+        "- readahead         decrypted nuggets sequential reads are read ahead into (0 = off, max %"PRIu32")\n"
+        "- metadata-cache    MEGABYTES of keycounts, TJ entries, and nugget metadata kept in memory (0 = all of them)\n"
+        "                    (not with swap_mirrored or swap_selective)\n"
+        "- backstore-path    file or block device to use as the backstore instead of ./blfs-nbd_device_name.bkstr\n"
+        "                    (a block device is used whole; backstore-size is ignored)\n"
+        "- stripe-member     another file or block device to stripe nugget data across; repeat to add more (max %"PRIu32")\n"
+        "                    (files are created backstore-size big; the backstore itself keeps all the metadata)\n"
+        "- stripe-nuggets    consecutive nuggets put on one stripe member before moving on to the next\n"
+        "- metadata-path     file or block device to keep the headers and per-nugget metadata on instead, leaving only\n"
+        "                    nugget data on the backstore (files are created backstore-size big, but sparse)\n\n",
+        argv[0], BLFS_MAX_NUM_WORKERS, BLFS_MAX_NUM_CRYPT_THREADS, BLFS_MAX_QUEUE_DEPTH, BLFS_MAX_MERGE_WINDOW_KB,
+        BLFS_MAX_READAHEAD_NUGGETS, BLFS_MAX_STRIPE_WIDTH - 1);
 
+        printf(
         "::open command::\n"
         "This command will open and load a preexisting StrongBox backstore or fail if it does not exist.\n\n"
         "Example: %s --allow-insecure-start open nbd4\n\n"
         ":options:\n"
         "- default-password  instead of asking you for a password, the password '"BLFS_DEFAULT_PASS"' will be used.\n"
-        "- allow-insecure-start ignores a MTRH failure (integrity issue) and loads the StrongBox backstore anyway\n\n"
+        "- allow-insecure-start ignores a MTRH failure (integrity issue) and loads the StrongBox backstore anyway\n"
+        "- workers           number of threads serving requests concurrently\n"
+        "- multi-conn        give the kernel one nbd socket per worker instead of sharing a single one\n"
+        "- crypt-threads     helper threads a request spanning several nuggets is split across\n"
+        "- queue-depth       requests accepted from the kernel before reading more of them stalls\n"
+        "- merge-window      contiguous queued writes are merged into one up to this many KILOBYTES\n"
+        "- read-deadline     MILLISECONDS a read may wait queued before it is served ahead of everything else\n"
+        "- write-deadline    MILLISECONDS a write may wait queued (behind reads) before it is served ahead of them\n"
+        "- io-engine         how the backstore is accessed: ioe_pread (default), ioe_mmap, ioe_uring, or ioe_direct\n"
+        "- readahead         decrypted nuggets sequential reads are read ahead into\n"
+        "- metadata-cache    MEGABYTES of keycounts, TJ entries, and nugget metadata kept in memory\n"
+        "- backstore-path    file or block device to use as the backstore instead of ./blfs-nbd_device_name.bkstr\n"
+        "- stripe-member     the backstore's stripe members, in the same order they were given to create\n"
+        "- metadata-path     the backstore's metadata device, if it was given one at create\n\n",
+        argv[0]);
 
+        printf(
         "::wipe command::\n"
         "This command will reset an already existing StrongBox backstore to its initial state, as if it were newly\n"
         " created. It will not be automatically loaded and must be subsequently opened via the open command. Note that\n"
@@ -2295,12 +3523,12 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
         "Example: %s wipe nbd4\n\n"
         ":options:\n"
         "- default-password  instead of asking you for a password, the password '"BLFS_DEFAULT_PASS"' will be used.\n"
-        "- allow-insecure-start ignores a MTRH failure (integrity issue) and loads the StrongBox backstore anyway\n\n"
+        "- allow-insecure-start ignores a MTRH failure (integrity issue) and loads the StrongBox backstore anyway\n"
+        "- backstore-path    file or block device to use as the backstore instead of ./blfs-nbd_device_name.bkstr\n\n"
 
         "To test for correctness, run `make pre && make check` from the /build directory. Check the README for more details.\n"
         "Don't forget to load nbd kernel module `modprobe nbd` and run as root!\n\n",
-        argv[0], BLFS_DEFAULT_BYTES_BACKSTORE, BLFS_DEFAULT_BYTES_FLAKE, BLFS_DEFAULT_FLAKES_PER_NUGGET, BLFS_DEFAULT_TPM_ID,
-        argv[0], argv[0], argv[0], argv[0], argv[0]);
+        argv[0]);
 
         Throw(EXCEPTION_MUST_HALT);
     }
@@ -2457,6 +3685,144 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
             IFDEBUG3(printf("<bare debug>: saw --tpm-id, got value: %"PRIu64"\n", buselfs_state->rpmb_secure_index));
         }
 
+        else if(strcmp(argv[argc], "--workers") == 0)
+        {
+            int64_t cin_num_workers_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_num_workers = (uint32_t) cin_num_workers_int;
+
+            if(cin_num_workers_int <= 0 || cin_num_workers_int > BLFS_MAX_NUM_WORKERS)
+                Throw(EXCEPTION_INVALID_NUM_WORKERS);
+
+            IFDEBUG3(printf("<bare debug>: saw --workers = %"PRIu32"\n", cin_num_workers));
+        }
+
+        else if(strcmp(argv[argc], "--multi-conn") == 0)
+        {
+            cin_multi_conn = TRUE;
+            IFDEBUG3(printf("<bare debug>: saw --multi-conn = %i\n", cin_multi_conn));
+        }
+
+        else if(strcmp(argv[argc], "--crypt-threads") == 0)
+        {
+            int64_t cin_num_crypt_threads_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_num_crypt_threads = (uint32_t) cin_num_crypt_threads_int;
+
+            if(cin_num_crypt_threads_int < 0 || cin_num_crypt_threads_int > BLFS_MAX_NUM_CRYPT_THREADS)
+                Throw(EXCEPTION_INVALID_NUM_CRYPT_THREADS);
+
+            IFDEBUG3(printf("<bare debug>: saw --crypt-threads = %"PRIu32"\n", cin_num_crypt_threads));
+        }
+
+        else if(strcmp(argv[argc], "--queue-depth") == 0)
+        {
+            int64_t cin_queue_depth_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_queue_depth = (uint32_t) cin_queue_depth_int;
+
+            if(cin_queue_depth_int < 0 || cin_queue_depth_int > BLFS_MAX_QUEUE_DEPTH)
+                Throw(EXCEPTION_INVALID_SCHEDULER_SETTING);
+
+            IFDEBUG3(printf("<bare debug>: saw --queue-depth = %"PRIu32"\n", cin_queue_depth));
+        }
+
+        else if(strcmp(argv[argc], "--merge-window") == 0)
+        {
+            int64_t cin_merge_window_kb_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_merge_window_kb = (uint32_t) cin_merge_window_kb_int;
+
+            if(cin_merge_window_kb_int < 0 || cin_merge_window_kb_int > BLFS_MAX_MERGE_WINDOW_KB)
+                Throw(EXCEPTION_INVALID_SCHEDULER_SETTING);
+
+            IFDEBUG3(printf("<bare debug>: saw --merge-window = %"PRIu32"\n", cin_merge_window_kb));
+        }
+
+        else if(strcmp(argv[argc], "--read-deadline") == 0 || strcmp(argv[argc], "--write-deadline") == 0)
+        {
+            int64_t cin_deadline_ms_int = strtoll(argv[argc + 1], NULL, 0);
+
+            if(cin_deadline_ms_int <= 0 || cin_deadline_ms_int > UINT32_MAX)
+                Throw(EXCEPTION_INVALID_SCHEDULER_SETTING);
+
+            if(argv[argc][2] == 'r')
+                cin_read_deadline_ms = (uint32_t) cin_deadline_ms_int;
+
+            else
+                cin_write_deadline_ms = (uint32_t) cin_deadline_ms_int;
+
+            IFDEBUG3(printf("<bare debug>: saw %s = %"PRId64"\n", argv[argc], cin_deadline_ms_int));
+        }
+
+        else if(strcmp(argv[argc], "--io-engine") == 0)
+        {
+            char * cin_io_engine_str = argv[argc + 1];
+
+            IFDEBUG3(printf("<bare debug>: saw --io-engine = %s\n", cin_io_engine_str));
+
+            cin_io_engine = blfs_ident_string_to_io_engine(cin_io_engine_str);
+
+            IFDEBUG3(printf("<bare debug>: saw --io-engine, got enum value: %d\n", cin_io_engine));
+        }
+
+        else if(strcmp(argv[argc], "--readahead") == 0)
+        {
+            int64_t cin_readahead_nuggets_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_readahead_nuggets = (uint32_t) cin_readahead_nuggets_int;
+
+            if(cin_readahead_nuggets_int < 0 || cin_readahead_nuggets_int > BLFS_MAX_READAHEAD_NUGGETS)
+                Throw(EXCEPTION_INVALID_READAHEAD);
+
+            IFDEBUG3(printf("<bare debug>: saw --readahead = %"PRIu32"\n", cin_readahead_nuggets));
+        }
+
+        else if(strcmp(argv[argc], "--metadata-cache") == 0)
+        {
+            int64_t cin_metadata_cache_mb_int = strtoll(argv[argc + 1], NULL, 0);
+            cin_metadata_cache_mb = (uint32_t) cin_metadata_cache_mb_int;
+
+            if(cin_metadata_cache_mb_int < 0 || cin_metadata_cache_mb_int > UINT32_MAX)
+                Throw(EXCEPTION_BAD_ARGUMENT_FORM);
+
+            IFDEBUG3(printf("<bare debug>: saw --metadata-cache = %"PRIu32"\n", cin_metadata_cache_mb));
+        }
+
+        else if(strcmp(argv[argc], "--backstore-path") == 0)
+        {
+            cin_backstore_path = argv[argc + 1];
+
+            if(strlen(cin_backstore_path) >= BLFS_BACKSTORE_FILENAME_MAXLEN)
+                Throw(EXCEPTION_BAD_ARGUMENT_FORM);
+
+            IFDEBUG3(printf("<bare debug>: saw --backstore-path = %s\n", cin_backstore_path));
+        }
+
+        else if(strcmp(argv[argc], "--metadata-path") == 0)
+        {
+            buselfs_state->metadata_path = argv[argc + 1];
+
+            IFDEBUG3(printf("<bare debug>: saw --metadata-path = %s\n", buselfs_state->metadata_path));
+        }
+
+        else if(strcmp(argv[argc], "--stripe-member") == 0)
+        {
+            if(buselfs_state->num_stripe_members >= BLFS_MAX_STRIPE_WIDTH - 1)
+                Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+
+            buselfs_state->stripe_member_paths[buselfs_state->num_stripe_members++] = argv[argc + 1];
+
+            IFDEBUG3(printf("<bare debug>: saw --stripe-member = %s\n", argv[argc + 1]));
+        }
+
+        else if(strcmp(argv[argc], "--stripe-nuggets") == 0)
+        {
+            int64_t cin_stripe_nuggets_int = strtoll(argv[argc + 1], NULL, 0);
+
+            if(cin_stripe_nuggets_int <= 0 || cin_stripe_nuggets_int > UINT32_MAX)
+                Throw(EXCEPTION_BAD_STRIPE_MEMBER);
+
+            buselfs_state->stripe_nuggets = (uint32_t) cin_stripe_nuggets_int;
+
+            IFDEBUG3(printf("<bare debug>: saw --stripe-nuggets = %"PRIu32"\n", buselfs_state->stripe_nuggets));
+        }
+
         IFDEBUG3(printf("<bare debug>: errno = %i\n", errno));
 
         if(errno == ERANGE)
@@ -2466,6 +3832,16 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
         }
     }
 
+    // ? Arguments were processed last to first; stripe members go first to last
+    for(uint32_t i = 0; i < buselfs_state->num_stripe_members / 2; i++)
+    {
+        uint32_t j = buselfs_state->num_stripe_members - 1 - i;
+        const char * stripe_member_path = buselfs_state->stripe_member_paths[i];
+
+        buselfs_state->stripe_member_paths[i] = buselfs_state->stripe_member_paths[j];
+        buselfs_state->stripe_member_paths[j] = stripe_member_path;
+    }
+
     if(cin_swap_strategy == swap_default)
         cin_swap_strategy = swap_disabled;
 
@@ -2481,6 +3857,14 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
     IFDEBUG3(printf("<bare debug>: cin_swap_strategy = %d\n", cin_swap_strategy));
     IFDEBUG3(printf("<bare debug>: cin_usecase = %d\n", cin_usecase));
     IFDEBUG3(printf("<bare debug>: cin_delay_rw = %d\n", cin_delay_rw));
+    IFDEBUG3(printf("<bare debug>: cin_num_workers = %"PRIu32"\n", cin_num_workers));
+    IFDEBUG3(printf("<bare debug>: cin_multi_conn = %d\n", cin_multi_conn));
+    IFDEBUG3(printf("<bare debug>: cin_num_crypt_threads = %"PRIu32"\n", cin_num_crypt_threads));
+    IFDEBUG3(printf("<bare debug>: cin_queue_depth = %"PRIu32"\n", cin_queue_depth));
+    IFDEBUG3(printf("<bare debug>: cin_merge_window_kb = %"PRIu32"\n", cin_merge_window_kb));
+    IFDEBUG3(printf("<bare debug>: cin_read_deadline_ms = %"PRIu32"\n", cin_read_deadline_ms));
+    IFDEBUG3(printf("<bare debug>: cin_write_deadline_ms = %"PRIu32"\n", cin_write_deadline_ms));
+    IFDEBUG3(printf("<bare debug>: cin_io_engine = %d\n", cin_io_engine));
 
     IFDEBUG3(printf("<bare debug>: defaults:\n"));
     IFDEBUG3(printf("<bare debug>: default allow_insecure_start = 0\n"));
@@ -2523,6 +3907,13 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
     if(cin_flakes_per_nugget < BLFS_HEAD_MIN_FLAKESPERNUGGET)
         Throw(EXCEPTION_TOO_FEW_FLAKES_PER_NUGGET);
 
+    // ! swap_mirrored and swap_selective set half of the cipher idents in
+    // ! memory only (see below), so none of them may ever be evicted
+    if(cin_metadata_cache_mb && (cin_swap_strategy == swap_mirrored || cin_swap_strategy == swap_selective))
+        Throw(EXCEPTION_BAD_ARGUMENT_FORM);
+
+    buselfs_state->metadata_cache_bytes = (uint64_t) cin_metadata_cache_mb * BYTES_IN_A_MB;
+
     /* Cipher selection and initialization */
 
     buselfs_state->primary_cipher = malloc(sizeof *buselfs_state->primary_cipher);
@@ -2549,7 +3940,12 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
 
     /* Prepare to setup the backstore file */
 
-    sprintf(backstore_path, BLFS_BACKSTORE_FILENAME, cin_device_name);
+    if(cin_backstore_path != NULL)
+        strcpy(backstore_path, cin_backstore_path);
+
+    else
+        sprintf(backstore_path, BLFS_BACKSTORE_FILENAME, cin_device_name);
+
     IFDEBUG3(printf("<bare debug>: backstore_path = %s\n", backstore_path));
 
     IFDEBUG3(printf("<bare debug>: continuing pre-initialization step...\n"));
@@ -2638,6 +4034,11 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
     if(buselfs_state->backstore == NULL)
         Throw(EXCEPTION_ASSERT_FAILURE);
 
+    // ? Creating/opening always goes through pread; switch over once it's done
+    blfs_backstore_set_io_engine(buselfs_state->backstore, cin_io_engine);
+
+    IFDEBUG(dzlog_info("io_engine: %i", cin_io_engine));
+
     for(uint32_t nugget_index = 0; nugget_index < buselfs_state->backstore->num_nuggets; nugget_index++)
     {
         blfs_nugget_metadata_t * meta = blfs_open_nugget_metadata(buselfs_state->backstore, nugget_index);
@@ -2647,6 +4048,8 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
         {
             meta->cipher_ident = (uint8_t) buselfs_state->swap_cipher->enum_id;
         }
+
+        trim_nugget_tables(buselfs_state);
     }
 
     buselfs_state->buseops = malloc(sizeof *buselfs_state->buseops);
@@ -2656,6 +4059,7 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
     buselfs_state->buseops->disc  = buse_disc;
     buselfs_state->buseops->flush = buse_flush;
     buselfs_state->buseops->trim  = buse_trim;
+    buselfs_state->buseops->write_zeroes = buse_write_zeroes;
 
     buselfs_state->buseops->size  =  buselfs_state->active_swap_strategy == swap_mirrored
                                   || buselfs_state->active_swap_strategy == swap_selective
@@ -2669,6 +4073,42 @@ buselfs_state_t * strongbox_main_actual(int argc, char * argv[], char * blockdev
 
     buselfs_state->delay_rw = cin_delay_rw;
 
+    /* Prepare for concurrent request handling */
+
+    buselfs_state->num_workers = cin_num_workers;
+    buselfs_state->buseops->workers = cin_num_workers;
+
+    // ? With multi-conn, each worker thread serves its own nbd socket instead
+    buselfs_state->buseops->connections = cin_multi_conn ? cin_num_workers : 1;
+
+    // ? Reads are served first and contiguous writes merged; see buse.c
+    buselfs_state->buseops->queue_depth = cin_queue_depth;
+    buselfs_state->buseops->merge_window = cin_merge_window_kb * BYTES_IN_A_KB;
+    buselfs_state->buseops->read_deadline_ms = cin_read_deadline_ms;
+    buselfs_state->buseops->write_deadline_ms = cin_write_deadline_ms;
+
+    blfs_initialize_locks(buselfs_state);
+
+    IFDEBUG(dzlog_info("scheduling with queue depth %"PRIu32" (0 = default), %"PRIu32" byte merge window, "
+                       "%"PRIu32" ms read and %"PRIu32" ms write deadlines",
+                       cin_queue_depth, buselfs_state->buseops->merge_window, cin_read_deadline_ms, cin_write_deadline_ms));
+
+    IFDEBUG(dzlog_info("serving requests with %"PRIu32" worker thread(s) over %"PRIu32" connection(s)",
+                       buselfs_state->num_workers, buselfs_state->buseops->connections));
+
+    if(cin_num_crypt_threads)
+        buselfs_state->crypt_pool = pool_init(cin_num_crypt_threads);
+
+    IFDEBUG(dzlog_info("splitting requests across %"PRIu32" crypt thread(s)", cin_num_crypt_threads));
+
+    if(cin_readahead_nuggets)
+    {
+        buselfs_state->readahead = readahead_init(cin_readahead_nuggets, buselfs_state->backstore->nugget_size_bytes);
+        readahead_start(buselfs_state->readahead, fill_read_ahead, buselfs_state);
+    }
+
+    IFDEBUG(dzlog_info("reading sequential streams ahead into %"PRIu32" nugget(s)", cin_readahead_nuggets));
+
     /* Let the show begin! */
 
     IFDEBUG(dzlog_info(">> StrongBox backend was setup successfully! <<"));
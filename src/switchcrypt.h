@@ -10,8 +10,11 @@
 #include "khash.h"
 #include "merkletree.h"
 #include "swappable.h"
+#include "pool.h"
+#include "readahead.h"
 
 #include <mqueue.h>
+#include <pthread.h>
 
 typedef struct blfs_swappable_cipher_t blfs_swappable_cipher_t;
 typedef struct buselfs_state_t buselfs_state_t;
@@ -152,6 +155,105 @@ typedef struct buselfs_state_t
      * BLFS_DELAY_RW_PENALTY_MS milliseconds (StrongBox will sleep)
      */
     int delay_rw;
+
+    /**
+     * The number of buse worker threads that serve requests concurrently. See
+     * the --workers flag and BLFS_DEFAULT_NUM_WORKERS.
+     */
+    uint32_t num_workers;
+
+    /**
+     * The number of buse_write calls currently executing. blfs_group_commit
+     * waits for this to reach zero (see writes_drained). Guarded by
+     * state_lock.
+     */
+    uint32_t writes_in_flight;
+
+    /**
+     * Non-zero while there are writes that have not been group committed yet.
+     * The first write after a commit opens the epoch by bumping the TPM global
+     * version (so a crash is detectable); blfs_group_commit closes it by
+     * committing the TPMGLOBALVER and MTRH headers. Guarded by state_lock.
+     */
+    uint8_t epoch_open;
+
+    /**
+     * The number of times writes_in_flight has drained to zero since the epoch
+     * opened. leave_write_epoch only rewrites the epoch record every
+     * BLFS_EPOCH_RECORD_INTERVAL drains. Guarded by state_lock.
+     */
+    uint32_t epoch_drains;
+
+    /**
+     * One (recursive) lock per nugget. A read or write holds the locks of
+     * every nugget it touches, always acquired in ascending nugget order, so
+     * requests against different nuggets do not block each other.
+     *
+     * ! NULL means requests are served by a single thread and no locking is
+     * ! done (e.g. during create/open and in the unit tests)
+     */
+    pthread_mutex_t * nugget_locks;
+
+    /**
+     * Guards state shared by every nugget: merkle_tree, merkle_tree_root_hash,
+     * the TPMGLOBALVER and MTRH headers, and the active cipher. Recursive. When
+     * held together with nugget locks, it must be acquired last.
+     *
+     * ! NULL means no locking is done (see nugget_locks)
+     */
+    pthread_mutex_t * state_lock;
+
+    /**
+     * Signalled (with state_lock) whenever writes_in_flight drops to zero.
+     *
+     * ! NULL when locking is not initialized (see nugget_locks)
+     */
+    pthread_cond_t * writes_drained;
+
+    /**
+     * Helper threads that buse_read and buse_write fan a request spanning
+     * several nuggets out to, one nugget per task. See the --crypt-threads
+     * flag and BLFS_DEFAULT_NUM_CRYPT_THREADS.
+     *
+     * ! NULL means every request is handled entirely by the calling thread
+     */
+    pool_t * crypt_pool;
+
+    /**
+     * Decrypted nuggets that sequential buse_read streams are read ahead
+     * into. See the --readahead flag and BLFS_DEFAULT_READAHEAD_NUGGETS.
+     *
+     * ! NULL means nothing is read ahead
+     */
+    readahead_t * readahead;
+
+    /**
+     * The files/devices (besides the backstore itself) that the backstore's
+     * body is striped across, in order, and how many consecutive nuggets go
+     * on each. See the --stripe-member and --stripe-nuggets flags.
+     *
+     * ! num_stripe_members == 0 means the backstore is not striped
+     */
+    uint32_t num_stripe_members;
+    const char * stripe_member_paths[BLFS_MAX_STRIPE_WIDTH - 1];
+    uint32_t stripe_nuggets;
+
+    /**
+     * The file/device holding the headers and nugget records when they are
+     * kept apart from the body. See the --metadata-path flag.
+     *
+     * ! NULL means they share the backstore with the body
+     */
+    const char * metadata_path;
+
+    /**
+     * Memory the backstore's keycounts, TJ entries, and nugget metadata may
+     * occupy before they start being evicted. See the --metadata-cache flag
+     * and blfs_nugget_tables_t.
+     *
+     * ! 0 means they are all kept in memory
+     */
+    uint64_t metadata_cache_bytes;
 } buselfs_state_t;
 
 /**
@@ -221,6 +323,53 @@ void get_flake_key_using_keychain(uint8_t * flake_key,
                                   uint32_t flake_index,
                                   uint64_t keycount);
 
+/**
+ * Allocates the per-nugget lock table and the state lock so that buse_read and
+ * buse_write can be called from multiple threads at once. Must be called after
+ * the backstore has been created or opened (num_nuggets must be known).
+ */
+void blfs_initialize_locks(buselfs_state_t * buselfs_state);
+
+/**
+ * Frees everything blfs_initialize_locks allocated. No other thread may be
+ * using buselfs_state at this point. Must be called before the backstore is
+ * closed.
+ */
+void blfs_destroy_locks(buselfs_state_t * buselfs_state);
+
+/**
+ * Acquires the locks of nuggets first_nugget_index through last_nugget_index
+ * (inclusive) in ascending order. A noop if locking is not initialized.
+ */
+void blfs_lock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index);
+
+/**
+ * Releases the locks acquired by blfs_lock_nuggets.
+ */
+void blfs_unlock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index);
+
+/**
+ * Like blfs_lock_nuggets, but gives up (releasing whatever it acquired) rather
+ * than wait on a lock someone else holds. Returns non-zero if every lock was
+ * acquired. Always succeeds if locking is not initialized.
+ */
+int blfs_trylock_nuggets(const buselfs_state_t * buselfs_state, uint64_t first_nugget_index, uint64_t last_nugget_index);
+
+/**
+ * Acquires/releases buselfs_state->state_lock. Noops if locking is not
+ * initialized.
+ */
+void blfs_lock_state(const buselfs_state_t * buselfs_state);
+void blfs_unlock_state(const buselfs_state_t * buselfs_state);
+
+/**
+ * Makes every write completed so far durable in one ordered commit: the body
+ * and metadata are synced, then the TPMGLOBALVER and MTRH headers covering
+ * them are written and synced. Closes the current write epoch, if any. This
+ * is what NBD_CMD_FLUSH (and FUA) ends up calling.
+ */
+void blfs_group_commit(buselfs_state_t * buselfs_state);
+
 /**
  * Update the global merkle tree root hash
  *
@@ -304,6 +453,28 @@ int buse_read(void * buffer, uint32_t len, uint64_t offset, void * userdata);
  */
 int buse_write(const void * buffer, uint32_t len, uint64_t offset, void * userdata);
 
+/**
+ * BUSE trim (discard) operation handler. Passed directly to the buse core.
+ * Nuggets lying entirely within the range are returned to the pristine state:
+ * rekeyed, TJ bits cleared, and their body hole-punched. Their flakes then read
+ * back as zeros without any I/O or decryption, and cipher swaps skip them.
+ * Partially covered nuggets are left alone.
+ *
+ * @param  userdata (buselfs_state*)
+ */
+int buse_trim(uint64_t from, uint32_t len, void * userdata);
+
+/**
+ * BUSE write zeroes operation handler. Passed directly to the buse core. Nuggets
+ * lying entirely within the range are reset exactly as buse_trim would (keeping
+ * their body allocated if no_hole is non-zero), so zeroing them costs no
+ * per-flake crypto. Only the partially covered nuggets at either end of the
+ * range go through buse_write.
+ *
+ * @param  userdata (buselfs_state*)
+ */
+int buse_write_zeroes(uint64_t from, uint32_t len, int no_hole, void * userdata);
+
 /**
  * Sugar function wrapping blfs_backstore_open that handles updating
  * md_bytes_per_nugget at the correct point and with context (buselfs_state).
@@ -0,0 +1,283 @@
+/**
+ * Bare-bones io_uring support for batching backstore writes and syncs.
+ *
+ * @author Bernard Dickens
+ */
+
+#include "uring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int io_uring_setup(unsigned entries, struct io_uring_params * params)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/**
+ * Does whatever is left of op (everything past the first done bytes) with
+ * plain synchronous syscalls.
+ */
+static void finish_op_synchronously(const blfs_uring_op_t * op, uint32_t done)
+{
+    if(op->opcode == IORING_OP_FSYNC)
+    {
+        if(fdatasync(op->fd) == -1)
+        {
+            dzlog_fatal("IO error: fdatasync error: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_SYNC_FAILURE);
+        }
+
+        return;
+    }
+
+    while(done < op->length)
+    {
+        ssize_t bytes_written = pwrite64(op->fd, op->buffer + done, op->length - done, op->offset + done);
+
+        if(bytes_written == -1 && errno == EINTR)
+            continue;
+
+        if(bytes_written <= 0)
+        {
+            dzlog_fatal("IO error: write error at offset %"PRIu64": %s",
+                        op->offset + done, bytes_written ? strerror(errno) : "no progress");
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+        }
+
+        done += bytes_written;
+    }
+}
+
+static void queue_op(blfs_uring_t * ring, uint8_t opcode, int fd, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    if(ring->num_ops == ring->entries)
+        blfs_uring_submit_and_wait(ring);
+
+    ring->ops[ring->num_ops++] = (blfs_uring_op_t) {
+        .opcode = opcode,
+        .fd = fd,
+        .buffer = buffer,
+        .length = length,
+        .offset = offset
+    };
+}
+
+blfs_uring_t * blfs_uring_init(uint32_t entries)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+
+    int ring_fd = io_uring_setup(entries, &params);
+
+    if(ring_fd < 0)
+    {
+        IFDEBUG(dzlog_error("io_uring_setup failed: %s", strerror(errno)));
+        Throw(EXCEPTION_URING_INIT_FAILURE);
+    }
+
+    blfs_uring_t * ring = calloc(1, sizeof *ring);
+
+    if(ring == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    ring->ring_fd = ring_fd;
+    ring->entries = params.sq_entries;
+    ring->ops = malloc(ring->entries * sizeof *ring->ops);
+
+    if(ring->ops == NULL)
+        Throw(EXCEPTION_ALLOC_FAILURE);
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // ? Newer kernels map both rings with a single mmap
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->sq_ring_size = ring->cq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQ_RING);
+
+    ring->cq_ring = params.features & IORING_FEAT_SINGLE_MMAP
+        ? ring->sq_ring
+        : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQES);
+
+    if(ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        IFDEBUG(dzlog_error("mapping the io_uring rings failed: %s", strerror(errno)));
+        Throw(EXCEPTION_URING_INIT_FAILURE);
+    }
+
+    ring->sq_tail  = (unsigned *) ((uint8_t *) ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask  = (unsigned *) ((uint8_t *) ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) ((uint8_t *) ring->sq_ring + params.sq_off.array);
+
+    ring->cq_head = (unsigned *) ((uint8_t *) ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *) ((uint8_t *) ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) ((uint8_t *) ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe *) ((uint8_t *) ring->cq_ring + params.cq_off.cqes);
+
+    IFDEBUG(dzlog_debug("io_uring %d set up with %"PRIu32" entries", ring_fd, ring->entries));
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+
+    return ring;
+}
+
+void blfs_uring_fini(blfs_uring_t * ring)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    munmap(ring->sqes, ring->sqes_size);
+
+    if(ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->ring_fd);
+
+    free(ring->ops);
+    free(ring);
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
+
+void blfs_uring_queue_write(blfs_uring_t * ring, int fd, const uint8_t * buffer, uint32_t length, uint64_t offset)
+{
+    queue_op(ring, IORING_OP_WRITE, fd, buffer, length, offset);
+}
+
+void blfs_uring_queue_fsync(blfs_uring_t * ring, int fd)
+{
+    queue_op(ring, IORING_OP_FSYNC, fd, NULL, 0, 0);
+}
+
+int blfs_uring_overlaps(const blfs_uring_t * ring, int fd, uint64_t offset, uint32_t length)
+{
+    for(uint32_t i = 0; i < ring->num_ops; i++)
+    {
+        const blfs_uring_op_t * op = ring->ops + i;
+
+        if(op->opcode == IORING_OP_WRITE
+           && op->fd == fd
+           && op->offset < offset + length
+           && offset < op->offset + op->length)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void blfs_uring_submit_and_wait(blfs_uring_t * ring)
+{
+    IFDEBUG(dzlog_debug(">>>> entering %s", __func__));
+
+    uint32_t num_ops = ring->num_ops;
+
+    if(num_ops == 0)
+        return;
+
+    // ? Cleared up front: finishing an op below may throw
+    ring->num_ops = 0;
+
+    unsigned tail = *ring->sq_tail;
+
+    for(uint32_t i = 0; i < num_ops; i++, tail++)
+    {
+        const blfs_uring_op_t * op = ring->ops + i;
+        unsigned index = tail & *ring->sq_mask;
+        struct io_uring_sqe * sqe = ring->sqes + index;
+
+        memset(sqe, 0, sizeof *sqe);
+        sqe->opcode = op->opcode;
+        sqe->fd = op->fd;
+        sqe->addr = (uint64_t) (uintptr_t) op->buffer;
+        sqe->len = op->length;
+        sqe->off = op->offset;
+        sqe->user_data = i;
+
+        if(op->opcode == IORING_OP_FSYNC)
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+
+        // ? The chain is what keeps e.g. headers from going out before the
+        // ? body and journal they vouch for
+        if(i + 1 < num_ops)
+            sqe->flags = IOSQE_IO_LINK;
+
+        ring->sq_array[index] = index;
+    }
+
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    // ? Kernel-side results, indexed by op; filled in as completions arrive
+    int32_t results[num_ops];
+    uint32_t completed = 0;
+    uint32_t submitted = 0;
+
+    while(completed < num_ops)
+    {
+        int ret = io_uring_enter(ring->ring_fd, num_ops - submitted, num_ops - completed, IORING_ENTER_GETEVENTS);
+
+        if(ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            dzlog_fatal("IO error: io_uring_enter error: %s", strerror(errno));
+            Throw(EXCEPTION_BACKSTORE_IO_FAILURE);
+        }
+
+        if(ret > 0)
+            submitted += ret;
+
+        unsigned head = *ring->cq_head;
+        unsigned cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        for(; head != cq_tail; head++, completed++)
+        {
+            const struct io_uring_cqe * cqe = ring->cqes + (head & *ring->cq_mask);
+            results[cqe->user_data] = cqe->res;
+        }
+
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    for(uint32_t i = 0; i < num_ops; i++)
+    {
+        const blfs_uring_op_t * op = ring->ops + i;
+        int32_t res = results[i];
+
+        if(res >= 0 && (uint32_t) res == op->length)
+            continue;
+
+        // ? A short write severs the chain and cancels the rest of it, so
+        // ? whatever didn't happen is redone here, in order
+        if(res >= 0 || res == -ECANCELED || res == -EINTR || res == -EAGAIN)
+        {
+            IFDEBUG(dzlog_debug("finishing op %"PRIu32" of %"PRIu32" synchronously (res = %"PRId32")", i, num_ops, res));
+            finish_op_synchronously(op, res > 0 ? (uint32_t) res : 0);
+            continue;
+        }
+
+        dzlog_fatal("IO error: io_uring %s error at offset %"PRIu64": %s",
+                    op->opcode == IORING_OP_FSYNC ? "fsync" : "write", op->offset, strerror(-res));
+
+        Throw(op->opcode == IORING_OP_FSYNC ? EXCEPTION_BACKSTORE_SYNC_FAILURE : EXCEPTION_BACKSTORE_IO_FAILURE);
+    }
+
+    IFDEBUG(dzlog_debug("<<<< leaving %s", __func__));
+}
@@ -0,0 +1,122 @@
+#ifndef BLFS_URING_H_
+#define BLFS_URING_H_
+
+#include "constants.h"
+
+#include <linux/io_uring.h>
+
+/**
+ * One queued operation, kept so that it can be finished synchronously should
+ * the kernel only do part of it (or cancel it).
+ */
+typedef struct blfs_uring_op_t
+{
+    uint8_t opcode;
+    int fd;
+    const uint8_t * buffer;
+    uint32_t length;
+    uint64_t offset;
+} blfs_uring_op_t;
+
+/**
+ * A minimal io_uring instance (no liburing) that queues backstore writes and
+ * fsyncs and submits them as a single linked chain, so they complete in the
+ * order they were queued. Not thread safe; each thread needs its own.
+ *
+ * @ring_fd     io_uring file descriptor
+ * @entries     Submission queue size, i.e. the most ops one submission holds
+ * @sq_*        Submission queue ring, as mapped from the kernel
+ * @cq_*        Completion queue ring, as mapped from the kernel
+ * @ops         The ops queued since the last submission, in order
+ * @num_ops     Number of queued ops
+ */
+typedef struct blfs_uring_t
+{
+    int ring_fd;
+    uint32_t entries;
+
+    void * sq_ring;
+    size_t sq_ring_size;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    struct io_uring_sqe * sqes;
+    size_t sqes_size;
+
+    void * cq_ring;
+    size_t cq_ring_size;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+
+    blfs_uring_op_t * ops;
+    uint32_t num_ops;
+} blfs_uring_t;
+
+/**
+ * Set up an io_uring with room for entries queued ops. Do not forget to call
+ * blfs_uring_fini() when you're done with it!
+ *
+ * Throws EXCEPTION_URING_INIT_FAILURE if the kernel does not support (or has
+ * disabled) io_uring.
+ *
+ * @param  entries  Submission queue size (a power of 2)
+ *
+ * @return          The new ring
+ */
+blfs_uring_t * blfs_uring_init(uint32_t entries);
+
+/**
+ * Tear down a ring. Anything still queued is dropped without being submitted.
+ *
+ * @param ring
+ */
+void blfs_uring_fini(blfs_uring_t * ring);
+
+/**
+ * Queue a write of length bytes from buffer to fd at offset. buffer must stay
+ * untouched until the ring is next submitted. Submits first (see
+ * blfs_uring_submit_and_wait) if the ring is already full.
+ *
+ * @param ring
+ * @param fd
+ * @param buffer
+ * @param length
+ * @param offset
+ */
+void blfs_uring_queue_write(blfs_uring_t * ring, int fd, const uint8_t * buffer, uint32_t length, uint64_t offset);
+
+/**
+ * Queue an fdatasync of fd. Submits first if the ring is already full.
+ *
+ * @param ring
+ * @param fd
+ */
+void blfs_uring_queue_fsync(blfs_uring_t * ring, int fd);
+
+/**
+ * Returns non-zero if a queued write to fd overlaps [offset, offset + length).
+ *
+ * @param ring
+ * @param fd
+ * @param offset
+ * @param length
+ */
+int blfs_uring_overlaps(const blfs_uring_t * ring, int fd, uint64_t offset, uint32_t length);
+
+/**
+ * Submit every queued op with a single io_uring_enter and wait for all of them
+ * to complete. Each op is linked to the next, so an op only starts once every
+ * op queued before it has finished.
+ *
+ * Ops the kernel only partly did or cancelled (once an earlier op in the chain
+ * fell short, the rest of the chain is cancelled) are finished synchronously,
+ * still in order. Throws EXCEPTION_BACKSTORE_IO_FAILURE or
+ * EXCEPTION_BACKSTORE_SYNC_FAILURE if a write or fsync actually fails.
+ *
+ * @param ring
+ */
+void blfs_uring_submit_and_wait(blfs_uring_t * ring);
+
+#endif /* BLFS_URING_H_ */
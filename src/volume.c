@@ -0,0 +1,127 @@
+/**
+ * In-process block API around buselfs_state_t; see volume.h
+ *
+ * @author Bernard Dickens
+ */
+
+#include "volume.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+
+// ? Guards every entry point: nothing thrown by the core may escape to callers
+#define VOLUME_TRY_OR_RETURN_EIO(fn_call)                                               \
+    do {                                                                                \
+        volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;                               \
+        Try { fn_call; }                                                                \
+        Catch(e)                                                                        \
+        {                                                                               \
+            dzlog_error("EXCEPTION: %s failed with exception 0x%x", __func__, e);       \
+            return -EIO;                                                                \
+        }                                                                               \
+    } while(0)
+
+static int range_is_valid(const buselfs_state_t * buselfs_state, uint64_t offset, uint32_t length)
+{
+    uint64_t size = buselfs_state->buseops->size;
+    return offset <= size && length <= size - offset;
+}
+
+buselfs_state_t * blfs_volume_open(int argc, char * argv[])
+{
+    char blockdevice[BLFS_BACKSTORE_FILENAME_MAXLEN] = { 0x00 };
+    buselfs_state_t * volatile buselfs_state = NULL;
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    Try
+    {
+        buselfs_state = strongbox_main_actual(argc, argv, blockdevice);
+    }
+
+    Catch(e)
+    {
+        // ? zlog may not be up yet
+        fprintf(stderr, "EXCEPTION: %s failed with exception 0x%x\n", __func__, e);
+        return NULL;
+    }
+
+    IFDEBUG(dzlog_info("volume opened in-process (%"PRIu64" bytes)", buselfs_state->buseops->size));
+    return buselfs_state;
+}
+
+uint64_t blfs_volume_size(const buselfs_state_t * buselfs_state)
+{
+    return buselfs_state->buseops->size;
+}
+
+int blfs_volume_read(buselfs_state_t * buselfs_state, void * buffer, uint32_t length, uint64_t offset)
+{
+    if(!range_is_valid(buselfs_state, offset, length))
+        return -EINVAL;
+
+    VOLUME_TRY_OR_RETURN_EIO(buse_read(buffer, length, offset, buselfs_state));
+    return 0;
+}
+
+int blfs_volume_write(buselfs_state_t * buselfs_state, const void * buffer, uint32_t length, uint64_t offset)
+{
+    if(!range_is_valid(buselfs_state, offset, length))
+        return -EINVAL;
+
+    VOLUME_TRY_OR_RETURN_EIO(buse_write(buffer, length, offset, buselfs_state));
+    return 0;
+}
+
+int blfs_volume_flush(buselfs_state_t * buselfs_state)
+{
+    VOLUME_TRY_OR_RETURN_EIO(blfs_group_commit(buselfs_state));
+    return 0;
+}
+
+int blfs_volume_trim(buselfs_state_t * buselfs_state, uint64_t offset, uint32_t length)
+{
+    if(!range_is_valid(buselfs_state, offset, length))
+        return -EINVAL;
+
+    VOLUME_TRY_OR_RETURN_EIO(buse_trim(offset, length, buselfs_state));
+    return 0;
+}
+
+int blfs_volume_write_zeroes(buselfs_state_t * buselfs_state, uint64_t offset, uint32_t length)
+{
+    if(!range_is_valid(buselfs_state, offset, length))
+        return -EINVAL;
+
+    VOLUME_TRY_OR_RETURN_EIO(buse_write_zeroes(offset, length, FALSE, buselfs_state));
+    return 0;
+}
+
+int blfs_volume_close(buselfs_state_t * buselfs_state)
+{
+    int ret = blfs_volume_flush(buselfs_state);
+
+    // ? Before the pool: the read-ahead thread may be fanned out across it
+    if(buselfs_state->readahead != NULL)
+        readahead_fini(buselfs_state->readahead);
+
+    if(buselfs_state->crypt_pool != NULL)
+        pool_fini(buselfs_state->crypt_pool);
+
+    blfs_destroy_locks(buselfs_state);
+    blfs_backstore_close(buselfs_state->backstore);
+    mt_delete(buselfs_state->merkle_tree);
+
+    if(!BLFS_DEFAULT_DISABLE_KEY_CACHING)
+        kh_destroy(BLFS_KHASH_NUGGET_KEY_CACHE_NAME, buselfs_state->cache_nugget_keys);
+
+    mq_close(buselfs_state->qd_incoming);
+    mq_close(buselfs_state->qd_outgoing);
+
+    free(buselfs_state->buseops);
+    free(buselfs_state);
+
+    zlog_fini();
+
+    return ret;
+}
@@ -0,0 +1,80 @@
+#ifndef BLFS_VOLUME_H_
+#define BLFS_VOLUME_H_
+
+#include "switchcrypt.h"
+
+/**
+ * In-process block API. These functions drive the same read/write/flush/trim
+ * handlers the nbd frontend hands to buse, but directly, so a StrongBox volume
+ * can be used (and benchmarked) without root, the nbd module, or /dev/nbdX.
+ *
+ * Every function here may be called from several threads at once on the same
+ * volume (except blfs_volume_close). None of them throw: exceptions raised by
+ * the StrongBox core are caught, logged, and turned into negative errno values.
+ *
+ * ! Only one volume can be open per process at a time, since zlog and the
+ * ! POSIX message queues are process-global.
+ */
+
+/**
+ * Creates, opens, or wipes a backstore exactly like the switchcrypt executable
+ * would, minus the nbd part. argv takes the same form as the executable's (e.g.
+ * `{ "prog", "--default-password", "--backstore-size", "64", "create", "vol0" }`)
+ * and the trailing "device name" picks the backstore file (see
+ * BLFS_BACKSTORE_FILENAME).
+ *
+ * @return the opened volume, or NULL on failure
+ */
+buselfs_state_t * blfs_volume_open(int argc, char * argv[]);
+
+/**
+ * @return the usable size of the volume in bytes
+ */
+uint64_t blfs_volume_size(const buselfs_state_t * buselfs_state);
+
+/**
+ * Reads length bytes at offset into buffer.
+ *
+ * @return 0 on success, -EINVAL if the range is out of bounds, -EIO otherwise
+ */
+int blfs_volume_read(buselfs_state_t * buselfs_state, void * buffer, uint32_t length, uint64_t offset);
+
+/**
+ * Writes length bytes from buffer at offset. Not durable until the next
+ * blfs_volume_flush (or blfs_volume_close).
+ *
+ * @return 0 on success, -EINVAL if the range is out of bounds, -EIO otherwise
+ */
+int blfs_volume_write(buselfs_state_t * buselfs_state, const void * buffer, uint32_t length, uint64_t offset);
+
+/**
+ * Makes every completed write durable (see blfs_group_commit).
+ *
+ * @return 0 on success, -EIO otherwise
+ */
+int blfs_volume_flush(buselfs_state_t * buselfs_state);
+
+/**
+ * Discards a range (see buse_trim).
+ *
+ * @return 0 on success, -EINVAL if the range is out of bounds, -EIO otherwise
+ */
+int blfs_volume_trim(buselfs_state_t * buselfs_state, uint64_t offset, uint32_t length);
+
+/**
+ * Zeroes a range (see buse_write_zeroes).
+ *
+ * @return 0 on success, -EINVAL if the range is out of bounds, -EIO otherwise
+ */
+int blfs_volume_write_zeroes(buselfs_state_t * buselfs_state, uint64_t offset, uint32_t length);
+
+/**
+ * Flushes, then releases the volume and everything blfs_volume_open set up. The
+ * volume must not be in use by any other thread. buselfs_state is freed even if
+ * the final flush fails.
+ *
+ * @return 0 on success, -EIO if the final flush failed
+ */
+int blfs_volume_close(buselfs_state_t * buselfs_state);
+
+#endif /* BLFS_VOLUME_H_ */
@@ -7,15 +7,15 @@ static const uint8_t buffer_init_backstore_state[/*204*/] = {
     // HEAD
     // header section
 
-    0xFF, 0xFF, 0xFF, 0xFF, // BLFS_HEAD_HEADER_BYTES_VERSION
+    0x34, 0x03, 0x00, 0x00, // BLFS_HEAD_HEADER_BYTES_VERSION (820)
 
     0x8f, 0xa2, 0x0d, 0x92, 0x35, 0xd6, 0xc2, 0x4c,
     0xe4, 0xbc, 0x4f, 0x47, 0xa4, 0xce, 0x69, 0xa8, // BLFS_HEAD_HEADER_BYTES_SALT
 
-    0xe8, 0x50, 0x3f, 0x1e, 0x6c, 0xf8, 0xea, 0xc9,
-    0x24, 0x4b, 0x82, 0x1d, 0xca, 0x8e, 0x45, 0x10,
-    0x64, 0x49, 0x48, 0x47, 0xde, 0x18, 0xd0, 0xa0,
-    0x11, 0x40, 0x05, 0x1b, 0xe6, 0x1c, 0xe2, 0xdb, // BLFS_HEAD_HEADER_BYTES_MTRH
+    0x8a, 0x20, 0xe7, 0xd6, 0x6f, 0xdd, 0xbb, 0xb1,
+    0x07, 0xe2, 0xee, 0x9c, 0xe6, 0xb3, 0x62, 0x01,
+    0x94, 0xcc, 0x3d, 0xc5, 0x60, 0xec, 0x28, 0x39,
+    0x13, 0x90, 0x5a, 0xce, 0xc2, 0x5e, 0x30, 0x66, // BLFS_HEAD_HEADER_BYTES_MTRH
 
     0x06, 0x07, 0x08, 0x09, 0x06, 0x07, 0x08, 0x09, // BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER
 
@@ -87,10 +87,10 @@ static const uint8_t test_play_data[] = {
 // ? For when we're using sc_default (with md_bytes_per_nugget=1) with the dummy
 // ? data above (which assumes md_bytes_per_nugget=8 per the buffer init state)
 static const uint8_t alternate_mtrh_data[] = {
-    0x57, 0x33, 0x4b, 0x58, 0x5a, 0x95, 0x96, 0x1e,
-    0x42, 0x1b, 0x98, 0xcc, 0xaf, 0x67, 0xe5, 0x4e,
-    0x3d, 0x82, 0x7a, 0xe4, 0x2b, 0x7d, 0x2c, 0x9d,
-    0x65, 0xfa, 0x89, 0xe5, 0x2f, 0x7d, 0x45, 0x20
+    0x88, 0xf0, 0xf5, 0x0f, 0x7a, 0x7f, 0xd2, 0x6b,
+    0xc0, 0x85, 0xc5, 0xc9, 0xf3, 0x49, 0x45, 0x2b,
+    0x9c, 0x90, 0xf6, 0x81, 0xfc, 0x26, 0x45, 0x78,
+    0xe5, 0x88, 0xc9, 0x37, 0x52, 0xbe, 0xf1, 0x2f
 };
 
 #endif /* BLFS__STRUTS_H_ */
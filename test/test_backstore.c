@@ -39,15 +39,16 @@ void tearDown(void)
 blfs_backstore_t * fake_initialize_backstore(blfs_backstore_t * backstore)
 {
     backstore->cache_headers = kh_init(BLFS_KHASH_HEADERS_CACHE_NAME);
-    backstore->cache_kcs_counts = kh_init(BLFS_KHASH_KCS_CACHE_NAME);
-    backstore->cache_tj_entries = kh_init(BLFS_KHASH_TJ_CACHE_NAME);
-    backstore->cache_nugget_md = kh_init(BLFS_KHASH_MD_CACHE_NAME);
+
+    // ? Allocated on first use
+    memset(&backstore->nugget_tables, 0, sizeof backstore->nugget_tables);
 
     // ? numbers taken from _struts.h
     backstore->kcs_real_offset = 105;
     backstore->tj_real_offset = 129;
     backstore->md_real_offset = 132;
     backstore->md_bytes_per_nugget = NUGGET_METADATA_BYTES;
+    backstore->md_default_cipher_ident = 0;
 
     backstore->nugget_size_bytes = 16;
     backstore->flake_size_bytes = 8;
@@ -55,6 +56,14 @@ blfs_backstore_t * fake_initialize_backstore(blfs_backstore_t * backstore)
     backstore->num_nuggets = 3;
     backstore->flakes_per_nugget = 2;
 
+    // ? The older layout: all keycounts, then all TJ entries, then all metadata
+    backstore->nugget_record_bytes = 0;
+
+    // ? Commits write through unless a test enables write-back itself
+    backstore->dirty_lock = NULL;
+    backstore->dirty_kcs_counts = NULL;
+    backstore->dirty_nugget_md = NULL;
+
     return backstore;
 }
 
@@ -139,7 +148,7 @@ void test_blfs_create_header_works_as_expected(void)
 
 void test_blfs_create_header_throws_exception_if_nugget_in_cache(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -174,7 +183,7 @@ void test_blfs_commit_header_works_as_expected(void)
 
 void test_blfs_open_keycount_works_as_expected(void)
 {
-    int nugget_index = 555;
+    int nugget_index = 2;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -207,7 +216,7 @@ void test_blfs_open_keycount_works_as_expected(void)
 
 void test_blfs_open_and_close_keycount_functions_cache_properly(void)
 {
-    int nugget_index = 50;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -223,12 +232,12 @@ void test_blfs_open_and_close_keycount_functions_cache_properly(void)
 
     blfs_close_keycount(backstore, actual_keycount2);
 
-    TEST_ASSERT_FALSE(KHASH_CACHE_EXISTS(BLFS_KHASH_KCS_CACHE_NAME, backstore->cache_kcs_counts, nugget_index));
+    TEST_ASSERT_FALSE(backstore->nugget_tables.pages[0]->loaded[nugget_index] & BLFS_TABLE_KEYCOUNT);
 }
 
 void test_blfs_create_keycount_works_as_expected(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -242,7 +251,7 @@ void test_blfs_create_keycount_works_as_expected(void)
 
 void test_blfs_create_keycount_throws_exception_if_nugget_in_cache(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -277,7 +286,7 @@ void test_blfs_commit_keycount_works_as_expected(void)
 
 void test_blfs_open_tjournal_entry_works_as_expected(void)
 {
-    int nugget_index = 555;
+    int nugget_index = 2;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -309,7 +318,7 @@ void test_blfs_open_tjournal_entry_works_as_expected(void)
 
 void test_blfs_open_and_close_tjournal_entry_functions_cache_properly(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -334,12 +343,12 @@ void test_blfs_open_and_close_tjournal_entry_functions_cache_properly(void)
 
     blfs_close_tjournal_entry(backstore, actual_tjournal_entry2);
 
-    TEST_ASSERT_FALSE(KHASH_CACHE_EXISTS(BLFS_KHASH_TJ_CACHE_NAME, backstore->cache_tj_entries, nugget_index));
+    TEST_ASSERT_FALSE(backstore->nugget_tables.pages[0]->loaded[nugget_index] & BLFS_TABLE_TJ_ENTRY);
 }
 
 void test_blfs_create_tjournal_entry_works_as_expected(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -355,7 +364,7 @@ void test_blfs_create_tjournal_entry_works_as_expected(void)
 
 void test_blfs_create_tjournal_entry_throws_exception_if_nugget_in_cache(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -391,7 +400,7 @@ void test_blfs_commit_tjournal_entry_works_as_expected(void)
 
 void test_blfs_open_nugget_md_works_as_expected(void)
 {
-    int nugget_index = 555;
+    int nugget_index = 2;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -413,7 +422,9 @@ void test_blfs_open_nugget_md_works_as_expected(void)
     TEST_ASSERT_EQUAL_UINT(NUGGET_METADATA_BYTES, actual_nugget_metadata->data_length);
     TEST_ASSERT_EQUAL_UINT(NUGGET_METADATA_BYTES - 1, actual_nugget_metadata->metadata_length);
     TEST_ASSERT_EQUAL_UINT(real_offset, actual_nugget_metadata->data_offset);
-    TEST_ASSERT_EQUAL_UINT(expected_output[0], actual_nugget_metadata->cipher_ident);
+    // ? The high bit of 0xF7 is the discarded flag, not part of the identifier
+    TEST_ASSERT_EQUAL_UINT(0x77, actual_nugget_metadata->cipher_ident);
+    TEST_ASSERT_TRUE(actual_nugget_metadata->discarded);
     TEST_ASSERT_EQUAL_MEMORY(expected_output + 1, actual_nugget_metadata->metadata, actual_nugget_metadata->metadata_length);
 
     blfs_backstore_read_Expect(backstore, NULL, NUGGET_METADATA_BYTES, backstore->md_real_offset);
@@ -427,12 +438,13 @@ void test_blfs_open_nugget_md_works_as_expected(void)
     TEST_ASSERT_EQUAL_UINT(NUGGET_METADATA_BYTES - 1, actual_nugget_metadata2->metadata_length);
     TEST_ASSERT_EQUAL_UINT(backstore->md_real_offset, actual_nugget_metadata2->data_offset);
     TEST_ASSERT_EQUAL_UINT(expected_ones[0], actual_nugget_metadata2->cipher_ident);
+    TEST_ASSERT_FALSE(actual_nugget_metadata2->discarded);
     TEST_ASSERT_EQUAL_MEMORY(expected_ones + 1, actual_nugget_metadata2->metadata,actual_nugget_metadata2->metadata_length);
 }
 
 void test_blfs_open_nugget_md_works_even_with_1_md_bytes_per_nugget(void)
 {
-    int nugget_index = 7;
+    int nugget_index = 2;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -460,7 +472,7 @@ void test_blfs_open_nugget_md_works_even_with_1_md_bytes_per_nugget(void)
 
 void test_blfs_open_and_close_nugget_md_functions_cache_properly(void)
 {
-    int nugget_index = 50;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -490,12 +502,12 @@ void test_blfs_open_and_close_nugget_md_functions_cache_properly(void)
 
     blfs_close_nugget_metadata(backstore, actual_nugget_metadata2);
 
-    TEST_ASSERT_FALSE(KHASH_CACHE_EXISTS(BLFS_KHASH_MD_CACHE_NAME, backstore->cache_nugget_md, nugget_index));
+    TEST_ASSERT_FALSE(backstore->nugget_tables.pages[0]->loaded[nugget_index] & BLFS_TABLE_METADATA);
 }
 
 void test_blfs_create_nugget_md_works_as_expected(void)
 {
-    int nugget_index = 60;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -530,7 +542,7 @@ void test_blfs_create_nugget_md_works_as_expected(void)
 
 void test_blfs_create_nugget_md_throws_exception_if_nugget_in_cache(void)
 {
-    int nugget_index = 50;
+    int nugget_index = 1;
     blfs_backstore_t bs;
     blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
 
@@ -561,6 +573,7 @@ void test_blfs_commit_nugget_md_works_as_expected(void)
     data[7] = 0xF0;
 
     nugget_metadata->cipher_ident = data[0];
+    nugget_metadata->discarded = FALSE;
     nugget_metadata->nugget_index = 25;
     nugget_metadata->data_offset = 0xF8;
     nugget_metadata->data_length = NUGGET_METADATA_BYTES;
@@ -571,3 +584,474 @@ void test_blfs_commit_nugget_md_works_as_expected(void)
 
     blfs_commit_nugget_metadata(backstore, nugget_metadata);
 }
+
+void test_blfs_commit_nugget_md_flags_discarded_nuggets_in_the_ident_byte(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+
+    blfs_nugget_metadata_t * nugget_metadata = malloc(sizeof *nugget_metadata);
+
+    uint8_t metadata[NUGGET_METADATA_BYTES - 1];
+    uint8_t data[NUGGET_METADATA_BYTES];
+
+    memset(metadata, 0x2C, sizeof metadata);
+
+    data[0] = 0x05 | BLFS_MD_DISCARDED_FLAG;
+    memcpy(data + 1, metadata, sizeof metadata);
+
+    nugget_metadata->cipher_ident = 0x05;
+    nugget_metadata->discarded = TRUE;
+    nugget_metadata->nugget_index = 25;
+    nugget_metadata->data_offset = 0xF8;
+    nugget_metadata->data_length = NUGGET_METADATA_BYTES;
+    nugget_metadata->metadata_length = nugget_metadata->data_length - 1;
+    nugget_metadata->metadata = metadata;
+
+    blfs_backstore_write_Expect(backstore, data, NUGGET_METADATA_BYTES, 0xF8);
+
+    blfs_commit_nugget_metadata(backstore, nugget_metadata);
+}
+
+void test_blfs_nugget_tables_are_dense_and_bounded(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+
+    blfs_keycount_t * count0 = blfs_create_keycount(backstore, 0);
+    blfs_keycount_t * count1 = blfs_create_keycount(backstore, 1);
+    blfs_tjournal_entry_t * entry0 = blfs_create_tjournal_entry(backstore, 0);
+    blfs_tjournal_entry_t * entry1 = blfs_create_tjournal_entry(backstore, 1);
+    blfs_nugget_metadata_t * meta0 = blfs_create_nugget_metadata(backstore, 0);
+    blfs_nugget_metadata_t * meta1 = blfs_create_nugget_metadata(backstore, 1);
+
+    // ? Neighboring nuggets are neighbors in memory too
+    TEST_ASSERT_EQUAL_UINT64(3, backstore->nugget_tables.num_entries);
+    TEST_ASSERT_EQUAL_PTR(count0 + 1, count1);
+    TEST_ASSERT_EQUAL_PTR(entry0->bitmask->mask + 1, entry1->bitmask->mask);
+    TEST_ASSERT_EQUAL_PTR(meta0->metadata + NUGGET_METADATA_BYTES - 1, meta1->metadata);
+
+    CEXCEPTION_T e_expected = EXCEPTION_OUT_OF_BOUNDS;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    TRY_FN_CATCH_EXCEPTION((void) blfs_open_keycount(backstore, backstore->num_nuggets));
+    TRY_FN_CATCH_EXCEPTION((void) blfs_open_tjournal_entry(backstore, backstore->num_nuggets));
+    TRY_FN_CATCH_EXCEPTION((void) blfs_create_nugget_metadata(backstore, backstore->num_nuggets));
+
+    blfs_close_nugget_tables(backstore);
+
+    TEST_ASSERT_EQUAL_UINT64(0, backstore->nugget_tables.num_entries);
+    TEST_ASSERT_NULL(backstore->nugget_tables.pages);
+}
+
+void test_blfs_load_nugget_tables_reads_each_region_at_once(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+
+    uint64_t keycounts[3] = { 5, 6, 7 };
+    uint8_t tj_entries[3] = { 0x80, 0x40, 0xC0 };
+    uint8_t metadata[3 * NUGGET_METADATA_BYTES];
+
+    memset(metadata, 0xAB, sizeof metadata);
+    metadata[NUGGET_METADATA_BYTES] = 0x02;
+
+    // ? Already open (and changed), so it must not be clobbered
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_HEAD_BYTES_KEYCOUNT, 105 + 2 * 8);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer((uint8_t *) &keycounts[2], BLFS_HEAD_BYTES_KEYCOUNT);
+
+    blfs_keycount_t * count2 = blfs_open_keycount(backstore, 2);
+    count2->keycount = 8;
+
+    blfs_backstore_read_Expect(backstore, NULL, sizeof keycounts, 105);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer((uint8_t *) keycounts, sizeof keycounts);
+    blfs_backstore_read_Expect(backstore, NULL, sizeof tj_entries, 129);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer(tj_entries, sizeof tj_entries);
+    blfs_backstore_read_Expect(backstore, NULL, sizeof metadata, 132);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer(metadata, sizeof metadata);
+
+    blfs_load_nugget_tables(backstore);
+
+    // ? Everything is in memory now; no more reads are expected
+    blfs_keycount_t * count0 = blfs_open_keycount(backstore, 0);
+    blfs_tjournal_entry_t * entry1 = blfs_open_tjournal_entry(backstore, 1);
+    blfs_nugget_metadata_t * meta1 = blfs_open_nugget_metadata(backstore, 1);
+
+    TEST_ASSERT_EQUAL_UINT64(5, count0->keycount);
+    TEST_ASSERT_EQUAL_UINT64(5, count0->keycount_on_disk);
+    TEST_ASSERT_EQUAL_UINT64(105, count0->data_offset);
+    TEST_ASSERT_EQUAL_UINT64(8, blfs_open_keycount(backstore, 2)->keycount);
+    TEST_ASSERT_EQUAL_HEX8(0x40, entry1->bitmask->mask[0]);
+    TEST_ASSERT_EQUAL_UINT64(130, entry1->data_offset);
+    TEST_ASSERT_EQUAL_UINT8(0x02, meta1->cipher_ident);
+    TEST_ASSERT_EQUAL_MEMORY(metadata + NUGGET_METADATA_BYTES + 1, meta1->metadata, meta1->metadata_length);
+    TEST_ASSERT_EQUAL_UINT64(140, meta1->data_offset);
+}
+
+void test_blfs_load_nugget_tables_reads_nugget_records_together(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+
+    // ? 8 byte keycount + 1 byte TJ entry + 8 bytes metadata per record
+    backstore->kcs_real_offset = 105;
+    backstore->tj_real_offset = 113;
+    backstore->md_real_offset = 114;
+    backstore->nugget_record_bytes = 17;
+
+    uint8_t records[3 * 17] = { 0x00 };
+
+    for(uint32_t nugget_index = 0; nugget_index < 3; nugget_index++)
+    {
+        uint8_t * record = records + nugget_index * 17;
+
+        record[0] = (uint8_t) (nugget_index + 1);
+        record[8] = 0x80 >> nugget_index;
+        record[9] = 0x0F;
+        memset(record + 10, (int) nugget_index, 7);
+    }
+
+    blfs_backstore_read_Expect(backstore, NULL, sizeof records, 105);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer(records, sizeof records);
+
+    blfs_load_nugget_tables(backstore);
+
+    blfs_keycount_t * count2 = blfs_open_keycount(backstore, 2);
+    blfs_tjournal_entry_t * entry2 = blfs_open_tjournal_entry(backstore, 2);
+    blfs_nugget_metadata_t * meta2 = blfs_open_nugget_metadata(backstore, 2);
+
+    TEST_ASSERT_EQUAL_UINT64(3, count2->keycount);
+    TEST_ASSERT_EQUAL_UINT64(105 + 2 * 17, count2->data_offset);
+    TEST_ASSERT_EQUAL_HEX8(0x20, entry2->bitmask->mask[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x0F, meta2->cipher_ident);
+    TEST_ASSERT_EQUAL_MEMORY(records + 2 * 17 + 10, meta2->metadata, meta2->metadata_length);
+}
+
+void test_blfs_load_nugget_tables_only_loads_what_fits_under_the_cap(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+
+    backstore->num_nuggets = 2 * BLFS_TABLE_PAGE_NUGGETS;
+
+    // ? Rounded up to a single page
+    backstore->nugget_tables.max_resident_bytes = 1;
+
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_TABLE_PAGE_NUGGETS * BLFS_HEAD_BYTES_KEYCOUNT, 105);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_TABLE_PAGE_NUGGETS, 129);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_TABLE_PAGE_NUGGETS * NUGGET_METADATA_BYTES, 132);
+    blfs_backstore_read_IgnoreArg_buffer();
+
+    blfs_load_nugget_tables(backstore);
+
+    TEST_ASSERT_EQUAL_UINT64(2, backstore->nugget_tables.num_pages);
+    TEST_ASSERT_EQUAL_UINT64(1, backstore->nugget_tables.resident_pages);
+    TEST_ASSERT_NULL(backstore->nugget_tables.pages[1]);
+
+    blfs_close_nugget_tables(backstore);
+}
+
+void test_blfs_pick_nugget_page_victim_gives_pages_a_second_chance(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    blfs_nugget_table_stats_t stats;
+    uint64_t page_index = 0;
+
+    backstore->num_nuggets = 3 * BLFS_TABLE_PAGE_NUGGETS;
+    backstore->nugget_tables.max_resident_bytes = 1;
+
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_HEAD_BYTES_KEYCOUNT, 105);
+    blfs_backstore_read_IgnoreArg_buffer();
+    (void) blfs_open_keycount(backstore, 0);
+
+    // ? Under the cap, nothing needs to go
+    TEST_ASSERT_FALSE(blfs_pick_nugget_page_victim(backstore, &page_index));
+
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_HEAD_BYTES_KEYCOUNT, 105 + BLFS_TABLE_PAGE_NUGGETS * 8);
+    blfs_backstore_read_IgnoreArg_buffer();
+    (void) blfs_open_keycount(backstore, BLFS_TABLE_PAGE_NUGGETS);
+
+    // ? Both pages were just used, so the hand clears both and comes back around
+    TEST_ASSERT_TRUE(blfs_pick_nugget_page_victim(backstore, &page_index));
+    TEST_ASSERT_EQUAL_UINT64(0, page_index);
+
+    // ? Clean entries are simply dropped
+    blfs_evict_nugget_page(backstore, 0);
+    blfs_evict_nugget_page(backstore, 0);
+
+    TEST_ASSERT_NULL(backstore->nugget_tables.pages[0]);
+    TEST_ASSERT_FALSE(blfs_pick_nugget_page_victim(backstore, &page_index));
+
+    (void) blfs_open_keycount(backstore, BLFS_TABLE_PAGE_NUGGETS);
+
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_HEAD_BYTES_KEYCOUNT, 105);
+    blfs_backstore_read_IgnoreArg_buffer();
+    (void) blfs_open_keycount(backstore, 0);
+
+    TEST_ASSERT_TRUE(blfs_pick_nugget_page_victim(backstore, &page_index));
+    TEST_ASSERT_EQUAL_UINT64(1, page_index);
+
+    blfs_get_nugget_table_stats(backstore, &stats);
+
+    TEST_ASSERT_EQUAL_UINT64(1, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(3, stats.misses);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.evictions);
+    TEST_ASSERT_EQUAL_UINT64(2 * backstore->nugget_tables.page_bytes, stats.resident_bytes);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.max_resident_bytes);
+
+    blfs_close_nugget_tables(backstore);
+}
+
+void test_blfs_evict_nugget_page_writes_back_created_and_dirty_entries(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    pthread_mutex_t dirty_lock;
+
+    pthread_mutex_init(&dirty_lock, NULL);
+
+    backstore->dirty_lock = &dirty_lock;
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    uint64_t keycount1 = 5;
+    uint8_t tj_entry2[1] = { 0x80 };
+
+    (void) blfs_create_keycount(backstore, 0);
+
+    blfs_backstore_read_Expect(backstore, NULL, BLFS_HEAD_BYTES_KEYCOUNT, 105 + 8);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer((uint8_t *) &keycount1, BLFS_HEAD_BYTES_KEYCOUNT);
+
+    blfs_keycount_t * count1 = blfs_open_keycount(backstore, 1);
+
+    blfs_backstore_read_Expect(backstore, NULL, 1, 131);
+    blfs_backstore_read_IgnoreArg_buffer();
+    blfs_backstore_read_ReturnArrayThruPtr_buffer(tj_entry2, 1);
+
+    (void) blfs_open_tjournal_entry(backstore, 2);
+
+    count1->keycount = 6;
+    blfs_commit_keycount(backstore, count1);
+
+    // ? Keycount 0 only ever existed in memory and keycount 1 is dirty; TJ
+    // ? entry 2 is neither, so it is not written
+    uint64_t expected_counts[2] = { 0, 6 };
+    blfs_backstore_write_Expect(backstore, (uint8_t *) expected_counts, sizeof expected_counts, 105);
+
+    blfs_evict_nugget_page(backstore, 0);
+
+    TEST_ASSERT_NULL(backstore->nugget_tables.pages[0]);
+    TEST_ASSERT_EQUAL_UINT64(0, backstore->nugget_tables.resident_pages);
+    TEST_ASSERT_EQUAL_UINT64(1, backstore->nugget_tables.evictions);
+    TEST_ASSERT_EQUAL_UINT32(0, backstore->dirty_kcs_counts->count);
+
+    blfs_close_nugget_tables(backstore);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+    pthread_mutex_destroy(&dirty_lock);
+}
+
+void test_blfs_commit_dirty_metadata_coalesces_deferred_commits(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    pthread_mutex_t dirty_lock;
+
+    pthread_mutex_init(&dirty_lock, NULL);
+
+    backstore->dirty_lock = &dirty_lock;
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    blfs_keycount_t * count0 = blfs_create_keycount(backstore, 0);
+    blfs_keycount_t * count1 = blfs_create_keycount(backstore, 1);
+    blfs_keycount_t * count2 = blfs_create_keycount(backstore, 2);
+    blfs_tjournal_entry_t * entry0 = blfs_create_tjournal_entry(backstore, 0);
+    blfs_tjournal_entry_t * entry2 = blfs_create_tjournal_entry(backstore, 2);
+
+    count0->keycount = 1;
+    count1->keycount = 1;
+    count2->keycount = 2;
+
+    bitmask_set_bits(entry0->bitmask, 0, 1);
+    bitmask_set_bits(entry2->bitmask, 1, 1);
+
+    uint8_t expected_tj0[1] = { 0x80 };
+    uint8_t expected_tj2[1] = { 0x40 };
+
+    // ? Two ahead of the disk, so this one cannot wait
+    blfs_backstore_write_Expect(backstore, (uint8_t *) &(count2->keycount), BLFS_HEAD_BYTES_KEYCOUNT, 105 + 2 * 8);
+
+    // ? TJ entries never wait: overwrites are detected by them
+    blfs_backstore_write_Expect(backstore, expected_tj2, 1, 131);
+    blfs_backstore_write_Expect(backstore, expected_tj0, 1, 129);
+    blfs_backstore_write_Expect(backstore, expected_tj0, 1, 129);
+
+    blfs_commit_keycount(backstore, count1);
+    blfs_commit_keycount(backstore, count0);
+    blfs_commit_keycount(backstore, count2);
+    blfs_commit_tjournal_entry(backstore, entry2);
+    blfs_commit_tjournal_entry(backstore, entry0);
+    blfs_commit_tjournal_entry(backstore, entry0);
+
+    TEST_ASSERT_TRUE(count0->dirty);
+    TEST_ASSERT_TRUE(count1->dirty);
+    TEST_ASSERT_FALSE(count2->dirty);
+    TEST_ASSERT_EQUAL_UINT32(2, backstore->dirty_kcs_counts->count);
+
+    uint64_t expected_counts[2] = { 1, 1 };
+
+    // ? Adjacent keycounts go out together
+    blfs_backstore_write_Expect(backstore, (uint8_t *) expected_counts, sizeof expected_counts, 105);
+
+    blfs_commit_dirty_metadata(backstore);
+
+    TEST_ASSERT_FALSE(count0->dirty);
+    TEST_ASSERT_EQUAL_UINT64(1, count0->keycount_on_disk);
+    TEST_ASSERT_EQUAL_UINT32(0, backstore->dirty_kcs_counts->count);
+
+    // ? Nothing left to write back
+    blfs_commit_dirty_metadata(backstore);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+    pthread_mutex_destroy(&dirty_lock);
+}
+
+void test_blfs_commit_keycount_through_never_defers(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    pthread_mutex_t dirty_lock;
+
+    pthread_mutex_init(&dirty_lock, NULL);
+
+    backstore->dirty_lock = &dirty_lock;
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    blfs_keycount_t * count = blfs_create_keycount(backstore, 1);
+    count->keycount = 1;
+
+    // ? Only one ahead of the disk, which blfs_commit_keycount would put off
+    blfs_backstore_write_Expect(backstore, (uint8_t *) &(count->keycount), BLFS_HEAD_BYTES_KEYCOUNT, 105 + 8);
+
+    blfs_commit_keycount_through(backstore, count);
+
+    TEST_ASSERT_FALSE(count->dirty);
+    TEST_ASSERT_EQUAL_UINT64(1, count->keycount_on_disk);
+    TEST_ASSERT_EQUAL_UINT32(0, backstore->dirty_kcs_counts->count);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+    pthread_mutex_destroy(&dirty_lock);
+}
+
+static blfs_keycount_t * racing_count;
+
+static void bump_racing_count(blfs_backstore_t * backstore, const uint8_t * buffer, uint32_t length, uint64_t offset, int num_calls)
+{
+    (void) backstore;
+    (void) buffer;
+    (void) length;
+    (void) offset;
+    (void) num_calls;
+
+    racing_count->keycount++;
+}
+
+void test_blfs_commit_dirty_metadata_records_the_keycount_it_wrote(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    pthread_mutex_t dirty_lock;
+
+    pthread_mutex_init(&dirty_lock, NULL);
+
+    backstore->dirty_lock = &dirty_lock;
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    racing_count = blfs_create_keycount(backstore, 1);
+    racing_count->keycount = 1;
+
+    blfs_commit_keycount(backstore, racing_count);
+
+    TEST_ASSERT_TRUE(racing_count->dirty);
+
+    // ? Another thread bumps the keycount while the flush is writing it out
+    blfs_backstore_write_ExpectAnyArgs();
+    blfs_backstore_write_StubWithCallback(&bump_racing_count);
+
+    blfs_commit_dirty_metadata(backstore);
+
+    TEST_ASSERT_EQUAL_UINT64(2, racing_count->keycount);
+    TEST_ASSERT_EQUAL_UINT64(1, racing_count->keycount_on_disk);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+    pthread_mutex_destroy(&dirty_lock);
+}
+
+void test_blfs_commit_dirty_metadata_writes_around_tj_entries_in_nugget_records(void)
+{
+    blfs_backstore_t bs;
+    blfs_backstore_t * backstore = fake_initialize_backstore(&bs);
+    pthread_mutex_t dirty_lock;
+
+    pthread_mutex_init(&dirty_lock, NULL);
+
+    // ? 8 byte keycount + 1 byte TJ entry + 8 bytes metadata per record
+    backstore->kcs_real_offset = 105;
+    backstore->tj_real_offset = 113;
+    backstore->md_real_offset = 114;
+    backstore->nugget_record_bytes = 17;
+
+    backstore->dirty_lock = &dirty_lock;
+    backstore->dirty_kcs_counts = vector_init();
+    backstore->dirty_nugget_md = vector_init();
+
+    blfs_keycount_t * count = blfs_create_keycount(backstore, 1);
+    blfs_tjournal_entry_t * entry = blfs_create_tjournal_entry(backstore, 1);
+    blfs_nugget_metadata_t * meta = blfs_create_nugget_metadata(backstore, 1);
+
+    TEST_ASSERT_EQUAL_UINT(122, count->data_offset);
+    TEST_ASSERT_EQUAL_UINT(130, entry->data_offset);
+    TEST_ASSERT_EQUAL_UINT(131, meta->data_offset);
+
+    count->keycount = 1;
+    bitmask_set_bits(entry->bitmask, 0, 2);
+    meta->cipher_ident = 0x0F;
+    memset(meta->metadata, 0xAB, meta->metadata_length);
+
+    uint8_t expected_tj[1] = { 0xC0 };
+    uint8_t expected_count[8] = { 0x01 };
+    uint8_t expected_md[8] = { 0x0F };
+    memset(expected_md + 1, 0xAB, 7);
+
+    blfs_backstore_write_Expect(backstore, expected_tj, 1, 130);
+
+    blfs_commit_nugget_metadata(backstore, meta);
+    blfs_commit_tjournal_entry(backstore, entry);
+    blfs_commit_keycount(backstore, count);
+
+    // ? The TJ entry already went out, so the rest of the record is two runs
+    blfs_backstore_write_Expect(backstore, expected_count, sizeof expected_count, 122);
+    blfs_backstore_write_Expect(backstore, expected_md, sizeof expected_md, 131);
+
+    blfs_commit_dirty_metadata(backstore);
+
+    vector_fini(backstore->dirty_kcs_counts);
+    vector_fini(backstore->dirty_nugget_md);
+    pthread_mutex_destroy(&dirty_lock);
+}
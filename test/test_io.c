@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <limits.h>
 #include <string.h>
 #include <sys/types.h>
@@ -20,6 +22,9 @@ Catch(e_actual)                                   \
     TEST_ASSERT_EQUAL_HEX_MESSAGE(e_expected, e_actual, "Encountered an unsuspected error condition!");
 
 #define BACKSTORE_FILE_PATH "/tmp/test.io.bin"
+#define STRIPE_MEMBER1_PATH "/tmp/test.io.stripe1.bin"
+#define STRIPE_MEMBER2_PATH "/tmp/test.io.stripe2.bin"
+#define BODY_DEVICE_PATH "/tmp/test.io.body.bin"
 
 int iofd;
 
@@ -35,9 +40,10 @@ void setUp(void)
 
     iofd = open(BACKSTORE_FILE_PATH, O_CREAT | O_RDWR | O_TRUNC, 0777);
 
-    fake_backstore = malloc(sizeof *fake_backstore);
+    fake_backstore = calloc(1, sizeof *fake_backstore);
     fake_backstore->io_fd = iofd;
     fake_backstore->body_real_offset = 128;
+    fake_backstore->logical_block_bytes = 1;
 }
 
 void tearDown(void)
@@ -86,6 +92,182 @@ void test_blfs_backstore_read_and_write_works_as_expected(void)
     TEST_ASSERT_EQUAL_MEMORY(buffer_expected_random, buffer_actual3, sizeof buffer_actual3);
 }
 
+void test_blfs_backstore_sync_works_as_expected(void)
+{
+    blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
+    blfs_backstore_sync(fake_backstore); // No errors? All good!
+}
+
+void test_blfs_backstore_sync_throws_exception_on_bad_fd(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BACKSTORE_SYNC_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    blfs_backstore_t bad_backstore = { .io_fd = -1 };
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_sync(&bad_backstore));
+}
+
+void test_blfs_backstore_read_and_write_throw_exception_on_io_failure(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BACKSTORE_IO_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    uint8_t buffer[64] = { 0x00 };
+
+    blfs_backstore_t bad_backstore = { .io_fd = -1, .file_size_actual = UINT64_MAX };
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_read(&bad_backstore, buffer, sizeof buffer, 0));
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_write(&bad_backstore, buffer, sizeof buffer, 0));
+
+    // ? Reading past the end of the (empty) backstore file must not spin
+    blfs_backstore_t short_backstore = { .io_fd = iofd, .file_size_actual = UINT64_MAX };
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_read(&short_backstore, buffer, sizeof buffer, 0));
+
+    blfs_backstore_write(&short_backstore, buffer, sizeof buffer / 2, 0);
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_read(&short_backstore, buffer, sizeof buffer, 0));
+}
+
+void test_blfs_backstore_mmap_io_engine_works_as_expected(void)
+{
+    uint8_t buffer_expected[1024];
+    uint8_t buffer_actual[sizeof buffer_expected] = { 0x00 };
+
+    for(uint32_t i = 0; i < sizeof buffer_expected; i++)
+        buffer_expected[i] = (uint8_t) (i * 3);
+
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(iofd, 4096));
+    fake_backstore->file_size_actual = 4096;
+
+    blfs_backstore_set_io_engine(fake_backstore, ioe_mmap);
+
+    TEST_ASSERT_NOT_NULL(fake_backstore->mapping);
+
+    blfs_backstore_write(fake_backstore, buffer_expected, sizeof buffer_expected, 3000);
+    blfs_backstore_read(fake_backstore, buffer_actual, sizeof buffer_actual, 3000);
+
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_sync(fake_backstore);
+
+    // ? The stores must have reached the file itself
+    blfs_backstore_set_io_engine(fake_backstore, ioe_pread);
+
+    TEST_ASSERT_NULL(fake_backstore->mapping);
+
+    memset(buffer_actual, 0, sizeof buffer_actual);
+    blfs_backstore_read(fake_backstore, buffer_actual, sizeof buffer_actual, 3000);
+
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+}
+
+void test_blfs_backstore_uring_io_engine_batches_work_as_expected(void)
+{
+    uint8_t buffer_expected[512];
+    uint8_t buffer_actual[sizeof buffer_expected] = { 0x00 };
+
+    for(uint32_t i = 0; i < sizeof buffer_expected; i++)
+        buffer_expected[i] = (uint8_t) (i * 5);
+
+    fake_backstore->file_size_actual = UINT64_MAX;
+
+    blfs_backstore_set_io_engine(fake_backstore, ioe_uring);
+
+    blfs_backstore_begin_batch(fake_backstore);
+    blfs_backstore_begin_batch(fake_backstore);
+
+    blfs_backstore_write(fake_backstore, buffer_expected, 256, 0);
+    blfs_backstore_end_batch(fake_backstore);
+
+    // ? Still queued: only the outermost batch submits
+    TEST_ASSERT_EQUAL_INT(0, lseek(iofd, 0, SEEK_END));
+
+    blfs_backstore_write(fake_backstore, buffer_expected + 256, 256, 256);
+    blfs_backstore_sync(fake_backstore);
+
+    // ? Reading what is still queued submits it first
+    blfs_backstore_read(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_end_batch(fake_backstore);
+
+    // ? Outside of a batch everything happens right away
+    memset(buffer_actual, 0, sizeof buffer_actual);
+    blfs_backstore_write(fake_backstore, buffer_expected, 64, 1000);
+    blfs_backstore_read(fake_backstore, buffer_actual, 64, 1000);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, 64);
+}
+
+void test_blfs_backstore_direct_io_engine_works_as_expected(void)
+{
+    uint8_t buffer_expected[5000];
+    uint8_t buffer_actual[sizeof buffer_expected] = { 0x00 };
+    uint8_t neighbours_expected[8] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    uint8_t neighbours_actual[sizeof neighbours_expected] = { 0x00 };
+
+    for(uint32_t i = 0; i < sizeof buffer_expected; i++)
+        buffer_expected[i] = (uint8_t) (i * 7);
+
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(iofd, 4 * 4096));
+    fake_backstore->file_size_actual = 4 * 4096;
+
+    blfs_backstore_write(fake_backstore, neighbours_expected, sizeof neighbours_expected, 4000);
+    blfs_backstore_write(fake_backstore, neighbours_expected, sizeof neighbours_expected, 9008);
+
+    blfs_backstore_set_io_engine(fake_backstore, ioe_direct);
+
+    // ? Starts and ends mid-block, right up against what was written above
+    blfs_backstore_write(fake_backstore, buffer_expected, sizeof buffer_expected, 4008);
+    blfs_backstore_read(fake_backstore, buffer_actual, sizeof buffer_actual, 4008);
+
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_read(fake_backstore, neighbours_actual, sizeof neighbours_actual, 4000);
+    TEST_ASSERT_EQUAL_MEMORY(neighbours_expected, neighbours_actual, sizeof neighbours_actual);
+
+    blfs_backstore_read(fake_backstore, neighbours_actual, sizeof neighbours_actual, 9008);
+    TEST_ASSERT_EQUAL_MEMORY(neighbours_expected, neighbours_actual, sizeof neighbours_actual);
+
+    // ? Within a single block
+    blfs_backstore_write(fake_backstore, neighbours_expected, sizeof neighbours_expected, 13000);
+
+    blfs_backstore_set_io_engine(fake_backstore, ioe_pread);
+
+    memset(buffer_actual, 0, sizeof buffer_actual);
+    blfs_backstore_read(fake_backstore, buffer_actual, sizeof buffer_actual, 4008);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_read(fake_backstore, neighbours_actual, sizeof neighbours_actual, 13000);
+    TEST_ASSERT_EQUAL_MEMORY(neighbours_expected, neighbours_actual, sizeof neighbours_actual);
+}
+
+void test_blfs_backstore_direct_io_engine_throws_exception_on_unaligned_size(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BACKSTORE_DIRECT_IO_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(iofd, 4096 + 512));
+    fake_backstore->file_size_actual = 4096 + 512;
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_set_io_engine(fake_backstore, ioe_direct));
+}
+
+void test_blfs_ident_string_to_io_engine_works_as_expected(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_STRING_TO_IO_ENGINE_FAILED;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    TEST_ASSERT_EQUAL_INT(ioe_default, blfs_ident_string_to_io_engine("ioe_default"));
+    TEST_ASSERT_EQUAL_INT(ioe_pread, blfs_ident_string_to_io_engine("ioe_pread"));
+    TEST_ASSERT_EQUAL_INT(ioe_mmap, blfs_ident_string_to_io_engine("ioe_mmap"));
+    TEST_ASSERT_EQUAL_INT(ioe_uring, blfs_ident_string_to_io_engine("ioe_uring"));
+    TEST_ASSERT_EQUAL_INT(ioe_direct, blfs_ident_string_to_io_engine("ioe_direct"));
+
+    TRY_FN_CATCH_EXCEPTION(blfs_ident_string_to_io_engine("mmap"));
+}
+
 void test_blfs_backstore_read_body_and_write_body_works_as_expected(void)
 {
     uint8_t buffer_actual1[45] = { 0x00 };
@@ -164,6 +346,253 @@ void test_blfs_backstore_read_body_and_write_body_works_as_expected(void)
     TEST_ASSERT_EQUAL_MEMORY(buffer_expected_welldefined, buffer_actual2, sizeof buffer_actual2);
 }
 
+void test_blfs_backstore_discard_body_works_as_expected(void)
+{
+    uint8_t buffer_actual[64] = { 0x00 };
+    uint8_t buffer_expected[sizeof buffer_actual];
+
+    memset(buffer_expected, 0xAB, sizeof buffer_expected);
+    memset(buffer_expected + 8, 0x00, 32);
+
+    fake_backstore->file_size_actual = fake_backstore->body_real_offset + sizeof buffer_actual;
+
+    memset(buffer_actual, 0xAB, sizeof buffer_actual);
+    blfs_backstore_write_body(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+
+    blfs_backstore_discard_body(fake_backstore, 16, 8, FALSE);
+    blfs_backstore_discard_body(fake_backstore, 16, 24, TRUE);
+    blfs_backstore_read_body(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+    TEST_ASSERT_EQUAL_UINT(fake_backstore->file_size_actual, lseek(fake_backstore->io_fd, 0, SEEK_END));
+}
+
+void test_blfs_backstore_discard_body_zeroes_around_logical_blocks(void)
+{
+    uint8_t buffer_actual[64] = { 0x00 };
+    uint8_t buffer_expected[sizeof buffer_actual];
+
+    memset(buffer_expected, 0xAB, sizeof buffer_expected);
+    memset(buffer_expected + 5, 0x00, 50);
+
+    // ? As if the backstore were a block device with (tiny) 16 byte blocks
+    fake_backstore->logical_block_bytes = 16;
+    fake_backstore->file_size_actual = fake_backstore->body_real_offset + sizeof buffer_actual;
+
+    memset(buffer_actual, 0xAB, sizeof buffer_actual);
+    blfs_backstore_write_body(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+
+    blfs_backstore_discard_body(fake_backstore, 50, 5, FALSE);
+    blfs_backstore_read_body(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+    TEST_ASSERT_EQUAL_UINT(fake_backstore->file_size_actual, lseek(fake_backstore->io_fd, 0, SEEK_END));
+}
+
+void test_blfs_backstore_body_is_hole_works_as_expected(void)
+{
+    uint8_t data[16];
+
+    memset(data, 0xAB, sizeof data);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fake_backstore->io_fd, 1024 * 1024));
+
+    TEST_ASSERT_TRUE(blfs_backstore_body_is_hole(fake_backstore, 65536, 0));
+    TEST_ASSERT_TRUE(blfs_backstore_body_is_hole(fake_backstore, 65536, 65536));
+
+    blfs_backstore_write_body(fake_backstore, data, sizeof data, 65536 + 4096);
+
+    TEST_ASSERT_FALSE(blfs_backstore_body_is_hole(fake_backstore, 65536, 65536));
+    TEST_ASSERT_FALSE(blfs_backstore_body_is_hole(fake_backstore, 65536 + 4096, 0));
+    TEST_ASSERT_TRUE(blfs_backstore_body_is_hole(fake_backstore, 4096, 0));
+    TEST_ASSERT_TRUE(blfs_backstore_body_is_hole(fake_backstore, 65536, 2 * 65536));
+
+    // ? Whatever a block device hasn't been written to is anyone's guess
+    fake_backstore->is_block_device = TRUE;
+    TEST_ASSERT_FALSE(blfs_backstore_body_is_hole(fake_backstore, 4096, 0));
+}
+
+void test_blfs_backstore_striped_body_io_works_as_expected(void)
+{
+    uint8_t buffer_expected[96];
+    uint8_t buffer_actual[sizeof buffer_expected] = { 0x00 };
+    uint8_t member_actual[32] = { 0x00 };
+
+    for(uint32_t i = 0; i < sizeof buffer_expected; i++)
+        buffer_expected[i] = (uint8_t) i + 1;
+
+    // ? Three members (the backstore and two more), one 16 byte nugget apiece
+    fake_backstore->nugget_size_bytes = 16;
+    fake_backstore->num_nuggets = 6;
+    fake_backstore->file_size_actual = fake_backstore->body_real_offset + 32;
+    fake_backstore->stripe_width = 3;
+    fake_backstore->stripe_nuggets = 1;
+    fake_backstore->stripe_members = calloc(2, sizeof *fake_backstore->stripe_members);
+
+    fake_backstore->stripe_members[0].io_fd = open(STRIPE_MEMBER1_PATH, O_CREAT | O_RDWR | O_TRUNC, 0777);
+    fake_backstore->stripe_members[0].file_size_actual = 32;
+    fake_backstore->stripe_members[0].logical_block_bytes = 1;
+    fake_backstore->stripe_members[1].io_fd = open(STRIPE_MEMBER2_PATH, O_CREAT | O_RDWR | O_TRUNC, 0777);
+    fake_backstore->stripe_members[1].file_size_actual = 32;
+    fake_backstore->stripe_members[1].logical_block_bytes = 1;
+
+    // ? One write spanning every member, split at nugget boundaries
+    blfs_backstore_write_body(fake_backstore, buffer_expected, sizeof buffer_expected, 0);
+
+    // ? Nuggets 0 and 3 follow the records; 1 and 4, 2 and 5 start their members
+    TEST_ASSERT_EQUAL_INT(16, pread(fake_backstore->io_fd, member_actual, 16, fake_backstore->body_real_offset + 16));
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 48, member_actual, 16);
+
+    TEST_ASSERT_EQUAL_INT(32, pread(fake_backstore->stripe_members[0].io_fd, member_actual, 32, 0));
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 16, member_actual, 16);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 64, member_actual + 16, 16);
+
+    TEST_ASSERT_EQUAL_INT(32, pread(fake_backstore->stripe_members[1].io_fd, member_actual, 32, 0));
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 32, member_actual, 16);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 80, member_actual + 16, 16);
+
+    blfs_backstore_read_body(fake_backstore, buffer_actual, 70, 9);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected + 9, buffer_actual, 70);
+
+    // ? Discards spanning members zero the right bytes on each
+    memset(buffer_expected + 40, 0x00, 20);
+    blfs_backstore_discard_body(fake_backstore, 20, 40, FALSE);
+
+    blfs_backstore_read_body(fake_backstore, buffer_actual, sizeof buffer_actual, 0);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_sync(fake_backstore);
+
+    close(fake_backstore->stripe_members[0].io_fd);
+    close(fake_backstore->stripe_members[1].io_fd);
+    free(fake_backstore->stripe_members);
+
+    unlink(STRIPE_MEMBER1_PATH);
+    unlink(STRIPE_MEMBER2_PATH);
+}
+
+void test_blfs_backstore_stripe_members_are_labeled_and_reopened(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BAD_STRIPE_MEMBER;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    const char * members[] = { STRIPE_MEMBER1_PATH, STRIPE_MEMBER2_PATH };
+    const char * members_swapped[] = { STRIPE_MEMBER2_PATH, STRIPE_MEMBER1_PATH };
+
+    unlink(BACKSTORE_FILE_PATH);
+
+    blfs_backstore_t * backstore = blfs_backstore_create(BACKSTORE_FILE_PATH, 4096);
+    blfs_backstore_create_stripe_members(backstore, members, 2, 4, 8192);
+
+    TEST_ASSERT_EQUAL_UINT(3, backstore->stripe_width);
+    TEST_ASSERT_EQUAL_UINT(4, backstore->stripe_nuggets);
+    TEST_ASSERT_EQUAL_UINT(8192, backstore->stripe_members[1].file_size_actual);
+
+    TEST_ASSERT_EQUAL_UINT(4096 - BLFS_STRIPE_LABEL_BYTES, blfs_backstore_stripe_member_bytes(backstore, 0));
+    TEST_ASSERT_EQUAL_UINT(8192 - BLFS_STRIPE_LABEL_BYTES, blfs_backstore_stripe_member_bytes(backstore, 2));
+
+    TEST_ASSERT_EQUAL_UINT(0, blfs_backstore_stripe_member_of(backstore, 3));
+    TEST_ASSERT_EQUAL_UINT(1, blfs_backstore_stripe_member_of(backstore, 4));
+    TEST_ASSERT_EQUAL_UINT(2, blfs_backstore_stripe_member_of(backstore, 11));
+    TEST_ASSERT_EQUAL_UINT(0, blfs_backstore_stripe_member_of(backstore, 12));
+
+    blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED)->data[0] = BLFS_HEAD_IS_INITIALIZED_VALUE;
+    blfs_commit_all_headers(backstore);
+    blfs_backstore_close(backstore);
+
+    backstore = blfs_backstore_open(BACKSTORE_FILE_PATH);
+    blfs_backstore_open_stripe_members(backstore, members, 2);
+
+    TEST_ASSERT_EQUAL_UINT(3, backstore->stripe_width);
+    TEST_ASSERT_EQUAL_UINT(4, backstore->stripe_nuggets);
+    TEST_ASSERT_EQUAL_STRING(STRIPE_MEMBER2_PATH, backstore->stripe_members[1].file_path);
+
+    blfs_backstore_close(backstore);
+
+    // ? Members out of order, missing, or given for an unstriped backstore
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_open_stripe_members(blfs_backstore_open(BACKSTORE_FILE_PATH), members_swapped, 2));
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_open_stripe_members(blfs_backstore_open(BACKSTORE_FILE_PATH), members, 1));
+
+    int iofd = open(BACKSTORE_FILE_PATH, O_RDWR | O_TRUNC);
+    TEST_ASSERT_EQUAL_INT(sizeof buffer_init_backstore_state, write(iofd, buffer_init_backstore_state, sizeof buffer_init_backstore_state));
+    close(iofd);
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_open_stripe_members(blfs_backstore_open(BACKSTORE_FILE_PATH), members, 2));
+
+    unlink(STRIPE_MEMBER1_PATH);
+    unlink(STRIPE_MEMBER2_PATH);
+}
+
+void test_blfs_backstore_body_device_keeps_body_apart_from_records(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BAD_STRIPE_MEMBER;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    uint8_t buffer_expected[64];
+    uint8_t buffer_actual[sizeof buffer_expected] = { 0x00 };
+    uint8_t buffer_zeros[sizeof buffer_expected] = { 0x00 };
+
+    uint32_t num_nuggets = 4;
+    uint32_t flakes_per_nugget = 2;
+    uint32_t flake_size_bytes = 8;
+
+    for(uint32_t i = 0; i < sizeof buffer_expected; i++)
+        buffer_expected[i] = (uint8_t) i + 1;
+
+    unlink(BACKSTORE_FILE_PATH);
+
+    blfs_backstore_t * backstore = blfs_backstore_create(BACKSTORE_FILE_PATH, 4096);
+    blfs_backstore_create_body_device(backstore, BODY_DEVICE_PATH, 8192);
+
+    TEST_ASSERT_NOT_NULL(backstore->body_device);
+    TEST_ASSERT_EQUAL_UINT(8192 - BLFS_STRIPE_LABEL_BYTES, blfs_backstore_stripe_member_bytes(backstore, 0));
+
+    memcpy(blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_NUMNUGGETS)->data, &num_nuggets, sizeof num_nuggets);
+    memcpy(blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESPERNUGGET)->data, &flakes_per_nugget, sizeof flakes_per_nugget);
+    memcpy(blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES)->data, &flake_size_bytes, sizeof flake_size_bytes);
+    blfs_open_header(backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED)->data[0] = BLFS_HEAD_IS_INITIALIZED_VALUE;
+
+    blfs_backstore_setup_actual_post(backstore);
+    blfs_backstore_setup_actual_finish(backstore);
+
+    TEST_ASSERT_EQUAL_UINT(64, backstore->writeable_size_actual);
+
+    // ? The body starts at the very beginning of the body device; nothing
+    // ? lands after the records
+    blfs_backstore_write_body(backstore, buffer_expected, sizeof buffer_expected, 0);
+
+    int bodyfd = open(BODY_DEVICE_PATH, O_RDONLY);
+    TEST_ASSERT_EQUAL_INT(sizeof buffer_actual, pread(bodyfd, buffer_actual, sizeof buffer_actual, 0));
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+    close(bodyfd);
+
+    blfs_backstore_read(backstore, buffer_actual, sizeof buffer_actual, backstore->body_real_offset);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_zeros, buffer_actual, sizeof buffer_actual);
+
+    blfs_commit_all_headers(backstore);
+    blfs_backstore_close(backstore);
+
+    backstore = blfs_backstore_open(BACKSTORE_FILE_PATH);
+    blfs_backstore_open_body_device(backstore, BODY_DEVICE_PATH);
+    blfs_backstore_open_stripe_members(backstore, NULL, 0);
+    backstore->md_bytes_per_nugget = 1;
+    blfs_backstore_setup_actual_finish(backstore);
+
+    blfs_backstore_read_body(backstore, buffer_actual, sizeof buffer_actual, 0);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_expected, buffer_actual, sizeof buffer_actual);
+
+    blfs_backstore_close(backstore);
+
+    // ? Some other file is not this backstore's body
+    int iofd = open(STRIPE_MEMBER1_PATH, O_CREAT | O_RDWR | O_TRUNC, 0777);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(iofd, 8192));
+    close(iofd);
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_open_body_device(blfs_backstore_open(BACKSTORE_FILE_PATH), STRIPE_MEMBER1_PATH));
+
+    unlink(STRIPE_MEMBER1_PATH);
+    unlink(BODY_DEVICE_PATH);
+}
+
 void test_blfs_backstore_create_work_as_expected(void)
 {
     unlink(BACKSTORE_FILE_PATH);
@@ -181,6 +610,8 @@ void test_blfs_backstore_create_work_as_expected(void)
     TEST_ASSERT_EQUAL_UINT(0, backstore->flake_size_bytes);
     TEST_ASSERT_EQUAL_UINT(1, backstore->md_bytes_per_nugget);
     TEST_ASSERT_EQUAL_UINT(0, backstore->num_nuggets);
+    TEST_ASSERT_FALSE(backstore->is_block_device);
+    TEST_ASSERT_EQUAL_UINT(1, backstore->logical_block_bytes);
     TEST_ASSERT_EQUAL_UINT(0, backstore->flakes_per_nugget);
     TEST_ASSERT_EQUAL_UINT(4096, backstore->file_size_actual);
 }
@@ -232,6 +663,94 @@ void test_blfs_backstore_open_work_as_expected(void)
     TEST_ASSERT_EQUAL_UINT(204, backstore2.file_size_actual);
 }
 
+void test_blfs_backstore_open_throws_exception_on_versions_newer_than_ours(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_INCOMPAT_BACKSTORE_VERSION;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+    uint32_t version = BLFS_CURRENT_VERSION + 1;
+
+    blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
+    blfs_backstore_write(fake_backstore, (uint8_t *) &version, BLFS_HEAD_HEADER_BYTES_VERSION, 0);
+
+    TRY_FN_CATCH_EXCEPTION(blfs_backstore_open(BACKSTORE_FILE_PATH));
+}
+
+void test_blfs_backstore_open_lays_out_nugget_records_for_nugget_records_version(void)
+{
+    uint32_t version = BLFS_NUGGET_RECORDS_VERSION;
+
+    blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
+    blfs_backstore_write(fake_backstore, (uint8_t *) &version, BLFS_HEAD_HEADER_BYTES_VERSION, 0);
+
+    blfs_backstore_t * backstore = blfs_backstore_open(BACKSTORE_FILE_PATH);
+
+    TEST_ASSERT_EQUAL_UINT(BLFS_NUGGET_RECORDS_VERSION, backstore->format_version);
+    TEST_ASSERT_EQUAL_UINT(0, backstore->epoch_record_offset);
+
+    // ? Nugget 0's keycount, TJ entry, and metadata, back to back
+    TEST_ASSERT_EQUAL_UINT(105, backstore->kcs_real_offset);
+    TEST_ASSERT_EQUAL_UINT(113, backstore->tj_real_offset);
+    TEST_ASSERT_EQUAL_UINT(114, backstore->md_real_offset);
+
+    backstore->md_bytes_per_nugget = 8;
+    blfs_backstore_setup_actual_finish(backstore);
+
+    TEST_ASSERT_EQUAL_UINT(17, backstore->nugget_record_bytes);
+    TEST_ASSERT_EQUAL_UINT(156, backstore->body_real_offset);
+    TEST_ASSERT_EQUAL_UINT(48, backstore->writeable_size_actual);
+
+    blfs_backstore_close(backstore);
+}
+
+void test_blfs_backstore_epoch_record_sits_between_headers_and_nugget_records(void)
+{
+    uint32_t version = BLFS_CURRENT_VERSION;
+    uint8_t root[BLFS_HEAD_HEADER_BYTES_MTRH];
+    uint8_t root_actual[BLFS_HEAD_HEADER_BYTES_MTRH] = { 0x00 };
+    uint64_t global_version_actual = 0;
+
+    memset(root, 0xAB, sizeof root);
+
+    blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
+    blfs_backstore_write(fake_backstore, (uint8_t *) &version, BLFS_HEAD_HEADER_BYTES_VERSION, 0);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fake_backstore->io_fd, 4096));
+
+    blfs_backstore_t * backstore = blfs_backstore_open(BACKSTORE_FILE_PATH);
+
+    TEST_ASSERT_EQUAL_UINT(105, backstore->epoch_record_offset);
+    TEST_ASSERT_EQUAL_UINT(105 + BLFS_EPOCH_RECORD_BYTES, backstore->kcs_real_offset);
+
+    blfs_backstore_write_epoch_record(backstore, 7, root);
+
+    TEST_ASSERT_TRUE(blfs_backstore_read_epoch_record(backstore, &global_version_actual, root_actual));
+    TEST_ASSERT_EQUAL_UINT64(7, global_version_actual);
+    TEST_ASSERT_EQUAL_MEMORY(root, root_actual, sizeof root);
+
+    // ? The record must not overlap nugget 0's keycount
+    uint8_t kc_actual[BLFS_HEAD_BYTES_KEYCOUNT];
+
+    blfs_backstore_read(backstore, kc_actual, sizeof kc_actual, backstore->kcs_real_offset);
+    TEST_ASSERT_EQUAL_MEMORY(buffer_init_backstore_state + backstore->kcs_real_offset, kc_actual, sizeof kc_actual);
+
+    blfs_backstore_close(backstore);
+}
+
+void test_blfs_backstore_read_epoch_record_returns_false_before_epoch_records(void)
+{
+    uint32_t version = BLFS_NUGGET_RECORDS_VERSION;
+    uint8_t root[BLFS_HEAD_HEADER_BYTES_MTRH] = { 0x00 };
+    uint64_t global_version = 0;
+
+    blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
+    blfs_backstore_write(fake_backstore, (uint8_t *) &version, BLFS_HEAD_HEADER_BYTES_VERSION, 0);
+
+    blfs_backstore_t * backstore = blfs_backstore_open(BACKSTORE_FILE_PATH);
+
+    TEST_ASSERT_FALSE(blfs_backstore_read_epoch_record(backstore, &global_version, root));
+
+    blfs_backstore_close(backstore);
+}
+
 void test_blfs_backstore_close_work_as_expected(void)
 {
     blfs_backstore_write(fake_backstore, buffer_init_backstore_state, sizeof buffer_init_backstore_state, 0);
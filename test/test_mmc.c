@@ -181,6 +181,18 @@ void test_integration_with_buselfs_works_as_expected(void)
     buselfs_state->cache_nugget_keys            = kh_init(BLFS_KHASH_NUGGET_KEY_CACHE_NAME);
     buselfs_state->merkle_tree                  = mt_create();
     buselfs_state->default_password             = BLFS_DEFAULT_PASS;
+    buselfs_state->nugget_locks                 = NULL;
+    buselfs_state->state_lock                   = NULL;
+    buselfs_state->writes_drained               = NULL;
+    buselfs_state->crypt_pool                   = NULL;
+    buselfs_state->readahead                    = NULL;
+    buselfs_state->num_stripe_members           = 0;
+    buselfs_state->stripe_nuggets               = BLFS_DEFAULT_STRIPE_NUGGETS;
+    buselfs_state->metadata_path                = NULL;
+    buselfs_state->metadata_cache_bytes         = 0;
+    buselfs_state->writes_in_flight             = 0;
+    buselfs_state->epoch_open                   = FALSE;
+    buselfs_state->epoch_drains                 = 0;
     buselfs_state->rpmb_secure_index            = _TEST_BLFS_TPM_ID;
     buselfs_state->primary_cipher               = malloc(sizeof *buselfs_state->primary_cipher);
     buselfs_state->swap_cipher                  = buselfs_state->primary_cipher;
@@ -0,0 +1,197 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "unity.h"
+#include "pool.h"
+
+#define TRY_FN_CATCH_EXCEPTION(fn_call)           \
+e_actual = EXCEPTION_NO_EXCEPTION;                \
+Try                                               \
+{                                                 \
+    fn_call;                                      \
+    TEST_FAIL();                                  \
+}                                                 \
+Catch(e_actual)                                   \
+    TEST_ASSERT_EQUAL_HEX_MESSAGE(e_expected, e_actual, "Encountered an unsuspected error condition!");
+
+#define NUM_TASKS 100
+
+typedef struct task_log_t
+{
+    uint32_t runs[NUM_TASKS];
+    uint32_t order[NUM_TASKS];
+    uint32_t num_runs;
+    uint32_t throw_at;
+} task_log_t;
+
+static pool_t * pool;
+
+static void log_task(void * context, uint32_t task_index)
+{
+    task_log_t * log = context;
+    uint32_t nth = __atomic_fetch_add(&log->num_runs, 1, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(log->runs + task_index, 1, __ATOMIC_RELAXED);
+    log->order[nth] = task_index;
+
+    if(task_index == log->throw_at)
+        Throw(EXCEPTION_ASSERT_FAILURE);
+}
+
+static void * run_pool_concurrently(void * arg)
+{
+    task_log_t * log = arg;
+
+    pool_run(pool, log_task, log, NUM_TASKS);
+    return NULL;
+}
+
+static void * run_pool_and_catch(void * arg)
+{
+    task_log_t * log = arg;
+    volatile CEXCEPTION_T e = EXCEPTION_NO_EXCEPTION;
+
+    Try
+    {
+        pool_run(pool, log_task, log, NUM_TASKS);
+    }
+
+    Catch(e) {}
+
+    return (void *) (uintptr_t) e;
+}
+
+void setUp(void)
+{
+    char buf[100] = { 0x00 };
+    snprintf(buf, sizeof buf, "level%s_blfs_%s", STRINGIZE(BLFS_DEBUG_LEVEL), "test");
+
+    if(dzlog_init(BLFS_CONFIG_ZLOG, buf))
+        exit(EXCEPTION_ZLOG_INIT_FAILURE);
+
+    pool = pool_init(3);
+}
+
+void tearDown(void)
+{
+    pool_fini(pool);
+    zlog_fini();
+}
+
+void test_pool_init_throws_exception_on_zero_threads(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_POOL_INIT_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    TRY_FN_CATCH_EXCEPTION(pool_init(0));
+}
+
+void test_pool_run_runs_every_task_exactly_once(void)
+{
+    task_log_t log;
+
+    memset(&log, 0, sizeof log);
+    log.throw_at = UINT32_MAX;
+
+    pool_run(pool, log_task, &log, NUM_TASKS);
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_TASKS, log.num_runs);
+
+    for(uint32_t i = 0; i < NUM_TASKS; i++)
+        TEST_ASSERT_EQUAL_UINT32(1, log.runs[i]);
+}
+
+void test_pool_run_without_pool_runs_tasks_in_order(void)
+{
+    task_log_t log;
+
+    memset(&log, 0, sizeof log);
+    log.throw_at = UINT32_MAX;
+
+    pool_run(NULL, log_task, &log, NUM_TASKS);
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_TASKS, log.num_runs);
+
+    for(uint32_t i = 0; i < NUM_TASKS; i++)
+        TEST_ASSERT_EQUAL_UINT32(i, log.order[i]);
+}
+
+void test_pool_run_does_nothing_with_zero_tasks(void)
+{
+    task_log_t log;
+
+    memset(&log, 0, sizeof log);
+
+    pool_run(pool, log_task, &log, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(0, log.num_runs);
+}
+
+void test_pool_run_rethrows_after_every_task_finishes(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_ASSERT_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    task_log_t log;
+
+    memset(&log, 0, sizeof log);
+    log.throw_at = 42;
+
+    TRY_FN_CATCH_EXCEPTION(pool_run(pool, log_task, &log, NUM_TASKS));
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_TASKS, log.num_runs);
+
+    for(uint32_t i = 0; i < NUM_TASKS; i++)
+        TEST_ASSERT_EQUAL_UINT32(1, log.runs[i]);
+}
+
+void test_pool_run_can_be_called_from_several_threads_at_once(void)
+{
+    pthread_t threads[4];
+    task_log_t logs[4];
+
+    memset(logs, 0, sizeof logs);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        logs[i].throw_at = UINT32_MAX;
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(threads + i, NULL, run_pool_concurrently, logs + i));
+    }
+
+    for(int i = 0; i < 4; ++i)
+        pthread_join(threads[i], NULL);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(NUM_TASKS, logs[i].num_runs);
+
+        for(uint32_t j = 0; j < NUM_TASKS; j++)
+            TEST_ASSERT_EQUAL_UINT32(1, logs[i].runs[j]);
+    }
+}
+
+void test_exception_ids_are_recycled_as_threads_come_and_go(void)
+{
+    task_log_t log;
+
+    // ? Every pass starts (and throws from) more threads than there are
+    // ? exception frames over the whole loop; they only fit if exited threads
+    // ? give their ids back
+    for(uint32_t i = 0; i < 2 * CEXCEPTION_NUM_ID; i++)
+    {
+        pthread_t thread;
+        void * e_actual = NULL;
+
+        pool_fini(pool);
+        pool = pool_init(3);
+
+        memset(&log, 0, sizeof log);
+        log.throw_at = 0;
+
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, run_pool_and_catch, &log));
+        TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, &e_actual));
+
+        TEST_ASSERT_EQUAL_HEX(EXCEPTION_ASSERT_FAILURE, (uintptr_t) e_actual);
+        TEST_ASSERT_EQUAL_UINT32(NUM_TASKS, log.num_runs);
+    }
+}
@@ -0,0 +1,209 @@
+#include <string.h>
+
+#include "unity.h"
+#include "readahead.h"
+
+#define TRY_FN_CATCH_EXCEPTION(fn_call)           \
+e_actual = EXCEPTION_NO_EXCEPTION;                \
+Try                                               \
+{                                                 \
+    fn_call;                                      \
+    TEST_FAIL();                                  \
+}                                                 \
+Catch(e_actual)                                   \
+    TEST_ASSERT_EQUAL_HEX_MESSAGE(e_expected, e_actual, "Encountered an unsuspected error condition!");
+
+#define NUGGET_SIZE 64
+#define NUM_SLOTS 8
+
+static readahead_t * ra;
+
+void setUp(void)
+{
+    char buf[100] = { 0x00 };
+    snprintf(buf, sizeof buf, "level%s_blfs_%s", STRINGIZE(BLFS_DEBUG_LEVEL), "test");
+
+    if(dzlog_init(BLFS_CONFIG_ZLOG, buf))
+        exit(EXCEPTION_ZLOG_INIT_FAILURE);
+
+    ra = readahead_init(NUM_SLOTS, NUGGET_SIZE);
+}
+
+void tearDown(void)
+{
+    readahead_fini(ra);
+    zlog_fini();
+}
+
+void test_readahead_init_throws_exception_on_zero_slots(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_INVALID_READAHEAD;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    TRY_FN_CATCH_EXCEPTION(readahead_init(0, NUGGET_SIZE));
+}
+
+void test_readahead_note_read_only_reads_sequential_streams_ahead(void)
+{
+    uint64_t first_nugget = 0;
+    uint32_t stream = 0;
+
+    // ? A lone read is not a stream yet
+    TEST_ASSERT_EQUAL_UINT32(0, readahead_note_read(ra, 0, NUGGET_SIZE, &first_nugget, &stream));
+
+    // ? ...but the read continuing it is
+    TEST_ASSERT_EQUAL_UINT32(BLFS_READAHEAD_MIN_WINDOW, readahead_note_read(ra, NUGGET_SIZE, NUGGET_SIZE, &first_nugget, &stream));
+    TEST_ASSERT_EQUAL_UINT64(2, first_nugget);
+
+    // ? Random reads start streams of their own and are never read ahead of
+    TEST_ASSERT_EQUAL_UINT32(0, readahead_note_read(ra, 40 * NUGGET_SIZE, 10, &first_nugget, &stream));
+    TEST_ASSERT_EQUAL_UINT32(0, readahead_note_read(ra, 7 * NUGGET_SIZE + 3, 10, &first_nugget, &stream));
+    TEST_ASSERT_EQUAL_UINT32(0, readahead_note_read(ra, 0, 0, &first_nugget, &stream));
+}
+
+void test_readahead_note_read_grows_window_as_stream_keeps_going(void)
+{
+    uint64_t first_nugget = 0;
+    uint32_t stream = 0;
+    uint32_t last_window = 0;
+    uint64_t prefetch_end = 0;
+
+    for(uint64_t nugget_index = 0; nugget_index < 64; nugget_index++)
+    {
+        uint32_t count = readahead_note_read(ra, nugget_index * NUGGET_SIZE, NUGGET_SIZE, &first_nugget, &stream);
+
+        if(count == 0)
+            continue;
+
+        // ? Windows pick up where the previous one ended and never overlap
+        TEST_ASSERT_TRUE(first_nugget > nugget_index);
+        TEST_ASSERT_TRUE(first_nugget >= prefetch_end);
+        TEST_ASSERT_TRUE(ra->streams[stream].window >= last_window);
+        TEST_ASSERT_TRUE(ra->streams[stream].window <= ra->max_window);
+
+        last_window = ra->streams[stream].window;
+        prefetch_end = first_nugget + count;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_SLOTS / 2, last_window);
+}
+
+void test_readahead_note_read_tracks_interleaved_streams(void)
+{
+    uint64_t first_nugget = 0;
+    uint32_t stream_a = 0;
+    uint32_t stream_b = 0;
+
+    readahead_note_read(ra, 0, NUGGET_SIZE, &first_nugget, &stream_a);
+    readahead_note_read(ra, 100 * NUGGET_SIZE, NUGGET_SIZE, &first_nugget, &stream_b);
+
+    TEST_ASSERT_EQUAL_UINT32(2, readahead_note_read(ra, NUGGET_SIZE, NUGGET_SIZE, &first_nugget, &stream_a));
+    TEST_ASSERT_EQUAL_UINT64(2, first_nugget);
+
+    TEST_ASSERT_EQUAL_UINT32(2, readahead_note_read(ra, 101 * NUGGET_SIZE, NUGGET_SIZE, &first_nugget, &stream_b));
+    TEST_ASSERT_EQUAL_UINT64(102, first_nugget);
+
+    TEST_ASSERT_NOT_EQUAL(stream_a, stream_b);
+}
+
+void test_readahead_insert_copy_out_and_invalidate_work_as_expected(void)
+{
+    uint8_t data[NUGGET_SIZE];
+    uint8_t actual[16] = { 0x00 };
+
+    for(uint32_t i = 0; i < sizeof data; i++)
+        data[i] = (uint8_t) i;
+
+    TEST_ASSERT_FALSE(readahead_contains(ra, 5));
+    TEST_ASSERT_FALSE(readahead_copy_out(ra, 5, actual, 0, sizeof actual));
+
+    readahead_insert(ra, 5, data, 0);
+
+    TEST_ASSERT_TRUE(readahead_contains(ra, 5));
+    TEST_ASSERT_TRUE(readahead_copy_out(ra, 5, actual, 10, sizeof actual));
+    TEST_ASSERT_EQUAL_MEMORY(data + 10, actual, sizeof actual);
+
+    readahead_invalidate(ra, 0, 4);
+    TEST_ASSERT_TRUE(readahead_contains(ra, 5));
+
+    readahead_invalidate(ra, 5, 9);
+    TEST_ASSERT_FALSE(readahead_contains(ra, 5));
+}
+
+void test_readahead_insert_evicts_read_nuggets_first(void)
+{
+    uint8_t data[NUGGET_SIZE] = { 0x00 };
+    uint8_t actual[1];
+
+    for(uint64_t nugget_index = 0; nugget_index < NUM_SLOTS; nugget_index++)
+        readahead_insert(ra, nugget_index, data, 0);
+
+    // ? Nugget 3 has been read, so it goes before the older nugget 0 does
+    TEST_ASSERT_TRUE(readahead_copy_out(ra, 3, actual, 0, sizeof actual));
+
+    readahead_insert(ra, 100, data, 0);
+
+    TEST_ASSERT_FALSE(readahead_contains(ra, 3));
+    TEST_ASSERT_TRUE(readahead_contains(ra, 0));
+    TEST_ASSERT_TRUE(readahead_contains(ra, 100));
+
+    // ? Now every nugget is unread, so the oldest goes
+    readahead_insert(ra, 101, data, 0);
+
+    TEST_ASSERT_FALSE(readahead_contains(ra, 0));
+    TEST_ASSERT_TRUE(readahead_contains(ra, 101));
+}
+
+void test_readahead_insert_shrinks_window_of_stream_whose_nuggets_went_unread(void)
+{
+    uint8_t data[NUGGET_SIZE] = { 0x00 };
+
+    ra->streams[1].window = 4;
+
+    for(uint64_t nugget_index = 0; nugget_index < NUM_SLOTS; nugget_index++)
+        readahead_insert(ra, nugget_index, data, 1);
+
+    readahead_insert(ra, 100, data, 0);
+
+    TEST_ASSERT_EQUAL_UINT32(2, ra->streams[1].window);
+}
+
+static uint32_t fills;
+
+static void fill_nuggets(void * context, uint64_t first_nugget, uint32_t count, uint32_t stream)
+{
+    uint8_t data[NUGGET_SIZE];
+
+    // ? A fill that throws must not take the read-ahead thread down with it
+    if(first_nugget == 50)
+        Throw(EXCEPTION_INTEGRITY_FAILURE);
+
+    for(uint64_t nugget_index = first_nugget; nugget_index < first_nugget + count; nugget_index++)
+    {
+        memset(data, (uint8_t) nugget_index, sizeof data);
+        readahead_insert((readahead_t *) context, nugget_index, data, stream);
+    }
+
+    fills++;
+}
+
+void test_readahead_schedule_fills_windows_on_the_readahead_thread(void)
+{
+    uint8_t actual[1] = { 0x00 };
+
+    fills = 0;
+    readahead_start(ra, fill_nuggets, ra);
+
+    readahead_schedule(ra, 50, 2, 0);
+    readahead_schedule(ra, 2, 3, 0);
+    readahead_wait(ra);
+
+    TEST_ASSERT_EQUAL_UINT32(1, fills);
+    TEST_ASSERT_FALSE(readahead_contains(ra, 50));
+    TEST_ASSERT_TRUE(readahead_contains(ra, 2));
+    TEST_ASSERT_TRUE(readahead_contains(ra, 4));
+    TEST_ASSERT_FALSE(readahead_contains(ra, 5));
+
+    TEST_ASSERT_TRUE(readahead_copy_out(ra, 3, actual, 0, sizeof actual));
+    TEST_ASSERT_EQUAL_HEX8(3, actual[0]);
+}
@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "_struts.h"
 
@@ -38,6 +39,8 @@ Catch(e_actual)                                   \
 
 #define _TEST_BLFS_TPM_ID 1 // ! ensure different than prod value
 #define BACKSTORE_FILE_PATH "/tmp/test.io.bin"
+#define STRIPE_MEMBER_FILE_PATH "/tmp/test.io.stripe1.bin"
+#define METADATA_FILE_PATH "/tmp/test.io.metadata.bin"
 
 static int iofd;
 static buselfs_state_t * buselfs_state;
@@ -65,6 +68,18 @@ static void make_fake_state()
     buselfs_state->cache_nugget_keys            = kh_init(BLFS_KHASH_NUGGET_KEY_CACHE_NAME);
     buselfs_state->merkle_tree                  = mt_create();
     buselfs_state->default_password             = BLFS_DEFAULT_PASS;
+    buselfs_state->nugget_locks                 = NULL;
+    buselfs_state->state_lock                   = NULL;
+    buselfs_state->writes_drained               = NULL;
+    buselfs_state->crypt_pool                   = NULL;
+    buselfs_state->readahead                    = NULL;
+    buselfs_state->num_stripe_members           = 0;
+    buselfs_state->stripe_nuggets               = BLFS_DEFAULT_STRIPE_NUGGETS;
+    buselfs_state->metadata_path                = NULL;
+    buselfs_state->metadata_cache_bytes         = 0;
+    buselfs_state->writes_in_flight             = 0;
+    buselfs_state->epoch_open                   = FALSE;
+    buselfs_state->epoch_drains                 = 0;
     buselfs_state->rpmb_secure_index            = _TEST_BLFS_TPM_ID;
     buselfs_state->primary_cipher               = &global_active_cipher;
     buselfs_state->swap_cipher                  = buselfs_state->primary_cipher;
@@ -378,7 +393,7 @@ void test_blfs_soft_open_works_as_expected(void)
     blfs_header_t * header_flakesize_bytes = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_FLAKESIZE_BYTES);
     blfs_header_t * header_initialized = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_INITIALIZED);
 
-    uint8_t expected_ver[BLFS_HEAD_HEADER_BYTES_VERSION] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    uint8_t expected_ver[BLFS_HEAD_HEADER_BYTES_VERSION] = { 0x34, 0x03, 0x00, 0x00 };
     uint8_t expected_salt[BLFS_HEAD_HEADER_BYTES_SALT] = {
         0x8f, 0xa2, 0x0d, 0x92, 0x35, 0xd6, 0xc2, 0x4c, 0xe4, 0xbc, 0x4f, 0x47,
         0xa4, 0xce, 0x69, 0xa8
@@ -477,8 +492,8 @@ void test_blfs_run_mode_create_works_when_backstore_exists_already(void)
     TEST_ASSERT_EQUAL_STRING(BACKSTORE_FILE_PATH, backstore->file_path);
     TEST_ASSERT_EQUAL_STRING("test.io.bin", backstore->file_name);
     TEST_ASSERT_EQUAL_UINT(105, backstore->kcs_real_offset);
-    TEST_ASSERT_EQUAL_UINT(865, backstore->tj_real_offset);
-    TEST_ASSERT_EQUAL_UINT(1055, backstore->md_real_offset);
+    TEST_ASSERT_EQUAL_UINT(113, backstore->tj_real_offset);
+    TEST_ASSERT_EQUAL_UINT(115, backstore->md_real_offset);
     TEST_ASSERT_EQUAL_UINT(1815, backstore->body_real_offset);
     TEST_ASSERT_EQUAL_UINT(2280, backstore->writeable_size_actual);
     TEST_ASSERT_EQUAL_UINT(24, backstore->nugget_size_bytes);
@@ -534,8 +549,8 @@ void test_blfs_run_mode_create_works_when_backstore_DNE(void)
     TEST_ASSERT_EQUAL_STRING(BACKSTORE_FILE_PATH, backstore->file_path);
     TEST_ASSERT_EQUAL_STRING("test.io.bin", backstore->file_name);
     TEST_ASSERT_EQUAL_UINT(105, backstore->kcs_real_offset);
-    TEST_ASSERT_EQUAL_UINT(865, backstore->tj_real_offset);
-    TEST_ASSERT_EQUAL_UINT(1055, backstore->md_real_offset);
+    TEST_ASSERT_EQUAL_UINT(113, backstore->tj_real_offset);
+    TEST_ASSERT_EQUAL_UINT(115, backstore->md_real_offset);
     TEST_ASSERT_EQUAL_UINT(1815, backstore->body_real_offset);
     TEST_ASSERT_EQUAL_UINT(2280, backstore->writeable_size_actual);
     TEST_ASSERT_EQUAL_UINT(24, backstore->nugget_size_bytes);
@@ -547,6 +562,52 @@ void test_blfs_run_mode_create_works_when_backstore_DNE(void)
     blfs_backstore_close(backstore);
 }
 
+void test_blfs_run_mode_create_stripes_body_across_members(void)
+{
+    unlink(BACKSTORE_FILE_PATH);
+
+    buselfs_state->num_stripe_members = 1;
+    buselfs_state->stripe_member_paths[0] = STRIPE_MEMBER_FILE_PATH;
+
+    blfs_run_mode_create(BACKSTORE_FILE_PATH, 4096, 2, 12, buselfs_state);
+
+    blfs_backstore_t * backstore = buselfs_state->backstore;
+
+    // ? Records stay on the backstore, so every other nugget only costs a record there
+    TEST_ASSERT_EQUAL_UINT(2, backstore->stripe_width);
+    TEST_ASSERT_EQUAL_UINT(BLFS_DEFAULT_STRIPE_NUGGETS, backstore->stripe_nuggets);
+    TEST_ASSERT_EQUAL_UINT(105, backstore->kcs_real_offset);
+    TEST_ASSERT_EQUAL_UINT(2463, backstore->body_real_offset);
+    TEST_ASSERT_EQUAL_UINT(3144, backstore->writeable_size_actual);
+    TEST_ASSERT_EQUAL_UINT(131, backstore->num_nuggets);
+    TEST_ASSERT_EQUAL_UINT(4096, backstore->stripe_members[0].file_size_actual);
+
+    blfs_backstore_close(backstore);
+    unlink(STRIPE_MEMBER_FILE_PATH);
+}
+
+void test_blfs_run_mode_create_keeps_metadata_on_metadata_device(void)
+{
+    unlink(METADATA_FILE_PATH);
+
+    buselfs_state->metadata_path = METADATA_FILE_PATH;
+
+    blfs_run_mode_create(BACKSTORE_FILE_PATH, 4096, 2, 12, buselfs_state);
+
+    blfs_backstore_t * backstore = buselfs_state->backstore;
+
+    // ? The body device only holds bodies, so it alone limits the nugget count
+    TEST_ASSERT_EQUAL_STRING(METADATA_FILE_PATH, backstore->file_path);
+    TEST_ASSERT_EQUAL_STRING(BACKSTORE_FILE_PATH, backstore->body_device->file_path);
+    TEST_ASSERT_EQUAL_UINT(105, backstore->kcs_real_offset);
+    TEST_ASSERT_EQUAL_UINT(3147, backstore->body_real_offset);
+    TEST_ASSERT_EQUAL_UINT(4056, backstore->writeable_size_actual);
+    TEST_ASSERT_EQUAL_UINT(169, backstore->num_nuggets);
+
+    blfs_backstore_close(backstore);
+    unlink(METADATA_FILE_PATH);
+}
+
 void test_blfs_run_mode_create_initializes_keycache_and_merkle_tree_properly(void)
 {
     free(buselfs_state->backstore);
@@ -784,6 +845,227 @@ void test_strongbox_main_actual_throws_exception_if_invalid_tpm_id(void)
     TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
 }
 
+void test_strongbox_main_actual_throws_exception_if_invalid_num_workers(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_INVALID_NUM_WORKERS;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--workers",
+        "0",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--workers",
+        "9999",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
+}
+
+void test_strongbox_main_actual_throws_exception_if_invalid_num_crypt_threads(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_INVALID_NUM_CRYPT_THREADS;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--crypt-threads",
+        "-1",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--crypt-threads",
+        "9999",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
+}
+
+void test_strongbox_main_actual_throws_exception_if_invalid_readahead(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_INVALID_READAHEAD;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--readahead",
+        "-1",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--readahead",
+        "9999",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
+}
+
+void test_strongbox_main_actual_throws_exception_if_bad_metadata_cache(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_BAD_ARGUMENT_FORM;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--metadata-cache",
+        "-1",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    // ? Swapping strategies keep cipher changes in memory only
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--swap-strategy",
+        "swap_mirrored",
+        "--metadata-cache",
+        "16",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(8, argv2, blockdevice));
+}
+
+void test_strongbox_main_actual_throws_exception_if_invalid_stripe_nuggets(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_BAD_STRIPE_MEMBER;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--stripe-nuggets",
+        "0",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--stripe-nuggets",
+        "-1",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
+}
+
+void test_strongbox_main_actual_throws_exception_if_invalid_scheduler_setting(void)
+{
+    zlog_fini();
+
+    CEXCEPTION_T e_expected = EXCEPTION_INVALID_SCHEDULER_SETTING;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv[] = {
+        "progname",
+        "--default-password",
+        "--queue-depth",
+        "99999",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv2[] = {
+        "progname",
+        "--default-password",
+        "--merge-window",
+        "-1",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv2, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv3[] = {
+        "progname",
+        "--default-password",
+        "--read-deadline",
+        "0",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv3, blockdevice));
+
+    e_actual = EXCEPTION_NO_EXCEPTION;
+
+    char * argv4[] = {
+        "progname",
+        "--default-password",
+        "--write-deadline",
+        "-5",
+        "create",
+        "device115"
+    };
+
+    TRY_FN_CATCH_EXCEPTION(strongbox_main_actual(6, argv4, blockdevice));
+}
+
 void test_strongbox_main_actual_throws_exception_if_nonimpl_cipher(void)
 {
     zlog_fini();
@@ -1211,6 +1493,90 @@ void test_buse_write_dirty_write_triggers_rekeying8(void)
     TEST_ASSERT_EQUAL_MEMORY(test_play_data + offset7, buffer7, sizeof buffer7);
 }
 
+void test_buse_trim_discards_whole_nuggets_only(void)
+{
+    blfs_backstore_write(buselfs_state->backstore, alternate_mtrh_data, sizeof alternate_mtrh_data, 20);
+
+    free(buselfs_state->backstore);
+
+    clear_tj();
+
+    blfs_run_mode_open(BACKSTORE_FILE_PATH, (uint8_t)(0), buselfs_state);
+
+    uint8_t buffer[sizeof test_play_data] = { 0x00 };
+    uint8_t expected[sizeof test_play_data];
+
+    memcpy(expected, test_play_data, sizeof expected);
+
+    buse_write(test_play_data, sizeof test_play_data, 0, (void *) buselfs_state);
+
+    // ? Covers the back half of nugget 0, all of nugget 1, and the front half of nugget 2
+    buse_trim(8, 32, (void *) buselfs_state);
+    memset(expected + 16, 0, 16);
+
+    buse_read(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+
+    blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, 1);
+    TEST_ASSERT_FALSE(bitmask_any_bits_set(entry->bitmask, 0, buselfs_state->backstore->flakes_per_nugget));
+    TEST_ASSERT_TRUE(blfs_open_nugget_metadata(buselfs_state->backstore, 1)->discarded);
+    TEST_ASSERT_FALSE(blfs_open_nugget_metadata(buselfs_state->backstore, 0)->discarded);
+
+    // ? A partial write into a discarded flake leaves the rest of it zeroed
+    buse_write(test_play_data + 20, 3, 20, (void *) buselfs_state);
+    memcpy(expected + 20, test_play_data + 20, 3);
+
+    buse_read(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+}
+
+void test_buse_write_zeroes_resets_whole_nuggets_and_writes_edges(void)
+{
+    blfs_backstore_write(buselfs_state->backstore, alternate_mtrh_data, sizeof alternate_mtrh_data, 20);
+
+    free(buselfs_state->backstore);
+
+    clear_tj();
+
+    blfs_run_mode_open(BACKSTORE_FILE_PATH, (uint8_t)(0), buselfs_state);
+
+    uint8_t buffer[sizeof test_play_data] = { 0x00 };
+    uint8_t expected[sizeof test_play_data];
+
+    memcpy(expected, test_play_data, sizeof expected);
+
+    buse_write(test_play_data, sizeof test_play_data, 0, (void *) buselfs_state);
+
+    uint64_t rekey_step = buselfs_state->crash_recovery ? 2 : 1;
+    uint64_t keycount0 = blfs_open_keycount(buselfs_state->backstore, 0)->keycount;
+    uint64_t keycount2 = blfs_open_keycount(buselfs_state->backstore, 2)->keycount;
+
+    // ? Covers the back of nugget 0, all of nugget 1, and the front of nugget 2
+    buse_write_zeroes(5, 38, FALSE, (void *) buselfs_state);
+    memset(expected + 5, 0, 38);
+
+    buse_read(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+
+    // ? Each partially covered nugget is overwritten (so rekeyed) only once
+    TEST_ASSERT_EQUAL_UINT64(keycount0 + rekey_step, blfs_open_keycount(buselfs_state->backstore, 0)->keycount);
+    TEST_ASSERT_EQUAL_UINT64(keycount2 + rekey_step, blfs_open_keycount(buselfs_state->backstore, 2)->keycount);
+
+    blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(buselfs_state->backstore, 1);
+    TEST_ASSERT_FALSE(bitmask_any_bits_set(entry->bitmask, 0, buselfs_state->backstore->flakes_per_nugget));
+
+    // ? Within a single nugget there's nothing to reset
+    buse_write_zeroes(1, 2, TRUE, (void *) buselfs_state);
+    memset(expected + 1, 0, 2);
+
+    buse_read(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+}
+
 static void readwrite_quicktests()
 {
     dzlog_notice("Running read/write quicktests (stage 1)...");
@@ -3401,3 +3767,540 @@ void test_buselfs_state_delay_rw_is_false_when_param_DNE(void)
 
     TEST_ASSERT_FALSE(buselfs_state->delay_rw);
 }
+
+typedef struct concurrent_rw_args_t
+{
+    uint64_t offset;
+    uint8_t fill;
+    int failed;
+} concurrent_rw_args_t;
+
+static void * concurrent_readwrite_worker(void * argp)
+{
+    concurrent_rw_args_t * args = argp;
+    uint8_t expected[4096];
+    uint8_t buffer[sizeof expected];
+
+    memset(expected, args->fill, sizeof expected);
+
+    // ? Unity asserts longjmp, so failures are reported back to the main thread
+    for(int i = 0; i < 16; ++i)
+    {
+        buse_write(expected, sizeof expected, args->offset, (void *) buselfs_state);
+        buse_read(buffer, sizeof buffer, args->offset, (void *) buselfs_state);
+
+        if(memcmp(expected, buffer, sizeof expected) != 0)
+            args->failed = 1;
+    }
+
+    return NULL;
+}
+
+void test_buselfs_state_num_workers_defaults_properly(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "create",
+        "device_actual-135"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_EQUAL_UINT32(BLFS_DEFAULT_NUM_WORKERS, buselfs_state->num_workers);
+    TEST_ASSERT_EQUAL_UINT32(BLFS_DEFAULT_NUM_WORKERS, buselfs_state->buseops->workers);
+    TEST_ASSERT_NOT_NULL(buselfs_state->nugget_locks);
+    TEST_ASSERT_NOT_NULL(buselfs_state->state_lock);
+    TEST_ASSERT_EQUAL_UINT32(1, buselfs_state->buseops->connections);
+    TEST_ASSERT_EQUAL_UINT32(BLFS_DEFAULT_QUEUE_DEPTH, buselfs_state->buseops->queue_depth);
+    TEST_ASSERT_EQUAL_UINT32(BLFS_DEFAULT_MERGE_WINDOW_KB * BYTES_IN_A_KB, buselfs_state->buseops->merge_window);
+}
+
+void test_buselfs_state_scheduler_settings_are_passed_to_buse(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--queue-depth",
+        "64",
+        "--merge-window",
+        "256",
+        "--read-deadline",
+        "20",
+        "--write-deadline",
+        "200",
+        "create",
+        "device_actual-140"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_EQUAL_UINT32(64, buselfs_state->buseops->queue_depth);
+    TEST_ASSERT_EQUAL_UINT32(256 * BYTES_IN_A_KB, buselfs_state->buseops->merge_window);
+    TEST_ASSERT_EQUAL_UINT32(20, buselfs_state->buseops->read_deadline_ms);
+    TEST_ASSERT_EQUAL_UINT32(200, buselfs_state->buseops->write_deadline_ms);
+}
+
+void test_buselfs_state_multi_conn_uses_one_connection_per_worker(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--workers",
+        "3",
+        "--multi-conn",
+        "create",
+        "device_actual-137"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_EQUAL_UINT32(3, buselfs_state->num_workers);
+    TEST_ASSERT_EQUAL_UINT32(3, buselfs_state->buseops->connections);
+}
+
+void test_strongbox_concurrent_readwrite_works_as_expected(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--workers",
+        "4",
+        "create",
+        "device_actual-136"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_EQUAL_UINT32(4, buselfs_state->num_workers);
+
+    pthread_t threads[4];
+    concurrent_rw_args_t args[4];
+
+    // ? Threads 0 and 1 share a nugget; 2 and 3 straddle a nugget boundary
+    uint64_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint64_t offsets[4] = { 0, 4096, nugget_size * 3 - 2048, nugget_size * 3 + 2048 };
+
+    for(int i = 0; i < 4; ++i)
+    {
+        args[i].offset = offsets[i];
+        args[i].fill = (uint8_t)(0xA0 + i);
+        args[i].failed = 0;
+
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, concurrent_readwrite_worker, &args[i]));
+    }
+
+    for(int i = 0; i < 4; ++i)
+        pthread_join(threads[i], NULL);
+
+    for(int i = 0; i < 4; ++i)
+        TEST_ASSERT_FALSE_MESSAGE(args[i].failed, "a concurrent read returned data another writer clobbered");
+
+    TEST_ASSERT_EQUAL_UINT32(0, buselfs_state->writes_in_flight);
+}
+
+void test_blfs_group_commit_shares_one_global_version_bump_per_epoch(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "create",
+        "device_actual-138"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    blfs_header_t * tpmv_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_TPMGLOBALVER);
+    uint64_t initial_version = *(uint64_t *) tpmv_header->data;
+
+    uint8_t buffer[4096];
+    memset(buffer, 0xCD, sizeof buffer);
+
+    TEST_ASSERT_FALSE(buselfs_state->epoch_open);
+
+    buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+    buse_write(buffer, sizeof buffer, sizeof buffer, (void *) buselfs_state);
+    buse_write(buffer, sizeof buffer, buselfs_state->backstore->nugget_size_bytes, (void *) buselfs_state);
+
+    TEST_ASSERT_TRUE(buselfs_state->epoch_open);
+    TEST_ASSERT_EQUAL_UINT64(initial_version + 1, *(uint64_t *) tpmv_header->data);
+
+    blfs_group_commit(buselfs_state);
+
+    TEST_ASSERT_FALSE(buselfs_state->epoch_open);
+    TEST_ASSERT_EQUAL_INT(MT_SUCCESS,
+        mt_verify(buselfs_state->merkle_tree, tpmv_header->data, BLFS_HEAD_HEADER_BYTES_TPMGLOBALVER, 0));
+
+    blfs_header_t * mtrh_header = blfs_open_header(buselfs_state->backstore, BLFS_HEAD_HEADER_TYPE_MTRH);
+    TEST_ASSERT_EQUAL_MEMORY(buselfs_state->merkle_tree_root_hash, mtrh_header->data, BLFS_HEAD_HEADER_BYTES_MTRH);
+
+    // ? A flush with nothing new to commit must not bump the version again
+    blfs_group_commit(buselfs_state);
+    TEST_ASSERT_EQUAL_UINT64(initial_version + 1, *(uint64_t *) tpmv_header->data);
+
+    buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_TRUE(buselfs_state->epoch_open);
+    TEST_ASSERT_EQUAL_UINT64(initial_version + 2, *(uint64_t *) tpmv_header->data);
+}
+
+void test_buse_write_journals_flakes_without_waiting_for_a_flush(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "create",
+        "device_actual-143"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    uint8_t buffer[4096];
+    memset(buffer, 0xCD, sizeof buffer);
+
+    buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    // ? Crash before any flush: whatever was waiting for one is lost
+    blfs_backstore_t * backstore = buselfs_state->backstore;
+
+    pthread_mutex_lock(backstore->dirty_lock);
+    backstore->dirty_kcs_counts->count = 0;
+    backstore->dirty_nugget_md->count = 0;
+    pthread_mutex_unlock(backstore->dirty_lock);
+
+    blfs_backstore_t * reopened = blfs_backstore_open_with_ctx(backstore->file_path, buselfs_state);
+    blfs_tjournal_entry_t * entry = blfs_open_tjournal_entry(reopened, 0);
+
+    // ? ...yet the flake is journaled, so overwriting it after the crash
+    // ? rekeys instead of reusing the keystream
+    TEST_ASSERT_TRUE(bitmask_is_bit_set(entry->bitmask, 0));
+
+    blfs_backstore_close(reopened);
+}
+
+void test_buse_write_only_rewrites_the_epoch_record_every_interval(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "create",
+        "device_actual-145"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    uint8_t buffer[4096];
+    uint8_t first_root[BLFS_HEAD_HEADER_BYTES_MTRH];
+    uint8_t record_root[BLFS_HEAD_HEADER_BYTES_MTRH];
+    uint8_t live_root[BLFS_HEAD_HEADER_BYTES_MTRH];
+    uint64_t record_version = 0;
+
+    memset(buffer, 0xCD, sizeof buffer);
+
+    // ? The first drain of an epoch always writes a record
+    buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_TRUE(blfs_backstore_read_epoch_record(buselfs_state->backstore, &record_version, first_root));
+    TEST_ASSERT_EQUAL_UINT32(1, buselfs_state->epoch_drains);
+
+    // ? ...the ones after it don't until the interval comes around again
+    for(uint32_t i = 1; i < BLFS_EPOCH_RECORD_INTERVAL; i++)
+    {
+        memset(buffer, i, sizeof buffer);
+        buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+    }
+
+    TEST_ASSERT_TRUE(blfs_backstore_read_epoch_record(buselfs_state->backstore, &record_version, record_root));
+    TEST_ASSERT_EQUAL_MEMORY(first_root, record_root, sizeof record_root);
+
+    buse_write(buffer, sizeof buffer, sizeof buffer, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_INT(MT_SUCCESS, mt_get_root(buselfs_state->merkle_tree, live_root));
+    TEST_ASSERT_TRUE(blfs_backstore_read_epoch_record(buselfs_state->backstore, &record_version, record_root));
+    TEST_ASSERT_EQUAL_MEMORY(live_root, record_root, sizeof record_root);
+
+    // ? A new epoch starts counting over
+    blfs_group_commit(buselfs_state);
+    buse_write(buffer, sizeof buffer, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_UINT32(1, buselfs_state->epoch_drains);
+}
+
+void test_blfs_soft_open_recovers_from_a_crash_between_group_commits(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "create",
+        "device_actual-144"
+    };
+
+    char * argv_open1[] = {
+        "progname",
+        "--default-password",
+        "open",
+        "device_actual-144"
+    };
+
+    int argc_create = sizeof(argv_create1)/sizeof(argv_create1[0]);
+    int argc_open = sizeof(argv_open1)/sizeof(argv_open1[0]);
+
+    buselfs_state = strongbox_main_actual(argc_create, argv_create1, blockdevice);
+
+    uint8_t buffer1[4096];
+    uint8_t buffer2[4096];
+    uint8_t buffer_actual[4096] = { 0x00 };
+
+    memset(buffer1, 0xCD, sizeof buffer1);
+    memset(buffer2, 0xEF, sizeof buffer2);
+
+    buse_write(buffer1, sizeof buffer1, 0, (void *) buselfs_state);
+
+    uint64_t keycount_before = blfs_open_keycount(buselfs_state->backstore, 0)->keycount;
+
+    // ? Crash before any flush: the header and MTRH are an epoch behind, which
+    // ? must not be mistaken for tampering
+    zlog_fini();
+    buselfs_state = strongbox_main_actual(argc_open, argv_open1, blockdevice);
+
+    TEST_ASSERT_TRUE(buselfs_state->crash_recovery);
+
+    buse_read(buffer_actual, sizeof buffer_actual, 0, (void *) buselfs_state);
+    TEST_ASSERT_EQUAL_MEMORY(buffer1, buffer_actual, sizeof buffer_actual);
+
+    // ? Keystreams from the lost epoch are skipped rather than reused
+    buse_write(buffer2, sizeof buffer2, 0, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_UINT64(keycount_before + 2, blfs_open_keycount(buselfs_state->backstore, 0)->keycount);
+
+    buse_read(buffer_actual, sizeof buffer_actual, 0, (void *) buselfs_state);
+    TEST_ASSERT_EQUAL_MEMORY(buffer2, buffer_actual, sizeof buffer_actual);
+}
+
+void test_buse_readwrite_fans_out_across_crypt_threads(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--crypt-threads",
+        "3",
+        "create",
+        "device_actual-139"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_NOT_NULL(buselfs_state->crypt_pool);
+    TEST_ASSERT_EQUAL_UINT32(3, buselfs_state->crypt_pool->num_threads);
+
+    // ? Unaligned at both ends and spanning five nuggets
+    uint64_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint64_t offset = nugget_size - 1000;
+    uint32_t length = (uint32_t)(3 * nugget_size + 2000);
+
+    uint8_t * expected = malloc(length);
+    uint8_t * actual = malloc(length);
+
+    for(uint32_t i = 0; i < length; i++)
+        expected[i] = (uint8_t)(i * 31 + (i >> 12));
+
+    buse_write(expected, length, offset, (void *) buselfs_state);
+    buse_read(actual, length, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    // ? Overwriting every one of those nuggets rekeys them, which must happen
+    // ? on this thread (it holds their locks) rather than deadlock in the pool
+    for(uint32_t i = 0; i < length; i++)
+        expected[i] = (uint8_t)(i * 17 + 5);
+
+    buse_write(expected, length, offset, (void *) buselfs_state);
+    buse_read(actual, length, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    // ? The serial path must agree with what the fanned out writes left behind
+    pool_t * crypt_pool = buselfs_state->crypt_pool;
+    buselfs_state->crypt_pool = NULL;
+
+    memset(actual, 0, length);
+    buse_read(actual, length, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    pool_fini(crypt_pool);
+
+    free(expected);
+    free(actual);
+}
+
+void test_buse_read_reads_sequential_streams_ahead(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--readahead",
+        "8",
+        "create",
+        "device_actual-142"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_NOT_NULL(buselfs_state->readahead);
+
+    uint32_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint32_t length = 6 * nugget_size;
+
+    uint8_t * expected = malloc(length);
+    uint8_t * actual = malloc(length);
+
+    for(uint32_t i = 0; i < length; i++)
+        expected[i] = (uint8_t)(i * 7 + (i >> 10));
+
+    buse_write(expected, length, 0, (void *) buselfs_state);
+
+    // ? Read it back sequentially, half a nugget at a time
+    for(uint32_t offset = 0; offset < length; offset += nugget_size / 2)
+        buse_read(actual + offset, nugget_size / 2, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    // ? Nuggets are read ahead on the read-ahead thread, after buse_read returns
+    readahead_wait(buselfs_state->readahead);
+    TEST_ASSERT_TRUE(readahead_contains(buselfs_state->readahead, 6));
+
+    // ? Writes must not leave stale plaintext behind in the read-ahead buffer
+    uint8_t * overwrite = malloc(nugget_size);
+
+    memset(overwrite, 0xCD, nugget_size);
+    memcpy(expected + 4 * nugget_size, overwrite, nugget_size);
+
+    buse_write(overwrite, nugget_size, 4 * nugget_size, (void *) buselfs_state);
+    TEST_ASSERT_FALSE(readahead_contains(buselfs_state->readahead, 4));
+
+    memset(actual, 0, length);
+
+    for(uint32_t offset = 0; offset < length; offset += nugget_size / 2)
+        buse_read(actual + offset, nugget_size / 2, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    readahead_fini(buselfs_state->readahead);
+    buselfs_state->readahead = NULL;
+
+    free(overwrite);
+    free(expected);
+    free(actual);
+}
+
+void test_buse_readwrite_works_with_mmap_io_engine(void)
+{
+    zlog_fini();
+
+    char * argv_create1[] = {
+        "progname",
+        "--default-password",
+        "--backstore-size",
+        "50",
+        "--io-engine",
+        "ioe_mmap",
+        "create",
+        "device_actual-141"
+    };
+
+    int argc = sizeof(argv_create1)/sizeof(argv_create1[0]);
+
+    buselfs_state = strongbox_main_actual(argc, argv_create1, blockdevice);
+
+    TEST_ASSERT_EQUAL_INT(ioe_mmap, buselfs_state->backstore->io_engine);
+    TEST_ASSERT_NOT_NULL(buselfs_state->backstore->mapping);
+
+    uint64_t nugget_size = buselfs_state->backstore->nugget_size_bytes;
+    uint64_t offset = nugget_size / 2;
+    uint32_t length = (uint32_t)(2 * nugget_size);
+
+    uint8_t * expected = malloc(length);
+    uint8_t * actual = malloc(length);
+
+    for(uint32_t i = 0; i < length; i++)
+        expected[i] = (uint8_t)(i * 13 + 7);
+
+    buse_write(expected, length, offset, (void *) buselfs_state);
+    buse_read(actual, length, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    blfs_group_commit(buselfs_state);
+
+    // ? Whatever went through the mapping must be in the file proper as well
+    blfs_backstore_set_io_engine(buselfs_state->backstore, ioe_pread);
+
+    TEST_ASSERT_NULL(buselfs_state->backstore->mapping);
+
+    memset(actual, 0, length);
+    buse_read(actual, length, offset, (void *) buselfs_state);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, length);
+
+    free(expected);
+    free(actual);
+}
@@ -0,0 +1,118 @@
+#include "uring.h"
+#include "unity.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BACKSTORE_FILE_PATH "/tmp/test.uring.bin"
+
+static int iofd;
+static blfs_uring_t * ring;
+
+void setUp(void)
+{
+    char buf[100] = { 0x00 };
+    snprintf(buf, sizeof buf, "level%s_blfs_%s", STRINGIZE(BLFS_DEBUG_LEVEL), "test");
+
+    if(dzlog_init(BLFS_CONFIG_ZLOG, buf))
+        exit(EXCEPTION_ZLOG_INIT_FAILURE);
+
+    iofd = open(BACKSTORE_FILE_PATH, O_CREAT | O_RDWR | O_TRUNC, 0777);
+    ring = blfs_uring_init(8);
+}
+
+void tearDown(void)
+{
+    blfs_uring_fini(ring);
+    close(iofd);
+    unlink(BACKSTORE_FILE_PATH);
+    zlog_fini();
+}
+
+void test_blfs_uring_submit_and_wait_writes_everything_in_order(void)
+{
+    uint8_t first[64];
+    uint8_t second[32];
+    uint8_t expected[64];
+    uint8_t actual[64] = { 0x00 };
+
+    memset(first, 0xAA, sizeof first);
+    memset(second, 0xBB, sizeof second);
+
+    // ? second lands on top of first, so the order they complete in matters
+    memcpy(expected, first, sizeof expected);
+    memcpy(expected + 16, second, sizeof second);
+
+    blfs_uring_queue_write(ring, iofd, first, sizeof first, 0);
+    blfs_uring_queue_fsync(ring, iofd);
+    blfs_uring_queue_write(ring, iofd, second, sizeof second, 16);
+
+    TEST_ASSERT_EQUAL_UINT32(3, ring->num_ops);
+
+    blfs_uring_submit_and_wait(ring);
+
+    TEST_ASSERT_EQUAL_UINT32(0, ring->num_ops);
+    TEST_ASSERT_EQUAL_INT(sizeof actual, pread(iofd, actual, sizeof actual, 0));
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof actual);
+}
+
+void test_blfs_uring_queue_write_submits_when_full(void)
+{
+    uint8_t data[20][16];
+    uint8_t actual[sizeof data] = { 0x00 };
+
+    for(uint32_t i = 0; i < 20; i++)
+    {
+        memset(data[i], (int) i, sizeof data[i]);
+        blfs_uring_queue_write(ring, iofd, data[i], sizeof data[i], i * sizeof data[i]);
+        TEST_ASSERT_TRUE(ring->num_ops <= ring->entries);
+    }
+
+    blfs_uring_submit_and_wait(ring);
+
+    TEST_ASSERT_EQUAL_INT(sizeof actual, pread(iofd, actual, sizeof actual, 0));
+    TEST_ASSERT_EQUAL_MEMORY(data, actual, sizeof actual);
+}
+
+void test_blfs_uring_overlaps_works_as_expected(void)
+{
+    uint8_t data[16] = { 0x00 };
+
+    TEST_ASSERT_FALSE(blfs_uring_overlaps(ring, iofd, 0, 100));
+
+    blfs_uring_queue_write(ring, iofd, data, sizeof data, 100);
+    blfs_uring_queue_fsync(ring, iofd);
+
+    TEST_ASSERT_FALSE(blfs_uring_overlaps(ring, iofd, 0, 100));
+    TEST_ASSERT_TRUE(blfs_uring_overlaps(ring, iofd, 0, 101));
+    TEST_ASSERT_TRUE(blfs_uring_overlaps(ring, iofd, 115, 10));
+    TEST_ASSERT_FALSE(blfs_uring_overlaps(ring, iofd, 116, 10));
+    TEST_ASSERT_FALSE(blfs_uring_overlaps(ring, iofd + 1, 100, 16));
+
+    blfs_uring_submit_and_wait(ring);
+
+    TEST_ASSERT_FALSE(blfs_uring_overlaps(ring, iofd, 100, 16));
+}
+
+void test_blfs_uring_submit_and_wait_throws_exception_on_bad_fd(void)
+{
+    CEXCEPTION_T e_expected = EXCEPTION_BACKSTORE_IO_FAILURE;
+    volatile CEXCEPTION_T e_actual = EXCEPTION_NO_EXCEPTION;
+
+    uint8_t data[16] = { 0x00 };
+
+    blfs_uring_queue_write(ring, -1, data, sizeof data, 0);
+
+    Try
+    {
+        blfs_uring_submit_and_wait(ring);
+        TEST_FAIL();
+    }
+
+    Catch(e_actual)
+        TEST_ASSERT_EQUAL_HEX_MESSAGE(e_expected, e_actual, "Encountered an unsuspected error condition!");
+
+    // ? The failed batch must not linger
+    TEST_ASSERT_EQUAL_UINT32(0, ring->num_ops);
+}
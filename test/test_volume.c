@@ -0,0 +1,149 @@
+#include "unity.h"
+#include "volume.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// ? These drive a real (small) backstore end to end, no nbd required
+
+#define VOLUME_DEVICE_NAME "device_volume-1"
+
+static char backstore_path[BLFS_BACKSTORE_FILENAME_MAXLEN];
+
+static char * argv_create[] = {
+    "progname",
+    "--default-password",
+    "--backstore-size",
+    "8",
+    "create",
+    VOLUME_DEVICE_NAME
+};
+
+static int argc_create = sizeof(argv_create) / sizeof(argv_create[0]);
+
+static int is_sudo()
+{
+    return !geteuid();
+}
+
+static void * trylock_first_nugget(void * volume)
+{
+    buselfs_state_t * buselfs_state = (buselfs_state_t *) volume;
+    int locked = blfs_trylock_nuggets(buselfs_state, 0, 0);
+
+    if(locked)
+        blfs_unlock_nuggets(buselfs_state, 0, 0);
+
+    return locked ? buselfs_state : NULL;
+}
+
+void setUp(void)
+{
+    if(BLFS_MANUAL_GV_FALLBACK == -1 && !is_sudo())
+    {
+        printf("Must be root!\n");
+        exit(255);
+    }
+
+    snprintf(backstore_path, sizeof backstore_path, BLFS_BACKSTORE_FILENAME, VOLUME_DEVICE_NAME);
+}
+
+void tearDown(void)
+{
+    unlink(backstore_path);
+}
+
+void test_blfs_volume_open_returns_null_on_bad_args(void)
+{
+    char * argv[] = {
+        "progname",
+        "cmd",
+        VOLUME_DEVICE_NAME
+    };
+
+    TEST_ASSERT_NULL(blfs_volume_open(3, argv));
+}
+
+void test_blfs_volume_rejects_out_of_bounds_requests(void)
+{
+    buselfs_state_t * volume = blfs_volume_open(argc_create, argv_create);
+    TEST_ASSERT_NOT_NULL(volume);
+
+    uint8_t buffer[4096] = { 0x00 };
+    uint64_t size = blfs_volume_size(volume);
+
+    TEST_ASSERT_EQUAL_INT(-EINVAL, blfs_volume_read(volume, buffer, sizeof buffer, size - 1));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, blfs_volume_write(volume, buffer, sizeof buffer, size));
+    TEST_ASSERT_EQUAL_INT(-EINVAL, blfs_volume_trim(volume, UINT64_MAX, 1));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_read(volume, buffer, sizeof buffer, size - sizeof buffer));
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_close(volume));
+}
+
+void test_blfs_volume_readwrite_flush_trim_works_as_expected(void)
+{
+    buselfs_state_t * volume = blfs_volume_open(argc_create, argv_create);
+    TEST_ASSERT_NOT_NULL(volume);
+
+    uint32_t nugget_size = volume->backstore->nugget_size_bytes;
+    uint8_t expected[3 * nugget_size];
+    uint8_t buffer[sizeof expected];
+
+    for(uint32_t i = 0; i < sizeof expected; i++)
+        expected[i] = (uint8_t) (i * 7);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_write(volume, expected, sizeof expected, 0));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_flush(volume));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_read(volume, buffer, sizeof buffer, 0));
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_trim(volume, nugget_size, nugget_size));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_write_zeroes(volume, 2 * nugget_size + 1, 10));
+    memset(expected + nugget_size, 0, nugget_size);
+    memset(expected + 2 * nugget_size + 1, 0, 10);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_read(volume, buffer, sizeof buffer, 0));
+
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, sizeof buffer);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_close(volume));
+}
+
+void test_blfs_volume_releases_locks_and_epoch_when_a_request_fails(void)
+{
+    buselfs_state_t * volume = blfs_volume_open(argc_create, argv_create);
+    TEST_ASSERT_NOT_NULL(volume);
+
+    uint32_t flake_size = volume->backstore->flake_size_bytes;
+    uint8_t buffer[flake_size];
+    uint8_t garbage[flake_size];
+
+    memset(buffer, 0xAB, sizeof buffer);
+    memset(garbage, 0x5A, sizeof garbage);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_write(volume, buffer, sizeof buffer, 0));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_flush(volume));
+
+    // ? Tamper with the first flake so that reading it (or rekeying its nugget
+    // ? to overwrite it) fails verification partway through the request
+    blfs_backstore_write_body(volume->backstore, garbage, sizeof garbage, 0);
+
+    TEST_ASSERT_EQUAL_INT(-EIO, blfs_volume_read(volume, buffer, sizeof buffer, 0));
+    TEST_ASSERT_EQUAL_INT(-EIO, blfs_volume_write(volume, buffer, sizeof buffer, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, volume->writes_in_flight);
+
+    // ? The nugget locks are recursive, so only another thread can tell
+    pthread_t thread;
+    void * result = NULL;
+
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, trylock_first_nugget, volume));
+    TEST_ASSERT_EQUAL_INT(0, pthread_join(thread, &result));
+    TEST_ASSERT_EQUAL_PTR(volume, result);
+
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_write(volume, buffer, sizeof buffer, volume->backstore->nugget_size_bytes));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_flush(volume));
+    TEST_ASSERT_EQUAL_INT(0, blfs_volume_close(volume));
+}
@@ -0,0 +1,226 @@
+/**
+ * Micro-benchmark for the NBD serving loop in vendor/buse.c.
+ *
+ * Plays the part of the kernel over a socketpair: keeps a fixed number of
+ * 4 KiB read or write requests in flight against an in-memory device and
+ * reports throughput along with the number of socket syscalls buse made per
+ * request. A last pair of phases writes sequentially with and without write
+ * merging, reporting how many backend writes each request cost. No nbd
+ * device, root, or backstore is needed.
+ *
+ * Build with `make busebench` from build/ (compiles buse.c with
+ * BUSE_COUNT_SYSCALLS), then e.g. `./busebench 100000 16 4`.
+ */
+
+#define _GNU_SOURCE
+
+#include "buse.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEVICE_SIZE (64U * 1024U * 1024U)
+#define BENCH_REQUEST_SIZE 4096U
+#define BENCH_MERGE_WINDOW (128U * 1024U)
+
+typedef struct bench_client_t
+{
+    int sk;
+    uint32_t type;
+    uint64_t num_requests;
+    uint32_t depth;
+    int sequential;
+} bench_client_t;
+
+static uint8_t * device;
+static uint64_t backend_writes;
+
+static uint64_t htonll_(uint64_t a)
+{
+    return ((uint64_t) htonl(a & 0xffffffff) << 32U) | htonl(a >> 32U);
+}
+
+static int bench_read(void * buf, u_int32_t len, u_int64_t offset, void * userdata)
+{
+    (void) userdata;
+    memcpy(buf, device + offset, len);
+    return 0;
+}
+
+static int bench_write(const void * buf, u_int32_t len, u_int64_t offset, void * userdata)
+{
+    (void) userdata;
+    memcpy(device + offset, buf, len);
+    __atomic_fetch_add(&backend_writes, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void read_exactly(int fd, void * buf, size_t count)
+{
+    while(count > 0)
+    {
+        ssize_t n = read(fd, buf, count);
+        assert(n > 0);
+        buf = (char *) buf + n;
+        count -= n;
+    }
+}
+
+static void write_exactly(int fd, const void * buf, size_t count)
+{
+    while(count > 0)
+    {
+        ssize_t n = write(fd, buf, count);
+        assert(n > 0);
+        buf = (const char *) buf + n;
+        count -= n;
+    }
+}
+
+static void send_request(bench_client_t * client, uint64_t index, const uint8_t * payload)
+{
+    struct nbd_request request;
+    uint64_t stride = client->sequential ? 1 : 7919U;
+    uint64_t offset = (index * stride * BENCH_REQUEST_SIZE) % BENCH_DEVICE_SIZE;
+
+    memset(&request, 0, sizeof request);
+    request.magic = htonl(NBD_REQUEST_MAGIC);
+    request.type = htonl(client->type);
+    request.from = htonll_(offset);
+    request.len = htonl(BENCH_REQUEST_SIZE);
+    memcpy(request.handle, &index, sizeof index);
+
+    write_exactly(client->sk, &request, sizeof request);
+
+    if(client->type == NBD_CMD_WRITE)
+        write_exactly(client->sk, payload, BENCH_REQUEST_SIZE);
+}
+
+static void * client_main(void * arg)
+{
+    bench_client_t * client = arg;
+    uint8_t payload[BENCH_REQUEST_SIZE];
+    uint64_t sent = 0;
+    uint64_t received = 0;
+
+    memset(payload, 0xAB, sizeof payload);
+
+    for(; sent < client->depth && sent < client->num_requests; ++sent)
+        send_request(client, sent, payload);
+
+    while(received < client->num_requests)
+    {
+        struct nbd_reply reply;
+
+        read_exactly(client->sk, &reply, sizeof reply);
+        assert(reply.magic == htonl(NBD_REPLY_MAGIC));
+        assert(reply.error == 0);
+
+        if(client->type == NBD_CMD_READ)
+            read_exactly(client->sk, payload, BENCH_REQUEST_SIZE);
+
+        received++;
+
+        if(sent < client->num_requests)
+            send_request(client, sent++, payload);
+    }
+
+    struct nbd_request disc;
+
+    memset(&disc, 0, sizeof disc);
+    disc.magic = htonl(NBD_REQUEST_MAGIC);
+    disc.type = htonl(NBD_CMD_DISC);
+    write_exactly(client->sk, &disc, sizeof disc);
+
+    return NULL;
+}
+
+static void run(const char * label,
+                uint32_t type,
+                int sequential,
+                uint32_t merge_window,
+                uint64_t num_requests,
+                uint32_t depth,
+                uint32_t workers)
+{
+    int sp[2];
+    pthread_t client_thread;
+    struct timespec start, end;
+    struct buse_operations aop;
+    bench_client_t client = { 0, type, num_requests, depth, sequential };
+
+    int err = socketpair(AF_UNIX, SOCK_STREAM, 0, sp);
+    assert(!err);
+
+    memset(&aop, 0, sizeof aop);
+    aop.read = bench_read;
+    aop.write = bench_write;
+    aop.size = BENCH_DEVICE_SIZE;
+    aop.workers = workers;
+    aop.merge_window = merge_window;
+
+    client.sk = sp[1];
+    buse_socket_syscalls = 0;
+    backend_writes = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    err = pthread_create(&client_thread, NULL, client_main, &client);
+    assert(!err);
+
+    buse_serve(sp[0], &aop, NULL, 0);
+    pthread_join(client_thread, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%-6s %10lu requests  %8.3f s  %10.0f IOPS  %5.2f socket syscalls/request",
+           label,
+           (unsigned long) num_requests,
+           elapsed,
+           num_requests / elapsed,
+           (double) buse_socket_syscalls / num_requests);
+
+    if(type == NBD_CMD_WRITE)
+        printf("  %5.2f backend writes/request", (double) backend_writes / num_requests);
+
+    printf("\n");
+
+    close(sp[0]);
+    close(sp[1]);
+}
+
+int main(int argc, char * argv[])
+{
+    uint64_t num_requests = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+    uint32_t depth        = argc > 2 ? strtoul(argv[2], NULL, 10) : 16;
+    uint32_t workers      = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+
+    if(!num_requests || !depth)
+    {
+        printf("\nUsage:\n  %s [num_requests 100000] [queue_depth 16] [workers 4]\n\n", argv[0]);
+        return 1;
+    }
+
+    device = calloc(BENCH_DEVICE_SIZE, 1);
+    assert(device);
+
+    printf("%u byte requests, queue depth %"PRIu32", %"PRIu32" worker(s)\n", BENCH_REQUEST_SIZE, depth, workers);
+
+    run("write", NBD_CMD_WRITE, 0, 0, num_requests, depth, workers);
+    run("read", NBD_CMD_READ, 0, 0, num_requests, depth, workers);
+    run("seqwr", NBD_CMD_WRITE, 1, 0, num_requests, depth, workers);
+    run("merged", NBD_CMD_WRITE, 1, BENCH_MERGE_WINDOW, num_requests, depth, workers);
+
+    free(device);
+    return 0;
+}
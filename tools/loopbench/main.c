@@ -0,0 +1,193 @@
+/**
+ * Loopback frontend: benchmarks a StrongBox volume through the in-process
+ * block API (src/volume.h) instead of through nbd, so it runs without root,
+ * the nbd module, or /dev/nbdX.
+ *
+ * Creates a fresh backstore with whatever switchcrypt options follow `--`,
+ * then has a number of threads issue random writes (followed by one flush)
+ * and then random reads against it, reporting throughput and per-request
+ * latency for each phase.
+ *
+ * Build with `make loopbench` from build/, then e.g.
+ * `./loopbench 20000 4096 4 -- --default-password --backstore-size 256 create loop0`.
+ */
+
+#include "volume.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct loopbench_thread_t
+{
+    buselfs_state_t * volume;
+    int is_write;
+    uint64_t num_requests;
+    uint32_t request_size;
+    uint32_t seed;
+    uint64_t * latencies_ns;
+} loopbench_thread_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static void * thread_main(void * arg)
+{
+    loopbench_thread_t * thread = arg;
+    uint64_t num_slots = blfs_volume_size(thread->volume) / thread->request_size;
+    uint8_t * buffer = malloc(thread->request_size);
+
+    assert(buffer);
+    memset(buffer, 0xAB, thread->request_size);
+
+    for(uint64_t i = 0; i < thread->num_requests; i++)
+    {
+        uint64_t offset = (rand_r(&thread->seed) % num_slots) * thread->request_size;
+        uint64_t start = now_ns();
+
+        int err = thread->is_write
+                ? blfs_volume_write(thread->volume, buffer, thread->request_size, offset)
+                : blfs_volume_read(thread->volume, buffer, thread->request_size, offset);
+
+        thread->latencies_ns[i] = now_ns() - start;
+
+        assert(!err);
+        (void) err;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+static int compare_u64(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void run(const char * label,
+                buselfs_state_t * volume,
+                int is_write,
+                uint64_t num_requests,
+                uint32_t request_size,
+                uint32_t num_threads)
+{
+    pthread_t tids[num_threads];
+    loopbench_thread_t threads[num_threads];
+    uint64_t * latencies_ns = malloc(num_requests * sizeof *latencies_ns);
+    uint64_t assigned = 0;
+
+    assert(latencies_ns);
+
+    uint64_t start = now_ns();
+
+    for(uint32_t i = 0; i < num_threads; i++)
+    {
+        uint64_t share = num_requests / num_threads + (i < num_requests % num_threads);
+
+        threads[i] = (loopbench_thread_t) {
+            volume, is_write, share, request_size, 0x5EED + i, latencies_ns + assigned
+        };
+
+        assigned += share;
+
+        int err = pthread_create(tids + i, NULL, thread_main, threads + i);
+        assert(!err);
+        (void) err;
+    }
+
+    for(uint32_t i = 0; i < num_threads; i++)
+        pthread_join(tids[i], NULL);
+
+    uint64_t flush_ns = 0;
+
+    if(is_write)
+    {
+        uint64_t flush_start = now_ns();
+        int err = blfs_volume_flush(volume);
+        assert(!err);
+        (void) err;
+        flush_ns = now_ns() - flush_start;
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+
+    qsort(latencies_ns, num_requests, sizeof *latencies_ns, compare_u64);
+
+    printf("%-6s %9"PRIu64" requests  %8.3f s  %9.0f IOPS  %8.2f MiB/s  "
+           "latency us: p50 %8.1f  p99 %8.1f  max %9.1f",
+           label,
+           num_requests,
+           elapsed,
+           num_requests / elapsed,
+           num_requests * (double) request_size / elapsed / (1024 * 1024),
+           latencies_ns[num_requests / 2] / 1e3,
+           latencies_ns[num_requests * 99 / 100] / 1e3,
+           latencies_ns[num_requests - 1] / 1e3);
+
+    if(is_write)
+        printf("  (flush %.1f ms)", flush_ns / 1e6);
+
+    printf("\n");
+
+    free(latencies_ns);
+}
+
+int main(int argc, char * argv[])
+{
+    int separator = 1;
+
+    while(separator < argc && strcmp(argv[separator], "--") != 0)
+        separator++;
+
+    if(separator != 4 || separator + 1 >= argc)
+    {
+        printf("\nUsage:\n  %s num_requests request_size threads -- [switchcrypt options] create name\n\n"
+               "Example: %s 20000 4096 4 -- --default-password --backstore-size 256 create loop0\n\n",
+               argv[0], argv[0]);
+        return 1;
+    }
+
+    uint64_t num_requests = strtoull(argv[1], NULL, 10);
+    uint32_t request_size = strtoul(argv[2], NULL, 10);
+    uint32_t num_threads  = strtoul(argv[3], NULL, 10);
+
+    if(!num_requests || !request_size || !num_threads)
+    {
+        printf("num_requests, request_size, and threads must all be non-zero\n");
+        return 1;
+    }
+
+    // ? Hand the volume an argv of its own, program name included
+    argv[separator] = argv[0];
+
+    buselfs_state_t * volume = blfs_volume_open(argc - separator, argv + separator);
+
+    if(volume == NULL)
+        return 1;
+
+    if(request_size > blfs_volume_size(volume))
+    {
+        printf("request_size is larger than the volume\n");
+        blfs_volume_close(volume);
+        return 1;
+    }
+
+    printf("%"PRIu32" byte requests, %"PRIu32" thread(s), %"PRIu64" byte volume\n",
+           request_size, num_threads, blfs_volume_size(volume));
+
+    run("write", volume, 1, num_requests, request_size, num_threads);
+    run("read", volume, 0, num_requests, request_size, num_threads);
+
+    return blfs_volume_close(volume) ? 1 : 0;
+}